@@ -26,6 +26,10 @@ namespace PeterDB {
     const int32_t ERR_DELETE_FILE = 107;
     const int32_t ERR_APPEND_PAGE = 109;
     const int32_t ERR_CREATE_FILE = 110;
+    const int32_t ERR_BUFFER_POOL_FULL = 111;
+    const int32_t ERR_PAGE_NOT_PINNED = 112;
+    const int32_t ERR_NO_FREE_PAGE = 113;
+    const int32_t ERR_WRITE_LOG = 114;
 
     /*
      * Record Based File System
@@ -42,6 +46,8 @@ namespace PeterDB {
     const int32_t ERR_ATTRIBUTE_NOT_SUPPORT = 207;
     const int32_t ERR_RECORD_NOT_FOUND = 208;
     const int32_t ERR_RECORD_NULL = 209;
+    const int32_t ERR_PAGE_READ_ONLY = 210;
+    const int32_t ERR_RECORD_TOO_LARGE = 211;
 
     /*
      * Relation Model
@@ -58,6 +64,10 @@ namespace PeterDB {
     const int32_t ERR_ACCESS_DENIED_SYS_TABLE = 307;
     const int32_t ERR_ATTR_NOT_EXIST = 308;
     const int32_t ERR_INDEX_NOT_EXIST = 309;
+    const int32_t ERR_FILE_NOT_CACHED = 310;
+    const int32_t ERR_CACHE_SIZE_INVALID = 311;
+    const int32_t ERR_INDEX_NAME_TOO_LONG = 312;
+    const int32_t ERR_INDEX_ATTR_NAME_INVALID = 313;
 
     /*
      * Index Manager
@@ -76,6 +86,10 @@ namespace PeterDB {
     const int32_t ERR_INDEXPAGE_LAST_CHILD_NOT_EXIST = 410;
     const int32_t ERR_LEAF_NOT_FOUND = 411;
     const int32_t ERR_LEAFNODE_ENTRY_NOT_EXIST = 412;
+    const int32_t ERR_FILE_VERSION_NOT_SUPPORT = 413;
+    const int32_t ERR_INDEX_NOT_EMPTY = 414;
+    const int32_t ERR_BULKLOAD_RUN = 415;
+    const int32_t ERR_LEAF_CHANGED = 416;
 
     /*
      * Query Engine
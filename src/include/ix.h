@@ -4,6 +4,9 @@
 #include <vector>
 #include <string>
 #include <queue>
+#include <memory>
+#include <condition_variable>
+#include <unordered_map>
 
 #include "pfm.h"
 #include "rbfm.h" // for some type declarations only, e.g., RID and Attribute
@@ -19,30 +22,104 @@ namespace PeterDB {
         const int32_t FILE_COUNTER_LEN = 4;
         const int32_t FILE_ROOTPAGE_PTR_LEN = 4;
         const int32_t FILE_ROOT_LEN = 4;
+        const int32_t FILE_VERSION_LEN = 4;
+        const int32_t FILE_FREE_PAGE_PTR_LEN = 4;
+
+        // IX File Format Version, files written before the version field read as 0
+        const uint32_t FILE_VERSION_LINEAR = 1;         // Entries are searched linearly
+        const uint32_t FILE_VERSION_SLOTTED = 2;        // Pages keep a slot array for binary search
+        const uint32_t FILE_VERSION_POSTING = 3;        // Leaf entries keep each key once with its rid list
+        const uint32_t FILE_VERSION_PREFIX = 4;         // Separators are cut short, index pages keep their common prefix once
+        const uint32_t FILE_VERSION_CURRENT = FILE_VERSION_PREFIX;
 
         // IX Page Common
         const int16_t PAGE_TYPE_LEN = 2;
         const int16_t PAGE_TYPE_UNKNOWN = 0;
         const int16_t PAGE_TYPE_INDEX = 1;
         const int16_t PAGE_TYPE_LEAF = 2;
+        const int16_t PAGE_TYPE_OVERFLOW = 3;
+        const int16_t PAGE_TYPE_FREE = 4;
         const int16_t PAGE_FREEBYTE_PTR_LEN = 2;
         const int16_t PAGE_COUNTER_LEN = 2;
         const int16_t PAGE_RID_PAGE_LEN = 4;
         const int16_t PAGE_RID_SLOT_LEN = 2;
         const int16_t PAGE_RID_LEN = PAGE_RID_PAGE_LEN + PAGE_RID_SLOT_LEN;
+        const int16_t PAGE_SLOT_LEN = 2;
 
         // Index Page
         const int16_t INDEXPAGE_CHILD_PTR_LEN = 4;
+        const int16_t INDEXPAGE_PREFIX_SIZE_LEN = 2;    // Key prefix below the header: prefix | prefix size
 
         // Leaf Page
         const int16_t LEAFPAGE_NEXT_PTR_LEN = 4;
 
+        // Posting List, leaf entry: key | rid number | rids, or key | POSTING_OVERFLOW | head page | tail page
+        const int16_t POSTING_RID_NUM_LEN = 2;
+        const int16_t POSTING_OVERFLOW = -1;
+        const int16_t POSTING_OVERFLOW_PTR_LEN = 4;
+        const int16_t POSTING_INLINE_MAX_LEN = PAGE_SIZE / 4;   // Longer rid lists move to overflow pages
+        const RID POSTING_ROUTE_RID = {UINT32_MAX, UINT16_MAX}; // Routes a key to the leaf holding its entry
+
+        // Overflow Page, sorted rids of one key
+        const int16_t OVERFLOWPAGE_NEXT_PTR_LEN = 4;
+
         // Page Pointer
         const uint32_t PAGE_PTR_NULL = 0;
+
+        // Free Page, the next free page is kept at the page begin
+        const int16_t FREEPAGE_NEXT_PTR_LEN = 4;
+
+        // Bulk Load
+        const float BULKLOAD_FILL_FACTOR_DEFAULT = 0.9;                 // Share of a page filled by entries
+        const uint64_t BULKLOAD_MEMORY_BUDGET_DEFAULT = 64 * 1024 * 1024;  // Entries sorted in memory per run
+        const char* const BULKLOAD_RUN_DIR_NAME = ".sort";                 // Next to the index file, holds spilled runs
+
+        // Composite Key, every attribute is a null flag and its value
+        const uint8_t COMPKEY_NULL = 0;                 // Nulls go before any value
+        const uint8_t COMPKEY_NOT_NULL = 1;
+        const uint8_t COMPKEY_STR_ESCAPE = 0;           // Zero bytes in strings are followed by 0xFF, strings end with 0x00 0x01
+        const uint8_t COMPKEY_STR_ESCAPED_ZERO = 0xFF;
+        const uint8_t COMPKEY_STR_END = 1;
+        const uint8_t COMPKEY_PREFIX_END = 0xFF;        // Above any attribute after a key prefix
     }
 
     class IX_ScanIterator;
 
+    class IX_BulkLoader;
+
+    // Reader/writer latch, waiting writers keep new readers out
+    class RWLatch {
+    public:
+        RWLatch();
+
+        void lock();
+        void unlock();
+        void lock_shared();
+        void unlock_shared();
+    private:
+        std::mutex latchMutex;
+        std::condition_variable latchChanged;
+        uint32_t readerNum;
+        uint32_t waitingWriterNum;
+        bool isWriting;
+    };
+
+    class SharedLatchGuard {
+    public:
+        explicit SharedLatchGuard(RWLatch& latch);
+        ~SharedLatchGuard();
+        SharedLatchGuard(const SharedLatchGuard &) = delete;
+        SharedLatchGuard &operator=(const SharedLatchGuard &) = delete;
+    private:
+        RWLatch& latch;
+    };
+
+    // Latch of one page, the version is bumped whenever entries of the leaf move in place
+    struct IXPageLatch {
+        RWLatch latch;
+        uint32_t version = 0;
+    };
+
     class IXFileHandle;
 
     class IndexManager {
@@ -66,6 +143,9 @@ namespace PeterDB {
         RC insertEntry(IXFileHandle &ixFileHandle, const Attribute &attr, const void *key, const RID &rid);
         RC insertEntryRecur(IXFileHandle &ixFileHandle, uint32_t pageNum, const Attribute &attr, const uint8_t *keyToInsert, const RID &ridToInsert,
                             uint8_t* middleKey, uint32_t& newChildPage, bool& isNewChildExist);
+        // Insert entries sorted as composite keys, each a key followed by its rid as in leaf pages
+        // Consecutive entries going into the same leaf are inserted under one descent
+        RC insertEntries(IXFileHandle &ixFileHandle, const Attribute &attr, const std::vector<const uint8_t*>& entries);
 
         // Delete an entry from the given index that is indicated by the given ixFileHandle.
         RC deleteEntry(IXFileHandle &ixFileHandle, const Attribute &attribute, const void *key, const RID &rid);
@@ -80,6 +160,8 @@ namespace PeterDB {
                 IX_ScanIterator &ix_ScanIterator);
 
         RC findTargetLeafNode(IXFileHandle &ixFileHandle, uint32_t& leafPageNum, const uint8_t* key, const RID& rid, const Attribute& attr);
+        // Pages from the root down to the target leaf
+        RC findTargetPath(IXFileHandle &ixFileHandle, std::vector<uint32_t>& path, const uint8_t* key, const RID& rid, const Attribute& attr);
 
         // Print the B+ tree in pre-order (in a JSON record format)
         RC printBTree(IXFileHandle &ixFileHandle, const Attribute &attribute, std::ostream &out) const;
@@ -90,6 +172,18 @@ namespace PeterDB {
         IndexManager &operator=(const IndexManager &) = default;                    // Prevent assignment
     private:
         bool isFileExists(std::string fileName);
+
+        // Entries going into a leaf with enough space, or out of it, only latch the leaf
+        // Other changes hold the tree latch exclusively, they may split, merge or free any page
+        RC insertEntryInLeaf(IXFileHandle &ixFileHandle, const Attribute &attr, const uint8_t *key, const RID &rid, bool& isInserted);
+        RC insertEntryInTree(IXFileHandle &ixFileHandle, const Attribute &attr, const uint8_t *key, const RID &rid);
+        RC insertEntriesInLeaf(IXFileHandle &ixFileHandle, const Attribute &attr, const std::vector<const uint8_t*>& entries,
+                               uint32_t first, uint32_t& insertedNum);
+        RC deleteEntryInLeaf(IXFileHandle &ixFileHandle, const Attribute &attr, const uint8_t *key, const RID &rid, bool& isDeleted, bool& isUnderflow);
+        RC deleteEntryInTree(IXFileHandle &ixFileHandle, const Attribute &attr, const uint8_t *key, const RID &rid, bool isDeleted);
+
+        // Merge or redistribute underflowing pages on the path bottom-up, then shrink the root
+        RC fixUnderflow(IXFileHandle &ixFileHandle, const std::vector<uint32_t>& path, const Attribute& attr);
     };
 
     class IXFileHandle {
@@ -99,28 +193,61 @@ namespace PeterDB {
         unsigned ixWritePageCounter;
         unsigned ixAppendPageCounter;
 
+        // Counters are persisted every metaDataFlushInterval page operations
+        uint32_t metaDataFlushInterval;
+        uint32_t metaDataDirtyOps;
+
         std::string fileName;
-        std::fstream* fs;
+        uint64_t fileId;                // Key of this file in the buffer pool
+        StorageBackend* backend;
 
         uint32_t rootPagePtr;
         uint32_t root;
+
+        uint32_t formatVersion;         // Page format of the file, see IX::FILE_VERSION_*
+
+        uint32_t freePageHead;          // Pages left by merges, reused before the file grows
+        uint32_t structureVersion;      // Bumped when entries move between pages or pages are freed
+
+        // Scans and changes within one leaf hold the tree latch shared, splits and merges hold it exclusively
+        // Pages are read under their own latch, leaves are changed under it
+        RWLatch treeLatch;
+        std::mutex pageLatchMutex;
+        std::unordered_map<uint32_t, std::unique_ptr<IXPageLatch>> pageLatches;
+        std::recursive_mutex metaDataMutex;     // Counters, page number and free page list
     public:
         IXFileHandle();
         ~IXFileHandle();
 
         RC open(const std::string& filename);
         RC close();
+        RC checkpoint();                                // Persist counters and dirty pages, takes the tree latch exclusively
+        RC checkpointIfLogFull();                       // Called only while no latch of the file is held
+        void setMetaDataFlushInterval(uint32_t interval);   // 0: only at close or checkpoint
 
         RC readPage(uint32_t pageNum, void* data);
         RC writePage(uint32_t pageNum, const void* data);
         RC appendPage(const void* data);
-        RC appendEmptyPage();
+        RC appendPages(const void* data, uint32_t pageCount);     // Written through, not cached
+        // Reuse a free page if there is one, otherwise append a new page
+        RC appendEmptyPage(uint32_t& pageNum);
+        RC freePage(uint32_t pageNum);
+
+        // Pin the page in the buffer pool and access its frame directly, counted as a page read
+        // A new page is not loaded from disk and not counted
+        RC pinPage(uint32_t pageNum, uint8_t*& frameData, bool isNewPage = false);
+        RC unpinPage(uint32_t pageNum, bool isDirty);
 
         // Put the current counter values of associated PF FileHandles into variables
         RC collectCounterValues(unsigned &readPageCount, unsigned &writePageCount, unsigned &appendPageCount);
 
+        // The hidden page and the root page go through the buffer pool, so they are logged like any page
+        RC readMetaPage(uint32_t pageNum, void* data, uint32_t len);
+        RC writeMetaPage(uint32_t pageNum, const void* data, uint32_t len);
         RC readMetaData();
         RC flushMetaData();
+        RC markMetaDataDirty();
+        RC syncAndDropLog(uint64_t flushedLsn);         // Records up to flushedLsn have to be written back first
 
         RC createRootPage();
 
@@ -137,6 +264,11 @@ namespace PeterDB {
 
         uint32_t getPageCounter();
         uint32_t getLastPageIndex();
+
+        uint32_t getFormatVersion();
+        uint32_t getStructureVersion();
+
+        IXPageLatch& getPageLatch(uint32_t pageNum);
     };
 
     class IXPageHandle {
@@ -148,17 +280,26 @@ namespace PeterDB {
         int16_t freeBytePtr;
         int16_t counter;
 
-        uint8_t data[PAGE_SIZE] = {};
-        uint8_t origin[PAGE_SIZE] = {};
+        uint8_t* data;                      // Pinned frame in the buffer pool, or a private empty page if pin fails
+        RC pinStatus;
+        bool isPinned;
+        bool isDataOwned;
+        bool isDirty;                       // Set by every change to data, decides the write back on unpin
     public:
         // Existed page
         IXPageHandle(IXFileHandle& fileHandle, uint32_t page);
         // New page with data
         IXPageHandle(IXFileHandle& fileHandle, uint8_t* newData, int16_t dataLen, uint32_t page, int16_t type, int16_t freeByte, int16_t counter);
+        // New page with data, built in the caller's page buffer instead of the buffer pool
+        IXPageHandle(IXFileHandle& fileHandle, uint8_t* pageBuffer, uint8_t* newData, int16_t dataLen, uint32_t page, int16_t type, int16_t counter);
         // New Page
         IXPageHandle(IXFileHandle& fileHandle, uint32_t page, int16_t type, int16_t freeByte, int16_t counter);
         ~IXPageHandle();
 
+        // Result of pinning the page, the handle must not be used unless it is 0
+        // Changes to the private page of a failed pin are never written anywhere
+        RC getPinStatus();
+
         bool isOpen();
         bool isTypeIndex();
         bool isTypeLeaf();
@@ -166,19 +307,49 @@ namespace PeterDB {
         bool isCompositeKeyMeetCompCondition(const uint8_t* key1, const RID& rid1, const uint8_t* key2, const RID& rid2, const Attribute& attr, const CompOp op);
         bool isKeyMeetCompCondition(const uint8_t* key1, const uint8_t* key2, const Attribute& attr, const CompOp op);
         bool isRidMeetCompCondition(const RID& rid1, const RID& rid2, const CompOp op);
+        bool isCompResultMeetCompOp(int compResult, const CompOp op);
+
+        // Negative, zero or positive as the first one is less than, equal to or greater than the second
+        static int compareKey(const uint8_t* key1, const uint8_t* key2, const Attribute& attr);
+        static int compareRid(const RID& rid1, const RID& rid2);
+        static int compareCompositeKey(const uint8_t* compKey1, const uint8_t* compKey2, const Attribute& attr);
 
         RC shiftRecordLeft(int16_t dataNeedShiftStartPos, int16_t dist);
         RC shiftRecordRight(int16_t dataNeedMoveStartPos, int16_t dist);
 
     public:
-        int16_t getKeyLen(const uint8_t* key, const Attribute &attr);
-        int32_t getKeyInt(const uint8_t* key);
-        float getKeyReal(const uint8_t* key);
+        static int16_t getKeyLen(const uint8_t* key, const Attribute &attr);
+        static int32_t getKeyInt(const uint8_t* key);
+        static float getKeyReal(const uint8_t* key);
         std::string getKeyString(const uint8_t* key);
 
         int16_t getHeaderLen();
         void flushHeader();
 
+        // Slot array: offset of each entry in key order, growing down from the page header
+        // Only pages of slotted files have one, other pages are searched linearly
+        bool hasSlotArray();
+        int16_t getSlotLen();
+        int16_t getSlot(int16_t index);
+        void setSlot(int16_t index, int16_t entryPos);
+        int16_t getSlotIndex(int16_t entryPos);
+        void insertSlot(int16_t index, int16_t entryPos, int16_t entryLen);
+        void deleteSlot(int16_t index, int16_t entryLen);
+        void resizeSlot(int16_t index, int16_t dist);
+
+        // Leaves of posting files keep each key once, followed by its sorted rids
+        bool hasPostingList();
+        // Index pages of prefix files keep the common prefix of their keys once, below the header
+        bool hasKeyPrefix();
+    protected:
+        int16_t getSlotOffset(int16_t index);
+        int16_t getKeyPrefixAreaLen();
+    public:
+
+    protected:
+        void pinPage(bool isNewPage);
+    public:
+
         int16_t getPageType();
         void setPageType(int16_t type);
 
@@ -194,7 +365,16 @@ namespace PeterDB {
         int16_t getCounter();
         void setCounter(int16_t counter);
 
-        void getRid(const uint8_t* keyData, const Attribute& attr, RID& rid);
+        static void getRid(const uint8_t* keyData, const Attribute& attr, RID& rid);
+        static void readRid(const uint8_t* ridData, RID& rid);
+        static void writeRid(uint8_t* ridData, const RID& rid);
+        // Index of the first rid not less than the given one in a sorted rid list
+        static int16_t findRidIndex(const uint8_t* ridData, int16_t ridNum, const RID& rid);
+
+        // Number of leading bytes two VarChar keys share
+        static int16_t getCommonPrefixLen(const uint8_t* key1, const uint8_t* key2);
+        // Shortest composite key greater than the left key and not greater than the right one, with a zero rid
+        static void getShortestSeparator(uint8_t* separator, const uint8_t* leftKey, const uint8_t* rightKey, const Attribute& attr);
 
     protected:
         int16_t getPageTypeFromData();
@@ -210,6 +390,8 @@ namespace PeterDB {
         IndexPageHandle(IXFileHandle& fileHandle, uint32_t page, uint32_t leftPage, uint8_t* key, uint32_t rightPage, const Attribute &attr);
         // Initialize new page with existing entries
         IndexPageHandle(IXFileHandle& fileHandle, uint32_t page, uint8_t* entryData, int16_t dataLen, int16_t entryCounter);
+        // Initialize new page with existing entries in the caller's page buffer
+        IndexPageHandle(IXFileHandle& fileHandle, uint8_t* pageBuffer, uint32_t page, uint8_t* entryData, int16_t dataLen, int16_t entryCounter);
         ~IndexPageHandle();
 
         // Get target child page, if not exist, append one
@@ -221,11 +403,39 @@ namespace PeterDB {
         RC writeIndex(int16_t pos, const uint8_t* key, const RID& rid, const Attribute& attr, uint32_t newPageNum);
 
         RC splitPageAndInsertIndex(uint8_t * middleCompKey, uint32_t & newIndexPage, const uint8_t* keyToInsert, const RID& ridToInsert, const Attribute& attr, uint32_t childPtrToInsert);
+        RC splitPrefixPageAndInsertIndex(uint8_t * middleCompKey, uint32_t & newIndexPage, const uint8_t* keyToInsert, const RID& ridToInsert, const Attribute& attr, uint32_t childPtrToInsert);
+
+        // Underflow, the right sibling is merged into this page or entries move over, the parent is updated
+        bool isUnderflow();
+        RC mergeOrRedistribute(IndexPageHandle& rightPH, IndexPageHandle& parentPH, int16_t keyIndex, bool& isMerged, const Attribute& attr);
+        uint32_t getChild(int16_t index, const Attribute& attr);
+        int16_t findChildIndex(uint32_t childPage, const Attribute& attr);
+        RC getKey(int16_t index, uint8_t* compKey, const Attribute& attr);       // Composite key with the page prefix
+        RC replaceKey(int16_t index, const uint8_t* compKey, const Attribute& attr);
+        RC deleteIndex(int16_t index, const Attribute& attr);                   // Removes the key and its right child
 
         RC print(const Attribute &attr, std::ostream &out);
 
+        void rebuildSlots(const Attribute& attr);
+
+        // Entries with full keys: child | key | rid | child | ..., keys are stripped of the page prefix when set
+        RC getEntries(std::vector<uint8_t>& entryData, const Attribute& attr);
+        RC setEntries(const uint8_t* entryData, int32_t dataLen, int16_t entryCounter, const Attribute& attr);
+        void getKeyPositions(const std::vector<uint8_t>& entryData, int16_t entryCounter, std::vector<int32_t>& keyPos, const Attribute& attr);
+        // Key to push up so that keys on both sides fill two pages evenly, -1 if they do not fit
+        int16_t findBalancedMiddleKey(const std::vector<uint8_t>& entryData, const std::vector<int32_t>& keyPos, const Attribute& attr);
+
+        // Key prefix shared by all keys of the page, empty for pages without one
+        int16_t getKeyPrefixLen();
+        void setKeyPrefix(const uint8_t* prefix, int16_t prefixLen);
+        // Negative, zero or positive as the key is below, starts with or is above the page prefix
+        int compareKeyPrefix(const uint8_t* key);
+        void stripKeyPrefix(uint8_t* strippedKey, const uint8_t* key);
+        RC insertIndexWithNewPrefix(const uint8_t* key, const RID& rid, const Attribute& attr, uint32_t childPage);
+
         int16_t getCompositeKeyLen(const uint8_t* key, const Attribute& attr);
         int16_t getEntryLen(const uint8_t* key, const Attribute& attr);
+        int16_t getInsertLen(const uint8_t* key, const Attribute& attr);
 
         bool hasEnoughSpace(const uint8_t* key, const Attribute &attr);
         int16_t getIndexHeaderLen();
@@ -243,6 +453,8 @@ namespace PeterDB {
         LeafPageHandle(IXFileHandle& fileHandle, uint32_t page, uint32_t next);
         // For split page
         LeafPageHandle(IXFileHandle& fileHandle, uint32_t page, uint32_t next, uint8_t* entryData, int16_t dataLen, int16_t entryCounter);
+        // For bulk loaded page in the caller's page buffer
+        LeafPageHandle(IXFileHandle& fileHandle, uint8_t* pageBuffer, uint32_t page, uint32_t next, uint8_t* entryData, int16_t dataLen, int16_t entryCounter);
         ~LeafPageHandle();
 
         RC insertEntry(const uint8_t* key, const RID& entry, const Attribute& attr, uint8_t* middleKey, uint32_t& newChild, bool& isNewChildExist);
@@ -253,14 +465,44 @@ namespace PeterDB {
 
         RC deleteEntry(const uint8_t* key, const RID& entry, const Attribute& attr);
 
+        // The entry fits in this page and no other page has to change
+        bool canInsertInPlace(const uint8_t* key, const Attribute& attr);
+        bool canDeleteInPlace(const uint8_t* key, const Attribute& attr);
+        // Some key in this page is greater, so the key belongs to this page whatever its rid
+        bool hasGreaterKey(const uint8_t* key, const Attribute& attr);
+
         RC getFirstCompKey(uint8_t* compKeyData, const Attribute& attr);
 
         RC splitPageAndInsertEntry(uint8_t* middleKey, uint32_t& newLeafPage, const uint8_t* key, const RID& rid, const Attribute& attr);
 
+        // Underflow, the right sibling is merged into this page or entries move over, the parent is updated
+        bool isUnderflow();
+        RC mergeOrRedistribute(LeafPageHandle& rightPH, IndexPageHandle& parentPH, int16_t keyIndex, bool& isMerged, const Attribute& attr);
+
+        // Posting list
+        RC insertPosting(const uint8_t* key, const RID& rid, const Attribute& attr, uint8_t* middleKey, uint32_t& newChild, bool& isNewChildExist);
+        RC insertPostingWithEnoughSpace(const uint8_t* key, const RID& rid, const Attribute& attr);
+        RC deletePosting(const uint8_t* key, const RID& rid, const Attribute& attr);
+        RC splitPageAndInsertPosting(uint8_t* middleKey, uint32_t& newLeafPage, const uint8_t* key, const RID& rid, const Attribute& attr);
+        RC findPosting(int16_t& pos, bool& isFound, const uint8_t* key, const Attribute& attr);
+        int16_t getPostingInsertLen(const uint8_t* key, const Attribute& attr);    // Bytes the page grows by
+        bool isPostingSpill(int16_t pos, const Attribute& attr);
+        RC spillPosting(int16_t pos, const RID& rid, const Attribute& attr);
+
+        int16_t getPostingRidNum(int16_t pos, const Attribute& attr);   // IX::POSTING_OVERFLOW if in overflow pages
+        void setPostingRidNum(int16_t pos, int16_t ridNum, const Attribute& attr);
+        void getPostingOverflowPtrs(int16_t pos, uint32_t& head, uint32_t& tail, const Attribute& attr);
+        void setPostingOverflowPtrs(int16_t pos, uint32_t head, uint32_t tail, const Attribute& attr);
+        RC insertOverflowRid(int16_t pos, const RID& rid, const Attribute& attr);
+        RC deleteOverflowRid(int16_t pos, const RID& rid, bool& isChainEmpty, const Attribute& attr);
+
         RC print(const Attribute &attr, std::ostream &out);
+        RC printPosting(const Attribute &attr, std::ostream &out);
+
+        void rebuildSlots(const Attribute& attr);
 
         bool hasEnoughSpace(const uint8_t* key, const Attribute& attr);
-        int16_t getEntryLen(const uint8_t* key, const Attribute& attr);
+        int16_t getEntryLen(const uint8_t* key, const Attribute& attr);     // Stored entry in posting files
 
         // For Scan
         int16_t getNextEntryPos(int16_t curEntryPos, const Attribute &attr);
@@ -279,6 +521,36 @@ namespace PeterDB {
         void setNextPtr(uint32_t next);
     };
 
+    // Chained page of sorted rids of one key whose posting list outgrew the leaf
+    // Rids are packed from the page begin, every page in the chain is non-empty
+    class OverflowPageHandle: public IXPageHandle {
+    public:
+        uint32_t nextPtr;
+    public:
+        // Open existed page
+        OverflowPageHandle(IXFileHandle& fileHandle, uint32_t page);
+        // Initialize new page with sorted rids
+        OverflowPageHandle(IXFileHandle& fileHandle, uint32_t page, uint32_t next, uint8_t* ridData, int16_t ridNum);
+        // Initialize new page with sorted rids in the caller's page buffer
+        OverflowPageHandle(IXFileHandle& fileHandle, uint8_t* pageBuffer, uint32_t page, uint32_t next, uint8_t* ridData, int16_t ridNum);
+        ~OverflowPageHandle();
+
+        RC insertRid(const RID& rid);
+        RC deleteRid(const RID& rid);
+        void getRidAt(int16_t index, RID& rid);
+
+        RC print(std::ostream &out);
+
+        bool hasEnoughSpace();
+        bool isEmpty();
+        int16_t getOverflowHeaderLen();
+
+        int16_t getNextPtrOffset();
+        uint32_t getNextPtr();
+        uint32_t getNextPtrFromData();
+        void setNextPtr(uint32_t next);
+    };
+
     class IX_ScanIterator {
     public:
         IXFileHandle* ixFileHandlePtr;
@@ -289,8 +561,25 @@ namespace PeterDB {
         bool highKeyInclusive;
 
         uint32_t curLeafPage;
-        int16_t remainDataLen;
+        uint32_t curLeafVersion;        // Entries of the leaf moved in place once its latch version differs
+        int16_t remainDataLen;          // From the next rid or entry to the end of the current page
         bool entryExceedUpperBound;
+
+        // Key of the current posting list, decoded once for all of its rids
+        uint8_t curKey[PAGE_SIZE];
+        int16_t curKeyLen;
+        int16_t curRidNum;              // Rids left in the leaf
+        uint32_t curOverflowPage;
+        int16_t overflowRemainLen;      // Negative before the overflow page is entered
+
+        // Entries may move to other pages while scanning, the scan then finds its place again by the last entry
+        uint32_t structureVersion;
+        bool isLastEntryExist;
+        std::vector<uint8_t> lastKey;
+        RID lastRid;
+        std::vector<uint8_t> seekKey;
+        RID seekRid;
+        bool isSeeking;                 // Skipping entries up to the last one returned
     public:
         // Constructor
         IX_ScanIterator();
@@ -309,7 +598,100 @@ namespace PeterDB {
         RC close();
 
     private:
+        RC seek(const uint8_t* key, bool isInclusive);
+        RC seekAfterLastEntry();
+        RC readNextEntry(RID &rid, void *key);
         RC getNextNonEmptyPage();
+        RC getNextOverflowRid(RID &rid);
+    };
+
+    // Build an empty index bottom-up from entries added in any order
+    // Entries are sorted in memory, runs beyond the memory budget are spilled to disk and merged
+    // Leaves and then each index level are written left to right, appended sequentially
+    class IX_BulkLoader {
+    public:
+        IXFileHandle* ixFileHandlePtr;
+        Attribute attr;
+        float fillFactor;
+        uint64_t memoryBudget;
+
+        // Composite keys (key + rid) of the current run
+        std::vector<uint8_t> runData;
+        std::vector<uint32_t> runEntryOffsets;
+        std::vector<std::string> runFileNames;
+
+        // Page being filled, entries of a leaf in pageData, of an index page with full keys in indexPageData
+        uint8_t pageData[PAGE_SIZE];
+        int16_t pageDataLen;
+        std::vector<uint8_t> indexPageData;
+        int16_t pageCounter;
+        uint32_t pageNum;
+
+        // First composite key and page number of every page on the level being built
+        std::vector<uint8_t> levelKeys;
+        std::vector<uint32_t> levelKeyOffsets;
+        std::vector<uint32_t> levelPages;
+
+        // Posting list being collected, and rids of the current leaf going to overflow pages
+        uint8_t postingKey[PAGE_SIZE];
+        int16_t postingKeyLen;
+        std::vector<uint8_t> postingRids;
+        std::vector<uint8_t> lastPostingKey;        // Key written before, the next leaf separator goes right above it
+        std::vector<uint8_t> overflowRids;
+        std::vector<std::pair<int16_t, int32_t>> overflowEntries;      // Entry position in the leaf, rid number
+
+        // Built pages not appended yet
+        std::vector<uint8_t> pageBatch;
+        uint32_t batchPageNum;
+    public:
+        IX_BulkLoader();
+        ~IX_BulkLoader();
+
+        // The index has to be empty
+        RC open(IXFileHandle* ixFileHandle, const Attribute& attr);
+        void setFillFactor(float factor);
+        void setMemoryBudget(uint64_t bytes);
+
+        RC addEntry(const void* key, const RID& rid);
+
+        // Sort entries and build the tree
+        RC close();
+        // Drop the entries added so far without building the tree
+        void abort();
+
+    private:
+        void sortRun();
+        RC spillRun();
+        RC mergeRuns();
+        void removeRuns();
+
+        RC addLeafEntry(const uint8_t* compKey);
+        RC flushPostingEntry();
+        RC appendLeafEntry(const uint8_t* entry, int16_t entryLen, const uint8_t* firstCompKey);
+        RC finishLeafPage(bool isLastLeaf);
+        RC buildIndexLevel();
+        RC finishIndexPage();
+        int32_t getIndexPageLen(int32_t keyBytes, int16_t keyNum, const uint8_t* firstKey, const uint8_t* lastKey);
+
+        int16_t getPageCapacity(int16_t headerLen);
+        int16_t getSlotLen();
+        uint32_t getNextPageNum();
+        std::string getRunFileName(uint32_t runIndex);
+        RC appendBuiltPage();
+        RC flushPageBatch();
+    };
+
+    // Key over several attributes stored in a VarChar key, comparing its bytes orders it by the attributes in turn
+    // Int and Real are big-endian with the sign flipped, strings are escaped so that a shorter one comes first
+    class CompositeKeyHelper {
+    public:
+        // VarChar attribute the index is built on
+        static Attribute getKeyAttribute(const std::string& name, const std::vector<Attribute>& keyAttrs);
+
+        // Key of the attributes at keyAttrIndex of data in the format of insertTuple
+        static RC encode(const uint8_t* data, const std::vector<Attribute>& attrs, const std::vector<uint32_t>& keyAttrIndex, uint8_t* key);
+        // Back to the format of insertTuple over the key attributes
+        static RC decode(const uint8_t* key, const std::vector<Attribute>& keyAttrs, uint8_t* data);
     };
 
 }// namespace PeterDB
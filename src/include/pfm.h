@@ -8,8 +8,16 @@
 #include <cstdio>
 #include <memory>
 #include <vector>
+#include <algorithm>
 #include <cstring>
+#include <unordered_map>
+#include <deque>
+#include <mutex>
+#include <thread>
+#include <condition_variable>
+#include <chrono>
 #include <sys/stat.h>
+#include <sys/uio.h>
 
 #include "glog/logging.h"
 #include "src/include/ErrorCode.h"
@@ -19,7 +27,46 @@ namespace PeterDB {
     typedef unsigned PageNum;
     typedef int RC;
 
+    namespace PFM {
+        // Buffer Pool
+        const uint32_t BUFFER_POOL_FRAME_NUM_DEFAULT = 1024;
+        const int32_t BUFFER_FRAME_NULL = -1;
+        const uint32_t VECTORED_IO_PAGE_NUM = 64;                           // Pages pinned per vectored read or write
+
+        // Read-ahead
+        const uint32_t PREFETCH_DEPTH_DEFAULT = 16;                         // Pages read ahead of a sequential reader, 0 disables
+        const uint32_t PREFETCH_TRIGGER_RUN = 2;                            // Consecutive page reads before prefetching starts
+        const uint32_t PREFETCH_QUEUE_MAX = 64;                             // Requests beyond it are dropped
+        const uint32_t PREFETCH_NO_PAGE = 0xFFFFFFFF;
+
+        // Metadata flush
+        const uint32_t METADATA_FLUSH_LAZY = 0;                             // Persist counters only at close or checkpoint
+        const uint32_t METADATA_FLUSH_INTERVAL_DEFAULT = METADATA_FLUSH_LAZY;
+
+        // Free space map, one byte per data page
+        // Bucket b > 0 means the page has at least (b - 1) * FSM_BUCKET_BYTES free bytes
+        const uint8_t FSM_BUCKET_UNKNOWN = 0;                               // Page has to be inspected
+        const uint8_t FSM_BUCKET_MAX = 255;
+        const uint16_t FSM_BUCKET_BYTES = 16;
+        const uint32_t FSM_COUNTER_LEN = 4 * sizeof(uint32_t);
+        const uint32_t FSM_HIDDEN_ENTRY_NUM = PAGE_SIZE - FSM_COUNTER_LEN;  // Entries persisted after the counters
+        const uint32_t FSM_UNKNOWN_PROBE_MAX = 8;                           // Pages with unknown entries read per page search
+
+        // Write-ahead log, one page image per record
+        const char* const WAL_DIR_NAME = ".wal";                            // Next to the data files, holds their logs
+        const uint32_t WAL_RECORD_HEADER_LEN = 16;                          // LSN | Page Index | Checksum
+        const uint32_t WAL_GROUP_COMMIT_DEFAULT = 256;                      // Page changes per log sync, 0: only when forced
+        const uint32_t WAL_GROUP_COMMIT_INTERVAL_MS = 10;                   // Age of a buffered change that triggers a log sync, 0: none
+        const uint64_t WAL_CHECKPOINT_BYTES = 16 * 1024 * 1024;             // Log size that triggers a checkpoint
+    }
+
+    typedef enum {
+        StorageFd = 0,      // Raw file descriptor with positional I/O
+        StorageFstream      // std::fstream, kept as a fallback
+    } StorageBackendType;
+
     class FileHandle;
+    class StorageBackend;
 
     class PagedFileManager {
     public:
@@ -30,12 +77,277 @@ namespace PeterDB {
         RC openFile(const std::string &fileName, FileHandle &fileHandle);   // Open a file
         RC closeFile(FileHandle &fileHandle);                               // Close a file
         bool isFileExists(std::string fileName);
+
+        void setStorageBackendType(StorageBackendType type);                // Backend of files opened afterwards
+        StorageBackendType getStorageBackendType();
+        StorageBackend* createStorageBackend();                             // Caller owns the backend
     protected:
         PagedFileManager();                                                 // Prevent construction
         ~PagedFileManager();                                                // Prevent unwanted destruction
         PagedFileManager(const PagedFileManager &);                         // Prevent construction by copying
         PagedFileManager &operator=(const PagedFileManager &);              // Prevent assignment
 
+    private:
+        StorageBackendType storageBackendType;
+    };
+
+    // Byte-addressed I/O on one file, shared by FileHandle, IXFileHandle and the buffer pool
+    class StorageBackend {
+    public:
+        virtual ~StorageBackend() = default;
+
+        virtual RC open(const std::string& fileName) = 0;
+        virtual RC close() = 0;
+        virtual bool isOpen() = 0;
+
+        virtual RC read(uint64_t offset, void* data, uint32_t len) = 0;
+        virtual RC write(uint64_t offset, const void* data, uint32_t len) = 0;
+        // Scatter / gather a contiguous range of the file, one read or write per buffer unless overridden
+        virtual RC readv(uint64_t offset, const struct iovec* iov, int iovCount);
+        virtual RC writev(uint64_t offset, const struct iovec* iov, int iovCount);
+        virtual RC flush() = 0;                                             // Push buffered writes to the OS
+        virtual RC sync() = 0;                                              // Make written data durable
+        virtual RC getFileSize(uint64_t& fileSize) = 0;
+        virtual bool isThreadSafe() { return false; }                       // Reads may run concurrently with other I/O
+    };
+
+    // One pread/pwrite per page, no shared stream position
+    class FdStorageBackend: public StorageBackend {
+    public:
+        FdStorageBackend();
+        ~FdStorageBackend() override;
+
+        RC open(const std::string& fileName) override;
+        RC close() override;
+        bool isOpen() override;
+
+        RC read(uint64_t offset, void* data, uint32_t len) override;
+        RC write(uint64_t offset, const void* data, uint32_t len) override;
+        RC readv(uint64_t offset, const struct iovec* iov, int iovCount) override;     // preadv
+        RC writev(uint64_t offset, const struct iovec* iov, int iovCount) override;    // pwritev
+        RC flush() override;
+        RC sync() override;                                                 // fdatasync
+        RC getFileSize(uint64_t& fileSize) override;
+        bool isThreadSafe() override { return true; }
+    private:
+        int fd;
+    };
+
+    class FstreamStorageBackend: public StorageBackend {
+    public:
+        FstreamStorageBackend();
+        ~FstreamStorageBackend() override;
+
+        RC open(const std::string& fileName) override;
+        RC close() override;
+        bool isOpen() override;
+
+        RC read(uint64_t offset, void* data, uint32_t len) override;
+        RC write(uint64_t offset, const void* data, uint32_t len) override;
+        RC flush() override;
+        RC sync() override;                                                 // Flush, then fdatasync the file through its name
+        RC getFileSize(uint64_t& fileSize) override;
+    private:
+        std::fstream* fs;
+        std::string fileName;
+        std::mutex ioMutex;                                                 // The stream position is shared by all operations
+    };
+
+    // One frame of the buffer pool, bound to a physical page of a file
+    typedef struct BufferFrame {
+        uint64_t fileId;
+        uint32_t pageIndex;         // Physical page index in the file, hidden pages included
+        StorageBackend* backend;    // Backend used to write back the frame when it is dirty
+        uint8_t* data;
+        int32_t pinCount;
+        bool isDirty;
+        bool refBit;                // Second chance bit of CLOCK
+        bool isValid;
+        bool isLoading;             // Being read without the lock, pinned until loaded
+        bool isWriting;             // Being written back before eviction without the lock, pins of its page wait
+        bool isPrefetched;          // Loaded by the prefetcher and not accessed yet
+        uint64_t lsn;               // Latest log record of the page, forced before the page is written back
+        uint32_t dirtyVersion;      // Bumped whenever the frame is dirtied, a write back only cleans the version it wrote
+    } BufferFrame;
+
+    typedef struct LogFile {
+        std::string logFileName;
+        int fd;                                     // Opened on the first write
+        uint32_t refCount;                          // Open handles of the data file
+        uint64_t logSize;                           // Bytes written to the log file
+        uint64_t nextLsn;
+        uint64_t durableLsn;
+        uint32_t pendingChangeNum;                  // Changes since the last log sync
+        std::chrono::steady_clock::time_point firstPendingTime;     // Oldest change not synced yet
+        std::vector<uint8_t> buffer;                // Records not written yet
+        uint64_t writingLen;                        // Bytes of the group being written without the lock
+        bool isWriting;
+        std::unordered_map<uint32_t, uint32_t> bufferedPages;  // Page index -> offset of its record in the buffer
+    } LogFile;
+
+    // Redo log of page images, one log file per data file kept as .wal/<data file name> in the same directory
+    // Changes are buffered and made durable in groups by one sequential write and sync
+    // A page is written back only after its log records are durable, the log is dropped once the data file is synced
+    // Records logged after the checkpoint started, or of pages still pinned, survive it
+    // Records of a page still in the buffer are overwritten by its newer image
+    // Logging a change only buffers it, so it is safe under the buffer pool lock
+    // A full group is synced by the caller once it holds no lock, a group left waiting is synced by a flusher thread
+    // The log lock is released while a group is written and synced
+    class LogManager {
+    public:
+        static LogManager &instance();                                      // Access to the singleton instance
+
+        // Attach a handle of the data file, the first one redoes the log left by a crash
+        RC openLog(uint64_t fileId, const std::string& fileName, StorageBackend* dataBackend, uint32_t& redoPageNum);
+        RC closeLog(uint64_t fileId);                                       // Detach a handle, the log is kept
+        uint64_t logPage(uint64_t fileId, uint32_t pageIndex, const void* data);   // LSN, 0 if the file is not logged
+        RC commitGroup(uint64_t fileId);                                    // Sync the buffered changes if a group is full
+        RC forceLog(uint64_t fileId, uint64_t lsn);                         // Make records up to lsn durable
+        // Records up to flushedLsn are written back and synced, the log is dropped as far as it holds only those
+        RC checkpoint(uint64_t fileId, uint64_t flushedLsn);
+        uint64_t getLastLsn(uint64_t fileId);       // 0 if nothing is logged
+        uint64_t getLogSize(uint64_t fileId);       // Buffered records included
+        RC removeLog(const std::string& fileName);  // Data file is removed or recreated
+        static std::string getLogFileName(const std::string& fileName);
+
+        void setGroupCommitSize(uint32_t changeNum);                        // 0: sync only when forced
+        void setGroupCommitInterval(uint32_t intervalMs);                   // 0: no time bound
+        void collectCounterValues(uint32_t &logPageCount, uint32_t &logSyncCount, uint32_t &redoPageCount);
+    protected:
+        LogManager();                                                       // Prevent construction
+        ~LogManager();                                                      // Prevent unwanted destruction
+        LogManager(const LogManager &);                                     // Prevent construction by copying
+        LogManager &operator=(const LogManager &);                          // Prevent assignment
+
+    private:
+        std::mutex logMutex;
+        std::condition_variable writeDone;          // Signaled when a group has been written
+        std::unordered_map<uint64_t, LogFile> logFiles;
+        uint32_t groupCommitSize;
+        uint32_t groupCommitInterval;
+
+        std::condition_variable flusherWake;
+        bool isStopping;
+        std::thread flusher;                        // Started on the first logged change
+
+        uint32_t logPageCounter;
+        uint32_t logSyncCounter;
+        uint32_t redoPageCounter;
+
+        LogFile* waitForWrite(std::unique_lock<std::mutex>& lock, uint64_t fileId);     // nullptr if not logged
+        RC writeBuffer(std::unique_lock<std::mutex>& lock, LogFile& log);  // Write buffered records and sync the log
+        void runFlusher();
+        RC redo(LogFile& log, StorageBackend* dataBackend, uint32_t& redoPageNum);
+        void closeLogFile(LogFile& log);
+        static uint32_t checksum(const uint8_t* data, uint32_t len);
+    };
+
+    // Process-wide page cache shared by FileHandle and IXFileHandle
+    // Pages are keyed by (file id, physical page index), frames are replaced by CLOCK
+    // A file is identified by its inode, so a stale handle on a removed file never shares frames with its successor
+    // All public methods are thread-safe, disk I/O and log syncs run without holding the lock
+    class BufferPool {
+    public:
+        static BufferPool &instance();                                      // Access to the singleton instance
+
+        // Change the number of frames, all dirty frames are written back first
+        // Fail if any frame is still pinned
+        RC setFrameNum(uint32_t frameNum);
+        uint32_t getFrameNum();
+
+        // Pin a physical page, load it from disk if not cached and loadFromDisk is set
+        RC pinPage(uint64_t fileId, StorageBackend* backend, uint32_t pageIndex, bool loadFromDisk,
+                   uint8_t*& frameData, bool& isHit);
+        RC unpinPage(uint64_t fileId, StorageBackend* backend, uint32_t pageIndex, bool isDirty);
+        // Pin consecutive physical pages, missing runs are loaded with one vectored read each if loadFromDisk is set
+        RC pinPages(uint64_t fileId, StorageBackend* backend, uint32_t firstPageIndex, uint32_t pageCount,
+                    bool loadFromDisk, std::vector<uint8_t*>& frameData, uint32_t& hitCount);
+        // Write pinned consecutive pages with one vectored write, the frames become clean
+        RC writePages(uint64_t fileId, StorageBackend* backend, uint32_t firstPageIndex, uint32_t pageCount);
+
+        // Write back unpinned dirty frames of a file
+        // flushedLsn is lowered below the LSN of frames left dirty, records up to it are written back
+        RC flushFile(uint64_t fileId, StorageBackend* backend, uint64_t& flushedLsn);
+        RC flushAll();                                                      // Write back all dirty frames
+        RC discardFile(const std::string& fileName);                        // Drop frames of a file without writing
+
+        // Load consecutive pages that are not cached yet, left unpinned, stop early if no frame is free
+        RC prefetchPages(uint64_t fileId, StorageBackend* backend, uint32_t firstPageIndex, uint32_t pageCount);
+
+        static RC getFileId(const std::string& fileName, uint64_t& fileId);
+
+        void collectCounterValues(uint32_t &hitCount, uint32_t &missCount, uint32_t &evictCount, uint32_t &writeBackCount);
+        // Pages loaded by prefetch, later accessed, and dropped without being accessed
+        void collectPrefetchCounterValues(uint32_t &prefetchCount, uint32_t &prefetchHitCount, uint32_t &prefetchWastedCount);
+    protected:
+        BufferPool();                                                       // Prevent construction
+        ~BufferPool();                                                      // Prevent unwanted destruction
+        BufferPool(const BufferPool &);                                     // Prevent construction by copying
+        BufferPool &operator=(const BufferPool &);                          // Prevent assignment
+
+    private:
+        std::vector<BufferFrame> frames;
+        std::vector<uint8_t> frameData;
+        std::unordered_map<uint64_t, std::unordered_map<uint32_t, int32_t>> pageTable;
+        uint32_t clockHand;
+        std::mutex poolMutex;
+        std::condition_variable loadDone;   // Signaled when frames finish loading or being written back
+
+        uint32_t hitCounter;
+        uint32_t missCounter;
+        uint32_t evictCounter;
+        uint32_t writeBackCounter;
+        uint32_t prefetchCounter;
+        uint32_t prefetchHitCounter;
+        uint32_t prefetchWastedCounter;
+
+        RC initFrames(uint32_t frameNum);
+        RC flushAllFrames(std::unique_lock<std::mutex>& lock);
+        int32_t findFrame(uint64_t fileId, uint32_t pageIndex);
+        int32_t findLoadedFrame(std::unique_lock<std::mutex>& lock, uint64_t fileId, uint32_t pageIndex);
+        void accessFrame(BufferFrame& frame);
+        // The frame is returned pinned and loading, the caller fills it and clears isLoading
+        // frameIndex is BUFFER_FRAME_NULL if another thread cached the page while the lock was released
+        RC allocFrame(std::unique_lock<std::mutex>& lock, uint64_t fileId, StorageBackend* backend, uint32_t pageIndex,
+                      int32_t& frameIndex);
+        RC findVictim(int32_t& frameIndex);
+        // Frames of consecutive pages, pinned by the caller, are written with the lock released meanwhile
+        RC writeBackRun(std::unique_lock<std::mutex>& lock, StorageBackend* backend, std::vector<BufferFrame*>& run);
+        void releaseFrame(BufferFrame& frame);
+
+        static RC readFromDisk(StorageBackend* backend, uint32_t pageIndex, uint8_t* data);
+    };
+
+    typedef struct PrefetchRequest {
+        uint64_t fileId;
+        StorageBackend* backend;
+        uint32_t firstPageIndex;    // Physical page index
+        uint32_t pageCount;
+    } PrefetchRequest;
+
+    // Read-ahead into the buffer pool, served by one worker thread started on the first request
+    class Prefetcher {
+    public:
+        static Prefetcher &instance();                                      // Access to the singleton instance
+
+        void request(uint64_t fileId, StorageBackend* backend, uint32_t firstPageIndex, uint32_t pageCount);
+        void cancel(StorageBackend* backend);       // Drop requests of a backend and wait for the one being served
+        void waitIdle();                            // Wait until all requests are served
+    protected:
+        Prefetcher();                                                       // Prevent construction
+        ~Prefetcher();                                                      // Prevent unwanted destruction
+        Prefetcher(const Prefetcher &);                                     // Prevent construction by copying
+        Prefetcher &operator=(const Prefetcher &);                          // Prevent assignment
+
+    private:
+        std::mutex queueMutex;
+        std::condition_variable queueChanged;
+        std::deque<PrefetchRequest> requests;
+        StorageBackend* activeBackend;              // Backend of the request being served
+        bool isStopping;
+        std::thread worker;
+
+        void run();
     };
 
     class FileHandle {
@@ -47,11 +359,37 @@ namespace PeterDB {
         uint32_t appendPageCounter;
         uint32_t pageCounter;
 
+        // Buffer pool counters of this handle, not persisted
+        uint32_t bufferHitCounter;
+        uint32_t bufferMissCounter;
+
+        // Counters are persisted every metadataFlushInterval page operations
+        uint32_t metadataFlushInterval;
+        uint32_t metadataDirtyOps;          // Page operations since the counters were last persisted
+
+        // Free space bucket of every data page
+        // Entries of the first FSM_HIDDEN_ENTRY_NUM pages are stored in the hidden page after the counters
+        // The others are kept in memory and start as unknown after reopening, page searches fill them lazily
+        std::vector<uint8_t> freeSpaceMap;
+
         std::string fileName;
-        std::fstream* fs;
+        uint64_t fileId;                    // Key of this file in the buffer pool
+        StorageBackend* backend;
+
+        // Sequential read detection, pages ahead of the reader are prefetched into the buffer pool
+        uint32_t prefetchDepth;
+        PageNum lastReadPage;
+        uint32_t sequentialRun;             // Consecutive page reads ending at lastReadPage
+        PageNum prefetchedUntil;            // Pages before it are already requested
 
         RC readMetadata();
         RC flushMetadata();
+        RC markMetadataDirty();
+        RC getFilePageNum(uint32_t& filePageNum);   // Number of data pages derived from the file size
+
+        void detectSequentialRead(PageNum pageNum);
+        void resetReadAhead();
+        RC syncAndDropLog(uint64_t flushedLsn);     // Records up to flushedLsn have to be written back first
 
         static int getCounterNum(); // Get Number of Counters
         int32_t getAllCounterLen();
@@ -65,13 +403,34 @@ namespace PeterDB {
 
         RC open(const std::string& tmpFileName);
         RC close();
+        RC checkpoint();                                                    // Persist counters and dirty pages
+        void setMetadataFlushInterval(uint32_t interval);                   // 0: only at close or checkpoint
+        void setPrefetchDepth(uint32_t depth);                              // 0: no read-ahead
 
         RC readPage(PageNum pageNum, void *data);                           // Get a specific page
         RC writePage(PageNum pageNum, const void *data);                    // Write a specific page
         RC appendPage(const void *data);                                    // Append a specific page
+        RC readPages(PageNum firstPage, uint32_t pageCount, void *data);    // Read consecutive pages
+        RC writePages(PageNum firstPage, uint32_t pageCount, const void *data);  // Write consecutive pages
+        RC appendPages(const void *data, uint32_t pageCount);               // Append contiguous pages in one write
         uint32_t getNumberOfPages();                                        // Get the number of pages in the file
         RC collectCounterValues(uint32_t &readPageCount, uint32_t &writePageCount,
                                 uint32_t &appendPageCount);                 // Put current counter values into variables
+        RC collectCounterValues(uint32_t &readPageCount, uint32_t &writePageCount, uint32_t &appendPageCount,
+                                uint32_t &bufferHitCount, uint32_t &bufferMissCount);
+
+        // Pin the page in the buffer pool and access its frame directly, counted as a page read
+        // Unpin with isDirty set is counted as a page write
+        RC pinPage(PageNum pageNum, uint8_t*& frameData);
+        RC unpinPage(PageNum pageNum, bool isDirty);
+
+        // Free space map, maintained by the owner of the page format and persisted with the counters
+        RC setPageFreeSpace(PageNum pageNum, uint16_t freeBytes);
+        bool isPageFreeSpaceKnown(PageNum pageNum);
+        uint16_t getPageFreeSpace(PageNum pageNum);                         // Lower bound, 0 if unknown
+        // Find the first page from startPage that may hold freeBytes, pages of unknown free space included
+        // No page is read, the caller has to verify the page and report its real free space
+        RC findPageWithFreeSpace(uint16_t freeBytes, PageNum startPage, PageNum& pageNum);
     };
 
 } // namespace PeterDB
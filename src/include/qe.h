@@ -16,6 +16,11 @@ namespace PeterDB {
         MIN = 0, MAX, COUNT, SUM, AVG
     } AggregateOp;
 
+    // How the RIDs of an index range are combined with the RIDs collected so far
+    typedef enum BitmapOp {
+        BITMAP_AND = 0, BITMAP_OR
+    } BitmapOp;
+
     // The following functions use the following
     // format for the passed data.
     //    For INT and REAL: use 4 bytes
@@ -48,6 +53,7 @@ namespace PeterDB {
         // A wrapper inheriting Iterator over RM_ScanIterator
     private:
         RelationManager &rm;
+        TableHandle table;
         RM_ScanIterator iter;
         std::string tableName;
         std::vector<Attribute> attrs;
@@ -58,8 +64,9 @@ namespace PeterDB {
             //Set members
             this->tableName = tableName;
 
-            // Get Attributes from RM
-            rm.getAttributes(tableName, attrs);
+            // Resolve the table once, rescans go through the handle
+            rm.openTable(tableName, table);
+            attrs = table.getAttributes();
 
             // Get Attribute Names from RM
             for (const Attribute &attr : attrs) {
@@ -68,7 +75,7 @@ namespace PeterDB {
             }
 
             // Call RM scan to get an iterator
-            rm.scan(tableName, "", NO_OP, NULL, attrNames, iter);
+            table.scan("", NO_OP, NULL, attrNames, iter);
 
             // Set alias
             if (alias) this->tableName = alias;
@@ -77,7 +84,7 @@ namespace PeterDB {
         // Start a new iterator given the new compOp and value
         void setIterator() {
             iter.close();
-            rm.scan(tableName, "", NO_OP, NULL, attrNames, iter);
+            table.scan("", NO_OP, NULL, attrNames, iter);
         };
 
         RC getNextTuple(void *data) override {
@@ -104,6 +111,7 @@ namespace PeterDB {
         // A wrapper inheriting Iterator over IX_IndexScan
     private:
         RelationManager &rm;
+        TableHandle table;
         RM_IndexScanIterator iter;
         std::string tableName;
         std::string attrName;
@@ -117,11 +125,12 @@ namespace PeterDB {
             this->tableName = tableName;
             this->attrName = attrName;
 
-            // Get Attributes from RM
-            rm.getAttributes(tableName, attrs);
+            // Resolve the table once, every match is read through the handle
+            rm.openTable(tableName, table);
+            attrs = table.getAttributes();
 
             // Call rm indexScan to get iterator
-            rm.indexScan(tableName, attrName, NULL, NULL, true, true, iter);
+            table.indexScan(attrName, NULL, NULL, true, true, iter);
 
             // Set alias
             if (alias) this->tableName = alias;
@@ -130,13 +139,13 @@ namespace PeterDB {
         // Start a new iterator given the new key range
         void setIterator(void *lowKey, void *highKey, bool lowKeyInclusive, bool highKeyInclusive) {
             iter.close();
-            rm.indexScan(tableName, attrName, lowKey, highKey, lowKeyInclusive, highKeyInclusive, iter);
+            table.indexScan(attrName, lowKey, highKey, lowKeyInclusive, highKeyInclusive, iter);
         };
 
         RC getNextTuple(void *data) override {
             RC rc = iter.getNextEntry(rid, key);
             if (rc == 0) {
-                rc = rm.readTuple(tableName, rid, data);
+                rc = table.readTuple(rid, data);
             }
             return rc;
         };
@@ -158,6 +167,69 @@ namespace PeterDB {
         };
     };
 
+    class IndexOnlyScan : public Iterator {
+        // Answers a projection from the entries of a covering index, without reading the table
+    private:
+        RelationManager &rm;
+        RM_IndexScanIterator iter;
+        std::string tableName;
+        std::string relName;                    // Table name or alias used in attribute names
+        std::vector<std::string> keyAttrNames;
+        std::vector<std::string> attrNames;
+        std::vector<Attribute> indexAttrs;      // Attributes of the decoded index entries
+        std::vector<uint32_t> projectedIndex;   // Position of every projected attribute in indexAttrs
+        uint8_t entry[PAGE_SIZE];
+        RID rid;
+    public:
+        // "lowKey"/"highKey" of setIterator() follow the insertTuple() format over keyAttrNames
+        IndexOnlyScan(RelationManager &rm, const std::string &tableName,
+                      const std::vector<std::string> &keyAttrNames,      // Key prefix of the index
+                      const std::vector<std::string> &attrNames,         // Projected attributes
+                      const char *alias = NULL);
+
+        ~IndexOnlyScan() override;
+
+        // Start a new iterator given the new key range
+        void setIterator(void *lowKey, void *highKey, bool lowKeyInclusive, bool highKeyInclusive);
+
+        RC getNextTuple(void *data) override;
+
+        // For attribute in std::vector<Attribute>, name it as rel.attr
+        RC getAttributes(std::vector<Attribute> &attrs) const override;
+
+    private:
+        RC resolveProjection();
+    };
+
+    class BitmapHeapScan : public Iterator {
+        // Collects the RIDs of index ranges, then fetches the tuples in (pageNum, slotNum) order
+        // so every heap page is read once
+    private:
+        RelationManager &rm;
+        std::string tableName;
+        std::string relName;                    // Table name or alias used in attribute names
+        std::vector<Attribute> attrs;
+        std::vector<RID> rids;                  // Sorted by (pageNum, slotNum), no duplicates
+        bool hasRange = false;
+        uint32_t nextRid = 0;
+        std::vector<std::vector<uint8_t>> pageTuples;   // Tuples of the current heap page
+        uint32_t nextTuple = 0;
+    public:
+        BitmapHeapScan(RelationManager &rm, const std::string &tableName, const char *alias = NULL);
+
+        ~BitmapHeapScan() override;
+
+        // Combine the RIDs of an index range with the current set, the first range starts the set.
+        // Keys follow the same format as IndexScan::setIterator()
+        RC addIndexRange(const std::string &attrName, void *lowKey, void *highKey,
+                         bool lowKeyInclusive, bool highKeyInclusive, BitmapOp op = BITMAP_AND);
+
+        RC getNextTuple(void *data) override;
+
+        // For attribute in std::vector<Attribute>, name it as rel.attr
+        RC getAttributes(std::vector<Attribute> &attrs) const override;
+    };
+
     class Filter : public Iterator {
         // Filter operator
         Iterator * iter;
@@ -332,6 +404,7 @@ namespace PeterDB {
         static RC concatRecords(uint8_t* output, uint8_t* outerRecord, const std::vector<Attribute>& outerAttr,
                                 uint8_t* innerRecord, const std::vector<Attribute>& innerAttr);
         static bool isSameKey(uint8_t* key1, uint8_t* key2, AttrType& type);
+        static bool isRIDLess(const RID& rid1, const RID& rid2);
 
         template<typename T>
         static bool performOper(const T& oper1, const T& oper2, Condition& cond) {
@@ -40,6 +40,11 @@ namespace PeterDB {
         NO_OP       // no condition
     } CompOp;
 
+    typedef enum {
+        PageReadWrite = 0,  // Written back on destruction only if modified
+        PageReadOnly        // Modification is refused, never written back
+    } PageAccessMode;
+
     # define RBFM_EOF (-1)  // end of a scan operator
     //  RBFM_ScanIterator is an iterator to go through records
     //  The way to use it is like the following:
@@ -82,10 +87,21 @@ namespace PeterDB {
     const int16_t PAGE_EMPTY_SLOT_OFFSET = -1;
     const int16_t PAGE_EMPTY_SLOT_LEN = 0;
 
+    // Pages packed in memory by insertRecords before they are appended together
+    const uint32_t INSERT_BATCH_PAGE_NUM = 64;
+
+    // Where each attribute of a new schema is found in an origin schema, see RecordBasedFileManager::buildTransformPlan
+    class SchemaTransformPlan {
+    public:
+        std::vector<int16_t> originIndex;   // -1 if the attribute is not in the origin schema
+    };
+
+    class RecordPageHandle;
 
     class RBFM_ScanIterator {
     public:
-        FileHandle fileHandle;
+        FileHandle* fileHandle;             // Scanned handle, has to stay open until the scan is closed
+        uint32_t pageNum;                   // Pages appended after the scan was opened are not scanned
         std::vector<Attribute> recordDesc;
         std::vector<uint32_t> selectedAttrIndex;
 
@@ -97,6 +113,7 @@ namespace PeterDB {
 
         uint32_t curPageIndex;
         uint16_t curSlotIndex;
+        RecordPageHandle* curPageHandle;    // Current page stays pinned until its slots are exhausted
 
         // Store record byte sequence
         uint8_t recordByteSeq[PAGE_SIZE];
@@ -117,6 +134,7 @@ namespace PeterDB {
         RC getNextRecord(RID &recordRid, void *data);
 
         bool isRecordMeetCondition(uint8_t attrData[], int16_t attrLen);
+        void releaseCurPage();
     };
 
     class RecordBasedFileManager {
@@ -151,6 +169,13 @@ namespace PeterDB {
                         RID &rid);
         RC insertRecord(FileHandle &fileHandle, const std::vector<Attribute> &recordDescriptor,
                         const void *data, const int8_t version, RID &rid);
+        // Insert a batch of records, packed into new pages which are appended INSERT_BATCH_PAGE_NUM at a time
+        // rids[i] is the rid of records[i]
+        // If a record fails, the records before it stay inserted and rids.size() is the index of the failing one
+        RC insertRecords(FileHandle &fileHandle, const std::vector<Attribute> &recordDescriptor,
+                         const std::vector<const void *> &records, std::vector<RID> &rids);
+        RC insertRecords(FileHandle &fileHandle, const std::vector<Attribute> &recordDescriptor,
+                         const std::vector<const void *> &records, const int8_t version, std::vector<RID> &rids);
         // Read a record identified by the given rid.
         RC
         readRecord(FileHandle &fileHandle, const std::vector<Attribute> &recordDescriptor, const RID &rid, void *data);
@@ -158,7 +183,16 @@ namespace PeterDB {
                       const std::vector<Attribute> &selected, const RID &rid, void *data);
         RC transformSchema(const std::vector<Attribute>& originSche, uint8_t* originData,
                            const std::vector<Attribute>& newSche, uint8_t* newData);
+        // Match the schemas once, so data of the origin schema is transformed without comparing attribute names
+        RC buildTransformPlan(const std::vector<Attribute>& originSche, const std::vector<Attribute>& newSche,
+                              SchemaTransformPlan& plan);
+        RC transformSchema(const SchemaTransformPlan& plan, const std::vector<Attribute>& originSche, uint8_t* originData,
+                           const std::vector<Attribute>& newSche, uint8_t* newData);
         RC readRecordVersion(FileHandle &fileHandle, const RID &rid, int8_t& version);
+        // Read the records in "slots" of one page, pinning the page once. data[i] receives slots[i].
+        // A record stored with a schema version other than "version" is left empty for the caller.
+        RC readRecordsOnPage(FileHandle &fileHandle, const std::vector<Attribute> &recordDescriptor, PageNum pageNum,
+                             const std::vector<uint16_t> &slots, int8_t version, std::vector<std::vector<uint8_t>> &data);
 
         // Print the record that is passed to this utility method.
         // This method will be mainly used for debugging/testing.
@@ -201,6 +235,7 @@ namespace PeterDB {
     private:
         // TODO: Create a PageOrganizer class to organize pages
         RC findAvailPage(FileHandle& fileHandle, int16_t recordLen, PageNum& availPageIndex);
+        RC appendBatchPages(FileHandle& fileHandle, uint8_t* pages, uint32_t pageCount);
     };
 
     class RecordPageHandle {
@@ -210,12 +245,26 @@ namespace PeterDB {
 
         int16_t freeBytePointer;
         int16_t slotCounter;
-        uint8_t data[PAGE_SIZE] = {};
+        uint8_t* data;                      // Pinned frame in the buffer pool, or a private empty page if pin fails
+        RC pinStatus;
+        bool isPinned;
+        bool ownsData;
+        bool isReadOnly;
+        bool isDirty;                       // Set by any modification of data, decides the write back on unpin
 
     public:
-        RecordPageHandle(FileHandle& fileHandle, PageNum pageNum);
+        RecordPageHandle(FileHandle& fileHandle, PageNum pageNum, PageAccessMode mode = PageReadWrite);
+        // Format a page in a caller-owned buffer, nothing is pinned or written back
+        RecordPageHandle(FileHandle& fileHandle, PageNum pageNum, uint8_t* pageData);
         ~RecordPageHandle();
 
+        // Result of pinning the page, the handle must not be used unless it is 0
+        // Changes to the private page of a failed pin are never written anywhere
+        RC getPinStatus();
+
+        // Re-read the cached header, a handle kept pinned may see the page modified through other handles
+        void refreshHeader();
+
         // Read Record
         // Record Format Described in report
         RC getRecordByteSeq(int16_t slotNum, uint8_t recordByteSeq[], int16_t& recordLen);
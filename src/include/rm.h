@@ -4,6 +4,8 @@
 #include <string>
 #include <vector>
 #include <unordered_set>
+#include <list>
+#include <memory>
 
 #include "src/include/rbfm.h"
 #include "src/include/ix.h"
@@ -39,6 +41,13 @@ namespace PeterDB {
         const int32_t CATALOG_INDEXES_FILENAME_LEN = 50;
         const int32_t CATALOG_INDEXES_ATTR_NUM = 3;
         const int32_t CATALOG_INDEXES_ATTR_NULL = -1;
+        // A composite index stores its ordered attribute list joined by this delimiter
+        const char CATALOG_INDEXES_ATTRNAME_DELIM = ',';
+        // Included (non-key) attributes of a covering index follow the key attributes after this delimiter
+        const char CATALOG_INDEXES_INCLUDE_DELIM = '+';
+
+        // Table and index files kept open by RelationManager, pinned files may exceed it
+        const uint32_t FILE_HANDLE_CACHE_SIZE_DEFAULT = 32;
 
         const std::string catalogTablesName = "Tables";
         const std::string catalogColumnsName = "Columns";
@@ -119,14 +128,93 @@ namespace PeterDB {
         RC getRecordAPIFormat(uint8_t* apiData);
     };
 
+    // An index of a table with its key resolved against the current schema
+    class TableIndex {
+    public:
+        std::string indexName;
+        std::string fileName;
+        std::vector<uint32_t> keyAttrIndex;         // Key attributes followed by included attributes
+        uint32_t keyAttrNum = 0;                    // Number of key attributes at the front of keyAttrIndex
+        Attribute keyAttr;
+    };
+
+    // Catalog records of one table, kept in memory until the next DDL
+    // Open TableHandles share the entry, it outlives the cache until they resolve again
+    class CatalogCacheEntry {
+    public:
+        CatalogTablesRecord tableRecord;
+        std::unordered_map<int32_t, std::vector<Attribute>> attrVersionMap;     // Schema of every table version
+        std::unordered_map<std::string, std::string> indexedAttrAndFileName;
+        // Attributes of every version that are still in the current version, and where they go in it
+        std::unordered_map<int32_t, std::vector<Attribute>> projAttrVersionMap;
+        std::unordered_map<int32_t, SchemaTransformPlan> transformPlans;
+        // Indexes maintained by DML, indexes on dropped attributes are left out
+        std::vector<TableIndex> indexes;
+    };
+
+    // Open FileHandles and IXFileHandles of RelationManager keyed by file name
+    // The least recently used file is closed once there are too many, files pinned by scans are never closed
+    class FileHandleCache {
+    public:
+        explicit FileHandleCache(uint32_t capacity = RM::FILE_HANDLE_CACHE_SIZE_DEFAULT);
+        ~FileHandleCache();
+        FileHandleCache(const FileHandleCache &) = delete;
+        FileHandleCache &operator=(const FileHandleCache &) = delete;
+
+        RC getFileHandle(const std::string& fileName, FileHandle*& fileHandle);
+        RC getIXFileHandle(const std::string& fileName, IXFileHandle*& ixFileHandle);
+
+        // Keep an open file in the cache, openSeq tells the pinned file from a later reopen of the same name
+        RC pin(const std::string& fileName, uint64_t& openSeq);
+        void unpin(const std::string& fileName, uint64_t openSeq);
+
+        // The file is about to be destroyed, a later lookup opens the file under that name again
+        // A pinned file stays open for the scans and handles that pinned it, it is closed by the last unpin
+        void closeFile(const std::string& fileName);
+        void closeAll();
+
+        RC setCapacity(uint32_t capacity);
+        uint32_t getCapacity();
+        uint32_t getOpenFileNum();
+
+        void collectCounterValues(uint32_t &hitCount, uint32_t &missCount, uint32_t &openCount);
+    private:
+        struct CachedFile {
+            std::unique_ptr<FileHandle> fileHandle;         // Set for table files
+            std::unique_ptr<IXFileHandle> ixFileHandle;     // Set for index files
+            uint32_t pinCount = 0;
+            uint64_t openSeq = 0;
+            std::list<std::string>::iterator lruPos;
+        };
+
+        RC lookup(const std::string& fileName, bool isIndex, CachedFile*& file);
+        void evict(uint32_t maxFileNum);
+        void close(CachedFile& file);
+
+        uint32_t capacity;
+        std::unordered_map<std::string, CachedFile> files;
+        std::list<std::string> lruList;                     // Most recently used first
+        std::unordered_map<uint64_t, CachedFile> closingFiles;      // Closed by name while pinned, keyed by openSeq
+        uint64_t nextOpenSeq;
+
+        uint32_t hitCounter;
+        uint32_t missCounter;
+        uint32_t openCounter;                               // Misses that opened the file successfully
+    };
+
     // RM_ScanIterator is an iterator to go through tuples
     class RM_ScanIterator {
         RBFM_ScanIterator rbfmIter;
+        // The scanned file stays open until close()
+        FileHandleCache* fileHandleCache = nullptr;
+        std::string fileName;
+        uint64_t openSeq = 0;
     public:
         RM_ScanIterator();
         ~RM_ScanIterator();
 
-        RC open(FileHandle &fileHandle, const std::vector<Attribute> &recordDescriptor,
+        RC open(FileHandleCache &fileHandleCache, const std::string &fileName,
+                const std::vector<Attribute> &recordDescriptor,
                 const std::string &conditionAttribute, const CompOp compOp, const void *value,
                 const std::vector<std::string> &attributeNames);
         // "data" follows the same format as RelationManager::insertTuple()
@@ -138,16 +226,94 @@ namespace PeterDB {
     // RM_IndexScanIterator is an iterator to go through index entries
     class RM_IndexScanIterator {
         IX_ScanIterator ixIter;
+        // Only set when keys are returned in tuple format, decoded back for composite indexes
+        std::vector<Attribute> keyAttrs;
+        bool isCompositeKey = false;
+        std::vector<uint8_t> lowKeyData;
+        std::vector<uint8_t> highKeyData;
+        // The index file is shared with other scans and DML, so close() only unpins it
+        FileHandleCache* fileHandleCache = nullptr;
+        std::string fileName;
+        uint64_t openSeq = 0;
+
+        RC pinIndexFile(FileHandleCache& fileHandleCache, const std::string& fileName, IXFileHandle*& ixFileHandle);
     public:
         RM_IndexScanIterator();    // Constructor
         ~RM_IndexScanIterator();    // Destructor
 
-        RC open(IXFileHandle* ixFileHandle, const Attribute& attr,
+        RC open(FileHandleCache& fileHandleCache, const std::string& fileName, const Attribute& attr,
+                const uint8_t* lowKey, const uint8_t* highKey,
+                bool lowKeyInclusive, bool highKeyInclusive);
+        // Composite index: bounds are tuples over the first prefixLen attributes of keyAttrs
+        // A single attribute index is scanned the same way when keyAttrs holds only that attribute
+        RC open(FileHandleCache& fileHandleCache, const std::string& fileName,
+                const std::vector<Attribute>& keyAttrs, uint32_t prefixLen,
                 const uint8_t* lowKey, const uint8_t* highKey,
                 bool lowKeyInclusive, bool highKeyInclusive);
         // "key" follows the same format as in IndexManager::insertEntry()
+        // When opened with keyAttrs, "key" follows the format of insertTuple() over all index attributes
         RC getNextEntry(RID &rid, void *key);    // Get next matching entry
         RC close();                              // Terminate index scan
+
+        // Attributes of the tuples returned by a scan opened with keyAttrs, empty otherwise
+        RC getKeyAttributes(std::vector<Attribute> &attrs) const;
+    };
+
+    class RelationManager;
+
+    // A table resolved once by RelationManager::openTable()
+    // Its schema, table file and index files are kept, so DML skips name checks and catalog lookups
+    // After any DDL the table is resolved again on the next call
+    class TableHandle {
+    public:
+        TableHandle();
+        ~TableHandle();
+        TableHandle(const TableHandle &) = delete;
+        TableHandle &operator=(const TableHandle &) = delete;
+
+        // "data" follows the same format as RelationManager::insertTuple()
+        RC insertTuple(const void *data, RID &rid);
+        // Same as RelationManager::insertTuples, on any error rids still lists every tuple left in the table
+        // Those tuples are indexed unless the error came from an index
+        RC insertTuples(const std::vector<const void *> &tuples, std::vector<RID> &rids);
+        RC deleteTuple(const RID &rid);
+        RC updateTuple(const void *data, const RID &rid);
+        RC readTuple(const RID &rid, void *data);
+
+        RC scan(const std::string &conditionAttribute, const CompOp compOp, const void *value,
+                const std::vector<std::string> &attributeNames, RM_ScanIterator &rm_ScanIterator);
+        // Scan on a single attribute index
+        RC indexScan(const std::string &attrName, const void *lowKey, const void *highKey,
+                     bool lowKeyInclusive, bool highKeyInclusive, RM_IndexScanIterator &rm_IndexScanIterator);
+
+        RC close();
+        bool isOpen() const;
+
+        const std::string& getTableName() const;
+        // Attributes of the current version when the table was last resolved
+        const std::vector<Attribute>& getAttributes() const;
+
+    private:
+        friend class RelationManager;
+
+        RC resolve();
+        RC checkCatalogVersion();
+        void release();             // Unpin all files
+        RC updateIndexes(const uint8_t* data, const RID& rid, bool isInsert);
+
+        RelationManager* rm;
+        std::string tableName;
+        bool isWritable;            // Catalog tables are read only
+        uint64_t catalogVersion;    // Catalog version the table was resolved at
+
+        // Schema, versions and indexes are read from the catalog cache entry, never copied
+        std::shared_ptr<CatalogCacheEntry> catalogEntry;
+        const std::vector<Attribute>* attrs;        // Attributes of the current version in catalogEntry
+
+        FileHandle* fileHandle;
+        uint64_t fileOpenSeq;
+        std::vector<IXFileHandle*> ixFileHandles;   // One for each index of catalogEntry
+        std::vector<uint64_t> ixOpenSeqs;
     };
 
     // Relation Manager
@@ -157,11 +323,13 @@ namespace PeterDB {
         FileHandle catalogColumnsFH;
         FileHandle catalogIndexesFH;
 
-        FileHandle tableFileHandle;
-        IXFileHandle ixFileHandle;
+        // Table and index files shared by all operations and scans
+        FileHandleCache fileHandleCache;
 
-        std::vector<IXFileHandle*> ixScanFHList;
-        std::unordered_map<std::string, IXFileHandle*> ixFHMap;
+        // Catalog lookups of DML are served from here, any change to the catalog drops all entries
+        std::unordered_map<std::string, std::shared_ptr<CatalogCacheEntry>> catalogCache;
+        uint64_t catalogVersion = 0;        // Bumped whenever the cache is dropped
+        float indexFillFactor = IX::BULKLOAD_FILL_FACTOR_DEFAULT;      // Share of each page filled by createIndex
     public:
         static RelationManager &instance();
 
@@ -175,14 +343,27 @@ namespace PeterDB {
 
         RC getAttributes(const std::string &tableName, std::vector<Attribute> &attrs);
 
+        // Resolve a table once for repeated DML, see TableHandle
+        RC openTable(const std::string &tableName, TableHandle &tableHandle);
+
         RC insertTuple(const std::string &tableName, const void *data, RID &rid);
 
+        // Insert a batch of tuples, rids[i] is the rid of tuples[i]
+        // Tuples are packed into new heap pages, then each index takes the new entries in key order
+        // If a tuple fails, the tuples before it stay inserted and indexed, rids.size() is the index of the failing one
+        // If an index fails, all tuples stay inserted and rids lists them, indexes may lack some of their entries
+        RC insertTuples(const std::string &tableName, const std::vector<const void *> &tuples, std::vector<RID> &rids);
+
         RC deleteTuple(const std::string &tableName, const RID &rid);
 
         RC updateTuple(const std::string &tableName, const void *data, const RID &rid);
 
         RC readTuple(const std::string &tableName, const RID &rid, void *data);
 
+        // Read the tuples of rids, which should be sorted by (pageNum, slotNum) so every heap page is read once
+        RC readTuples(const std::string &tableName, const std::vector<RID> &rids,
+                      std::vector<std::vector<uint8_t>> &tuples);
+
         // Print a tuple that is passed to this utility method.
         // The format is the same as printRecord().
         RC printTuple(const std::vector<Attribute> &attrs, const void *data, std::ostream &out);
@@ -208,6 +389,21 @@ namespace PeterDB {
 
         RC destroyIndex(const std::string &tableName, const std::string &attrName);
 
+        // Composite index over an ordered list of attributes
+        RC createIndex(const std::string &tableName, const std::vector<std::string> &attrNames);
+
+        RC destroyIndex(const std::string &tableName, const std::vector<std::string> &attrNames);
+
+        // Covering index, leaf entries also carry the values of the included attributes
+        RC createIndex(const std::string &tableName, const std::vector<std::string> &keyAttrNames,
+                       const std::vector<std::string> &includedAttrNames);
+
+        RC destroyIndex(const std::string &tableName, const std::vector<std::string> &keyAttrNames,
+                        const std::vector<std::string> &includedAttrNames);
+
+        // Pages of indexes built afterwards are filled up to this share, the rest is left for later inserts
+        void setIndexFillFactor(float factor);
+
         // indexScan returns an iterator to allow the caller to go through qualified entries in index
         RC indexScan(const std::string &tableName,
                      const std::string &attrName,
@@ -217,6 +413,25 @@ namespace PeterDB {
                      bool highKeyInclusive,
                      RM_IndexScanIterator &rm_IndexScanIterator);
 
+        // Range scan on a prefix of a composite index, keys follow the insertTuple() format over attrNames
+        RC indexScan(const std::string &tableName,
+                     const std::vector<std::string> &attrNames,
+                     const void *lowKey,
+                     const void *highKey,
+                     bool lowKeyInclusive,
+                     bool highKeyInclusive,
+                     RM_IndexScanIterator &rm_IndexScanIterator);
+
+        // Same as above, but only uses an index whose entries carry all of coveredAttrNames
+        RC indexScan(const std::string &tableName,
+                     const std::vector<std::string> &attrNames,
+                     const std::vector<std::string> &coveredAttrNames,
+                     const void *lowKey,
+                     const void *highKey,
+                     bool lowKeyInclusive,
+                     bool highKeyInclusive,
+                     RM_IndexScanIterator &rm_IndexScanIterator);
+
     public:
         RC insertTableColIntoCatalog(const std::string& tableName, std::vector<Attribute> schema);
         RC insertIndexIntoCatalog(const int32_t tableID, const std::string& attrName, const std::string& fileName);
@@ -230,18 +445,47 @@ namespace PeterDB {
         RC getTableMetaData(const std::string& tableName, CatalogTablesRecord& tableRecord);
         RC getTableMetaDataAndRID(const std::string& tableName, CatalogTablesRecord& tableRecord, RID& rid);
         RC getIndexes(const std::string& tableName, std::unordered_map<std::string, std::string>& indexedAttrAndFileName);
+        // Load the catalog records of the table on a miss, the entry is valid until the next DDL
+        RC getCatalogCacheEntry(const std::string& tableName, std::shared_ptr<CatalogCacheEntry>& entry);
+        void invalidateCatalogCache();
+        uint64_t getCatalogVersion();
+        RC getTableFileHandle(const std::string& tableName, FileHandle*& fileHandle);
+        void closeIndexFileHandle(const std::string& fileName);
+        FileHandleCache& getFileHandleCache();
+        RC getIndexKeyAttrs(const std::vector<Attribute>& attrs, const std::string& indexName,
+                            std::vector<uint32_t>& keyAttrIndex, Attribute& keyAttr);
+        // Fill an empty index file with the keys of every record, the scan and the file are closed on any failure
+        RC bulkLoadIndex(const std::string& tableFileName, const std::vector<Attribute>& attrs,
+                         const std::vector<uint32_t>& keyAttrIndex, uint32_t keyAttrNum,
+                         const Attribute& keyAttr, const std::string& ixFileName);
+        uint32_t getIndexKeyAttrNum(const std::string& indexName);
+        // "dict" holds the offset of every attribute in data
+        RC updateIndex(IXFileHandle& ixFileHandle, const TableIndex& index, const std::vector<Attribute>& attrs,
+                       const uint8_t* data, const std::vector<int16_t>& dict, const RID& rid, bool isInsert);
+        // Sort the entries of all tuples by key, so consecutive entries land in the same leaf
+        RC insertIndexEntries(IXFileHandle& ixFileHandle, const TableIndex& index, const std::vector<Attribute>& attrs,
+                              const std::vector<const void *>& tuples, const std::vector<RID>& rids);
+        // Attributes of every version that survive up to the current version, in the order of that version
+        void buildProjAttrVersionMap(const std::unordered_map<int32_t, std::vector<Attribute>>& attrVersionMap,
+                                     int32_t tableVersion,
+                                     std::unordered_map<int32_t, std::vector<Attribute>>& projAttrVersionMap);
+        // Only key attributes decide, included attributes are carried along and may be null
+        bool isIndexKeyNull(const uint8_t* data, const std::vector<uint32_t>& keyAttrIndex, uint32_t keyAttrNum);
 
         bool isTableAccessible(const std::string& tableName);
         bool isTableNameValid(const std::string& tableName);
 
         std::string getTableFileName(const std::string& tableName);
         std::string getIndexFileName(const std::string& tableName, const std::string& attrName);
+        std::string getIndexName(const std::vector<std::string>& attrNames,
+                                 const std::vector<std::string>& includedAttrNames = {});
+        std::vector<std::string> splitIndexName(const std::string& indexName);
 
     protected:
         RelationManager();                                                  // Prevent construction
         ~RelationManager();                                                 // Prevent unwanted destruction
-        RelationManager(const RelationManager &);                           // Prevent construction by copying
-        RelationManager &operator=(const RelationManager &);                // Prevent assignment
+        RelationManager(const RelationManager &) = delete;                  // Prevent construction by copying
+        RelationManager &operator=(const RelationManager &) = delete;       // Prevent assignment
 
     };
 
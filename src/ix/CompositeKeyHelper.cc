@@ -0,0 +1,137 @@
+#include "src/include/ix.h"
+
+namespace PeterDB {
+    Attribute CompositeKeyHelper::getKeyAttribute(const std::string& name, const std::vector<Attribute>& keyAttrs) {
+        AttrLength keyLen = 0;
+        for(const Attribute& attr: keyAttrs) {
+            keyLen += sizeof(IX::COMPKEY_NOT_NULL);
+            if(attr.type == TypeVarChar) {
+                // Every byte may be escaped
+                keyLen += attr.length * 2 + 2;
+            }
+            else {
+                keyLen += sizeof(int32_t);
+            }
+        }
+        return Attribute{name, TypeVarChar, keyLen};
+    }
+
+    RC CompositeKeyHelper::encode(const uint8_t* data, const std::vector<Attribute>& attrs, const std::vector<uint32_t>& keyAttrIndex, uint8_t* key) {
+        std::vector<int16_t> dict(attrs.size());
+        ApiDataHelper::buildDict((uint8_t *)data, attrs, dict);
+
+        int32_t keyLen = 0;
+        uint8_t* pos = key + sizeof(int32_t);
+        for(uint32_t index: keyAttrIndex) {
+            if(index >= attrs.size()) {
+                return ERR_ATTR_NOT_EXIST;
+            }
+            if(RecordHelper::isAttrNull((uint8_t *)data, index)) {
+                pos[keyLen++] = IX::COMPKEY_NULL;
+                continue;
+            }
+            pos[keyLen++] = IX::COMPKEY_NOT_NULL;
+            const uint8_t* value = data + dict[index];
+            switch (attrs[index].type) {
+                case TypeInt: {
+                    uint32_t bits;
+                    memcpy(&bits, value, sizeof(int32_t));
+                    bits ^= 0x80000000u;
+                    for(int i = 3; i >= 0; i--) {
+                        pos[keyLen++] = (bits >> (i * 8)) & 0xFF;
+                    }
+                    break;
+                }
+                case TypeReal: {
+                    float real;
+                    memcpy(&real, value, sizeof(float));
+                    if(real == 0) {
+                        real = 0;       // -0.0 equals 0.0
+                    }
+                    uint32_t bits;
+                    memcpy(&bits, &real, sizeof(float));
+                    bits = (bits & 0x80000000u) ? ~bits : bits ^ 0x80000000u;
+                    for(int i = 3; i >= 0; i--) {
+                        pos[keyLen++] = (bits >> (i * 8)) & 0xFF;
+                    }
+                    break;
+                }
+                case TypeVarChar: {
+                    int32_t strLen;
+                    memcpy(&strLen, value, sizeof(int32_t));
+                    for(int32_t i = 0; i < strLen; i++) {
+                        uint8_t c = value[sizeof(int32_t) + i];
+                        pos[keyLen++] = c;
+                        if(c == IX::COMPKEY_STR_ESCAPE) {
+                            pos[keyLen++] = IX::COMPKEY_STR_ESCAPED_ZERO;
+                        }
+                    }
+                    pos[keyLen++] = IX::COMPKEY_STR_ESCAPE;
+                    pos[keyLen++] = IX::COMPKEY_STR_END;
+                    break;
+                }
+                default:
+                    return ERR_KEY_TYPE_NOT_SUPPORT;
+            }
+        }
+        memcpy(key, &keyLen, sizeof(int32_t));
+        return 0;
+    }
+
+    RC CompositeKeyHelper::decode(const uint8_t* key, const std::vector<Attribute>& keyAttrs, uint8_t* data) {
+        int32_t keyLen;
+        memcpy(&keyLen, key, sizeof(int32_t));
+        const uint8_t* pos = key + sizeof(int32_t);
+        int32_t keyPos = 0;
+
+        int16_t nullByteNum = ceil(keyAttrs.size() / 8.0);
+        bzero(data, nullByteNum);
+        int16_t dataPos = nullByteNum;
+        for(uint32_t i = 0; i < keyAttrs.size(); i++) {
+            if(keyPos >= keyLen) {
+                return ERR_IMPOSSIBLE;
+            }
+            if(pos[keyPos++] == IX::COMPKEY_NULL) {
+                RecordHelper::setAttrNull(data, i);
+                continue;
+            }
+            switch (keyAttrs[i].type) {
+                case TypeInt:
+                case TypeReal: {
+                    uint32_t bits = 0;
+                    for(int j = 0; j < 4; j++) {
+                        bits = (bits << 8) | pos[keyPos++];
+                    }
+                    if(keyAttrs[i].type == TypeInt) {
+                        bits ^= 0x80000000u;
+                    }
+                    else {
+                        bits = (bits & 0x80000000u) ? bits ^ 0x80000000u : ~bits;
+                    }
+                    memcpy(data + dataPos, &bits, sizeof(int32_t));
+                    dataPos += sizeof(int32_t);
+                    break;
+                }
+                case TypeVarChar: {
+                    int32_t strLen = 0;
+                    uint8_t* str = data + dataPos + sizeof(int32_t);
+                    while(keyPos + 1 < keyLen) {
+                        uint8_t c = pos[keyPos++];
+                        if(c == IX::COMPKEY_STR_ESCAPE) {
+                            if(pos[keyPos++] == IX::COMPKEY_STR_END) {
+                                break;
+                            }
+                        }
+                        str[strLen++] = c;
+                    }
+                    memcpy(data + dataPos, &strLen, sizeof(int32_t));
+                    dataPos += sizeof(int32_t) + strLen;
+                    break;
+                }
+                default:
+                    return ERR_KEY_TYPE_NOT_SUPPORT;
+            }
+        }
+        return 0;
+    }
+}
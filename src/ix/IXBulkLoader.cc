@@ -0,0 +1,526 @@
+#include <unistd.h>
+#include <cerrno>
+
+#include "src/include/ix.h"
+
+namespace PeterDB {
+    // Sequential reader of a spilled run, entries are composite keys (key + rid)
+    class BulkLoadRunReader {
+    public:
+        std::ifstream in;
+        uint8_t entry[PAGE_SIZE];
+        bool isEnd = false;
+
+        void next(const Attribute& attr) {
+            int16_t keyLen = sizeof(int32_t);
+            if(!in.read((char *)entry, sizeof(int32_t))) {
+                isEnd = true;
+                return;
+            }
+            if(attr.type == TypeVarChar) {
+                int32_t strLen;
+                memcpy(&strLen, entry, sizeof(int32_t));
+                if(!in.read((char *)entry + keyLen, strLen)) {
+                    isEnd = true;
+                    return;
+                }
+                keyLen += strLen;
+            }
+            if(!in.read((char *)entry + keyLen, IX::PAGE_RID_LEN)) {
+                isEnd = true;
+            }
+        }
+    };
+
+    IX_BulkLoader::IX_BulkLoader() {
+        ixFileHandlePtr = nullptr;
+        fillFactor = IX::BULKLOAD_FILL_FACTOR_DEFAULT;
+        memoryBudget = IX::BULKLOAD_MEMORY_BUDGET_DEFAULT;
+        pageDataLen = 0;
+        pageCounter = 0;
+        pageNum = IX::PAGE_PTR_NULL;
+        postingKeyLen = 0;
+        batchPageNum = 0;
+    }
+
+    IX_BulkLoader::~IX_BulkLoader() {
+        removeRuns();
+    }
+
+    RC IX_BulkLoader::open(IXFileHandle* ixFileHandle, const Attribute& attr) {
+        if(!ixFileHandle->isOpen()) {
+            return ERR_FILE_NOT_OPEN;
+        }
+        if(ixFileHandle->isRootPageExist() && !ixFileHandle->isRootNull()) {
+            return ERR_INDEX_NOT_EMPTY;
+        }
+        removeRuns();
+        this->ixFileHandlePtr = ixFileHandle;
+        this->attr = attr;
+        runData.clear();
+        runEntryOffsets.clear();
+        return 0;
+    }
+
+    void IX_BulkLoader::setFillFactor(float factor) {
+        fillFactor = std::min(factor, 1.0f);    // A page takes at least one entry
+    }
+
+    void IX_BulkLoader::setMemoryBudget(uint64_t bytes) {
+        memoryBudget = bytes;
+    }
+
+    RC IX_BulkLoader::addEntry(const void* key, const RID& rid) {
+        if(!ixFileHandlePtr) {
+            return ERR_FILE_NOT_OPEN;
+        }
+        int16_t keyLen = IXPageHandle::getKeyLen((const uint8_t *)key, attr);
+        uint32_t offset = runData.size();
+        runData.resize(offset + keyLen + IX::PAGE_RID_LEN);
+        memcpy(runData.data() + offset, key, keyLen);
+        memcpy(runData.data() + offset + keyLen, &rid.pageNum, IX::PAGE_RID_PAGE_LEN);
+        memcpy(runData.data() + offset + keyLen + IX::PAGE_RID_PAGE_LEN, &rid.slotNum, IX::PAGE_RID_SLOT_LEN);
+        runEntryOffsets.push_back(offset);
+
+        if(runData.size() + runEntryOffsets.size() * sizeof(uint32_t) >= memoryBudget) {
+            return spillRun();
+        }
+        return 0;
+    }
+
+    RC IX_BulkLoader::close() {
+        if(!ixFileHandlePtr) {
+            return ERR_FILE_NOT_OPEN;
+        }
+        RC ret = 0;
+        if(runEntryOffsets.empty() && runFileNames.empty()) {
+            ixFileHandlePtr = nullptr;
+            return 0;
+        }
+        if(!ixFileHandlePtr->isRootPageExist()) {
+            ret = ixFileHandlePtr->createRootPage();
+            if(ret) return ret;
+        }
+
+        pageDataLen = 0;
+        indexPageData.clear();
+        pageCounter = 0;
+        levelKeys.clear();
+        levelKeyOffsets.clear();
+        levelPages.clear();
+        postingKeyLen = 0;
+        postingRids.clear();
+        lastPostingKey.clear();
+        overflowRids.clear();
+        overflowEntries.clear();
+        pageBatch.resize(PFM::VECTORED_IO_PAGE_NUM * PAGE_SIZE);
+        batchPageNum = 0;
+
+        // 1. Fill leaves left to right with sorted entries
+        if(runFileNames.empty()) {
+            sortRun();
+            for(uint32_t offset: runEntryOffsets) {
+                ret = addLeafEntry(runData.data() + offset);
+                if(ret) return ret;
+            }
+        }
+        else {
+            ret = spillRun();
+            if(ret) return ret;
+            ret = mergeRuns();
+            if(ret) return ret;
+        }
+        ret = flushPostingEntry();
+        if(ret) return ret;
+        ret = finishLeafPage(true);
+        if(ret) return ret;
+
+        // 2. Build index levels bottom-up until a single page is left as root
+        while(levelPages.size() > 1) {
+            ret = buildIndexLevel();
+            if(ret) return ret;
+        }
+        ret = flushPageBatch();
+        if(ret) return ret;
+        ret = ixFileHandlePtr->setRoot(levelPages.front());
+        if(ret) return ret;
+
+        abort();
+        return 0;
+    }
+
+    void IX_BulkLoader::abort() {
+        removeRuns();
+        runData.clear();
+        runEntryOffsets.clear();
+        ixFileHandlePtr = nullptr;
+    }
+
+    void IX_BulkLoader::sortRun() {
+        const uint8_t* entries = runData.data();
+        const Attribute& keyAttr = attr;
+        std::sort(runEntryOffsets.begin(), runEntryOffsets.end(), [entries, &keyAttr](uint32_t a, uint32_t b) {
+            return IXPageHandle::compareCompositeKey(entries + a, entries + b, keyAttr) < 0;
+        });
+    }
+
+    RC IX_BulkLoader::spillRun() {
+        if(runEntryOffsets.empty()) {
+            return 0;
+        }
+        sortRun();
+
+        std::string runFileName = getRunFileName(runFileNames.size());
+        std::string runDirName = runFileName.substr(0, runFileName.rfind('/'));
+        if(::mkdir(runDirName.c_str(), 0755) != 0 && errno != EEXIST) {
+            LOG(ERROR) << "Fail to create " << runDirName << ", errno " << errno << " @ IX_BulkLoader::spillRun" << std::endl;
+            return ERR_BULKLOAD_RUN;
+        }
+        runFileNames.push_back(runFileName);
+        std::ofstream out(runFileName, std::ios::binary | std::ios::trunc);
+        for(uint32_t offset: runEntryOffsets) {
+            const uint8_t* compKey = runData.data() + offset;
+            out.write((const char *)compKey, IXPageHandle::getKeyLen(compKey, attr) + IX::PAGE_RID_LEN);
+        }
+        out.close();
+        if(!out.good()) {
+            LOG(ERROR) << "Fail to write " << runFileName << " @ IX_BulkLoader::spillRun" << std::endl;
+            return ERR_BULKLOAD_RUN;
+        }
+        runData.clear();
+        runEntryOffsets.clear();
+        return 0;
+    }
+
+    // K-way merge of sorted runs, the smallest head entry goes to the leaves first
+    RC IX_BulkLoader::mergeRuns() {
+        RC ret = 0;
+        std::vector<std::unique_ptr<BulkLoadRunReader>> readers;
+        for(const std::string& runFileName: runFileNames) {
+            readers.emplace_back(new BulkLoadRunReader);
+            readers.back()->in.open(runFileName, std::ios::binary);
+            if(!readers.back()->in.good()) {
+                LOG(ERROR) << "Fail to open " << runFileName << " @ IX_BulkLoader::mergeRuns" << std::endl;
+                return ERR_BULKLOAD_RUN;
+            }
+        }
+
+        const Attribute& keyAttr = attr;
+        auto isHeadGreater = [&readers, &keyAttr](uint32_t a, uint32_t b) {
+            return IXPageHandle::compareCompositeKey(readers[a]->entry, readers[b]->entry, keyAttr) > 0;
+        };
+        std::priority_queue<uint32_t, std::vector<uint32_t>, decltype(isHeadGreater)> heads(isHeadGreater);
+        for(uint32_t i = 0; i < readers.size(); i++) {
+            readers[i]->next(attr);
+            if(!readers[i]->isEnd) {
+                heads.push(i);
+            }
+        }
+        while(!heads.empty()) {
+            uint32_t i = heads.top();
+            heads.pop();
+            ret = addLeafEntry(readers[i]->entry);
+            if(ret) return ret;
+            readers[i]->next(attr);
+            if(!readers[i]->isEnd) {
+                heads.push(i);
+            }
+        }
+        return 0;
+    }
+
+    void IX_BulkLoader::removeRuns() {
+        if(runFileNames.empty()) {
+            return;
+        }
+        std::string runDirName = runFileNames.front().substr(0, runFileNames.front().rfind('/'));
+        for(const std::string& runFileName: runFileNames) {
+            remove(runFileName.c_str());
+        }
+        runFileNames.clear();
+        ::rmdir(runDirName.c_str());    // Fails while other loads still have runs in it
+    }
+
+    RC IX_BulkLoader::addLeafEntry(const uint8_t* compKey) {
+        RC ret = 0;
+        int16_t keyLen = IXPageHandle::getKeyLen(compKey, attr);
+        if(ixFileHandlePtr->getFormatVersion() < IX::FILE_VERSION_POSTING) {
+            return appendLeafEntry(compKey, keyLen + IX::PAGE_RID_LEN, compKey);
+        }
+
+        // Sorted rids of a key come together, its posting list is written once the key changes
+        if(postingKeyLen > 0 && IXPageHandle::compareKey(postingKey, compKey, attr) == 0) {
+            postingRids.insert(postingRids.end(), compKey + keyLen, compKey + keyLen + IX::PAGE_RID_LEN);
+            return 0;
+        }
+        ret = flushPostingEntry();
+        if(ret) return ret;
+        memcpy(postingKey, compKey, keyLen);
+        postingKeyLen = keyLen;
+        postingRids.assign(compKey + keyLen, compKey + keyLen + IX::PAGE_RID_LEN);
+        return 0;
+    }
+
+    // Same rule as LeafPageHandle::isPostingSpill, lists beyond the inline limit go to overflow pages
+    RC IX_BulkLoader::flushPostingEntry() {
+        RC ret = 0;
+        if(postingKeyLen == 0) {
+            return 0;
+        }
+        int32_t ridNum = postingRids.size() / IX::PAGE_RID_LEN;
+        int32_t inlineLen = postingKeyLen + IX::POSTING_RID_NUM_LEN + postingRids.size();
+        bool isOverflow = ridNum > 1 && inlineLen > IX::POSTING_INLINE_MAX_LEN;
+
+        uint8_t entry[PAGE_SIZE];
+        int16_t entryLen = postingKeyLen;
+        memcpy(entry, postingKey, postingKeyLen);
+        int16_t ridNumField = isOverflow ? IX::POSTING_OVERFLOW : (int16_t)ridNum;
+        memcpy(entry + entryLen, &ridNumField, IX::POSTING_RID_NUM_LEN);
+        entryLen += IX::POSTING_RID_NUM_LEN;
+        if(isOverflow) {
+            // Chain pointers are set when the leaf is finished
+            bzero(entry + entryLen, 2 * IX::POSTING_OVERFLOW_PTR_LEN);
+            entryLen += 2 * IX::POSTING_OVERFLOW_PTR_LEN;
+        }
+        else {
+            memcpy(entry + entryLen, postingRids.data(), postingRids.size());
+            entryLen += postingRids.size();
+        }
+
+        // Separators only route by key, in prefix files the shortest one above the key written before is enough
+        uint8_t firstCompKey[PAGE_SIZE];
+        if(lastPostingKey.empty() || ixFileHandlePtr->getFormatVersion() < IX::FILE_VERSION_PREFIX) {
+            memcpy(firstCompKey, postingKey, postingKeyLen);
+            bzero(firstCompKey + postingKeyLen, IX::PAGE_RID_LEN);
+        }
+        else {
+            IXPageHandle::getShortestSeparator(firstCompKey, lastPostingKey.data(), postingKey, attr);
+        }
+        ret = appendLeafEntry(entry, entryLen, firstCompKey);
+        if(ret) return ret;
+        lastPostingKey.assign(postingKey, postingKey + postingKeyLen);
+
+        if(isOverflow) {
+            overflowEntries.emplace_back(pageDataLen - entryLen, ridNum);
+            overflowRids.insert(overflowRids.end(), postingRids.begin(), postingRids.end());
+        }
+        postingKeyLen = 0;
+        postingRids.clear();
+        return 0;
+    }
+
+    RC IX_BulkLoader::appendLeafEntry(const uint8_t* entry, int16_t entryLen, const uint8_t* firstCompKey) {
+        RC ret = 0;
+        int16_t headerLen = IX::PAGE_TYPE_LEN + IX::PAGE_FREEBYTE_PTR_LEN + IX::PAGE_COUNTER_LEN + IX::LEAFPAGE_NEXT_PTR_LEN;
+        if(pageCounter > 0 && pageDataLen + entryLen + (pageCounter + 1) * getSlotLen() > getPageCapacity(headerLen)) {
+            ret = finishLeafPage(false);
+            if(ret) return ret;
+        }
+        if(pageCounter == 0) {
+            pageNum = getNextPageNum();
+            int16_t compKeyLen = IXPageHandle::getKeyLen(firstCompKey, attr) + IX::PAGE_RID_LEN;
+            levelKeyOffsets.push_back(levelKeys.size());
+            levelKeys.insert(levelKeys.end(), firstCompKey, firstCompKey + compKeyLen);
+            levelPages.push_back(pageNum);
+        }
+        memcpy(pageData + pageDataLen, entry, entryLen);
+        pageDataLen += entryLen;
+        pageCounter++;
+        return 0;
+    }
+
+    // The leaf is followed by the overflow pages of its entries, then by the next leaf
+    RC IX_BulkLoader::finishLeafPage(bool isLastLeaf) {
+        RC ret = 0;
+        if(pageCounter == 0) {
+            return 0;
+        }
+        int16_t overflowHeaderLen = IX::PAGE_TYPE_LEN + IX::PAGE_FREEBYTE_PTR_LEN + IX::PAGE_COUNTER_LEN + IX::OVERFLOWPAGE_NEXT_PTR_LEN;
+        int16_t ridsPerPage = std::max(getPageCapacity(overflowHeaderLen) / IX::PAGE_RID_LEN, 1);
+        uint32_t overflowPageNum = 0;
+        for(auto& overflowEntry: overflowEntries) {
+            uint32_t head = pageNum + 1 + overflowPageNum;
+            overflowPageNum += (overflowEntry.second + ridsPerPage - 1) / ridsPerPage;
+            uint32_t tail = pageNum + overflowPageNum;
+            int16_t ptrPos = overflowEntry.first + IXPageHandle::getKeyLen(pageData + overflowEntry.first, attr) + IX::POSTING_RID_NUM_LEN;
+            memcpy(pageData + ptrPos, &head, IX::POSTING_OVERFLOW_PTR_LEN);
+            memcpy(pageData + ptrPos + IX::POSTING_OVERFLOW_PTR_LEN, &tail, IX::POSTING_OVERFLOW_PTR_LEN);
+        }
+        {
+            uint32_t nextLeafPage = isLastLeaf ? IX::PAGE_PTR_NULL : pageNum + 1 + overflowPageNum;
+            LeafPageHandle leafPH(*ixFileHandlePtr, pageBatch.data() + batchPageNum * PAGE_SIZE, pageNum, nextLeafPage,
+                                  pageData, pageDataLen, pageCounter);
+            leafPH.rebuildSlots(attr);
+        }
+        pageDataLen = 0;
+        pageCounter = 0;
+        ret = appendBuiltPage();
+        if(ret) return ret;
+
+        uint32_t overflowPage = pageNum + 1;
+        uint8_t* rids = overflowRids.data();
+        for(auto& overflowEntry: overflowEntries) {
+            for(int32_t ridLeft = overflowEntry.second; ridLeft > 0; ridLeft -= ridsPerPage) {
+                int16_t ridNum = std::min<int32_t>(ridLeft, ridsPerPage);
+                uint32_t nextPage = ridLeft > ridsPerPage ? overflowPage + 1 : IX::PAGE_PTR_NULL;
+                {
+                    OverflowPageHandle overflowPH(*ixFileHandlePtr, pageBatch.data() + batchPageNum * PAGE_SIZE,
+                                                  overflowPage, nextPage, rids, ridNum);
+                }
+                rids += ridNum * IX::PAGE_RID_LEN;
+                overflowPage++;
+                ret = appendBuiltPage();
+                if(ret) return ret;
+            }
+        }
+        overflowRids.clear();
+        overflowEntries.clear();
+        return 0;
+    }
+
+    // Children of the level are grouped into index pages, the first key of each page is pushed up
+    RC IX_BulkLoader::buildIndexLevel() {
+        RC ret = 0;
+        std::vector<uint8_t> childKeys;
+        std::vector<uint32_t> childKeyOffsets;
+        std::vector<uint32_t> childPages;
+        childKeys.swap(levelKeys);
+        childKeyOffsets.swap(levelKeyOffsets);
+        childPages.swap(levelPages);
+        auto getChildKey = [&](uint32_t i) { return childKeys.data() + childKeyOffsets[i]; };
+        auto getCompKeyLen = [&](uint32_t i) { return IXPageHandle::getKeyLen(getChildKey(i), attr) + IX::PAGE_RID_LEN; };
+
+        // 1. Fill pages up to the fill factor, every page takes at least one key
+        int16_t headerLen = IX::PAGE_TYPE_LEN + IX::PAGE_FREEBYTE_PTR_LEN + IX::PAGE_COUNTER_LEN;
+        std::vector<uint32_t> pageStarts;       // First child of every page
+        int32_t keyBytes = 0;
+        int16_t keyNum = 0;
+        for(uint32_t i = 0; i < childPages.size(); i++) {
+            int16_t compKeyLen = getCompKeyLen(i);
+            if(!pageStarts.empty() &&
+               (keyNum == 0 || getIndexPageLen(keyBytes + compKeyLen, keyNum + 1, getChildKey(pageStarts.back() + 1), getChildKey(i)) <= getPageCapacity(headerLen))) {
+                keyBytes += compKeyLen;
+                keyNum++;
+                continue;
+            }
+            pageStarts.push_back(i);
+            keyBytes = 0;
+            keyNum = 0;
+        }
+
+        // 2. A last page left with a single child has no key, it takes half of the children of the page before
+        if(pageStarts.size() > 1 && pageStarts.back() == childPages.size() - 1) {
+            uint32_t prevStart = pageStarts[pageStarts.size() - 2];
+            uint32_t childNum = childPages.size() - prevStart;
+            if(childNum < 4) {
+                // Two pages with a key each need 4 children, both pages go into one
+                pageStarts.pop_back();
+            }
+            else {
+                // The last page may go beyond the fill factor, but has to fit in the page
+                uint32_t start = prevStart + childNum / 2;
+                for(; start < childPages.size() - 2; start++) {
+                    keyBytes = 0;
+                    for(uint32_t i = start + 1; i < childPages.size(); i++) {
+                        keyBytes += getCompKeyLen(i);
+                    }
+                    keyNum = childPages.size() - start - 1;
+                    if(getIndexPageLen(keyBytes, keyNum, getChildKey(start + 1), getChildKey(childPages.size() - 1)) <= PAGE_SIZE - headerLen) {
+                        break;
+                    }
+                }
+                pageStarts.back() = start;
+            }
+        }
+
+        // 3. Write the pages
+        for(uint32_t p = 0; p < pageStarts.size(); p++) {
+            uint32_t end = p + 1 < pageStarts.size() ? pageStarts[p + 1] : childPages.size();
+            const uint8_t* compKey = getChildKey(pageStarts[p]);
+            const uint8_t* childPtr = (const uint8_t*)&childPages[pageStarts[p]];
+            pageNum = getNextPageNum();
+            levelKeyOffsets.push_back(levelKeys.size());
+            levelKeys.insert(levelKeys.end(), compKey, compKey + getCompKeyLen(pageStarts[p]));
+            levelPages.push_back(pageNum);
+            indexPageData.assign(childPtr, childPtr + IX::INDEXPAGE_CHILD_PTR_LEN);
+            for(uint32_t i = pageStarts[p] + 1; i < end; i++) {
+                compKey = getChildKey(i);
+                childPtr = (const uint8_t*)&childPages[i];
+                indexPageData.insert(indexPageData.end(), compKey, compKey + getCompKeyLen(i));
+                indexPageData.insert(indexPageData.end(), childPtr, childPtr + IX::INDEXPAGE_CHILD_PTR_LEN);
+                pageCounter++;
+            }
+            ret = finishIndexPage();
+            if(ret) return ret;
+        }
+        return 0;
+    }
+
+    // Bytes of an index page holding keyNum keys of keyBytes in total, firstKey and lastKey are its first and last key
+    int32_t IX_BulkLoader::getIndexPageLen(int32_t keyBytes, int16_t keyNum, const uint8_t* firstKey, const uint8_t* lastKey) {
+        int32_t pageLen = IX::INDEXPAGE_CHILD_PTR_LEN + keyBytes + keyNum * (IX::INDEXPAGE_CHILD_PTR_LEN + getSlotLen());
+        if(ixFileHandlePtr->getFormatVersion() >= IX::FILE_VERSION_PREFIX) {
+            // Keys are sorted, the page prefix is the part the first key shares with the last one
+            int16_t prefixLen = 0;
+            if(attr.type == TypeVarChar && keyNum > 1) {
+                prefixLen = IXPageHandle::getCommonPrefixLen(firstKey, lastKey);
+            }
+            pageLen += IX::INDEXPAGE_PREFIX_SIZE_LEN - (keyNum - 1) * prefixLen;
+        }
+        return pageLen;
+    }
+
+    // Keys are stored without the page prefix, so the page may take more entries than a page buffer holds in full
+    RC IX_BulkLoader::finishIndexPage() {
+        RC ret = 0;
+        if(indexPageData.empty()) {
+            return 0;
+        }
+        {
+            IndexPageHandle indexPH(*ixFileHandlePtr, pageBatch.data() + batchPageNum * PAGE_SIZE, pageNum,
+                                    indexPageData.data(), 0, 0);
+            ret = indexPH.setEntries(indexPageData.data(), indexPageData.size(), pageCounter, attr);
+            if(ret) return ret;
+        }
+        indexPageData.clear();
+        pageCounter = 0;
+        return appendBuiltPage();
+    }
+
+    int16_t IX_BulkLoader::getPageCapacity(int16_t headerLen) {
+        return (int16_t)((PAGE_SIZE - headerLen) * fillFactor);
+    }
+
+    int16_t IX_BulkLoader::getSlotLen() {
+        return ixFileHandlePtr->getFormatVersion() >= IX::FILE_VERSION_SLOTTED ? IX::PAGE_SLOT_LEN : 0;
+    }
+
+    // Pages are appended in the order they are built
+    uint32_t IX_BulkLoader::getNextPageNum() {
+        return ixFileHandlePtr->getPageCounter() + batchPageNum;
+    }
+
+    // Runs live in a directory next to the index file
+    std::string IX_BulkLoader::getRunFileName(uint32_t runIndex) {
+        std::string fileName = ixFileHandlePtr->getFileName();
+        size_t slashPos = fileName.rfind('/');
+        std::string dirName = slashPos == std::string::npos ? "" : fileName.substr(0, slashPos + 1);
+        std::string baseName = slashPos == std::string::npos ? fileName : fileName.substr(slashPos + 1);
+        return dirName + IX::BULKLOAD_RUN_DIR_NAME + "/" + baseName + "." + std::to_string(runIndex);
+    }
+
+    RC IX_BulkLoader::appendBuiltPage() {
+        batchPageNum++;
+        if(batchPageNum == PFM::VECTORED_IO_PAGE_NUM) {
+            return flushPageBatch();
+        }
+        return 0;
+    }
+
+    RC IX_BulkLoader::flushPageBatch() {
+        RC ret = ixFileHandlePtr->appendPages(pageBatch.data(), batchPageNum);
+        if(ret) return ret;
+        batchPageNum = 0;
+        return 0;
+    }
+}
@@ -10,13 +10,21 @@ namespace PeterDB {
         ixReadPageCounter = 0;
         ixWritePageCounter = 0;
         ixAppendPageCounter = 0;
-        fs = nullptr;
+        metaDataFlushInterval = PFM::METADATA_FLUSH_INTERVAL_DEFAULT;
+        metaDataDirtyOps = 0;
+        fileId = 0;
+        backend = nullptr;
         rootPagePtr = IX::PAGE_PTR_NULL;
         root = IX::PAGE_PTR_NULL;
+        formatVersion = IX::FILE_VERSION_CURRENT;
+        freePageHead = IX::PAGE_PTR_NULL;
+        structureVersion = 0;
     }
 
     IXFileHandle::~IXFileHandle() {
-        flushMetaData();
+        if(metaDataDirtyOps) {
+            flushMetaData();
+        }
         flushRoot();
     }
 
@@ -27,11 +35,25 @@ namespace PeterDB {
         }
 
         fileName = tmpFileName;
-        fs = new fstream(fileName, std::fstream::in | std::fstream::out | std::fstream::binary);
-        if(!isOpen()) {
+        backend = PagedFileManager::instance().createStorageBackend();
+        if(backend->open(fileName)) {
+            delete backend;
+            backend = nullptr;
             return ERR_OPEN_FILE;
         }
+        ret = BufferPool::getFileId(fileName, fileId);
+        if(ret) return ret;
+
+        // Changes lost in a crash are redone into the index file, cached pages are stale
+        uint32_t redoPageNum;
+        ret = LogManager::instance().openLog(fileId, fileName, backend, redoPageNum);
+        if(ret) return ret;
+        if(redoPageNum) {
+            BufferPool::instance().discardFile(fileName);
+        }
 
+        formatVersion = IX::FILE_VERSION_CURRENT;     // Kept for a newly created file
+        freePageHead = IX::PAGE_PTR_NULL;
         ret = readMetaData();
         if(ret) return ret;
         if(isRootPageExist()) {
@@ -44,76 +66,175 @@ namespace PeterDB {
         if(!isOpen()) {
             return ERR_FILE_NOT_OPEN;
         }
-        flushMetaData();
-        flushRoot();
-        delete fs;
-        fs = nullptr;
-        return 0;
+        // The file is closed anyway, the first failure is reported
+        // Metadata pages are cached too, they are updated before the pages are written back
+        RC ret = 0;
+        if(metaDataDirtyOps) {
+            ret = flushMetaData();
+        }
+        RC rootRet = flushRoot();
+        ret = ret ? ret : rootRet;
+        uint64_t flushedLsn = LogManager::instance().getLastLsn(fileId);
+        RC flushRet = BufferPool::instance().flushFile(fileId, backend, flushedLsn);
+        ret = ret ? ret : flushRet;
+        if(!ret) {
+            // Keep the log for redo if pages could not be written back
+            ret = syncAndDropLog(flushedLsn);
+        }
+        LogManager::instance().closeLog(fileId);
+        RC closeRet = backend->close();
+        ret = ret ? ret : closeRet;
+        delete backend;
+        backend = nullptr;
+        pageLatches.clear();
+        return ret;
     }
 
     RC IXFileHandle::readPage(uint32_t pageNum, void* data) {
+        uint8_t* frameData = nullptr;
+        RC ret = pinPage(pageNum, frameData);
+        if(ret) {
+            return ret;
+        }
+        memcpy(data, frameData, PAGE_SIZE);
+        return unpinPage(pageNum, false);
+    }
+
+    RC IXFileHandle::writePage(uint32_t pageNum, const void* data) {
+        uint8_t* frameData = nullptr;
+        RC ret = pinPage(pageNum, frameData, true);
+        if(ret) {
+            return ret;
+        }
+        if(frameData != data) {
+            memcpy(frameData, data, PAGE_SIZE);
+        }
+        return unpinPage(pageNum, true);
+    }
+
+    RC IXFileHandle::pinPage(uint32_t pageNum, uint8_t*& frameData, bool isNewPage) {
         if(!isOpen()) {
             return ERR_FILE_NOT_OPEN;
         }
-        if(pageNum >= ixAppendPageCounter) {
+        if(pageNum >= getPageCounter()) {
             return ERR_PAGE_NOT_EXIST;
         }
 
-        fs->clear();
-        fs->seekg(pageNum * PAGE_SIZE, fs->beg);  // Page is 0-indexed
-        fs->read((char *)data, PAGE_SIZE);
-        if(!fs->good()) {
+        bool isHit;
+        RC ret = BufferPool::instance().pinPage(fileId, backend, pageNum, !isNewPage, frameData, isHit);  // Page is 0-indexed
+        if(ret) {
             return ERR_READ_PAGE;
         }
-        ixReadPageCounter++;
-        flushMetaData();
+        if(!isNewPage) {
+            std::lock_guard<std::recursive_mutex> guard(metaDataMutex);
+            ixReadPageCounter++;
+            markMetaDataDirty();
+        }
         return 0;
     }
 
-    RC IXFileHandle::writePage(uint32_t pageNum, const void* data) {
-        if(!isOpen()) {
-            return ERR_FILE_NOT_OPEN;
-        }
-        if(pageNum >= ixAppendPageCounter) {
-            return ERR_PAGE_NOT_EXIST;
+    RC IXFileHandle::unpinPage(uint32_t pageNum, bool isDirty) {
+        RC ret = BufferPool::instance().unpinPage(fileId, backend, pageNum, isDirty);
+        if(ret) {
+            return ret;
         }
-
-        fs->clear();
-        fs->seekp(pageNum * PAGE_SIZE, fs->beg);  // Page is 0-indexed
-        fs->write((char *)data, PAGE_SIZE);
-        fs->flush(); // IMPORTANT!
-        if(!fs->good()) {
-            return ERR_WRITE_PAGE;
+        if(isDirty) {
+            std::lock_guard<std::recursive_mutex> guard(metaDataMutex);
+            ixWritePageCounter++;
+            markMetaDataDirty();
         }
-        ixWritePageCounter++;
-        flushMetaData();
         return 0;
     }
 
     RC IXFileHandle::appendPage(const void* data) {
+        std::lock_guard<std::recursive_mutex> guard(metaDataMutex);
         if(!isOpen()) {
             return ERR_FILE_NOT_OPEN;
         }
 
-        fs->clear();
-        fs->seekp(ixAppendPageCounter * PAGE_SIZE);
-        fs->write((char *)data, PAGE_SIZE);
-        fs->flush(); // IMPORTANT!
-        if(!fs->good()) {
+        if(backend->write((uint64_t)ixAppendPageCounter * PAGE_SIZE, data, PAGE_SIZE) || backend->flush()) {
             return ERR_APPEND_PAGE;
         }
+        LogManager::instance().logPage(fileId, ixAppendPageCounter, data);
+        LogManager::instance().commitGroup(fileId);
         ixAppendPageCounter++;
-        flushMetaData();
+        markMetaDataDirty();
         return 0;
     }
 
-    RC IXFileHandle::appendEmptyPage() {
+    RC IXFileHandle::appendPages(const void* data, uint32_t pageCount) {
+        {
+            std::lock_guard<std::recursive_mutex> guard(metaDataMutex);
+            if(!isOpen()) {
+                return ERR_FILE_NOT_OPEN;
+            }
+            if(pageCount == 0) {
+                return 0;
+            }
+
+            if(backend->write((uint64_t)ixAppendPageCounter * PAGE_SIZE, data, pageCount * PAGE_SIZE) || backend->flush()) {
+                return ERR_APPEND_PAGE;
+            }
+            LogManager& logManager = LogManager::instance();
+            for(uint32_t i = 0; i < pageCount; i++) {
+                logManager.logPage(fileId, ixAppendPageCounter + i, (const uint8_t *)data + (size_t)i * PAGE_SIZE);
+            }
+            logManager.commitGroup(fileId);
+            ixAppendPageCounter += pageCount;
+            markMetaDataDirty();
+        }
+        // The tree latch is taken after the metadata lock is released, as in changes of the tree
+        return checkpointIfLogFull();
+    }
+
+    RC IXFileHandle::appendEmptyPage(uint32_t& pageNum) {
+        std::lock_guard<std::recursive_mutex> guard(metaDataMutex);
+        RC ret = 0;
         uint8_t emptyPage[PAGE_SIZE];
+        if(freePageHead != IX::PAGE_PTR_NULL) {
+            ret = readPage(freePageHead, emptyPage);
+            int16_t pageType;
+            memcpy(&pageType, emptyPage + PAGE_SIZE - IX::PAGE_TYPE_LEN, IX::PAGE_TYPE_LEN);
+            if(ret == 0 && pageType == IX::PAGE_TYPE_FREE) {
+                pageNum = freePageHead;
+                memcpy(&freePageHead, emptyPage, IX::FREEPAGE_NEXT_PTR_LEN);
+                bzero(emptyPage, PAGE_SIZE);
+                ret = writePage(pageNum, emptyPage);
+                if(ret) return ret;
+                return flushMetaData();
+            }
+            // The list is not trusted any more, its pages are left unused
+            LOG(ERROR) << "Free page list broken at page " << freePageHead << " of " << fileName << " @ IXFileHandle::appendEmptyPage" << std::endl;
+            freePageHead = IX::PAGE_PTR_NULL;
+            flushMetaData();
+        }
         bzero(emptyPage, PAGE_SIZE);
-        return appendPage(emptyPage);
+        ret = appendPage(emptyPage);
+        if(ret) return ret;
+        pageNum = getLastPageIndex();
+        return 0;
+    }
+
+    // The page goes on top of the free list, scans standing on it have to find their place again
+    RC IXFileHandle::freePage(uint32_t pageNum) {
+        std::lock_guard<std::recursive_mutex> guard(metaDataMutex);
+        RC ret = 0;
+        if(pageNum < IX::FILE_HIDDEN_PAGE_NUM + IX::FILE_ROOT_PAGE_NUM || pageNum >= getPageCounter()) {
+            return ERR_PAGE_NOT_EXIST;
+        }
+        uint8_t freePage[PAGE_SIZE];
+        bzero(freePage, PAGE_SIZE);
+        memcpy(freePage, &freePageHead, IX::FREEPAGE_NEXT_PTR_LEN);
+        memcpy(freePage + PAGE_SIZE - IX::PAGE_TYPE_LEN, &IX::PAGE_TYPE_FREE, IX::PAGE_TYPE_LEN);
+        ret = writePage(pageNum, freePage);
+        if(ret) return ret;
+        freePageHead = pageNum;
+        structureVersion++;
+        return flushMetaData();
     }
 
     RC IXFileHandle::collectCounterValues(unsigned &readPageCount, unsigned &writePageCount, unsigned &appendPageCount) {
+        std::lock_guard<std::recursive_mutex> guard(metaDataMutex);
         readPageCount = ixReadPageCounter;
         writePageCount = ixWritePageCounter;
         appendPageCount = ixAppendPageCounter;
@@ -121,50 +242,146 @@ namespace PeterDB {
     }
 
     uint32_t IXFileHandle::getPageCounter() {
-        return ixAppendPageCounter;     // Page won't be deleted -> appendCount = pageCounter
+        std::lock_guard<std::recursive_mutex> guard(metaDataMutex);
+        return ixAppendPageCounter;     // Freed pages stay in the file -> appendCount = pageCounter
     }
 
     uint32_t IXFileHandle::getLastPageIndex() {
+        std::lock_guard<std::recursive_mutex> guard(metaDataMutex);
         return ixAppendPageCounter - 1;     // Page is 0-indexed, page 0: hidden page; page 1: root page
     }
 
     // Meta Data Format
-    // Read | Write | Append | RootPage
+    // Read | Write | Append | RootPage | Version | FreePage
     RC IXFileHandle::readMetaData() {
         if(!isOpen()) {
             return ERR_FILE_NOT_OPEN;
         }
-        fs->clear();
-        fs->seekg(fs->beg);
-        fs->read((char *)(&ixReadPageCounter), IX::FILE_COUNTER_LEN);
-        fs->read((char *)(&ixWritePageCounter), IX::FILE_COUNTER_LEN);
-        fs->read((char *)(&ixAppendPageCounter), IX::FILE_COUNTER_LEN);
-        fs->read((char *)(&rootPagePtr), IX::FILE_ROOTPAGE_PTR_LEN);
+        // A newly created file is empty, keep the initial values
+        uint64_t fileSize;
+        RC ret = backend->getFileSize(fileSize);
+        if(ret) return ret;
+        if(fileSize >= PAGE_SIZE) {
+            uint8_t hiddenPage[PAGE_SIZE];
+            ret = readMetaPage(0, hiddenPage, PAGE_SIZE);
+            if(ret) return ret;
+            memcpy(&ixReadPageCounter, hiddenPage, IX::FILE_COUNTER_LEN);
+            memcpy(&ixWritePageCounter, hiddenPage + IX::FILE_COUNTER_LEN, IX::FILE_COUNTER_LEN);
+            memcpy(&ixAppendPageCounter, hiddenPage + IX::FILE_COUNTER_LEN * 2, IX::FILE_COUNTER_LEN);
+            memcpy(&rootPagePtr, hiddenPage + IX::FILE_COUNTER_LEN * 3, IX::FILE_ROOTPAGE_PTR_LEN);
+            memcpy(&formatVersion, hiddenPage + IX::FILE_COUNTER_LEN * 3 + IX::FILE_ROOTPAGE_PTR_LEN, IX::FILE_VERSION_LEN);
+            memcpy(&freePageHead, hiddenPage + IX::FILE_COUNTER_LEN * 3 + IX::FILE_ROOTPAGE_PTR_LEN + IX::FILE_VERSION_LEN, IX::FILE_FREE_PAGE_PTR_LEN);
+            // Older files leave the version field zeroed
+            if(formatVersion == 0) {
+                formatVersion = IX::FILE_VERSION_LINEAR;
+            }
+            if(formatVersion > IX::FILE_VERSION_CURRENT) {
+                LOG(ERROR) << "Unknown format version " << formatVersion << " of " << fileName << " @ IXFileHandle::readMetaData" << std::endl;
+                return ERR_FILE_VERSION_NOT_SUPPORT;
+            }
+        }
+
+        // Counters are flushed lazily, pages are always appended to disk
+        // Rebuild the page counter from the file size
+        uint32_t filePageNum = fileSize / PAGE_SIZE;
+        if(filePageNum != ixAppendPageCounter) {
+            ixAppendPageCounter = filePageNum;
+            metaDataDirtyOps++;
+        }
         return 0;
     }
     RC IXFileHandle::flushMetaData() {
+        std::lock_guard<std::recursive_mutex> guard(metaDataMutex);
         if(!isOpen()) {
             return ERR_FILE_NOT_OPEN;
         }
-        fs->clear();
-        fs->seekp(fs->beg);
-        fs->write((char *)(&ixReadPageCounter), IX::FILE_COUNTER_LEN);
-        fs->write((char *)(&ixWritePageCounter), IX::FILE_COUNTER_LEN);
-        fs->write((char *)(&ixAppendPageCounter), IX::FILE_COUNTER_LEN);
-        fs->write((char *)(&rootPagePtr), IX::FILE_ROOTPAGE_PTR_LEN);
+        uint8_t metaData[IX::FILE_COUNTER_LEN * 3 + IX::FILE_ROOTPAGE_PTR_LEN + IX::FILE_VERSION_LEN + IX::FILE_FREE_PAGE_PTR_LEN];
+        memcpy(metaData, &ixReadPageCounter, IX::FILE_COUNTER_LEN);
+        memcpy(metaData + IX::FILE_COUNTER_LEN, &ixWritePageCounter, IX::FILE_COUNTER_LEN);
+        memcpy(metaData + IX::FILE_COUNTER_LEN * 2, &ixAppendPageCounter, IX::FILE_COUNTER_LEN);
+        memcpy(metaData + IX::FILE_COUNTER_LEN * 3, &rootPagePtr, IX::FILE_ROOTPAGE_PTR_LEN);
+        memcpy(metaData + IX::FILE_COUNTER_LEN * 3 + IX::FILE_ROOTPAGE_PTR_LEN, &formatVersion, IX::FILE_VERSION_LEN);
+        memcpy(metaData + IX::FILE_COUNTER_LEN * 3 + IX::FILE_ROOTPAGE_PTR_LEN + IX::FILE_VERSION_LEN, &freePageHead, IX::FILE_FREE_PAGE_PTR_LEN);
+        RC ret = writeMetaPage(0, metaData, sizeof(metaData));
+        if(ret) return ret;
+        metaDataDirtyOps = 0;
         return 0;
     }
 
+    RC IXFileHandle::readMetaPage(uint32_t pageNum, void* data, uint32_t len) {
+        uint8_t* frameData = nullptr;
+        bool isHit;
+        RC ret = BufferPool::instance().pinPage(fileId, backend, pageNum, true, frameData, isHit);
+        if(ret) return ret;
+        memcpy(data, frameData, len);
+        return BufferPool::instance().unpinPage(fileId, backend, pageNum, false);
+    }
+
+    // Only the leading len bytes are changed, the rest of the page is kept
+    RC IXFileHandle::writeMetaPage(uint32_t pageNum, const void* data, uint32_t len) {
+        uint8_t* frameData = nullptr;
+        bool isHit;
+        RC ret = BufferPool::instance().pinPage(fileId, backend, pageNum, true, frameData, isHit);
+        if(ret) return ret;
+        memcpy(frameData, data, len);
+        return BufferPool::instance().unpinPage(fileId, backend, pageNum, true);
+    }
+
+    RC IXFileHandle::markMetaDataDirty() {
+        std::lock_guard<std::recursive_mutex> guard(metaDataMutex);
+        metaDataDirtyOps++;
+        if(metaDataFlushInterval != PFM::METADATA_FLUSH_LAZY && metaDataDirtyOps >= metaDataFlushInterval) {
+            return flushMetaData();
+        }
+        return 0;
+    }
+
+    // No page is changed while the tree latch is held exclusively, pages pinned by scans are left dirty
+    RC IXFileHandle::checkpoint() {
+        if(!isOpen()) {
+            return ERR_FILE_NOT_OPEN;
+        }
+        std::lock_guard<RWLatch> treeGuard(treeLatch);
+        RC ret = flushMetaData();
+        if(ret) return ret;
+        uint64_t flushedLsn = LogManager::instance().getLastLsn(fileId);
+        ret = BufferPool::instance().flushFile(fileId, backend, flushedLsn);
+        if(ret) return ret;
+        ret = backend->flush();
+        if(ret) return ret;
+        return syncAndDropLog(flushedLsn);
+    }
+
+    RC IXFileHandle::checkpointIfLogFull() {
+        if(LogManager::instance().getLogSize(fileId) < PFM::WAL_CHECKPOINT_BYTES) {
+            return 0;
+        }
+        return checkpoint();
+    }
+
+    RC IXFileHandle::syncAndDropLog(uint64_t flushedLsn) {
+        LogManager& logManager = LogManager::instance();
+        if(logManager.getLogSize(fileId) == 0) {
+            return 0;       // Nothing changed since the last checkpoint
+        }
+        RC ret = backend->sync();
+        if(ret) return ret;
+        return logManager.checkpoint(fileId, flushedLsn);
+    }
+
+    void IXFileHandle::setMetaDataFlushInterval(uint32_t interval) {
+        metaDataFlushInterval = interval;
+    }
+
     RC IXFileHandle::createRootPage() {
         if(!isOpen()) {
             return ERR_FILE_NOT_OPEN;
         }
         RC ret = 0;
-        ret = appendEmptyPage();
+        ret = appendEmptyPage(rootPagePtr);
         if(ret) {
             return ret;
         }
-        rootPagePtr = getLastPageIndex();
         flushMetaData();
         return 0;
     }
@@ -175,9 +392,9 @@ namespace PeterDB {
         if(!isRootPageExist()) {
             return ERR_ROOTPAGE_NOT_EXIST;
         }
-        fs->clear();
-        fs->seekg(rootPagePtr * PAGE_SIZE, fs->beg);
-        fs->read((char *)(&root), IX::FILE_ROOT_LEN);
+        RC ret = readMetaPage(rootPagePtr, &root, IX::FILE_ROOT_LEN);
+        if(ret) return ret;
+        std::lock_guard<std::recursive_mutex> guard(metaDataMutex);
         ixReadPageCounter++;
         return 0;
     }
@@ -185,10 +402,12 @@ namespace PeterDB {
         if(!isOpen()) {
             return ERR_FILE_NOT_OPEN;
         }
-        fs->clear();
-        fs->seekp(rootPagePtr * PAGE_SIZE, fs->beg);
-        fs->write((char *)(&root), IX::FILE_ROOT_LEN);
-        fs->flush();
+        if(!isRootPageExist()) {
+            return 0;       // Page 0 is the hidden page
+        }
+        RC ret = writeMetaPage(rootPagePtr, &root, IX::FILE_ROOT_LEN);
+        if(ret) return ret;
+        std::lock_guard<std::recursive_mutex> guard(metaDataMutex);
         ixWritePageCounter++;
         return 0;
     }
@@ -205,11 +424,24 @@ namespace PeterDB {
         if(!isOpen()) {
             return ERR_FILE_NOT_OPEN;
         }
-        fs->clear();
-        fs->seekp(rootPagePtr * PAGE_SIZE, fs->beg);
-        fs->write((char *)(&newRoot), IX::FILE_ROOT_LEN);
-        fs->flush();
-        return 0;
+        return writeMetaPage(rootPagePtr, &newRoot, IX::FILE_ROOT_LEN);
+    }
+
+    uint32_t IXFileHandle::getFormatVersion() {
+        return formatVersion;
+    }
+
+    uint32_t IXFileHandle::getStructureVersion() {
+        return structureVersion;
+    }
+
+    IXPageLatch& IXFileHandle::getPageLatch(uint32_t pageNum) {
+        std::lock_guard<std::mutex> guard(pageLatchMutex);
+        std::unique_ptr<IXPageLatch>& pageLatch = pageLatches[pageNum];
+        if(!pageLatch) {
+            pageLatch.reset(new IXPageLatch());
+        }
+        return *pageLatch;
     }
 
     std::string IXFileHandle::getFileName() {
@@ -217,7 +449,7 @@ namespace PeterDB {
     }
 
     bool IXFileHandle::isOpen() {
-        return fs && fs->is_open();
+        return backend && backend->isOpen();
     }
 
     bool IXFileHandle::isRootPageExist() {
@@ -2,8 +2,7 @@
 
 namespace PeterDB {
     IXPageHandle::IXPageHandle(IXFileHandle& fileHandle, uint32_t page): ixFileHandle(fileHandle), pageNum(page) {
-        ixFileHandle.readPage(pageNum, data);
-        memcpy(origin, data, PAGE_SIZE);
+        pinPage(false);
 
         freeBytePtr = getFreeBytePointerFromData();
         pageType = getPageTypeFromData();
@@ -13,23 +12,55 @@ namespace PeterDB {
     // New Page
     IXPageHandle::IXPageHandle(IXFileHandle& fileHandle, uint32_t page, int16_t type, int16_t freeByte, int16_t counter):
         ixFileHandle(fileHandle), pageNum(page), pageType(type), freeBytePtr(freeByte), counter(counter) {
-        ixFileHandle.readPage(pageNum, data);
-        memcpy(origin, data, PAGE_SIZE);
+        pinPage(false);
     }
 
     // New Page with data
     IXPageHandle::IXPageHandle(IXFileHandle& fileHandle, uint8_t* newData, int16_t dataLen, uint32_t page, int16_t type, int16_t freeByte, int16_t counter):
             ixFileHandle(fileHandle), pageNum(page), pageType(type), freeBytePtr(freeByte), counter(counter) {
+        pinPage(true);
+        bzero(data, PAGE_SIZE);
+        memcpy(data, newData, dataLen);
+        isDirty = true;
+    }
+
+    // New Page with data in the caller's page buffer
+    IXPageHandle::IXPageHandle(IXFileHandle& fileHandle, uint8_t* pageBuffer, uint8_t* newData, int16_t dataLen, uint32_t page, int16_t type, int16_t counter):
+            ixFileHandle(fileHandle), pageNum(page), pageType(type), freeBytePtr(dataLen), counter(counter) {
+        data = pageBuffer;
+        pinStatus = 0;
+        isPinned = false;
+        isDataOwned = false;
+        isDirty = true;
+        bzero(data, PAGE_SIZE);
         memcpy(data, newData, dataLen);
     }
 
     IXPageHandle::~IXPageHandle() {
         flushHeader();
-        if(memcmp(origin, data, PAGE_SIZE) != 0) {
-            ixFileHandle.writePage(pageNum, data);
+        if(isPinned) {
+            ixFileHandle.unpinPage(pageNum, isDirty);
+        }
+        else if(isDataOwned) {
+            delete[] data;
         }
     }
 
+    void IXPageHandle::pinPage(bool isNewPage) {
+        isDirty = false;
+        pinStatus = ixFileHandle.pinPage(pageNum, data, isNewPage);
+        isPinned = pinStatus == 0;
+        isDataOwned = !isPinned;
+        if(!isPinned) {
+            LOG(ERROR) << "Fail to pin page " << pageNum << " @ IXPageHandle::pinPage" << std::endl;
+            data = new uint8_t[PAGE_SIZE]();
+        }
+    }
+
+    RC IXPageHandle::getPinStatus() {
+        return pinStatus;
+    }
+
     bool IXPageHandle::isOpen() {
         return ixFileHandle.isOpen();
     }
@@ -42,118 +73,88 @@ namespace PeterDB {
     }
 
     bool IXPageHandle::isCompositeKeyMeetCompCondition(const uint8_t* key1, const RID& rid1, const uint8_t* key2, const RID& rid2, const Attribute& attr, const CompOp op) {
+        int compResult = compareKey(key1, key2, attr);
+        if(compResult == 0) {
+            compResult = compareRid(rid1, rid2);
+        }
+        return isCompResultMeetCompOp(compResult, op);
+    }
+
+    bool IXPageHandle::isKeyMeetCompCondition(const uint8_t* key1, const uint8_t* key2, const Attribute& attr, const CompOp op) {
+        return isCompResultMeetCompOp(compareKey(key1, key2, attr), op);
+    }
+
+    bool IXPageHandle::isRidMeetCompCondition(const RID& rid1, const RID& rid2, const CompOp op) {
+        return isCompResultMeetCompOp(compareRid(rid1, rid2), op);
+    }
+
+    bool IXPageHandle::isCompResultMeetCompOp(int compResult, const CompOp op) {
         switch (op) {
             case GT_OP:
-                return isKeyMeetCompCondition(key1, key2, attr, GT_OP) ||
-                       (isKeyMeetCompCondition(key1, key2, attr, EQ_OP) && isRidMeetCompCondition(rid1, rid2, GT_OP));
+                return compResult > 0;
             case GE_OP:
-                return isKeyMeetCompCondition(key1, key2, attr, GE_OP) ||
-                       (isKeyMeetCompCondition(key1, key2, attr, EQ_OP) && isRidMeetCompCondition(rid1, rid2, GE_OP));
+                return compResult >= 0;
             case LT_OP:
-                return isKeyMeetCompCondition(key1, key2, attr, LT_OP) ||
-                       (isKeyMeetCompCondition(key1, key2, attr, EQ_OP) && isRidMeetCompCondition(rid1, rid2, LT_OP));
+                return compResult < 0;
             case LE_OP:
-                return isKeyMeetCompCondition(key1, key2, attr, LE_OP) ||
-                       (isKeyMeetCompCondition(key1, key2, attr, EQ_OP) && isRidMeetCompCondition(rid1, rid2, LE_OP));
+                return compResult <= 0;
             case NE_OP:
-                return !(isKeyMeetCompCondition(key1, key2, attr, EQ_OP) && isRidMeetCompCondition(rid1, rid2, EQ_OP));
+                return compResult != 0;
             case EQ_OP:
-                return isKeyMeetCompCondition(key1, key2, attr, EQ_OP) && isRidMeetCompCondition(rid1, rid2, EQ_OP);
+                return compResult == 0;
             default:
                 return false;
         }
-        return false;
     }
 
-    bool IXPageHandle::isKeyMeetCompCondition(const uint8_t* key1, const uint8_t* key2, const Attribute& attr, const CompOp op) {
+    // VarChar keys are compared in place on the length-prefixed bytes, same order as std::string
+    int IXPageHandle::compareKey(const uint8_t* key1, const uint8_t* key2, const Attribute& attr) {
         switch (attr.type) {
-            case TypeInt:
-                int32_t int1;
-                int1 = getKeyInt(key1);
-                int32_t int2;
-                int2 = getKeyInt(key2);
-                switch (op) {
-                    case GT_OP:
-                        return int1 > int2;
-                    case GE_OP:
-                        return int1 >= int2;
-                    case LT_OP:
-                        return int1 < int2;
-                    case LE_OP:
-                        return int1 <= int2;
-                    case NE_OP:
-                        return int1 != int2;
-                    case EQ_OP:
-                        return int1 == int2;
-                    default:
-                        return false;
-                }
-                break;
-            case TypeReal:
-                float float1;
-                float1 = getKeyReal(key1);
-                float float2;
-                float2 = getKeyReal(key2);
-                switch (op) {
-                    case GT_OP:
-                        return float1 > float2;
-                    case GE_OP:
-                        return float1 >= float2;
-                    case LT_OP:
-                        return float1 < float2;
-                    case LE_OP:
-                        return float1 <= float2;
-                    case NE_OP:
-                        return float1 != float2;
-                    case EQ_OP:
-                        return float1 == float2;
-                    default:
-                        return false;
-                }
-            case TypeVarChar:
-                std::string str1;
-                str1 = getKeyString(key1);
-                std::string str2;
-                str2 = getKeyString(key2);
-                switch (op) {
-                    case GT_OP:
-                        return str1 > str2;
-                    case GE_OP:
-                        return str1 >= str2;
-                    case LT_OP:
-                        return str1 < str2;
-                    case LE_OP:
-                        return str1 <= str2;
-                    case NE_OP:
-                        return str1 != str2;
-                    case EQ_OP:
-                        return str1 == str2;
-                    default:
-                        return false;
+            case TypeInt: {
+                int32_t int1 = getKeyInt(key1);
+                int32_t int2 = getKeyInt(key2);
+                return int1 < int2 ? -1 : (int1 > int2 ? 1 : 0);
+            }
+            case TypeReal: {
+                float float1 = getKeyReal(key1);
+                float float2 = getKeyReal(key2);
+                return float1 < float2 ? -1 : (float1 > float2 ? 1 : 0);
+            }
+            case TypeVarChar: {
+                int32_t len1, len2;
+                memcpy(&len1, key1, sizeof(int32_t));
+                memcpy(&len2, key2, sizeof(int32_t));
+                int compResult = memcmp(key1 + sizeof(int32_t), key2 + sizeof(int32_t), std::min(len1, len2));
+                if(compResult != 0) {
+                    return compResult;
                 }
-                break;
+                return len1 < len2 ? -1 : (len1 > len2 ? 1 : 0);
+            }
+            default:
+                return 0;
         }
-        return false;
     }
 
-    bool IXPageHandle::isRidMeetCompCondition(const RID& rid1, const RID& rid2, const CompOp op) {
-        switch (op) {
-            case GT_OP:
-                return rid1.pageNum > rid2.pageNum || (rid1.pageNum == rid2.pageNum && rid1.slotNum > rid2.slotNum);
-            case GE_OP:
-                return rid1.pageNum >= rid2.pageNum || (rid1.pageNum == rid2.pageNum && rid1.slotNum >= rid2.slotNum);
-            case LT_OP:
-                return rid1.pageNum < rid2.pageNum || (rid1.pageNum == rid2.pageNum && rid1.slotNum < rid2.slotNum);
-            case LE_OP:
-                return rid1.pageNum <= rid2.pageNum || (rid1.pageNum == rid2.pageNum && rid1.slotNum <= rid2.slotNum);
-            case NE_OP:
-                return !(rid1.pageNum == rid2.pageNum && rid1.slotNum == rid2.slotNum);
-            case EQ_OP:
-                return rid1.pageNum == rid2.pageNum && rid1.slotNum == rid2.slotNum;
-            default:
-                return false;
+    // Composite keys are ordered by key and then by rid
+    int IXPageHandle::compareCompositeKey(const uint8_t* compKey1, const uint8_t* compKey2, const Attribute& attr) {
+        int compResult = compareKey(compKey1, compKey2, attr);
+        if(compResult != 0) {
+            return compResult;
         }
-        return false;
+        RID rid1, rid2;
+        getRid(compKey1, attr, rid1);
+        getRid(compKey2, attr, rid2);
+        return compareRid(rid1, rid2);
+    }
+
+    int IXPageHandle::compareRid(const RID& rid1, const RID& rid2) {
+        if(rid1.pageNum != rid2.pageNum) {
+            return rid1.pageNum < rid2.pageNum ? -1 : 1;
+        }
+        if(rid1.slotNum != rid2.slotNum) {
+            return rid1.slotNum < rid2.slotNum ? -1 : 1;
+        }
+        return 0;
     }
 
     RC IXPageHandle::shiftRecordLeft(int16_t dataNeedShiftStartPos, int16_t dist) {
@@ -167,6 +168,7 @@ namespace PeterDB {
 
         // Must Use Memmove! Source and Destination May Overlap
         memmove(data + dataNeedShiftStartPos - dist, data + dataNeedShiftStartPos, dataNeedMoveLen);
+        isDirty = true;
 
         return 0;
     }
@@ -181,6 +183,7 @@ namespace PeterDB {
         }
         // Must Use Memmove! Source and Destination May Overlap
         memmove(data + dataNeedMoveStartPos + dist, data + dataNeedMoveStartPos, dataNeedMoveLen);
+        isDirty = true;
 
         return 0;
     }
@@ -219,10 +222,104 @@ namespace PeterDB {
     int16_t IXPageHandle::getHeaderLen() {
         return IX::PAGE_TYPE_LEN + IX::PAGE_FREEBYTE_PTR_LEN + IX::PAGE_COUNTER_LEN;
     }
+    // Readers sharing a page leave its frame untouched
     void IXPageHandle::flushHeader() {
-        setPageType(pageType);
-        setFreeBytePointer(freeBytePtr);
-        setCounter(counter);
+        if(pageType != getPageTypeFromData()) {
+            setPageType(pageType);
+        }
+        if(freeBytePtr != getFreeBytePointerFromData()) {
+            setFreeBytePointer(freeBytePtr);
+        }
+        if(counter != getCounterFromData()) {
+            setCounter(counter);
+        }
+    }
+
+    bool IXPageHandle::hasSlotArray() {
+        return ixFileHandle.getFormatVersion() >= IX::FILE_VERSION_SLOTTED;
+    }
+    int16_t IXPageHandle::getSlotLen() {
+        return hasSlotArray() ? IX::PAGE_SLOT_LEN : 0;
+    }
+
+    // Slot array starts right below the header, leaf header includes the next pointer
+    // and index header the key prefix
+    int16_t IXPageHandle::getSlotOffset(int16_t index) {
+        int16_t headerLen = getHeaderLen() + (isTypeLeaf() ? IX::LEAFPAGE_NEXT_PTR_LEN : 0) +
+                            (isTypeIndex() ? getKeyPrefixAreaLen() : 0);
+        return PAGE_SIZE - headerLen - (index + 1) * IX::PAGE_SLOT_LEN;
+    }
+    int16_t IXPageHandle::getSlot(int16_t index) {
+        int16_t entryPos;
+        memcpy(&entryPos, data + getSlotOffset(index), IX::PAGE_SLOT_LEN);
+        return entryPos;
+    }
+    void IXPageHandle::setSlot(int16_t index, int16_t entryPos) {
+        memcpy(data + getSlotOffset(index), &entryPos, IX::PAGE_SLOT_LEN);
+        isDirty = true;
+    }
+
+    // Entries are packed in key order, so slots are in ascending order
+    // Return counter if the position is at the end of entries
+    int16_t IXPageHandle::getSlotIndex(int16_t entryPos) {
+        int16_t low = 0, high = counter;
+        while(low < high) {
+            int16_t mid = low + (high - low) / 2;
+            if(getSlot(mid) < entryPos) {
+                low = mid + 1;
+            }
+            else {
+                high = mid;
+            }
+        }
+        return low;
+    }
+
+    // Called after the entry is written at entryPos, before the counter is increased
+    void IXPageHandle::insertSlot(int16_t index, int16_t entryPos, int16_t entryLen) {
+        if(index < counter) {
+            // Slots grow down, move slots of the following entries down by one
+            memmove(data + getSlotOffset(counter), data + getSlotOffset(counter - 1), (counter - index) * IX::PAGE_SLOT_LEN);
+            isDirty = true;
+        }
+        for(int16_t i = index + 1; i <= counter; i++) {
+            setSlot(i, getSlot(i) + entryLen);
+        }
+        setSlot(index, entryPos);
+    }
+
+    // Called after the entry is removed, before the counter is decreased
+    void IXPageHandle::deleteSlot(int16_t index, int16_t entryLen) {
+        if(index < counter - 1) {
+            memmove(data + getSlotOffset(counter - 2), data + getSlotOffset(counter - 1), (counter - 1 - index) * IX::PAGE_SLOT_LEN);
+            isDirty = true;
+        }
+        for(int16_t i = index; i < counter - 1; i++) {
+            setSlot(i, getSlot(i) - entryLen);
+        }
+    }
+
+    // Called after the entry at index grows or shrinks by dist bytes
+    void IXPageHandle::resizeSlot(int16_t index, int16_t dist) {
+        for(int16_t i = index + 1; i < counter; i++) {
+            setSlot(i, getSlot(i) + dist);
+        }
+    }
+
+    bool IXPageHandle::hasPostingList() {
+        return ixFileHandle.getFormatVersion() >= IX::FILE_VERSION_POSTING;
+    }
+
+    bool IXPageHandle::hasKeyPrefix() {
+        return ixFileHandle.getFormatVersion() >= IX::FILE_VERSION_PREFIX;
+    }
+    int16_t IXPageHandle::getKeyPrefixAreaLen() {
+        if(!hasKeyPrefix()) {
+            return 0;
+        }
+        int16_t prefixLen;
+        memcpy(&prefixLen, data + PAGE_SIZE - getHeaderLen() - IX::INDEXPAGE_PREFIX_SIZE_LEN, IX::INDEXPAGE_PREFIX_SIZE_LEN);
+        return IX::INDEXPAGE_PREFIX_SIZE_LEN + prefixLen;
     }
 
     int16_t IXPageHandle::getPageType() {
@@ -236,6 +333,7 @@ namespace PeterDB {
     void IXPageHandle::setPageType(int16_t type) {
         memcpy(data + PAGE_SIZE - IX::PAGE_TYPE_LEN, &type, IX::PAGE_TYPE_LEN);
         this->pageType = type;
+        isDirty = true;
     }
 
     int16_t IXPageHandle::getFreeBytePointerOffset() {
@@ -252,6 +350,7 @@ namespace PeterDB {
     void IXPageHandle::setFreeBytePointer(int16_t ptr) {
         memcpy(data + getFreeBytePointerOffset(), &ptr, IX::PAGE_FREEBYTE_PTR_LEN);
         this->freeBytePtr = ptr;
+        isDirty = true;
     }
 
     int16_t IXPageHandle::getCounterOffset() {
@@ -268,6 +367,7 @@ namespace PeterDB {
     void IXPageHandle::setCounter(int16_t counter) {
         memcpy(data + getCounterOffset(), &counter, IX::PAGE_COUNTER_LEN);
         this->counter = counter;
+        isDirty = true;
     }
 
     void IXPageHandle::getRid(const uint8_t* keyData, const Attribute& attr, RID& rid) {
@@ -277,4 +377,60 @@ namespace PeterDB {
         memcpy(&rid.slotNum, keyData + offset, IX::PAGE_RID_SLOT_LEN);
     }
 
+    void IXPageHandle::readRid(const uint8_t* ridData, RID& rid) {
+        memcpy(&rid.pageNum, ridData, IX::PAGE_RID_PAGE_LEN);
+        memcpy(&rid.slotNum, ridData + IX::PAGE_RID_PAGE_LEN, IX::PAGE_RID_SLOT_LEN);
+    }
+
+    void IXPageHandle::writeRid(uint8_t* ridData, const RID& rid) {
+        memcpy(ridData, &rid.pageNum, IX::PAGE_RID_PAGE_LEN);
+        memcpy(ridData + IX::PAGE_RID_PAGE_LEN, &rid.slotNum, IX::PAGE_RID_SLOT_LEN);
+    }
+
+    int16_t IXPageHandle::findRidIndex(const uint8_t* ridData, int16_t ridNum, const RID& rid) {
+        RID curRid;
+        int16_t low = 0, high = ridNum;
+        while(low < high) {
+            int16_t mid = low + (high - low) / 2;
+            readRid(ridData + mid * IX::PAGE_RID_LEN, curRid);
+            if(compareRid(curRid, rid) < 0) {
+                low = mid + 1;
+            }
+            else {
+                high = mid;
+            }
+        }
+        return low;
+    }
+
+    int16_t IXPageHandle::getCommonPrefixLen(const uint8_t* key1, const uint8_t* key2) {
+        int32_t len1, len2;
+        memcpy(&len1, key1, sizeof(int32_t));
+        memcpy(&len2, key2, sizeof(int32_t));
+        int16_t prefixLen = 0;
+        int16_t maxLen = std::min(len1, len2);
+        while(prefixLen < maxLen && key1[sizeof(int32_t) + prefixLen] == key2[sizeof(int32_t) + prefixLen]) {
+            prefixLen++;
+        }
+        return prefixLen;
+    }
+
+    // Keys of the left page are at most the left key, so any key above it and up to the right key separates them
+    // For VarChar it is the right key cut right after the first byte that differs from the left key
+    void IXPageHandle::getShortestSeparator(uint8_t* separator, const uint8_t* leftKey, const uint8_t* rightKey, const Attribute& attr) {
+        int16_t keyLen = getKeyLen(rightKey, attr);
+        if(attr.type == TypeVarChar) {
+            int32_t rightLen;
+            memcpy(&rightLen, rightKey, sizeof(int32_t));
+            int32_t separatorLen = std::min<int32_t>(getCommonPrefixLen(leftKey, rightKey) + 1, rightLen);
+            memcpy(separator, &separatorLen, sizeof(int32_t));
+            memcpy(separator + sizeof(int32_t), rightKey + sizeof(int32_t), separatorLen);
+            keyLen = sizeof(int32_t) + separatorLen;
+        }
+        else {
+            memcpy(separator, rightKey, keyLen);
+        }
+        bzero(separator + keyLen, IX::PAGE_RID_LEN);
+    }
+
 }
@@ -2,18 +2,26 @@
 
 namespace PeterDB {
     IX_ScanIterator::IX_ScanIterator() {
+        ixFileHandlePtr = nullptr;
         lowKey = nullptr;
         highKey = nullptr;
         curLeafPage = 0;
+        curLeafVersion = 0;
         remainDataLen = 0;
         entryExceedUpperBound = false;
+        curKeyLen = 0;
+        curRidNum = 0;
+        curOverflowPage = IX::PAGE_PTR_NULL;
+        overflowRemainLen = -1;
+        structureVersion = 0;
+        isLastEntryExist = false;
+        isSeeking = false;
     }
 
     IX_ScanIterator::~IX_ScanIterator() = default;
 
     RC IX_ScanIterator::open(IXFileHandle* fileHandle, const Attribute& attr, const uint8_t* lowKey,
                              const uint8_t* highKey, bool lowKeyInclusive, bool highKeyInclusive) {
-        RC ret = 0;
         this->ixFileHandlePtr = fileHandle;
         this->attr = attr;
         this->lowKey = lowKey;
@@ -21,9 +29,12 @@ namespace PeterDB {
         this->lowKeyInclusive = lowKeyInclusive;
         this->highKeyInclusive = highKeyInclusive;
 
-        curLeafPage = 0;
-        remainDataLen = 0;
         entryExceedUpperBound = false;
+        curKeyLen = 0;
+        SharedLatchGuard treeGuard(ixFileHandlePtr->treeLatch);
+        structureVersion = ixFileHandlePtr->getStructureVersion();
+        isLastEntryExist = false;
+        isSeeking = false;
 
         if(!ixFileHandlePtr->isRootPageExist()) {
             return ERR_ROOTPAGE_NOT_EXIST;
@@ -31,88 +42,242 @@ namespace PeterDB {
         if(ixFileHandlePtr->isRootNull()) {
             return ERR_ROOT_NULL;
         }
+        return seek(lowKey, lowKeyInclusive);
+    }
+
+    // Stand before the first entry whose key is above (or equal to) the key
+    RC IX_ScanIterator::seek(const uint8_t* key, bool isInclusive) {
+        RC ret = 0;
+        curLeafPage = 0;
+        remainDataLen = 0;
+        curRidNum = 0;
+        curOverflowPage = IX::PAGE_PTR_NULL;
+        overflowRemainLen = -1;
+
         // Find the right leaf node to start scanning
         RID smallestRID = {0, 0};
-        ret = IndexManager::instance().findTargetLeafNode(*ixFileHandlePtr, curLeafPage, lowKey, smallestRID, attr);
+        ret = IndexManager::instance().findTargetLeafNode(*ixFileHandlePtr, curLeafPage, key, smallestRID, attr);
         if(ret) return ret;
 
         // Skip empty pages
-        getNextNonEmptyPage();
+        ret = getNextNonEmptyPage();
+        if(ret) return ret;
 
-        if(!lowKey) {
+        if(!key) {
             return 0;
         }
 
         while(curLeafPage != IX::PAGE_PTR_NULL && curLeafPage < ixFileHandlePtr->getPageCounter()) {
+            IXPageLatch& leafLatch = ixFileHandlePtr->getPageLatch(curLeafPage);
+            SharedLatchGuard leafGuard(leafLatch.latch);
             LeafPageHandle leafPH(*ixFileHandlePtr, curLeafPage);
+            ret = leafPH.getPinStatus();
+            if(ret) return ret;
             int16_t firstEntryPos;
-            if(this->lowKeyInclusive) {
-                leafPH.findFirstKeyMeetCompCondition(firstEntryPos, lowKey, attr, GE_OP);
+            if(isInclusive) {
+                leafPH.findFirstKeyMeetCompCondition(firstEntryPos, key, attr, GE_OP);
             }
             else {
-                leafPH.findFirstKeyMeetCompCondition(firstEntryPos, lowKey, attr, GT_OP);
+                leafPH.findFirstKeyMeetCompCondition(firstEntryPos, key, attr, GT_OP);
             }
 
             if(firstEntryPos != leafPH.getFreeBytePointer()) {
                 remainDataLen = leafPH.getFreeBytePointer() - firstEntryPos;
+                curLeafVersion = leafLatch.version;
                 break;
             }
             else {
                 // Reach the end, go to next non-empty page
                 curLeafPage = leafPH.getNextPtr();
-                getNextNonEmptyPage();
+                ret = getNextNonEmptyPage();
+                if(ret) return ret;
             }
         }
 
         return 0;
     }
 
+    // Entries up to the last one returned are skipped once the scan stands on its key again
+    RC IX_ScanIterator::seekAfterLastEntry() {
+        structureVersion = ixFileHandlePtr->getStructureVersion();
+        if(!isLastEntryExist) {
+            return seek(lowKey, lowKeyInclusive);
+        }
+        seekKey = lastKey;
+        seekRid = lastRid;
+        isSeeking = true;
+        return seek(seekKey.data(), true);
+    }
+
+    // The file stays open, it belongs to the caller and may be shared with other scans
     RC IX_ScanIterator::close() {
-        ixFileHandlePtr->close();
+        if(!ixFileHandlePtr) {
+            return 0;
+        }
+        ixFileHandlePtr = nullptr;
+        curLeafPage = IX::PAGE_PTR_NULL;
+        curOverflowPage = IX::PAGE_PTR_NULL;
+        isLastEntryExist = false;
+        isSeeking = false;
+        std::vector<uint8_t>().swap(lastKey);
+        std::vector<uint8_t>().swap(seekKey);
         return 0;
     }
 
     RC IX_ScanIterator::getNextEntry(RID &rid, void *key) {
         RC ret = 0;
-        if(curLeafPage >= ixFileHandlePtr->getPageCounter() || curLeafPage == IX::PAGE_PTR_NULL) {
+        if(!ixFileHandlePtr) {
             return IX_EOF;
         }
-        if(highKey && entryExceedUpperBound) {
-            return IX_EOF;
+        SharedLatchGuard treeGuard(ixFileHandlePtr->treeLatch);
+        // Pages were merged or entries moved to a sibling since the last entry
+        if(ixFileHandlePtr->getStructureVersion() != structureVersion) {
+            ret = seekAfterLastEntry();
+            if(ret) return ret == ERR_ROOT_NULL ? IX_EOF : ret;
         }
+        while(true) {
+            ret = readNextEntry(rid, key);
+            if(ret == ERR_LEAF_CHANGED) {
+                // Entries of the current leaf moved, stand after the last entry again
+                ret = seekAfterLastEntry();
+                if(ret) return ret == ERR_ROOT_NULL ? IX_EOF : ret;
+                continue;
+            }
+            if(ret) return ret;
+            if(isSeeking) {
+                if(curKeyLen == (int16_t)seekKey.size() && memcmp(curKey, seekKey.data(), curKeyLen) == 0 &&
+                   IXPageHandle::compareRid(rid, seekRid) <= 0) {
+                    continue;
+                }
+                isSeeking = false;
+            }
+            isLastEntryExist = true;
+            lastKey.assign(curKey, curKey + curKeyLen);
+            lastRid = rid;
+            return 0;
+        }
+    }
+
+    RC IX_ScanIterator::readNextEntry(RID &rid, void *key) {
+        RC ret = 0;
+        while(true) {
+            // 1. Rids left in overflow pages or in the leaf share the key decoded before
+            if(curOverflowPage != IX::PAGE_PTR_NULL) {
+                ret = getNextOverflowRid(rid);
+                if(ret == 0) {
+                    memcpy(key, curKey, curKeyLen);
+                    return 0;
+                }
+                if(ret != IX_EOF) return ret;
+                continue;
+            }
+            if(curLeafPage >= ixFileHandlePtr->getPageCounter() || curLeafPage == IX::PAGE_PTR_NULL) {
+                return IX_EOF;
+            }
+            IXPageLatch& leafLatch = ixFileHandlePtr->getPageLatch(curLeafPage);
+            SharedLatchGuard leafGuard(leafLatch.latch);
+            if(leafLatch.version != curLeafVersion) {
+                return ERR_LEAF_CHANGED;
+            }
+            LeafPageHandle leafPH(*ixFileHandlePtr, curLeafPage);
+            ret = leafPH.getPinStatus();
+            if(ret) return ret;
+            int16_t pos = leafPH.getFreeBytePointer() - remainDataLen;
+            if(curRidNum > 0) {
+                IXPageHandle::readRid(leafPH.data + pos, rid);
+                memcpy(key, curKey, curKeyLen);
+                curRidNum--;
+                remainDataLen -= IX::PAGE_RID_LEN;
+                if(remainDataLen == 0) {
+                    // Reach the end of current page
+                    curLeafPage = leafPH.getNextPtr();
+                    ret = getNextNonEmptyPage();
+                    if(ret) return ret;
+                }
+                return 0;
+            }
 
-        // Read current entry and check if it meets condition
-        LeafPageHandle leafPH(*ixFileHandlePtr, curLeafPage);
-        ret = leafPH.getEntry(leafPH.getFreeBytePointer() - remainDataLen, (uint8_t *) key, rid, attr);
-        if(ret) return IX_EOF;
+            // 2. Decode the next entry and check if it exceeds upper bound
+            if(highKey && entryExceedUpperBound) {
+                return IX_EOF;
+            }
+            if(pos >= leafPH.getFreeBytePointer()) {
+                return IX_EOF;
+            }
+            if(highKey && highKeyInclusive &&
+               leafPH.isKeyMeetCompCondition(leafPH.data + pos, highKey, attr, GT_OP)) {
+                entryExceedUpperBound = true;
+                return IX_EOF;
+            }
+            if(highKey && !highKeyInclusive &&
+               leafPH.isKeyMeetCompCondition(leafPH.data + pos, highKey, attr, GE_OP)) {
+                entryExceedUpperBound = true;
+                return IX_EOF;
+            }
+            curKeyLen = IXPageHandle::getKeyLen(leafPH.data + pos, attr);
+            memcpy(curKey, leafPH.data + pos, curKeyLen);
 
-        // Check if current entry exceed upper bound
-        if(highKey && highKeyInclusive &&
-           leafPH.isKeyMeetCompCondition((uint8_t *)key, highKey, attr, GT_OP)) {
-            entryExceedUpperBound = true;
-            return IX_EOF;
-        }
-        if(highKey && !highKeyInclusive &&
-           leafPH.isKeyMeetCompCondition((uint8_t *)key, highKey, attr, GE_OP)) {
-            entryExceedUpperBound = true;
-            return IX_EOF;
+            if(!leafPH.hasPostingList()) {
+                // Every entry is a key with one rid
+                curRidNum = 1;
+                remainDataLen -= curKeyLen;
+                continue;
+            }
+            curRidNum = leafPH.getPostingRidNum(pos, attr);
+            if(curRidNum == IX::POSTING_OVERFLOW) {
+                uint32_t tail;
+                leafPH.getPostingOverflowPtrs(pos, curOverflowPage, tail, attr);
+                overflowRemainLen = -1;
+                curRidNum = 0;
+                remainDataLen -= leafPH.getEntryLen(leafPH.data + pos, attr);
+                if(remainDataLen == 0) {
+                    curLeafPage = leafPH.getNextPtr();
+                    ret = getNextNonEmptyPage();
+                    if(ret) return ret;
+                }
+                continue;
+            }
+            remainDataLen -= curKeyLen + IX::POSTING_RID_NUM_LEN;
         }
+    }
 
-        int16_t nextEntryPos = leafPH.getNextEntryPos(leafPH.getFreeBytePointer() - remainDataLen, attr);
-        remainDataLen = leafPH.getFreeBytePointer() - nextEntryPos;
-        if(remainDataLen == 0) {
-            // Reach the end of current page
-            curLeafPage = leafPH.getNextPtr();
-            getNextNonEmptyPage();
+    // Moves on as soon as a page is finished, so the head of a chain taking over its successor is not read twice
+    RC IX_ScanIterator::getNextOverflowRid(RID &rid) {
+        RC ret = 0;
+        while(curOverflowPage != IX::PAGE_PTR_NULL && curOverflowPage < ixFileHandlePtr->getPageCounter()) {
+            OverflowPageHandle overflowPH(*ixFileHandlePtr, curOverflowPage);
+            ret = overflowPH.getPinStatus();
+            if(ret) return ret;
+            if(overflowRemainLen < 0) {
+                overflowRemainLen = overflowPH.getFreeBytePointer();
+            }
+            if(overflowRemainLen > 0) {
+                IXPageHandle::readRid(overflowPH.data + overflowPH.getFreeBytePointer() - overflowRemainLen, rid);
+                overflowRemainLen -= IX::PAGE_RID_LEN;
+                if(overflowRemainLen == 0) {
+                    curOverflowPage = overflowPH.getNextPtr();
+                    overflowRemainLen = -1;
+                }
+                return 0;
+            }
+            curOverflowPage = overflowPH.getNextPtr();
+            overflowRemainLen = -1;
         }
-        return 0;
+        curOverflowPage = IX::PAGE_PTR_NULL;
+        return IX_EOF;
     }
 
     RC IX_ScanIterator::getNextNonEmptyPage() {
+        RC ret = 0;
         while(curLeafPage != IX::PAGE_PTR_NULL && curLeafPage < ixFileHandlePtr->getPageCounter()) {
+            IXPageLatch& leafLatch = ixFileHandlePtr->getPageLatch(curLeafPage);
+            SharedLatchGuard leafGuard(leafLatch.latch);
             LeafPageHandle leafPH(*ixFileHandlePtr, curLeafPage);
+            ret = leafPH.getPinStatus();
+            if(ret) return ret;
             if(!leafPH.isEmpty()) {
                 remainDataLen = leafPH.getFreeBytePointer();
+                curLeafVersion = leafLatch.version;
                 break;
             }
             curLeafPage = leafPH.getNextPtr();
@@ -18,9 +18,16 @@ namespace PeterDB {
         // Write right page pointer
         memcpy(data + pos, &rightPage, IX::INDEXPAGE_CHILD_PTR_LEN);
         pos += IX::INDEXPAGE_CHILD_PTR_LEN;
+        isDirty = true;
 
         setFreeBytePointer(pos);
         setCounter(1);
+        if(hasKeyPrefix()) {
+            setKeyPrefix(nullptr, 0);
+        }
+        if(hasSlotArray()) {
+            setSlot(0, IX::INDEXPAGE_CHILD_PTR_LEN);
+        }
     }
 
     // Initialize new page with existing entries
@@ -29,6 +36,12 @@ namespace PeterDB {
                                      IXPageHandle(fileHandle, entryData, dataLen, page, IX::PAGE_TYPE_INDEX, dataLen, entryCounter) {
     }
 
+    // Initialize new page with existing entries in the caller's page buffer
+    IndexPageHandle::IndexPageHandle(IXFileHandle& fileHandle, uint8_t* pageBuffer, uint32_t page,
+                                     uint8_t* entryData, int16_t dataLen, int16_t entryCounter):
+                                     IXPageHandle(fileHandle, pageBuffer, entryData, dataLen, page, IX::PAGE_TYPE_INDEX, entryCounter) {
+    }
+
     IndexPageHandle::~IndexPageHandle() = default;
 
     RC IndexPageHandle::getTargetChild(uint32_t& childPtr, const uint8_t* key, const RID& rid, const Attribute &attr) {
@@ -37,8 +50,10 @@ namespace PeterDB {
             memcpy(&childPtr, data, IX::INDEXPAGE_CHILD_PTR_LEN);
             return 0;
         }
+        // All rids of a key are in one posting list, route by key with the largest rid
+        // It never goes left of a separator with the same key, whose rid is zero
         int16_t pos;
-        ret = findPosToInsertKey(pos, key, rid, attr);
+        ret = findPosToInsertKey(pos, key, hasPostingList() ? IX::POSTING_ROUTE_RID : rid, attr);
         if(ret) return ret;
         // Get previous child pointer
         pos -= IX::INDEXPAGE_CHILD_PTR_LEN;
@@ -52,9 +67,38 @@ namespace PeterDB {
             return 0;
         }
 
+        // Keys are stored without the page prefix, a key outside of it is below or above all of them
+        uint8_t strippedKey[PAGE_SIZE];
+        if(getKeyPrefixLen() > 0) {
+            int prefixComp = compareKeyPrefix(keyToInsert);
+            if(prefixComp != 0) {
+                curPos = prefixComp < 0 ? IX::INDEXPAGE_CHILD_PTR_LEN : freeBytePtr;
+                return 0;
+            }
+            stripKeyPrefix(strippedKey, keyToInsert);
+            keyToInsert = strippedKey;
+        }
+
+        RID tmpRid;
+        if(hasSlotArray()) {
+            // Binary search the first key greater than the key to insert
+            int16_t low = 0, high = counter;
+            while(low < high) {
+                int16_t mid = low + (high - low) / 2;
+                getRid(data + getSlot(mid), attr, tmpRid);
+                if(isCompositeKeyMeetCompCondition(data + getSlot(mid), tmpRid, keyToInsert, ridToInsert, attr, CompOp::GT_OP)) {
+                    high = mid;
+                }
+                else {
+                    low = mid + 1;
+                }
+            }
+            curPos = low < counter ? getSlot(low) : freeBytePtr;
+            return 0;
+        }
+
         // Iterate over all following keys
         curPos = IX::INDEXPAGE_CHILD_PTR_LEN;
-        RID tmpRid;
         for(int16_t i = 0; i < counter; i++) {
             getRid(data + curPos, attr, tmpRid);
             if(isCompositeKeyMeetCompCondition(data + curPos, tmpRid, keyToInsert, ridToInsert, attr, CompOp::GT_OP)) {
@@ -82,12 +126,14 @@ namespace PeterDB {
 
             if(ixFileHandle.getRoot() == pageNum) {
                 // Insert new index page
-                ret = ixFileHandle.appendEmptyPage();
+                uint32_t newParentPage;
+                ret = ixFileHandle.appendEmptyPage(newParentPage);
                 if(ret) return ret;
-                uint32_t newParentPage = ixFileHandle.getLastPageIndex();
 
                 IndexPageHandle newIndexPH(ixFileHandle, newParentPage,
                                            pageNum, middleKey, newChildPage, attr);
+                ret = newIndexPH.getPinStatus();
+                if(ret) return ret;
                 ixFileHandle.setRoot(newParentPage);
             }
         }
@@ -96,6 +142,17 @@ namespace PeterDB {
 
     RC IndexPageHandle::insertIndexWithEnoughSpace(const uint8_t* key, const RID& rid, const Attribute& attr, uint32_t childPage) {
         RC ret = 0;
+        // The key is stored without the page prefix, a key not starting with it shortens the prefix
+        uint8_t strippedKey[PAGE_SIZE];
+        const uint8_t* storedKey = key;
+        if(getKeyPrefixLen() > 0) {
+            if(compareKeyPrefix(key) != 0) {
+                return insertIndexWithNewPrefix(key, rid, attr, childPage);
+            }
+            stripKeyPrefix(strippedKey, key);
+            storedKey = strippedKey;
+        }
+
         int16_t insertPos = 0;
         ret = findPosToInsertKey(insertPos, key, rid, attr);
         if(ret) return ret;
@@ -103,7 +160,7 @@ namespace PeterDB {
         if(insertPos > freeBytePtr) {
             return ERR_PTR_BEYONG_FREEBYTE;
         }
-        int16_t entryLen = getEntryLen(key, attr);
+        int16_t entryLen = getEntryLen(storedKey, attr);
         if(insertPos < freeBytePtr) {
             // Insert Entry in the middle, Need to shift entries right
             ret = shiftRecordRight(insertPos, entryLen);
@@ -111,7 +168,10 @@ namespace PeterDB {
                 return ret;
             }
         }
-        writeIndex(insertPos, key, rid, attr, childPage);
+        writeIndex(insertPos, storedKey, rid, attr, childPage);
+        if(hasSlotArray()) {
+            insertSlot(getSlotIndex(insertPos), insertPos, entryLen);
+        }
 
         freeBytePtr += entryLen;
         counter++;
@@ -127,15 +187,18 @@ namespace PeterDB {
         memcpy(data + pos, &rid.slotNum, IX::PAGE_RID_SLOT_LEN);
         pos += IX::PAGE_RID_SLOT_LEN;
         memcpy(data + pos, &newPageNum, IX::INDEXPAGE_CHILD_PTR_LEN);
+        isDirty = true;
         return 0;
     }
 
     RC IndexPageHandle::splitPageAndInsertIndex(uint8_t * middleCompKey, uint32_t& newIndexPage, const uint8_t* keyToInsert, const RID& ridToInsert, const Attribute& attr, uint32_t childPtrToInsert) {
         RC ret = 0;
+        if(hasKeyPrefix()) {
+            return splitPrefixPageAndInsertIndex(middleCompKey, newIndexPage, keyToInsert, ridToInsert, attr, childPtrToInsert);
+        }
         // 0. Append a new page
-        ret = ixFileHandle.appendEmptyPage();
+        ret = ixFileHandle.appendEmptyPage(newIndexPage);
         if(ret) return ret;
-        newIndexPage = ixFileHandle.getLastPageIndex();
 
         // 1. Push up middle key - 3 Cases
         int16_t newKeyInsertPos;
@@ -161,6 +224,9 @@ namespace PeterDB {
             moveStartPos = prevPos + getCompositeKeyLen(data + prevPos, attr);
             moveLen = freeBytePtr - moveStartPos;
             IndexPageHandle newIndexPH(ixFileHandle, newIndexPage, data + moveStartPos, moveLen, counter - curIndex);
+            ret = newIndexPH.getPinStatus();
+            if(ret) return ret;
+            newIndexPH.rebuildSlots(attr);
             // Cur Page set counters
             freeBytePtr = prevPos;
             counter = prevIndex;
@@ -181,6 +247,9 @@ namespace PeterDB {
             memcpy(dataToMove, &childPtrToInsert, IX::INDEXPAGE_CHILD_PTR_LEN);
             memcpy(dataToMove + IX::INDEXPAGE_CHILD_PTR_LEN, data + curPos, freeBytePtr - curPos);
             IndexPageHandle newIndexPH(ixFileHandle, newIndexPage, dataToMove, moveLen, counter - curIndex);
+            ret = newIndexPH.getPinStatus();
+            if(ret) return ret;
+            newIndexPH.rebuildSlots(attr);
             // Cur Page set counters
             freeBytePtr = curPos;
             counter = prevIndex + 1;
@@ -193,6 +262,9 @@ namespace PeterDB {
             moveStartPos = curPos + getCompositeKeyLen(data + curPos, attr);
             moveLen = freeBytePtr - moveStartPos;
             IndexPageHandle newIndexPH(ixFileHandle, newIndexPage, data + moveStartPos, moveLen, counter - curIndex - 1);
+            ret = newIndexPH.getPinStatus();
+            if(ret) return ret;
+            newIndexPH.rebuildSlots(attr);
             // Cur Page set counters
             freeBytePtr = curPos;
             counter = prevIndex + 1;
@@ -204,6 +276,344 @@ namespace PeterDB {
         return 0;
     }
 
+    // Keys of the page and the new one are laid out in full, then cut where both halves are about the same size
+    // once each is stored with its own prefix, and the middle key goes up
+    RC IndexPageHandle::splitPrefixPageAndInsertIndex(uint8_t * middleCompKey, uint32_t& newIndexPage, const uint8_t* keyToInsert, const RID& ridToInsert, const Attribute& attr, uint32_t childPtrToInsert) {
+        RC ret = 0;
+        // 0. Append a new page
+        ret = ixFileHandle.appendEmptyPage(newIndexPage);
+        if(ret) return ret;
+
+        // 1. All entries with the new one in place
+        std::vector<uint8_t> entries;
+        ret = getEntries(entries, attr);
+        if(ret) return ret;
+        int32_t insertPos = IX::INDEXPAGE_CHILD_PTR_LEN;
+        RID tmpRid;
+        for(int16_t i = 0; i < counter; i++) {
+            getRid(entries.data() + insertPos, attr, tmpRid);
+            if(isCompositeKeyMeetCompCondition(entries.data() + insertPos, tmpRid, keyToInsert, ridToInsert, attr, CompOp::GT_OP)) {
+                break;
+            }
+            insertPos += getEntryLen(entries.data() + insertPos, attr);
+        }
+        int16_t keyLen = getKeyLen(keyToInsert, attr);
+        uint8_t entryToInsert[PAGE_SIZE];
+        memcpy(entryToInsert, keyToInsert, keyLen);
+        writeRid(entryToInsert + keyLen, ridToInsert);
+        memcpy(entryToInsert + keyLen + IX::PAGE_RID_LEN, &childPtrToInsert, IX::INDEXPAGE_CHILD_PTR_LEN);
+        entries.insert(entries.begin() + insertPos, entryToInsert, entryToInsert + getEntryLen(keyToInsert, attr));
+
+        int16_t entryNum = counter + 1;
+        std::vector<int32_t> keyPos;
+        getKeyPositions(entries, entryNum, keyPos, attr);
+
+        // 2. Cut where both pages are about the same size
+        int16_t middleIndex = findBalancedMiddleKey(entries, keyPos, attr);
+        if(middleIndex < 0) {
+            return ERR_PAGE_NOT_ENOUGH_SPACE;
+        }
+
+        // 3. Push up the middle composite key (key + rid), keys after it move to the new page
+        int16_t middleKeyLen = getCompositeKeyLen(entries.data() + keyPos[middleIndex], attr);
+        memcpy(middleCompKey, entries.data() + keyPos[middleIndex], middleKeyLen);
+        int32_t moveStartPos = keyPos[middleIndex] + middleKeyLen;
+        IndexPageHandle newIndexPH(ixFileHandle, newIndexPage, entries.data(), 0, 0);
+        ret = newIndexPH.getPinStatus();
+        if(ret) return ret;
+        ret = newIndexPH.setEntries(entries.data() + moveStartPos, entries.size() - moveStartPos, entryNum - middleIndex - 1, attr);
+        if(ret) return ret;
+        return setEntries(entries.data(), keyPos[middleIndex], middleIndex, attr);
+    }
+
+    // Every key grows back by the part of the old prefix it does not share with the new key
+    RC IndexPageHandle::insertIndexWithNewPrefix(const uint8_t* key, const RID& rid, const Attribute& attr, uint32_t childPage) {
+        RC ret = 0;
+        std::vector<uint8_t> entries;
+        ret = getEntries(entries, attr);
+        if(ret) return ret;
+        int32_t insertPos = IX::INDEXPAGE_CHILD_PTR_LEN;
+        RID tmpRid;
+        for(int16_t i = 0; i < counter; i++) {
+            getRid(entries.data() + insertPos, attr, tmpRid);
+            if(isCompositeKeyMeetCompCondition(entries.data() + insertPos, tmpRid, key, rid, attr, CompOp::GT_OP)) {
+                break;
+            }
+            insertPos += getEntryLen(entries.data() + insertPos, attr);
+        }
+        int16_t keyLen = getKeyLen(key, attr);
+        uint8_t entryToInsert[PAGE_SIZE];
+        memcpy(entryToInsert, key, keyLen);
+        writeRid(entryToInsert + keyLen, rid);
+        memcpy(entryToInsert + keyLen + IX::PAGE_RID_LEN, &childPage, IX::INDEXPAGE_CHILD_PTR_LEN);
+        entries.insert(entries.begin() + insertPos, entryToInsert, entryToInsert + getEntryLen(key, attr));
+        return setEntries(entries.data(), entries.size(), counter + 1, attr);
+    }
+
+    RC IndexPageHandle::getEntries(std::vector<uint8_t>& entryData, const Attribute& attr) {
+        int16_t prefixLen = getKeyPrefixLen();
+        const uint8_t* prefix = data + PAGE_SIZE - getHeaderLen() - IX::INDEXPAGE_PREFIX_SIZE_LEN - prefixLen;
+        entryData.assign(data, data + IX::INDEXPAGE_CHILD_PTR_LEN);
+        int16_t pos = IX::INDEXPAGE_CHILD_PTR_LEN;
+        for(int16_t i = 0; i < counter; i++) {
+            int16_t keyLen = getKeyLen(data + pos, attr);
+            if(prefixLen > 0) {
+                int32_t fullLen = keyLen - sizeof(int32_t) + prefixLen;
+                const uint8_t* fullLenData = (const uint8_t*)&fullLen;
+                entryData.insert(entryData.end(), fullLenData, fullLenData + sizeof(int32_t));
+                entryData.insert(entryData.end(), prefix, prefix + prefixLen);
+                entryData.insert(entryData.end(), data + pos + sizeof(int32_t), data + pos + keyLen);
+            }
+            else {
+                entryData.insert(entryData.end(), data + pos, data + pos + keyLen);
+            }
+            entryData.insert(entryData.end(), data + pos + keyLen, data + pos + keyLen + IX::PAGE_RID_LEN + IX::INDEXPAGE_CHILD_PTR_LEN);
+            pos += keyLen + IX::PAGE_RID_LEN + IX::INDEXPAGE_CHILD_PTR_LEN;
+        }
+        if(pos != freeBytePtr) {
+            return ERR_IMPOSSIBLE;
+        }
+        return 0;
+    }
+
+    // Sorted keys share the prefix of the first and the last one, which is kept once in the page
+    RC IndexPageHandle::setEntries(const uint8_t* entryData, int32_t dataLen, int16_t entryCounter, const Attribute& attr) {
+        int16_t prefixLen = 0;
+        int32_t lastKeyPos = IX::INDEXPAGE_CHILD_PTR_LEN;
+        for(int16_t i = 0; i < entryCounter - 1; i++) {
+            lastKeyPos += getEntryLen(entryData + lastKeyPos, attr);
+        }
+        if(hasKeyPrefix() && attr.type == TypeVarChar && entryCounter > 1) {
+            prefixLen = getCommonPrefixLen(entryData + IX::INDEXPAGE_CHILD_PTR_LEN, entryData + lastKeyPos);
+        }
+        int32_t storedLen = dataLen - entryCounter * prefixLen;
+        int32_t prefixAreaLen = hasKeyPrefix() ? IX::INDEXPAGE_PREFIX_SIZE_LEN + prefixLen : 0;
+        if(storedLen + entryCounter * getSlotLen() + prefixAreaLen > PAGE_SIZE - getHeaderLen()) {
+            return ERR_PAGE_NOT_ENOUGH_SPACE;
+        }
+
+        if(hasKeyPrefix()) {
+            setKeyPrefix(entryData + IX::INDEXPAGE_CHILD_PTR_LEN + sizeof(int32_t), prefixLen);
+        }
+        memcpy(data, entryData, IX::INDEXPAGE_CHILD_PTR_LEN);
+        isDirty = true;
+        int16_t pos = IX::INDEXPAGE_CHILD_PTR_LEN;
+        int32_t srcPos = IX::INDEXPAGE_CHILD_PTR_LEN;
+        for(int16_t i = 0; i < entryCounter; i++) {
+            int16_t keyLen = getKeyLen(entryData + srcPos, attr);
+            if(prefixLen > 0) {
+                int32_t suffixLen = keyLen - sizeof(int32_t) - prefixLen;
+                memcpy(data + pos, &suffixLen, sizeof(int32_t));
+                memcpy(data + pos + sizeof(int32_t), entryData + srcPos + sizeof(int32_t) + prefixLen, suffixLen);
+                pos += sizeof(int32_t) + suffixLen;
+            }
+            else {
+                memcpy(data + pos, entryData + srcPos, keyLen);
+                pos += keyLen;
+            }
+            memcpy(data + pos, entryData + srcPos + keyLen, IX::PAGE_RID_LEN + IX::INDEXPAGE_CHILD_PTR_LEN);
+            pos += IX::PAGE_RID_LEN + IX::INDEXPAGE_CHILD_PTR_LEN;
+            srcPos += keyLen + IX::PAGE_RID_LEN + IX::INDEXPAGE_CHILD_PTR_LEN;
+        }
+        freeBytePtr = pos;
+        counter = entryCounter;
+        rebuildSlots(attr);
+        return 0;
+    }
+
+    void IndexPageHandle::getKeyPositions(const std::vector<uint8_t>& entryData, int16_t entryCounter, std::vector<int32_t>& keyPos, const Attribute& attr) {
+        keyPos.resize(entryCounter + 1);
+        keyPos[0] = IX::INDEXPAGE_CHILD_PTR_LEN;
+        for(int16_t i = 0; i < entryCounter; i++) {
+            keyPos[i + 1] = keyPos[i] + getEntryLen(entryData.data() + keyPos[i], attr);
+        }
+    }
+
+    // Sorted keys of a page share the prefix of its first and last one, pushing up a key leaves at least one on each side
+    int16_t IndexPageHandle::findBalancedMiddleKey(const std::vector<uint8_t>& entryData, const std::vector<int32_t>& keyPos, const Attribute& attr) {
+        int16_t entryNum = keyPos.size() - 1;
+        auto getPageLen = [&](int16_t first, int16_t last) {
+            int32_t keyNum = last - first + 1;
+            int32_t prefixLen = 0;
+            if(hasKeyPrefix() && attr.type == TypeVarChar && keyNum > 1) {
+                prefixLen = getCommonPrefixLen(entryData.data() + keyPos[first], entryData.data() + keyPos[last]);
+            }
+            int32_t prefixAreaLen = hasKeyPrefix() ? IX::INDEXPAGE_PREFIX_SIZE_LEN + prefixLen : 0;
+            return IX::INDEXPAGE_CHILD_PTR_LEN + keyPos[last + 1] - keyPos[first] - keyNum * prefixLen +
+                   keyNum * getSlotLen() + prefixAreaLen;
+        };
+        int16_t middleIndex = -1;
+        int32_t minPageLen = PAGE_SIZE;
+        for(int16_t i = 1; i < entryNum - 1; i++) {
+            int32_t pageLen = std::max(getPageLen(0, i - 1), getPageLen(i + 1, entryNum - 1));
+            if(pageLen <= PAGE_SIZE - getHeaderLen() && pageLen < minPageLen) {
+                minPageLen = pageLen;
+                middleIndex = i;
+            }
+        }
+        return middleIndex;
+    }
+
+    bool IndexPageHandle::isUnderflow() {
+        int32_t usedLen = freeBytePtr + counter * getSlotLen() + getKeyPrefixAreaLen();
+        return usedLen * 2 < PAGE_SIZE - getHeaderLen();
+    }
+
+    // Child pointers are not touched by the key prefix, they are read in place
+    uint32_t IndexPageHandle::getChild(int16_t index, const Attribute& attr) {
+        int16_t pos = 0;
+        for(int16_t i = 0; i < index; i++) {
+            pos += IX::INDEXPAGE_CHILD_PTR_LEN + getCompositeKeyLen(data + pos + IX::INDEXPAGE_CHILD_PTR_LEN, attr);
+        }
+        uint32_t childPage;
+        memcpy(&childPage, data + pos, IX::INDEXPAGE_CHILD_PTR_LEN);
+        return childPage;
+    }
+
+    int16_t IndexPageHandle::findChildIndex(uint32_t childPage, const Attribute& attr) {
+        int16_t pos = 0;
+        uint32_t curChild;
+        for(int16_t i = 0; i <= counter; i++) {
+            memcpy(&curChild, data + pos, IX::INDEXPAGE_CHILD_PTR_LEN);
+            if(curChild == childPage) {
+                return i;
+            }
+            if(i < counter) {
+                pos += IX::INDEXPAGE_CHILD_PTR_LEN + getCompositeKeyLen(data + pos + IX::INDEXPAGE_CHILD_PTR_LEN, attr);
+            }
+        }
+        return -1;
+    }
+
+    RC IndexPageHandle::getKey(int16_t index, uint8_t* compKey, const Attribute& attr) {
+        RC ret = 0;
+        if(index < 0 || index >= counter) {
+            return ERR_KEY_NOT_EXIST;
+        }
+        std::vector<uint8_t> entries;
+        ret = getEntries(entries, attr);
+        if(ret) return ret;
+        std::vector<int32_t> keyPos;
+        getKeyPositions(entries, counter, keyPos, attr);
+        memcpy(compKey, entries.data() + keyPos[index], getCompositeKeyLen(entries.data() + keyPos[index], attr));
+        return 0;
+    }
+
+    // A longer key may not fit, the page is then left as it is
+    RC IndexPageHandle::replaceKey(int16_t index, const uint8_t* compKey, const Attribute& attr) {
+        RC ret = 0;
+        if(index < 0 || index >= counter) {
+            return ERR_KEY_NOT_EXIST;
+        }
+        std::vector<uint8_t> entries;
+        ret = getEntries(entries, attr);
+        if(ret) return ret;
+        std::vector<int32_t> keyPos;
+        getKeyPositions(entries, counter, keyPos, attr);
+        entries.erase(entries.begin() + keyPos[index], entries.begin() + keyPos[index] + getCompositeKeyLen(entries.data() + keyPos[index], attr));
+        entries.insert(entries.begin() + keyPos[index], compKey, compKey + getCompositeKeyLen(compKey, attr));
+        return setEntries(entries.data(), entries.size(), counter, attr);
+    }
+
+    RC IndexPageHandle::deleteIndex(int16_t index, const Attribute& attr) {
+        RC ret = 0;
+        if(index < 0 || index >= counter) {
+            return ERR_KEY_NOT_EXIST;
+        }
+        std::vector<uint8_t> entries;
+        ret = getEntries(entries, attr);
+        if(ret) return ret;
+        std::vector<int32_t> keyPos;
+        getKeyPositions(entries, counter, keyPos, attr);
+        entries.erase(entries.begin() + keyPos[index], entries.begin() + keyPos[index + 1]);
+        return setEntries(entries.data(), entries.size(), counter - 1, attr);
+    }
+
+    // The separator comes down between both pages, they become one page if it fits
+    // Otherwise the keys are cut again where both pages are about the same size and the middle one goes up
+    RC IndexPageHandle::mergeOrRedistribute(IndexPageHandle& rightPH, IndexPageHandle& parentPH, int16_t keyIndex, bool& isMerged, const Attribute& attr) {
+        RC ret = 0;
+        isMerged = false;
+        std::vector<uint8_t> entries, rightEntries;
+        ret = getEntries(entries, attr);
+        if(ret) return ret;
+        ret = rightPH.getEntries(rightEntries, attr);
+        if(ret) return ret;
+        uint8_t separator[PAGE_SIZE];
+        ret = parentPH.getKey(keyIndex, separator, attr);
+        if(ret) return ret;
+        entries.insert(entries.end(), separator, separator + getCompositeKeyLen(separator, attr));
+        entries.insert(entries.end(), rightEntries.begin(), rightEntries.end());
+        int16_t entryNum = counter + 1 + rightPH.counter;
+
+        // 1. Merge
+        ret = setEntries(entries.data(), entries.size(), entryNum, attr);
+        if(ret == 0) {
+            isMerged = true;
+            return parentPH.deleteIndex(keyIndex, attr);
+        }
+        if(ret != ERR_PAGE_NOT_ENOUGH_SPACE) {
+            return ret;
+        }
+
+        // 2. Redistribute
+        std::vector<int32_t> keyPos;
+        getKeyPositions(entries, entryNum, keyPos, attr);
+        int16_t middleIndex = findBalancedMiddleKey(entries, keyPos, attr);
+        if(middleIndex < 0 || middleIndex == counter) {
+            return 0;
+        }
+        ret = parentPH.replaceKey(keyIndex, entries.data() + keyPos[middleIndex], attr);
+        if(ret == ERR_PAGE_NOT_ENOUGH_SPACE) {
+            return 0;
+        }
+        if(ret) return ret;
+        int32_t moveStartPos = keyPos[middleIndex] + getCompositeKeyLen(entries.data() + keyPos[middleIndex], attr);
+        ret = rightPH.setEntries(entries.data() + moveStartPos, entries.size() - moveStartPos, entryNum - middleIndex - 1, attr);
+        if(ret) return ret;
+        return setEntries(entries.data(), keyPos[middleIndex], middleIndex, attr);
+    }
+
+    int16_t IndexPageHandle::getKeyPrefixLen() {
+        if(!hasKeyPrefix()) {
+            return 0;
+        }
+        return getKeyPrefixAreaLen() - IX::INDEXPAGE_PREFIX_SIZE_LEN;
+    }
+
+    void IndexPageHandle::setKeyPrefix(const uint8_t* prefix, int16_t prefixLen) {
+        int16_t prefixSizeOffset = PAGE_SIZE - getHeaderLen() - IX::INDEXPAGE_PREFIX_SIZE_LEN;
+        memcpy(data + prefixSizeOffset, &prefixLen, IX::INDEXPAGE_PREFIX_SIZE_LEN);
+        if(prefixLen > 0) {
+            memmove(data + prefixSizeOffset - prefixLen, prefix, prefixLen);
+        }
+        isDirty = true;
+    }
+
+    int IndexPageHandle::compareKeyPrefix(const uint8_t* key) {
+        int16_t prefixLen = getKeyPrefixLen();
+        if(prefixLen == 0) {
+            return 0;
+        }
+        const uint8_t* prefix = data + PAGE_SIZE - getHeaderLen() - IX::INDEXPAGE_PREFIX_SIZE_LEN - prefixLen;
+        int32_t keyLen;
+        memcpy(&keyLen, key, sizeof(int32_t));
+        int compResult = memcmp(key + sizeof(int32_t), prefix, std::min<int32_t>(keyLen, prefixLen));
+        if(compResult != 0) {
+            return compResult;
+        }
+        return keyLen < prefixLen ? -1 : 0;
+    }
+
+    void IndexPageHandle::stripKeyPrefix(uint8_t* strippedKey, const uint8_t* key) {
+        int16_t prefixLen = getKeyPrefixLen();
+        int32_t keyLen;
+        memcpy(&keyLen, key, sizeof(int32_t));
+        int32_t suffixLen = keyLen - prefixLen;
+        memcpy(strippedKey, &suffixLen, sizeof(int32_t));
+        memcpy(strippedKey + sizeof(int32_t), key + sizeof(int32_t) + prefixLen, suffixLen);
+    }
+
     int16_t IndexPageHandle::getCompositeKeyLen(const uint8_t* key, const Attribute& attr) {
         return getKeyLen(key, attr) + IX::PAGE_RID_LEN;
     }
@@ -217,34 +627,39 @@ namespace PeterDB {
         // 1. Keys
         out << "{\"keys\": [";
         std::queue<int> children;
-        int16_t offset = 0;
+        // Keys with the page prefix put back
+        std::vector<uint8_t> entries;
+        ret = getEntries(entries, attr);
+        if(ret) return ret;
+        const uint8_t* entryData = entries.data();
+        int32_t offset = 0;
         uint32_t child;
         for(int16_t i = 0; i < counter; i++) {
-            memcpy(&child, data + offset, IX::INDEXPAGE_CHILD_PTR_LEN);
+            memcpy(&child, entryData + offset, IX::INDEXPAGE_CHILD_PTR_LEN);
             children.push(child);
             offset += IX::INDEXPAGE_CHILD_PTR_LEN;
             out << "\"";
             switch (attr.type) {
                 case TypeInt:
-                    out << getKeyInt(data + offset);
+                    out << getKeyInt(entryData + offset);
                     break;
                 case TypeReal:
-                    out << getKeyReal(data + offset);
+                    out << getKeyReal(entryData + offset);
                     break;
                 case TypeVarChar:
-                    out << getKeyString(data + offset);
+                    out << getKeyString(entryData + offset);
                     break;
                 default:
                     return ERR_KEY_TYPE_NOT_SUPPORT;
             }
-            offset += getCompositeKeyLen(data + offset, attr);
+            offset += getCompositeKeyLen(entryData + offset, attr);
             out << "\"";
             if(i != counter - 1) {
                 out << ",";
             }
         }
         // Last Child
-        memcpy(&child, data + offset, IX::INDEXPAGE_CHILD_PTR_LEN);
+        memcpy(&child, entryData + offset, IX::INDEXPAGE_CHILD_PTR_LEN);
         if(child < IX::FILE_HIDDEN_PAGE_NUM) {
             return ERR_INDEXPAGE_LAST_CHILD_NOT_EXIST;
         }
@@ -256,14 +671,20 @@ namespace PeterDB {
             int16_t pageType;
             {
                 IXPageHandle pageHandle(ixFileHandle, children.front());
+                ret = pageHandle.getPinStatus();
+                if(ret) return ret;
                 pageType = pageHandle.getPageType();
             }
             if(pageType == IX::PAGE_TYPE_INDEX) {
                 IndexPageHandle indexPH(ixFileHandle, children.front());
+                ret = indexPH.getPinStatus();
+                if(ret) return ret;
                 indexPH.print(attr, out);
             }
             else if(pageType == IX::PAGE_TYPE_LEAF) {
                 LeafPageHandle leafPH(ixFileHandle, children.front());
+                ret = leafPH.getPinStatus();
+                if(ret) return ret;
                 leafPH.print(attr, out);
             }
             children.pop();
@@ -277,16 +698,46 @@ namespace PeterDB {
     }
 
 
+    void IndexPageHandle::rebuildSlots(const Attribute& attr) {
+        if(!hasSlotArray()) {
+            return;
+        }
+        int16_t pos = IX::INDEXPAGE_CHILD_PTR_LEN;
+        for(int16_t i = 0; i < counter; i++) {
+            setSlot(i, pos);
+            pos += getEntryLen(data + pos, attr);
+        }
+    }
+
+    int16_t IndexPageHandle::getInsertLen(const uint8_t* key, const Attribute& attr) {
+        int16_t prefixLen = getKeyPrefixLen();
+        if(prefixLen == 0) {
+            return getEntryLen(key, attr) + getSlotLen();
+        }
+        if(compareKeyPrefix(key) == 0) {
+            return getEntryLen(key, attr) - prefixLen + getSlotLen();
+        }
+        // The prefix shrinks to the part the key shares, stored keys grow and the prefix area shrinks by the rest
+        const uint8_t* prefix = data + PAGE_SIZE - getHeaderLen() - IX::INDEXPAGE_PREFIX_SIZE_LEN - prefixLen;
+        int32_t keyLen;
+        memcpy(&keyLen, key, sizeof(int32_t));
+        int16_t newPrefixLen = 0;
+        while(newPrefixLen < std::min<int32_t>(keyLen, prefixLen) && key[sizeof(int32_t) + newPrefixLen] == prefix[newPrefixLen]) {
+            newPrefixLen++;
+        }
+        return getEntryLen(key, attr) - newPrefixLen + getSlotLen() + (counter - 1) * (prefixLen - newPrefixLen);
+    }
+
     bool IndexPageHandle::hasEnoughSpace(const uint8_t* key, const Attribute &attr) {
-        return getFreeSpace() >= getEntryLen(key, attr);
+        return getFreeSpace() >= getInsertLen(key, attr);
     }
 
     int16_t IndexPageHandle::getIndexHeaderLen() {
-        return getHeaderLen();
+        return getHeaderLen() + getKeyPrefixAreaLen();
     }
 
     int16_t IndexPageHandle::getFreeSpace() {
-        return PAGE_SIZE - freeBytePtr - getIndexHeaderLen();
+        return PAGE_SIZE - freeBytePtr - getIndexHeaderLen() - counter * getSlotLen();
     }
 
 }
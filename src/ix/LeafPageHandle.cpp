@@ -16,12 +16,23 @@ namespace PeterDB {
         setNextPtr(next);
     }
 
+    LeafPageHandle::LeafPageHandle(IXFileHandle& fileHandle, uint8_t* pageBuffer, uint32_t page, uint32_t next,
+                                   uint8_t* entryData, int16_t dataLen, int16_t entryCounter):
+                                   IXPageHandle(fileHandle, pageBuffer, entryData, dataLen, page, IX::PAGE_TYPE_LEAF, entryCounter) {
+        setNextPtr(next);
+    }
+
     LeafPageHandle::~LeafPageHandle() {
-        setNextPtr(nextPtr);
+        if(nextPtr != getNextPtrFromData()) {
+            setNextPtr(nextPtr);
+        }
     }
 
     RC LeafPageHandle::insertEntry(const uint8_t* key, const RID& rid, const Attribute& attr, uint8_t* middleKey, uint32_t& newChild, bool& isNewChildExist) {
         RC ret = 0;
+        if(hasPostingList()) {
+            return insertPosting(key, rid, attr, middleKey, newChild, isNewChildExist);
+        }
         if(hasEnoughSpace(key, attr)) {
             ret = insertEntryWithEnoughSpace(key, rid, attr);
             if(ret) return ret;
@@ -38,27 +49,16 @@ namespace PeterDB {
 
     RC LeafPageHandle::insertEntryWithEnoughSpace(const uint8_t* key, const RID& rid, const Attribute& attr) {
         RC ret = 0;
-        if(getFreeSpace() < getEntryLen(key, attr)) {
+        if(hasPostingList()) {
+            return insertPostingWithEnoughSpace(key, rid, attr);
+        }
+        if(!hasEnoughSpace(key, attr)) {
             return ERR_PAGE_NOT_ENOUGH_SPACE;
         }
 
+        // Find the first entry greater than the new one
         int16_t pos = 0;
-        if(counter == 0) {
-            // Case 1: the first entry
-            pos = 0;
-        }
-        else {
-            // Case 2: Iterate over other keys
-            RID curRid;
-            pos = 0;
-            for (int16_t index = 0; index < counter; index++) {
-                getRid(data + pos, attr, curRid);
-                if (isCompositeKeyMeetCompCondition(key, rid, data + pos, curRid, attr, LT_OP)) {
-                    break;
-                }
-                pos += getEntryLen(data + pos, attr);
-            }
-        }
+        findFirstCompositeKeyMeetCompCondition(pos, key, rid, attr, LT_OP);
 
         if(pos > freeBytePtr) {
             return ERR_PTR_BEYONG_FREEBYTE;
@@ -74,6 +74,9 @@ namespace PeterDB {
         }
 
         writeEntry(pos, key, rid, attr);
+        if(hasSlotArray()) {
+            insertSlot(getSlotIndex(pos), pos, entryLen);
+        }
 
         freeBytePtr += entryLen;
         counter++;
@@ -91,10 +94,27 @@ namespace PeterDB {
         pos += IX::PAGE_RID_PAGE_LEN;
         memcpy(data + pos, &entry.slotNum, IX::PAGE_RID_SLOT_LEN);
         pos += IX::PAGE_RID_SLOT_LEN;
+        isDirty = true;
         return 0;
     }
 
     RC LeafPageHandle::findFirstKeyMeetCompCondition(int16_t& pos, const uint8_t* key, const Attribute& attr, CompOp op) {
+        if(hasSlotArray() && (op == GE_OP || op == GT_OP)) {
+            // Keys are sorted, entries meeting the condition are at the end of the page
+            int16_t low = 0, high = counter;
+            while(low < high) {
+                int16_t mid = low + (high - low) / 2;
+                if(isKeyMeetCompCondition(data + getSlot(mid), key, attr, op)) {
+                    high = mid;
+                }
+                else {
+                    low = mid + 1;
+                }
+            }
+            pos = low < counter ? getSlot(low) : freeBytePtr;
+            return 0;
+        }
+
         pos = 0;
         for (int16_t index = 0; index < counter; index++) {
             if (isKeyMeetCompCondition(data + pos, key, attr, op)) {
@@ -106,8 +126,32 @@ namespace PeterDB {
     }
 
     RC LeafPageHandle::findFirstCompositeKeyMeetCompCondition(int16_t& pos, const uint8_t* key, const RID& rid, const Attribute& attr, CompOp op) {
-        pos = 0;
         RID curRID;
+        if(hasSlotArray() && (op == LT_OP || op == LE_OP || op == EQ_OP)) {
+            // An equal entry is the first one not less than the composite key
+            CompOp boundOp = op == EQ_OP ? LE_OP : op;
+            int16_t low = 0, high = counter;
+            while(low < high) {
+                int16_t mid = low + (high - low) / 2;
+                getRid(data + getSlot(mid), attr, curRID);
+                if(isCompositeKeyMeetCompCondition(key, rid, data + getSlot(mid), curRID, attr, boundOp)) {
+                    high = mid;
+                }
+                else {
+                    low = mid + 1;
+                }
+            }
+            pos = low < counter ? getSlot(low) : freeBytePtr;
+            if(op == EQ_OP && pos < freeBytePtr) {
+                getRid(data + pos, attr, curRID);
+                if(!isCompositeKeyMeetCompCondition(key, rid, data + pos, curRID, attr, EQ_OP)) {
+                    pos = freeBytePtr;
+                }
+            }
+            return 0;
+        }
+
+        pos = 0;
         for (int16_t index = 0; index < counter; index++) {
             getRid(data + pos, attr, curRID);
             if (isCompositeKeyMeetCompCondition(key, rid, data + pos, curRID, attr, op)) {
@@ -120,6 +164,9 @@ namespace PeterDB {
 
     RC LeafPageHandle::deleteEntry(const uint8_t* key, const RID& entry, const Attribute& attr) {
         RC ret = 0;
+        if(hasPostingList()) {
+            return deletePosting(key, entry, attr);
+        }
         int16_t slotPos = 0;
         findFirstCompositeKeyMeetCompCondition(slotPos, (uint8_t *)key, entry, attr, EQ_OP);
         if(slotPos >= freeBytePtr) {
@@ -130,6 +177,9 @@ namespace PeterDB {
         if(dataNeedMovePos < freeBytePtr) {
             shiftRecordLeft(dataNeedMovePos, curEntryLen);
         }
+        if(hasSlotArray()) {
+            deleteSlot(getSlotIndex(slotPos), curEntryLen);
+        }
         freeBytePtr -= curEntryLen;
         counter--;
         return 0;
@@ -139,6 +189,13 @@ namespace PeterDB {
         if(counter < 1) {
             return ERR_KEY_NOT_EXIST;
         }
+        if(hasPostingList()) {
+            // Separators only route by key, the rid is left zero
+            int16_t keyLen = getKeyLen(data, attr);
+            memcpy(compKeyData, data, keyLen);
+            bzero(compKeyData + keyLen, IX::PAGE_RID_LEN);
+            return 0;
+        }
         int compKeyLen = getEntryLen(data, attr);
         memcpy(compKeyData, data, compKeyLen);
         return 0;
@@ -147,9 +204,8 @@ namespace PeterDB {
     RC LeafPageHandle::splitPageAndInsertEntry(uint8_t* middleKey, uint32_t& newLeafPage, const uint8_t* key, const RID& rid, const Attribute& attr) {
         RC ret = 0;
         // 0. Append a new page
-        ret = ixFileHandle.appendEmptyPage();
+        ret = ixFileHandle.appendEmptyPage(newLeafPage);
         if(ret) return ret;
-        newLeafPage = ixFileHandle.getLastPageIndex();
 
         // 1. Find move data start position and index
         // IMPORTANT make sure new entry can be inserted into current page or new page
@@ -164,13 +220,13 @@ namespace PeterDB {
         RID tmpRid;
         getRid(data + moveStartPos, attr, tmpRid);
         if(isCompositeKeyMeetCompCondition(key, rid, data + moveStartPos, tmpRid, attr, CompOp::LT_OP)) {
-            if(moveStartPos + getEntryLen(key, attr) > getMaxFreeSpace()) {
+            if(moveStartPos + getEntryLen(key, attr) + (moveStartIndex + 1) * getSlotLen() > getMaxFreeSpace()) {
                 isSplitFeasible = false;
                 moveStartIndex--;
             }
         }
         else {
-            if(freeBytePtr - moveStartPos + getEntryLen(key, attr) > getMaxFreeSpace()) {
+            if(freeBytePtr - moveStartPos + getEntryLen(key, attr) + (counter - moveStartIndex + 1) * getSlotLen() > getMaxFreeSpace()) {
                 isSplitFeasible = false;
                 moveStartIndex++;
             }
@@ -187,8 +243,11 @@ namespace PeterDB {
         int16_t moveLen = freeBytePtr - moveStartPos;
         LeafPageHandle newLeafPageHandle(ixFileHandle, newLeafPage, nextPtr, data + moveStartPos,
                                          moveLen, counter - moveStartIndex);
+        ret = newLeafPageHandle.getPinStatus();
+        if(ret) return ret;
+        newLeafPageHandle.rebuildSlots(attr);
 
-        // 3. Compact old page and maintain metadata
+        // 3. Compact old page and maintain metadata, slots of remaining entries are unchanged
         freeBytePtr -= moveLen;
         counter = moveStartIndex;
 
@@ -213,8 +272,492 @@ namespace PeterDB {
         return 0;
     }
 
+    RC LeafPageHandle::insertPosting(const uint8_t* key, const RID& rid, const Attribute& attr, uint8_t* middleKey, uint32_t& newChild, bool& isNewChildExist) {
+        RC ret = 0;
+        if(getFreeSpace() >= getPostingInsertLen(key, attr)) {
+            ret = insertPostingWithEnoughSpace(key, rid, attr);
+            if(ret) return ret;
+            isNewChildExist = false;
+        }
+        else {
+            ret = splitPageAndInsertPosting(middleKey, newChild, key, rid, attr);
+            if(ret) return ret;
+            isNewChildExist = true;
+        }
+        return 0;
+    }
+
+    RC LeafPageHandle::insertPostingWithEnoughSpace(const uint8_t* key, const RID& rid, const Attribute& attr) {
+        if(getFreeSpace() < getPostingInsertLen(key, attr)) {
+            return ERR_PAGE_NOT_ENOUGH_SPACE;
+        }
+        int16_t pos;
+        bool isFound;
+        findPosting(pos, isFound, key, attr);
+        int16_t keyLen = getKeyLen(key, attr);
+
+        if(!isFound) {
+            // New key, its posting list starts with one rid
+            int16_t entryLen = keyLen + IX::POSTING_RID_NUM_LEN + IX::PAGE_RID_LEN;
+            shiftRecordRight(pos, entryLen);
+            memcpy(data + pos, key, keyLen);
+            isDirty = true;
+            setPostingRidNum(pos, 1, attr);
+            writeRid(data + pos + keyLen + IX::POSTING_RID_NUM_LEN, rid);
+            if(hasSlotArray()) {
+                insertSlot(getSlotIndex(pos), pos, entryLen);
+            }
+            freeBytePtr += entryLen;
+            counter++;
+            return 0;
+        }
+
+        int16_t ridNum = getPostingRidNum(pos, attr);
+        if(ridNum == IX::POSTING_OVERFLOW) {
+            return insertOverflowRid(pos, rid, attr);
+        }
+        if(isPostingSpill(pos, attr)) {
+            return spillPosting(pos, rid, attr);
+        }
+
+        // Keep the rid list sorted
+        int16_t ridListPos = pos + keyLen + IX::POSTING_RID_NUM_LEN;
+        int16_t ridPos = ridListPos + findRidIndex(data + ridListPos, ridNum, rid) * IX::PAGE_RID_LEN;
+        shiftRecordRight(ridPos, IX::PAGE_RID_LEN);
+        writeRid(data + ridPos, rid);
+        isDirty = true;
+        setPostingRidNum(pos, ridNum + 1, attr);
+        if(hasSlotArray()) {
+            resizeSlot(getSlotIndex(pos), IX::PAGE_RID_LEN);
+        }
+        freeBytePtr += IX::PAGE_RID_LEN;
+        return 0;
+    }
+
+    RC LeafPageHandle::deletePosting(const uint8_t* key, const RID& rid, const Attribute& attr) {
+        RC ret = 0;
+        int16_t pos;
+        bool isFound;
+        findPosting(pos, isFound, key, attr);
+        if(!isFound) {
+            return ERR_LEAFNODE_ENTRY_NOT_EXIST;
+        }
+
+        bool isEntryEmpty = false;
+        int16_t ridNum = getPostingRidNum(pos, attr);
+        if(ridNum == IX::POSTING_OVERFLOW) {
+            ret = deleteOverflowRid(pos, rid, isEntryEmpty, attr);
+            if(ret) return ret;
+        }
+        else {
+            int16_t ridListPos = pos + getKeyLen(key, attr) + IX::POSTING_RID_NUM_LEN;
+            int16_t ridIndex = findRidIndex(data + ridListPos, ridNum, rid);
+            RID curRid;
+            if(ridIndex < ridNum) {
+                readRid(data + ridListPos + ridIndex * IX::PAGE_RID_LEN, curRid);
+            }
+            if(ridIndex >= ridNum || compareRid(curRid, rid) != 0) {
+                return ERR_LEAFNODE_ENTRY_NOT_EXIST;
+            }
+            if(ridNum > 1) {
+                shiftRecordLeft(ridListPos + (ridIndex + 1) * IX::PAGE_RID_LEN, IX::PAGE_RID_LEN);
+                setPostingRidNum(pos, ridNum - 1, attr);
+                if(hasSlotArray()) {
+                    resizeSlot(getSlotIndex(pos), -IX::PAGE_RID_LEN);
+                }
+                freeBytePtr -= IX::PAGE_RID_LEN;
+                return 0;
+            }
+            isEntryEmpty = true;
+        }
+
+        if(isEntryEmpty) {
+            // The last rid of the key is gone, remove the whole entry
+            int16_t entryLen = getEntryLen(data + pos, attr);
+            shiftRecordLeft(pos + entryLen, entryLen);
+            if(hasSlotArray()) {
+                deleteSlot(getSlotIndex(pos), entryLen);
+            }
+            freeBytePtr -= entryLen;
+            counter--;
+        }
+        return 0;
+    }
+
+    RC LeafPageHandle::splitPageAndInsertPosting(uint8_t* middleKey, uint32_t& newLeafPage, const uint8_t* key, const RID& rid, const Attribute& attr) {
+        RC ret = 0;
+        // 0. Append a new page
+        ret = ixFileHandle.appendEmptyPage(newLeafPage);
+        if(ret) return ret;
+
+        // 1. Split at the entry boundary balancing both pages, the page taking the key must have space for it
+        int16_t insertLen = getPostingInsertLen(key, attr);
+        int16_t keyPos;
+        bool isFound;
+        findPosting(keyPos, isFound, key, attr);
+        int16_t keyIndex = getSlotIndex(keyPos);
+        int16_t moveStartIndex = -1;
+        int16_t minLenDiff = PAGE_SIZE;
+        for(int16_t i = 1; i < counter; i++) {
+            int16_t leftLen = getSlot(i) + i * getSlotLen();
+            int16_t rightLen = freeBytePtr - getSlot(i) + (counter - i) * getSlotLen();
+            // A new key right before the first moved entry stays in the old page
+            if(isFound ? keyIndex < i : keyIndex <= i) {
+                leftLen += insertLen;
+            }
+            else {
+                rightLen += insertLen;
+            }
+            if(leftLen > getMaxFreeSpace() || rightLen > getMaxFreeSpace()) {
+                continue;
+            }
+            if(std::abs(leftLen - rightLen) < minLenDiff) {
+                minLenDiff = std::abs(leftLen - rightLen);
+                moveStartIndex = i;
+            }
+        }
+        if(moveStartIndex < 0) {
+            return ERR_PAGE_NOT_ENOUGH_SPACE;
+        }
+        bool isKeyInOldPage = isFound ? keyIndex < moveStartIndex : keyIndex <= moveStartIndex;
+
+        // 2. Move data to new page and set metadata
+        int16_t moveStartPos = getSlot(moveStartIndex);
+        LeafPageHandle newLeafPageHandle(ixFileHandle, newLeafPage, nextPtr, data + moveStartPos,
+                                         freeBytePtr - moveStartPos, counter - moveStartIndex);
+        ret = newLeafPageHandle.getPinStatus();
+        if(ret) return ret;
+        newLeafPageHandle.rebuildSlots(attr);
+
+        // 3. Compact old page and insert new leaf page into the linked list
+        freeBytePtr = moveStartPos;
+        counter = moveStartIndex;
+        nextPtr = newLeafPage;
+
+        // 4. Insert into the page holding the key
+        if(isKeyInOldPage) {
+            ret = insertPostingWithEnoughSpace(key, rid, attr);
+        }
+        else {
+            ret = newLeafPageHandle.insertPostingWithEnoughSpace(key, rid, attr);
+        }
+        if(ret) return ret;
+
+        // 5. Return new middle composite key, prefix files only keep the shortest key separating both pages
+        if(hasKeyPrefix()) {
+            getShortestSeparator(middleKey, data + getSlot(counter - 1), newLeafPageHandle.data, attr);
+        }
+        else {
+            newLeafPageHandle.getFirstCompKey(middleKey, attr);
+        }
+        return 0;
+    }
+
+    RC LeafPageHandle::findPosting(int16_t& pos, bool& isFound, const uint8_t* key, const Attribute& attr) {
+        findFirstKeyMeetCompCondition(pos, key, attr, GE_OP);
+        isFound = pos < freeBytePtr && compareKey(data + pos, key, attr) == 0;
+        return 0;
+    }
+
+    int16_t LeafPageHandle::getPostingInsertLen(const uint8_t* key, const Attribute& attr) {
+        int16_t pos;
+        bool isFound;
+        findPosting(pos, isFound, key, attr);
+        if(!isFound) {
+            return getKeyLen(key, attr) + IX::POSTING_RID_NUM_LEN + IX::PAGE_RID_LEN + getSlotLen();
+        }
+        if(getPostingRidNum(pos, attr) == IX::POSTING_OVERFLOW || isPostingSpill(pos, attr)) {
+            return 0;
+        }
+        return IX::PAGE_RID_LEN;
+    }
+
+    // One more rid makes the inline list too long, a single rid always stays inline
+    bool LeafPageHandle::isPostingSpill(int16_t pos, const Attribute& attr) {
+        return getPostingRidNum(pos, attr) > 1 &&
+               getEntryLen(data + pos, attr) + IX::PAGE_RID_LEN > IX::POSTING_INLINE_MAX_LEN;
+    }
+
+    // Move the inline rids and the new one into an overflow page, the entry shrinks to the chain pointers
+    RC LeafPageHandle::spillPosting(int16_t pos, const RID& rid, const Attribute& attr) {
+        RC ret = 0;
+        int16_t keyLen = getKeyLen(data + pos, attr);
+        int16_t ridNum = getPostingRidNum(pos, attr);
+        int16_t ridListPos = pos + keyLen + IX::POSTING_RID_NUM_LEN;
+        int16_t ridIndex = findRidIndex(data + ridListPos, ridNum, rid);
+        uint8_t ridData[PAGE_SIZE];
+        memcpy(ridData, data + ridListPos, ridIndex * IX::PAGE_RID_LEN);
+        writeRid(ridData + ridIndex * IX::PAGE_RID_LEN, rid);
+        memcpy(ridData + (ridIndex + 1) * IX::PAGE_RID_LEN, data + ridListPos + ridIndex * IX::PAGE_RID_LEN,
+               (ridNum - ridIndex) * IX::PAGE_RID_LEN);
+
+        uint32_t overflowPage;
+        ret = ixFileHandle.appendEmptyPage(overflowPage);
+        if(ret) return ret;
+        {
+            OverflowPageHandle overflowPH(ixFileHandle, overflowPage, IX::PAGE_PTR_NULL, ridData, ridNum + 1);
+            ret = overflowPH.getPinStatus();
+            if(ret) return ret;
+        }
+
+        int16_t oldEntryLen = getEntryLen(data + pos, attr);
+        int16_t newEntryLen = keyLen + IX::POSTING_RID_NUM_LEN + 2 * IX::POSTING_OVERFLOW_PTR_LEN;
+        shiftRecordLeft(pos + oldEntryLen, oldEntryLen - newEntryLen);
+        setPostingRidNum(pos, IX::POSTING_OVERFLOW, attr);
+        setPostingOverflowPtrs(pos, overflowPage, overflowPage, attr);
+        if(hasSlotArray()) {
+            resizeSlot(getSlotIndex(pos), newEntryLen - oldEntryLen);
+        }
+        freeBytePtr -= oldEntryLen - newEntryLen;
+        return 0;
+    }
+
+    int16_t LeafPageHandle::getPostingRidNum(int16_t pos, const Attribute& attr) {
+        int16_t ridNum;
+        memcpy(&ridNum, data + pos + getKeyLen(data + pos, attr), IX::POSTING_RID_NUM_LEN);
+        return ridNum;
+    }
+    void LeafPageHandle::setPostingRidNum(int16_t pos, int16_t ridNum, const Attribute& attr) {
+        memcpy(data + pos + getKeyLen(data + pos, attr), &ridNum, IX::POSTING_RID_NUM_LEN);
+        isDirty = true;
+    }
+
+    void LeafPageHandle::getPostingOverflowPtrs(int16_t pos, uint32_t& head, uint32_t& tail, const Attribute& attr) {
+        int16_t ptrPos = pos + getKeyLen(data + pos, attr) + IX::POSTING_RID_NUM_LEN;
+        memcpy(&head, data + ptrPos, IX::POSTING_OVERFLOW_PTR_LEN);
+        memcpy(&tail, data + ptrPos + IX::POSTING_OVERFLOW_PTR_LEN, IX::POSTING_OVERFLOW_PTR_LEN);
+    }
+    void LeafPageHandle::setPostingOverflowPtrs(int16_t pos, uint32_t head, uint32_t tail, const Attribute& attr) {
+        int16_t ptrPos = pos + getKeyLen(data + pos, attr) + IX::POSTING_RID_NUM_LEN;
+        memcpy(data + ptrPos, &head, IX::POSTING_OVERFLOW_PTR_LEN);
+        memcpy(data + ptrPos + IX::POSTING_OVERFLOW_PTR_LEN, &tail, IX::POSTING_OVERFLOW_PTR_LEN);
+        isDirty = true;
+    }
+
+    RC LeafPageHandle::insertOverflowRid(int16_t pos, const RID& rid, const Attribute& attr) {
+        RC ret = 0;
+        uint32_t head, tail;
+        getPostingOverflowPtrs(pos, head, tail, attr);
+
+        // Rids mostly come in ascending order, those go to the tail without walking the chain
+        uint32_t targetPage = tail;
+        {
+            OverflowPageHandle tailPH(ixFileHandle, tail);
+            ret = tailPH.getPinStatus();
+            if(ret) return ret;
+            RID firstRid;
+            tailPH.getRidAt(0, firstRid);
+            if(compareRid(rid, firstRid) < 0) {
+                targetPage = head;
+            }
+        }
+        while(targetPage != tail) {
+            OverflowPageHandle curPH(ixFileHandle, targetPage);
+            ret = curPH.getPinStatus();
+            if(ret) return ret;
+            OverflowPageHandle nextPH(ixFileHandle, curPH.getNextPtr());
+            ret = nextPH.getPinStatus();
+            if(ret) return ret;
+            RID firstRid;
+            nextPH.getRidAt(0, firstRid);
+            if(compareRid(rid, firstRid) < 0) {
+                break;
+            }
+            targetPage = curPH.getNextPtr();
+        }
+
+        OverflowPageHandle targetPH(ixFileHandle, targetPage);
+        ret = targetPH.getPinStatus();
+        if(ret) return ret;
+        if(targetPH.hasEnoughSpace()) {
+            return targetPH.insertRid(rid);
+        }
+
+        // Page is full: a rid after the tail starts a new tail, otherwise the page splits in halves
+        uint32_t newPage;
+        ret = ixFileHandle.appendEmptyPage(newPage);
+        if(ret) return ret;
+        RID lastRid;
+        targetPH.getRidAt(targetPH.getCounter() - 1, lastRid);
+        if(targetPage == tail && compareRid(rid, lastRid) > 0) {
+            uint8_t ridData[IX::PAGE_RID_LEN];
+            writeRid(ridData, rid);
+            OverflowPageHandle newPH(ixFileHandle, newPage, targetPH.getNextPtr(), ridData, 1);
+            ret = newPH.getPinStatus();
+            if(ret) return ret;
+        }
+        else {
+            int16_t moveNum = targetPH.getCounter() / 2;
+            int16_t moveStartPos = (targetPH.getCounter() - moveNum) * IX::PAGE_RID_LEN;
+            OverflowPageHandle newPH(ixFileHandle, newPage, targetPH.getNextPtr(), targetPH.data + moveStartPos, moveNum);
+            ret = newPH.getPinStatus();
+            if(ret) return ret;
+            targetPH.freeBytePtr = moveStartPos;
+            targetPH.counter -= moveNum;
+            RID firstRid;
+            newPH.getRidAt(0, firstRid);
+            ret = compareRid(rid, firstRid) < 0 ? targetPH.insertRid(rid) : newPH.insertRid(rid);
+            if(ret) return ret;
+        }
+        targetPH.setNextPtr(newPage);
+        if(targetPage == tail) {
+            setPostingOverflowPtrs(pos, head, newPage, attr);
+        }
+        return 0;
+    }
+
+    RC LeafPageHandle::deleteOverflowRid(int16_t pos, const RID& rid, bool& isChainEmpty, const Attribute& attr) {
+        RC ret = 0;
+        uint32_t head, tail;
+        getPostingOverflowPtrs(pos, head, tail, attr);
+        isChainEmpty = false;
+
+        // A page leaving the chain is freed once no handle holds it
+        uint32_t pageToFree = IX::PAGE_PTR_NULL;
+        uint32_t prevPage = IX::PAGE_PTR_NULL;
+        uint32_t curPage = head;
+        while(curPage != IX::PAGE_PTR_NULL) {
+            OverflowPageHandle curPH(ixFileHandle, curPage);
+            ret = curPH.getPinStatus();
+            if(ret) return ret;
+            RID lastRid;
+            curPH.getRidAt(curPH.getCounter() - 1, lastRid);
+            if(compareRid(rid, lastRid) > 0) {
+                prevPage = curPage;
+                curPage = curPH.getNextPtr();
+                continue;
+            }
+            ret = curPH.deleteRid(rid);
+            if(ret) return ret;
+            if(!curPH.isEmpty()) {
+                return 0;
+            }
+
+            // An empty page leaves the chain, the head takes over the rids of its successor instead
+            uint32_t nextPage = curPH.getNextPtr();
+            if(curPage != head) {
+                OverflowPageHandle prevPH(ixFileHandle, prevPage);
+                ret = prevPH.getPinStatus();
+                if(ret) return ret;
+                prevPH.setNextPtr(nextPage);
+                if(curPage == tail) {
+                    setPostingOverflowPtrs(pos, head, prevPage, attr);
+                }
+                pageToFree = curPage;
+            }
+            else if(nextPage != IX::PAGE_PTR_NULL) {
+                OverflowPageHandle nextPH(ixFileHandle, nextPage);
+                ret = nextPH.getPinStatus();
+                if(ret) return ret;
+                memcpy(curPH.data, nextPH.data, nextPH.getFreeBytePointer());
+                curPH.isDirty = true;
+                curPH.freeBytePtr = nextPH.getFreeBytePointer();
+                curPH.counter = nextPH.getCounter();
+                curPH.setNextPtr(nextPH.getNextPtr());
+                if(nextPage == tail) {
+                    setPostingOverflowPtrs(pos, head, head, attr);
+                }
+                pageToFree = nextPage;
+            }
+            else {
+                isChainEmpty = true;
+                pageToFree = head;
+            }
+            break;
+        }
+        if(pageToFree == IX::PAGE_PTR_NULL) {
+            return ERR_LEAFNODE_ENTRY_NOT_EXIST;
+        }
+        return ixFileHandle.freePage(pageToFree);
+    }
+
+    bool LeafPageHandle::isUnderflow() {
+        return (freeBytePtr + counter * getSlotLen()) * 2 < getMaxFreeSpace();
+    }
+
+    // The right sibling is appended to this page if both fit, and its separator leaves the parent
+    // Otherwise entries of both are cut again at the entry boundary balancing them, with a new separator
+    RC LeafPageHandle::mergeOrRedistribute(LeafPageHandle& rightPH, IndexPageHandle& parentPH, int16_t keyIndex, bool& isMerged, const Attribute& attr) {
+        RC ret = 0;
+        isMerged = false;
+        int16_t entryNum = counter + rightPH.counter;
+        int16_t totalLen = freeBytePtr + rightPH.freeBytePtr;
+
+        // 1. Merge
+        if(totalLen + entryNum * getSlotLen() <= getMaxFreeSpace()) {
+            memcpy(data + freeBytePtr, rightPH.data, rightPH.freeBytePtr);
+            isDirty = true;
+            freeBytePtr = totalLen;
+            counter = entryNum;
+            nextPtr = rightPH.nextPtr;
+            rebuildSlots(attr);
+            isMerged = true;
+            return parentPH.deleteIndex(keyIndex, attr);
+        }
+
+        // 2. Redistribute
+        std::vector<uint8_t> entries(data, data + freeBytePtr);
+        entries.insert(entries.end(), rightPH.data, rightPH.data + rightPH.freeBytePtr);
+        std::vector<int16_t> entryPos(entryNum + 1, 0);
+        for(int16_t i = 0; i < entryNum; i++) {
+            entryPos[i + 1] = entryPos[i] + getEntryLen(entries.data() + entryPos[i], attr);
+        }
+        int16_t moveStartIndex = -1;
+        int16_t minLenDiff = PAGE_SIZE;
+        for(int16_t i = 1; i < entryNum; i++) {
+            int16_t leftLen = entryPos[i] + i * getSlotLen();
+            int16_t rightLen = totalLen - entryPos[i] + (entryNum - i) * getSlotLen();
+            if(leftLen > getMaxFreeSpace() || rightLen > getMaxFreeSpace()) {
+                continue;
+            }
+            if(std::abs(leftLen - rightLen) < minLenDiff) {
+                minLenDiff = std::abs(leftLen - rightLen);
+                moveStartIndex = i;
+            }
+        }
+        if(moveStartIndex < 0 || moveStartIndex == counter) {
+            return 0;
+        }
+
+        // 3. The parent takes the new separator first, pages are left as they are if it does not fit
+        uint8_t separator[PAGE_SIZE];
+        const uint8_t* lastLeftKey = entries.data() + entryPos[moveStartIndex - 1];
+        const uint8_t* firstRightKey = entries.data() + entryPos[moveStartIndex];
+        if(hasKeyPrefix()) {
+            getShortestSeparator(separator, lastLeftKey, firstRightKey, attr);
+        }
+        else if(hasPostingList()) {
+            int16_t keyLen = getKeyLen(firstRightKey, attr);
+            memcpy(separator, firstRightKey, keyLen);
+            bzero(separator + keyLen, IX::PAGE_RID_LEN);
+        }
+        else {
+            memcpy(separator, firstRightKey, getEntryLen(firstRightKey, attr));
+        }
+        ret = parentPH.replaceKey(keyIndex, separator, attr);
+        if(ret == ERR_PAGE_NOT_ENOUGH_SPACE) {
+            return 0;
+        }
+        if(ret) return ret;
+
+        memcpy(data, entries.data(), entryPos[moveStartIndex]);
+        isDirty = true;
+        freeBytePtr = entryPos[moveStartIndex];
+        counter = moveStartIndex;
+        rebuildSlots(attr);
+        memcpy(rightPH.data, entries.data() + entryPos[moveStartIndex], totalLen - entryPos[moveStartIndex]);
+        rightPH.isDirty = true;
+        rightPH.freeBytePtr = totalLen - entryPos[moveStartIndex];
+        rightPH.counter = entryNum - moveStartIndex;
+        rightPH.rebuildSlots(attr);
+        return 0;
+    }
+
     RC LeafPageHandle::print(const Attribute &attr, std::ostream &out) {
         RC ret = 0;
+        if(hasPostingList()) {
+            return printPosting(attr, out);
+        }
         out << "{\"keys\": [";
         int16_t offset = 0;
         uint32_t pageNum;
@@ -292,10 +835,113 @@ namespace PeterDB {
         return 0;
     }
 
+    RC LeafPageHandle::printPosting(const Attribute &attr, std::ostream &out) {
+        out << "{\"keys\": [";
+        int16_t pos = 0;
+        RID rid;
+        for(int16_t i = 0; i < counter; i++) {
+            out << "\"";
+            switch (attr.type) {
+                case TypeInt:
+                    out << getKeyInt(data + pos) << ":[";
+                    break;
+                case TypeReal:
+                    out << getKeyReal(data + pos) << ":[";
+                    break;
+                case TypeVarChar:
+                    out << getKeyString(data + pos) << ":[";
+                    break;
+                default:
+                    return ERR_KEY_TYPE_NOT_SUPPORT;
+            }
+            int16_t ridNum = getPostingRidNum(pos, attr);
+            if(ridNum == IX::POSTING_OVERFLOW) {
+                uint32_t head, tail;
+                getPostingOverflowPtrs(pos, head, tail, attr);
+                for(uint32_t curPage = head; curPage != IX::PAGE_PTR_NULL;) {
+                    OverflowPageHandle overflowPH(ixFileHandle, curPage);
+                    if(overflowPH.getPinStatus()) return overflowPH.getPinStatus();
+                    overflowPH.print(out);
+                    curPage = overflowPH.getNextPtr();
+                    if(curPage != IX::PAGE_PTR_NULL) {
+                        out << ",";
+                    }
+                }
+            }
+            else {
+                int16_t ridListPos = pos + getKeyLen(data + pos, attr) + IX::POSTING_RID_NUM_LEN;
+                for(int16_t j = 0; j < ridNum; j++) {
+                    readRid(data + ridListPos + j * IX::PAGE_RID_LEN, rid);
+                    out << "(" << rid.pageNum << "," << rid.slotNum << ")";
+                    if(j < ridNum - 1) {
+                        out << ",";
+                    }
+                }
+            }
+            out << "]\"";
+            if(i < counter - 1) {
+                out << ",";
+            }
+            pos += getEntryLen(data + pos, attr);
+        }
+        out << "]}";
+        return 0;
+    }
+
+    void LeafPageHandle::rebuildSlots(const Attribute& attr) {
+        if(!hasSlotArray()) {
+            return;
+        }
+        int16_t pos = 0;
+        for(int16_t i = 0; i < counter; i++) {
+            setSlot(i, pos);
+            pos += getEntryLen(data + pos, attr);
+        }
+    }
+
+    // Posting lists growing into overflow pages change other pages
+    bool LeafPageHandle::canInsertInPlace(const uint8_t* key, const Attribute& attr) {
+        if(!hasPostingList()) {
+            return hasEnoughSpace(key, attr);
+        }
+        int16_t pos;
+        bool isFound;
+        findPosting(pos, isFound, key, attr);
+        if(isFound && (getPostingRidNum(pos, attr) == IX::POSTING_OVERFLOW || isPostingSpill(pos, attr))) {
+            return false;
+        }
+        return getFreeSpace() >= getPostingInsertLen(key, attr);
+    }
+
+    bool LeafPageHandle::canDeleteInPlace(const uint8_t* key, const Attribute& attr) {
+        if(!hasPostingList()) {
+            return true;
+        }
+        int16_t pos;
+        bool isFound;
+        findPosting(pos, isFound, key, attr);
+        return !isFound || getPostingRidNum(pos, attr) != IX::POSTING_OVERFLOW;
+    }
+
+    bool LeafPageHandle::hasGreaterKey(const uint8_t* key, const Attribute& attr) {
+        int16_t pos;
+        findFirstKeyMeetCompCondition(pos, key, attr, GT_OP);
+        return pos < freeBytePtr;
+    }
+
     bool LeafPageHandle::hasEnoughSpace(const uint8_t* key, const Attribute &attr) {
-        return getFreeSpace() >= getEntryLen(key, attr);
+        return getFreeSpace() >= getEntryLen(key, attr) + getSlotLen();
     }
     int16_t LeafPageHandle::getEntryLen(const uint8_t* key, const Attribute& attr) {
+        if(hasPostingList()) {
+            int16_t keyLen = getKeyLen(key, attr);
+            int16_t ridNum;
+            memcpy(&ridNum, key + keyLen, IX::POSTING_RID_NUM_LEN);
+            if(ridNum == IX::POSTING_OVERFLOW) {
+                return keyLen + IX::POSTING_RID_NUM_LEN + 2 * IX::POSTING_OVERFLOW_PTR_LEN;
+            }
+            return keyLen + IX::POSTING_RID_NUM_LEN + ridNum * IX::PAGE_RID_LEN;
+        }
         return getKeyLen(key, attr) + IX::PAGE_RID_PAGE_LEN + IX::PAGE_RID_SLOT_LEN;
     }
 
@@ -324,7 +970,7 @@ namespace PeterDB {
         return PAGE_SIZE - getLeafHeaderLen();
     }
     int16_t LeafPageHandle::getFreeSpace() {
-        return PAGE_SIZE - getLeafHeaderLen() - freeBytePtr;
+        return PAGE_SIZE - getLeafHeaderLen() - freeBytePtr - counter * getSlotLen();
     }
     bool LeafPageHandle::isEmpty() {
         return counter == 0;
@@ -344,5 +990,6 @@ namespace PeterDB {
     void LeafPageHandle::setNextPtr(uint32_t next) {
         memcpy(data + getNextPtrOffset(), &next, IX::LEAFPAGE_NEXT_PTR_LEN);
         this->nextPtr = next;
+        isDirty = true;
     }
 }
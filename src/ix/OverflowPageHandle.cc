@@ -0,0 +1,99 @@
+#include "src/include/ix.h"
+
+namespace PeterDB {
+    OverflowPageHandle::OverflowPageHandle(IXFileHandle& fileHandle, uint32_t page): IXPageHandle(fileHandle, page) {
+        nextPtr = getNextPtrFromData();
+    }
+
+    OverflowPageHandle::OverflowPageHandle(IXFileHandle& fileHandle, uint32_t page, uint32_t next,
+                                           uint8_t* ridData, int16_t ridNum):
+                                           IXPageHandle(fileHandle, ridData, ridNum * IX::PAGE_RID_LEN, page,
+                                                        IX::PAGE_TYPE_OVERFLOW, ridNum * IX::PAGE_RID_LEN, ridNum) {
+        setNextPtr(next);
+    }
+
+    OverflowPageHandle::OverflowPageHandle(IXFileHandle& fileHandle, uint8_t* pageBuffer, uint32_t page, uint32_t next,
+                                           uint8_t* ridData, int16_t ridNum):
+                                           IXPageHandle(fileHandle, pageBuffer, ridData, ridNum * IX::PAGE_RID_LEN, page,
+                                                        IX::PAGE_TYPE_OVERFLOW, ridNum) {
+        setNextPtr(next);
+    }
+
+    OverflowPageHandle::~OverflowPageHandle() {
+        if(nextPtr != getNextPtrFromData()) {
+            setNextPtr(nextPtr);
+        }
+    }
+
+    RC OverflowPageHandle::insertRid(const RID& rid) {
+        if(!hasEnoughSpace()) {
+            return ERR_PAGE_NOT_ENOUGH_SPACE;
+        }
+        int16_t pos = findRidIndex(data, counter, rid) * IX::PAGE_RID_LEN;
+        shiftRecordRight(pos, IX::PAGE_RID_LEN);
+        writeRid(data + pos, rid);
+        isDirty = true;
+        freeBytePtr += IX::PAGE_RID_LEN;
+        counter++;
+        return 0;
+    }
+
+    RC OverflowPageHandle::deleteRid(const RID& rid) {
+        int16_t index = findRidIndex(data, counter, rid);
+        RID curRid;
+        if(index < counter) {
+            getRidAt(index, curRid);
+        }
+        if(index >= counter || compareRid(curRid, rid) != 0) {
+            return ERR_LEAFNODE_ENTRY_NOT_EXIST;
+        }
+        int16_t pos = index * IX::PAGE_RID_LEN;
+        shiftRecordLeft(pos + IX::PAGE_RID_LEN, IX::PAGE_RID_LEN);
+        freeBytePtr -= IX::PAGE_RID_LEN;
+        counter--;
+        return 0;
+    }
+
+    void OverflowPageHandle::getRidAt(int16_t index, RID& rid) {
+        readRid(data + index * IX::PAGE_RID_LEN, rid);
+    }
+
+    RC OverflowPageHandle::print(std::ostream &out) {
+        RID rid;
+        for(int16_t i = 0; i < counter; i++) {
+            getRidAt(i, rid);
+            out << "(" << rid.pageNum << "," << rid.slotNum << ")";
+            if(i < counter - 1) {
+                out << ",";
+            }
+        }
+        return 0;
+    }
+
+    bool OverflowPageHandle::hasEnoughSpace() {
+        return PAGE_SIZE - getOverflowHeaderLen() - freeBytePtr >= IX::PAGE_RID_LEN;
+    }
+    bool OverflowPageHandle::isEmpty() {
+        return counter == 0;
+    }
+    int16_t OverflowPageHandle::getOverflowHeaderLen() {
+        return getHeaderLen() + IX::OVERFLOWPAGE_NEXT_PTR_LEN;
+    }
+
+    int16_t OverflowPageHandle::getNextPtrOffset() {
+        return PAGE_SIZE - getHeaderLen() - IX::OVERFLOWPAGE_NEXT_PTR_LEN;
+    }
+    uint32_t OverflowPageHandle::getNextPtr() {
+        return nextPtr;
+    }
+    uint32_t OverflowPageHandle::getNextPtrFromData() {
+        uint32_t nextPtr;
+        memcpy(&nextPtr, data + getNextPtrOffset(), IX::OVERFLOWPAGE_NEXT_PTR_LEN);
+        return nextPtr;
+    }
+    void OverflowPageHandle::setNextPtr(uint32_t next) {
+        memcpy(data + getNextPtrOffset(), &next, IX::OVERFLOWPAGE_NEXT_PTR_LEN);
+        this->nextPtr = next;
+        isDirty = true;
+    }
+}
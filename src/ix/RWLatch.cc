@@ -0,0 +1,45 @@
+#include "src/include/ix.h"
+
+namespace PeterDB {
+    RWLatch::RWLatch() {
+        readerNum = 0;
+        waitingWriterNum = 0;
+        isWriting = false;
+    }
+
+    void RWLatch::lock() {
+        std::unique_lock<std::mutex> lock(latchMutex);
+        waitingWriterNum++;
+        latchChanged.wait(lock, [this]() { return !isWriting && readerNum == 0; });
+        waitingWriterNum--;
+        isWriting = true;
+    }
+
+    void RWLatch::unlock() {
+        std::lock_guard<std::mutex> guard(latchMutex);
+        isWriting = false;
+        latchChanged.notify_all();
+    }
+
+    void RWLatch::lock_shared() {
+        std::unique_lock<std::mutex> lock(latchMutex);
+        latchChanged.wait(lock, [this]() { return !isWriting && waitingWriterNum == 0; });
+        readerNum++;
+    }
+
+    void RWLatch::unlock_shared() {
+        std::lock_guard<std::mutex> guard(latchMutex);
+        readerNum--;
+        if(readerNum == 0) {
+            latchChanged.notify_all();
+        }
+    }
+
+    SharedLatchGuard::SharedLatchGuard(RWLatch& latch): latch(latch) {
+        latch.lock_shared();
+    }
+
+    SharedLatchGuard::~SharedLatchGuard() {
+        latch.unlock_shared();
+    }
+}
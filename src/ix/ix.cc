@@ -24,6 +24,11 @@ namespace PeterDB {
                 return ERR_CREATE_FILE;
             }
         }
+        // The inode may be reused from a removed file, its frames are stale
+        // Frames of a removed file are left alone since stale handles may still write to it
+        BufferPool::instance().discardFile(fileName);
+        ret = LogManager::instance().removeLog(fileName);
+        if(ret) return ret;
 
         // Reserve the first page to store metadata
         // Counters * 3
@@ -33,7 +38,12 @@ namespace PeterDB {
             if(ret || !fileHandle.isOpen()) {
                 return ERR_CREATE_FILE;
             }
-            fileHandle.appendEmptyPage();
+            uint32_t hiddenPage;
+            ret = fileHandle.appendEmptyPage(hiddenPage);
+            RC closeRet = fileHandle.close();     // Metadata is cached, it has to be written back
+            if(ret || closeRet) {
+                return ERR_CREATE_FILE;
+            }
         }
         return 0;
     }
@@ -46,7 +56,7 @@ namespace PeterDB {
         if(remove(fileName.c_str()) != 0) {
             return ERR_DELETE_FILE;
         }
-        return 0;
+        return LogManager::instance().removeLog(fileName);
     }
 
     RC IndexManager::openFile(const std::string &fileName, IXFileHandle &ixFileHandle) {
@@ -76,6 +86,20 @@ namespace PeterDB {
         if(!ixFileHandle.isOpen()) {
             return ERR_FILE_NOT_OPEN;
         }
+        bool isInserted = false;
+        ret = insertEntryInLeaf(ixFileHandle, attr, (uint8_t *)key, rid, isInserted);
+        if(!ret && !isInserted) {
+            ret = insertEntryInTree(ixFileHandle, attr, (uint8_t *)key, rid);
+        }
+        if(ret) return ret;
+        // Checkpoints wait until no latch is held, pages are written back only between changes
+        return ixFileHandle.checkpointIfLogFull();
+    }
+
+    // The leaf splits, or the tree is empty
+    RC IndexManager::insertEntryInTree(IXFileHandle &ixFileHandle, const Attribute &attr, const uint8_t *key, const RID &rid) {
+        RC ret = 0;
+        std::lock_guard<RWLatch> treeGuard(ixFileHandle.treeLatch);
         if(!ixFileHandle.isRootPageExist()) {
             // Root Page not exist
             ret = ixFileHandle.createRootPage();
@@ -86,13 +110,15 @@ namespace PeterDB {
 
         if(ixFileHandle.isRootNull()) {
             // Append one leaf page
-            ret = ixFileHandle.appendEmptyPage();
+            uint32_t leafPage;
+            ret = ixFileHandle.appendEmptyPage(leafPage);
             if(ret) {
                 return ret;
             }
-            uint32_t leafPage = ixFileHandle.getLastPageIndex();
             LeafPageHandle leafPageHandle(ixFileHandle, leafPage, IX::PAGE_PTR_NULL);
-            ret = leafPageHandle.insertEntryWithEnoughSpace((uint8_t *) key, rid, attr);
+            ret = leafPageHandle.getPinStatus();
+            if(ret) return ret;
+            ret = leafPageHandle.insertEntryWithEnoughSpace(key, rid, attr);
             if(ret) {
                 return ret;
             }
@@ -103,8 +129,102 @@ namespace PeterDB {
         uint8_t newKey[PAGE_SIZE];
         uint32_t newChildPage;
         bool isNewChildExist = false;
-        ret = insertEntryRecur(ixFileHandle, ixFileHandle.getRoot(), attr, (uint8_t *)key, rid, newKey, newChildPage, isNewChildExist);
+        ret = insertEntryRecur(ixFileHandle, ixFileHandle.getRoot(), attr, key, rid, newKey, newChildPage, isNewChildExist);
+        if(ret) return ret;
+        // Entries may have moved under an open scan
+        ixFileHandle.structureVersion++;
+        return 0;
+    }
+
+    RC IndexManager::insertEntryInLeaf(IXFileHandle &ixFileHandle, const Attribute &attr, const uint8_t *key, const RID &rid, bool& isInserted) {
+        RC ret = 0;
+        isInserted = false;
+        SharedLatchGuard treeGuard(ixFileHandle.treeLatch);
+        if(!ixFileHandle.isRootPageExist() || ixFileHandle.isRootNull()) {
+            return 0;
+        }
+
+        uint32_t leafPage;
+        ret = findTargetLeafNode(ixFileHandle, leafPage, key, rid, attr);
+        if(ret) return ret;
+        IXPageLatch& leafLatch = ixFileHandle.getPageLatch(leafPage);
+        std::lock_guard<RWLatch> leafGuard(leafLatch.latch);
+        LeafPageHandle leafPH(ixFileHandle, leafPage);
+        ret = leafPH.getPinStatus();
+        if(ret) return ret;
+        if(!leafPH.canInsertInPlace(key, attr)) {
+            return 0;
+        }
+        ret = leafPH.insertEntryWithEnoughSpace(key, rid, attr);
         if(ret) return ret;
+        leafLatch.version++;
+        isInserted = true;
+        return 0;
+    }
+
+    RC IndexManager::insertEntries(IXFileHandle &ixFileHandle, const Attribute &attr, const std::vector<const uint8_t*>& entries) {
+        RC ret = 0;
+        if(!ixFileHandle.isOpen()) {
+            return ERR_FILE_NOT_OPEN;
+        }
+        uint32_t next = 0;
+        while(next < entries.size()) {
+            uint32_t insertedNum = 0;
+            ret = insertEntriesInLeaf(ixFileHandle, attr, entries, next, insertedNum);
+            if(ret) return ret;
+            if(insertedNum == 0) {
+                // The leaf splits, or the tree is empty
+                RID rid;
+                IXPageHandle::getRid(entries[next], attr, rid);
+                ret = insertEntry(ixFileHandle, attr, entries[next], rid);
+                if(ret) return ret;
+                insertedNum = 1;
+            }
+            next += insertedNum;
+            ret = ixFileHandle.checkpointIfLogFull();
+            if(ret) return ret;
+        }
+        return 0;
+    }
+
+    // Insert entries from "first" on into the leaf of entries[first], until one belongs to another leaf or does not fit
+    // Entries are sorted, so one with a smaller key than some key of the leaf still belongs to it, and all of them belong to the last leaf
+    RC IndexManager::insertEntriesInLeaf(IXFileHandle &ixFileHandle, const Attribute &attr, const std::vector<const uint8_t*>& entries,
+                                         uint32_t first, uint32_t& insertedNum) {
+        RC ret = 0;
+        insertedNum = 0;
+        SharedLatchGuard treeGuard(ixFileHandle.treeLatch);
+        if(!ixFileHandle.isRootPageExist() || ixFileHandle.isRootNull()) {
+            return 0;
+        }
+
+        RID rid;
+        IXPageHandle::getRid(entries[first], attr, rid);
+        uint32_t leafPage;
+        ret = findTargetLeafNode(ixFileHandle, leafPage, entries[first], rid, attr);
+        if(ret) return ret;
+        IXPageLatch& leafLatch = ixFileHandle.getPageLatch(leafPage);
+        std::lock_guard<RWLatch> leafGuard(leafLatch.latch);
+        LeafPageHandle leafPH(ixFileHandle, leafPage);
+        ret = leafPH.getPinStatus();
+        if(ret) return ret;
+        bool isLastLeaf = leafPH.getNextPtr() == IX::PAGE_PTR_NULL;
+        for(uint32_t i = first; i < entries.size(); i++) {
+            const uint8_t* key = entries[i];
+            if(i > first && !isLastLeaf && !leafPH.hasGreaterKey(key, attr)) {
+                break;
+            }
+            if(!leafPH.canInsertInPlace(key, attr)) {
+                break;
+            }
+            IXPageHandle::getRid(key, attr, rid);
+            ret = leafPH.insertEntryWithEnoughSpace(key, rid, attr);
+            if(ret) return ret;
+            insertedNum++;
+        }
+        if(insertedNum) {
+            leafLatch.version++;
+        }
         return 0;
     }
 
@@ -114,12 +234,16 @@ namespace PeterDB {
         int16_t pageType;
         {
             IXPageHandle pageFH(ixFileHandle, pageNum);
+            ret = pageFH.getPinStatus();
+            if(ret) return ret;
             pageType = pageFH.getPageType();
         }
 
         if(pageType == IX::PAGE_TYPE_INDEX) {
             uint32_t oldChild;
             IndexPageHandle curIndexPH(ixFileHandle, pageNum);
+            ret = curIndexPH.getPinStatus();
+            if(ret) return ret;
             curIndexPH.getTargetChild(oldChild, keyToInsert, ridToInsert, attr);
             ret = insertEntryRecur(ixFileHandle, oldChild, attr, keyToInsert, ridToInsert, middleKey, newChildPage, isNewChildExist);
             if (ret) return ret;
@@ -141,18 +265,22 @@ namespace PeterDB {
         }
         else if(pageType == IX::PAGE_TYPE_LEAF) {
             LeafPageHandle leafPH(ixFileHandle, pageNum);
+            ret = leafPH.getPinStatus();
+            if(ret) return ret;
             ret = leafPH.insertEntry(keyToInsert, ridToInsert, attr, middleKey, newChildPage, isNewChildExist);
             if(ret) return ret;
 
             // Corner Case: Leaf node needs to split and there isn't any index page yet
             if(isNewChildExist && pageNum == ixFileHandle.getRoot()) {
                 // Insert new index page
-                ret = ixFileHandle.appendEmptyPage();
+                uint32_t newIndexPageNum;
+                ret = ixFileHandle.appendEmptyPage(newIndexPageNum);
                 if(ret) return ret;
-                uint32_t newIndexPageNum = ixFileHandle.getLastPageIndex();
 
                 IndexPageHandle newIndexPH(ixFileHandle, newIndexPageNum,
                                            pageNum, middleKey, newChildPage, attr);
+                ret = newIndexPH.getPinStatus();
+                if(ret) return ret;
                 ixFileHandle.setRoot(newIndexPageNum);
                 isNewChildExist = false;
             }
@@ -166,19 +294,159 @@ namespace PeterDB {
     RC
     IndexManager::deleteEntry(IXFileHandle &ixFileHandle, const Attribute &attribute, const void *key, const RID &rid) {
         RC ret = 0;
-        if(!ixFileHandle.isRootPageExist()) {
-            return ERR_ROOTPAGE_NOT_EXIST;
+        bool isDeleted = false;
+        bool isUnderflow = false;
+        ret = deleteEntryInLeaf(ixFileHandle, attribute, (uint8_t *)key, rid, isDeleted, isUnderflow);
+        if(!ret && (!isDeleted || isUnderflow)) {
+            ret = deleteEntryInTree(ixFileHandle, attribute, (uint8_t *)key, rid, isDeleted);
         }
-        if(ixFileHandle.isRootNull()) {
-            return ERR_ROOT_NULL;
+        if(ret) return ret;
+        return ixFileHandle.checkpointIfLogFull();
+    }
+
+    // The rid is in overflow pages, or the leaf has to merge
+    RC IndexManager::deleteEntryInTree(IXFileHandle &ixFileHandle, const Attribute &attribute, const uint8_t *key, const RID &rid, bool isDeleted) {
+        RC ret = 0;
+        std::lock_guard<RWLatch> treeGuard(ixFileHandle.treeLatch);
+        std::vector<uint32_t> path;
+        ret = findTargetPath(ixFileHandle, path, key, rid, attribute);
+        if(ret) return ret;
+        if(!isDeleted) {
+            LeafPageHandle leafPH(ixFileHandle, path.back());
+            ret = leafPH.getPinStatus();
+            if(ret) return ret;
+            ret = leafPH.deleteEntry(key, rid, attribute);
+            if(ret) return ret;
+            ixFileHandle.structureVersion++;
         }
+        return fixUnderflow(ixFileHandle, path, attribute);
+    }
 
-        uint32_t leafPage;
-        ret = findTargetLeafNode(ixFileHandle, leafPage, (uint8_t *)key, rid, attribute);
+    RC IndexManager::deleteEntryInLeaf(IXFileHandle &ixFileHandle, const Attribute &attr, const uint8_t *key, const RID &rid, bool& isDeleted, bool& isUnderflow) {
+        RC ret = 0;
+        isDeleted = false;
+        isUnderflow = false;
+        SharedLatchGuard treeGuard(ixFileHandle.treeLatch);
+        std::vector<uint32_t> path;
+        ret = findTargetPath(ixFileHandle, path, key, rid, attr);
         if(ret) return ret;
-        LeafPageHandle leafPH(ixFileHandle, leafPage);
-        ret = leafPH.deleteEntry((uint8_t *)key, rid, attribute);
+
+        IXPageLatch& leafLatch = ixFileHandle.getPageLatch(path.back());
+        std::lock_guard<RWLatch> leafGuard(leafLatch.latch);
+        LeafPageHandle leafPH(ixFileHandle, path.back());
+        ret = leafPH.getPinStatus();
+        if(ret) return ret;
+        if(!leafPH.canDeleteInPlace(key, attr)) {
+            return 0;
+        }
+        ret = leafPH.deleteEntry(key, rid, attr);
         if(ret) return ret;
+        leafLatch.version++;
+        isDeleted = true;
+        isUnderflow = path.size() > 1 && leafPH.isUnderflow();
+        return 0;
+    }
+
+    RC IndexManager::fixUnderflow(IXFileHandle &ixFileHandle, const std::vector<uint32_t>& path, const Attribute& attr) {
+        RC ret = 0;
+        // 1. Bottom-up, a page less than half full is merged with its right sibling, the last child with its left one
+        bool isRootChanged = false;
+        for(size_t level = path.size() - 1; level > 0; level--) {
+            bool isLeaf = level == path.size() - 1;
+            {
+                IXPageHandle pageFH(ixFileHandle, path[level]);
+                ret = pageFH.getPinStatus();
+                if(ret) return ret;
+                if(pageFH.getPageType() != (isLeaf ? IX::PAGE_TYPE_LEAF : IX::PAGE_TYPE_INDEX)) {
+                    return ERR_IMPOSSIBLE;
+                }
+            }
+            bool isUnderflow;
+            if(isLeaf) {
+                LeafPageHandle leafPH(ixFileHandle, path[level]);
+                ret = leafPH.getPinStatus();
+                if(ret) return ret;
+                isUnderflow = leafPH.isUnderflow();
+            }
+            else {
+                IndexPageHandle indexPH(ixFileHandle, path[level]);
+                ret = indexPH.getPinStatus();
+                if(ret) return ret;
+                isUnderflow = indexPH.isUnderflow();
+            }
+            if(!isUnderflow) {
+                break;
+            }
+
+            bool isMerged = false;
+            uint32_t rightPage;
+            {
+                IndexPageHandle parentPH(ixFileHandle, path[level - 1]);
+                ret = parentPH.getPinStatus();
+                if(ret) return ret;
+                int16_t childIndex = parentPH.findChildIndex(path[level], attr);
+                if(childIndex < 0) {
+                    return ERR_IMPOSSIBLE;
+                }
+                int16_t keyIndex = childIndex < parentPH.getCounter() ? childIndex : childIndex - 1;
+                if(keyIndex < 0) {
+                    // The only child of its parent
+                    break;
+                }
+                uint32_t leftPage = parentPH.getChild(keyIndex, attr);
+                rightPage = parentPH.getChild(keyIndex + 1, attr);
+                if(isLeaf) {
+                    LeafPageHandle leftPH(ixFileHandle, leftPage);
+                    ret = leftPH.getPinStatus();
+                    if(ret) return ret;
+                    LeafPageHandle rightPH(ixFileHandle, rightPage);
+                    ret = rightPH.getPinStatus();
+                    if(ret) return ret;
+                    ret = leftPH.mergeOrRedistribute(rightPH, parentPH, keyIndex, isMerged, attr);
+                }
+                else {
+                    IndexPageHandle leftPH(ixFileHandle, leftPage);
+                    ret = leftPH.getPinStatus();
+                    if(ret) return ret;
+                    IndexPageHandle rightPH(ixFileHandle, rightPage);
+                    ret = rightPH.getPinStatus();
+                    if(ret) return ret;
+                    ret = leftPH.mergeOrRedistribute(rightPH, parentPH, keyIndex, isMerged, attr);
+                }
+                if(ret) return ret;
+            }
+            // Entries may have moved under an open scan
+            ixFileHandle.structureVersion++;
+            if(!isMerged) {
+                break;
+            }
+            ret = ixFileHandle.freePage(rightPage);
+            if(ret) return ret;
+            isRootChanged = level == 1;
+        }
+
+        // 2. A root left without keys gives way to its only child
+        while(isRootChanged) {
+            uint32_t rootPage = ixFileHandle.getRoot();
+            uint32_t childPage;
+            {
+                IXPageHandle rootFH(ixFileHandle, rootPage);
+                ret = rootFH.getPinStatus();
+                if(ret) return ret;
+                if(rootFH.getPageType() != IX::PAGE_TYPE_INDEX || rootFH.getCounter() > 0) {
+                    break;
+                }
+            }
+            {
+                IndexPageHandle rootPH(ixFileHandle, rootPage);
+                ret = rootPH.getPinStatus();
+                if(ret) return ret;
+                childPage = rootPH.getChild(0, attr);
+            }
+            ixFileHandle.setRoot(childPage);
+            ret = ixFileHandle.freePage(rootPage);
+            if(ret) return ret;
+        }
         return 0;
     }
 
@@ -196,6 +464,15 @@ namespace PeterDB {
     }
 
     RC IndexManager::findTargetLeafNode(IXFileHandle &ixFileHandle, uint32_t& leafPageNum, const uint8_t* key, const RID& rid, const Attribute& attr) {
+        RC ret = 0;
+        std::vector<uint32_t> path;
+        ret = findTargetPath(ixFileHandle, path, key, rid, attr);
+        if(ret) return ret;
+        leafPageNum = path.back();
+        return 0;
+    }
+
+    RC IndexManager::findTargetPath(IXFileHandle &ixFileHandle, std::vector<uint32_t>& path, const uint8_t* key, const RID& rid, const Attribute& attr) {
         RC ret = 0;
         if(!ixFileHandle.isRootPageExist()) {
             return ERR_ROOTPAGE_NOT_EXIST;
@@ -204,29 +481,30 @@ namespace PeterDB {
             return ERR_ROOT_NULL;
         }
 
+        path.clear();
         uint32_t curPageNum = ixFileHandle.getRoot();
         while(curPageNum != IX::PAGE_PTR_NULL && curPageNum < ixFileHandle.getPageCounter()) {
+            path.push_back(curPageNum);
             int16_t pageType;
             {
+                SharedLatchGuard pageGuard(ixFileHandle.getPageLatch(curPageNum).latch);
                 IXPageHandle pageFH(ixFileHandle, curPageNum);
+                ret = pageFH.getPinStatus();
+                if(ret) return ret;
                 pageType = pageFH.getPageType();
             }
 
             if (pageType == IX::PAGE_TYPE_LEAF) {
-                break;
+                return 0;
             }
 
             IndexPageHandle indexPH(ixFileHandle, curPageNum);
+            ret = indexPH.getPinStatus();
+            if(ret) return ret;
             ret = indexPH.getTargetChild(curPageNum, key, rid, attr);
             if (ret) return ret;
         }
-        if(curPageNum != IX::PAGE_PTR_NULL && curPageNum < ixFileHandle.getPageCounter()) {
-            leafPageNum = curPageNum;
-        }
-        else {
-            return ERR_LEAF_NOT_FOUND;
-        }
-        return 0;
+        return ERR_LEAF_NOT_FOUND;
     }
 
     RC IndexManager::printBTree(IXFileHandle &ixFileHandle, const Attribute &attr, std::ostream &out) const {
@@ -241,15 +519,21 @@ namespace PeterDB {
         int16_t pageType;
         {
             IXPageHandle pageFH(ixFileHandle, ixFileHandle.getRoot());
+            ret = pageFH.getPinStatus();
+            if(ret) return ret;
             pageType = pageFH.getPageType();
         }
 
         if(pageType == IX::PAGE_TYPE_INDEX) {
             IndexPageHandle indexPH(ixFileHandle, ixFileHandle.getRoot());
+            ret = indexPH.getPinStatus();
+            if(ret) return ret;
             indexPH.print(attr, out);
         }
         else if(pageType == IX::PAGE_TYPE_LEAF) {
             LeafPageHandle leafPH(ixFileHandle, ixFileHandle.getRoot());
+            ret = leafPH.getPinStatus();
+            if(ret) return ret;
             leafPH.print(attr, out);
         }
         else {
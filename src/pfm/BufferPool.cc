@@ -0,0 +1,638 @@
+#include "src/include/pfm.h"
+
+namespace PeterDB {
+    BufferPool &BufferPool::instance() {
+        static BufferPool _buffer_pool = BufferPool();
+        return _buffer_pool;
+    }
+
+    BufferPool::BufferPool() {
+        LogManager::instance();     // Constructed first so that it outlives the final write back
+        clockHand = 0;
+        hitCounter = 0;
+        missCounter = 0;
+        evictCounter = 0;
+        writeBackCounter = 0;
+        prefetchCounter = 0;
+        prefetchHitCounter = 0;
+        prefetchWastedCounter = 0;
+        initFrames(PFM::BUFFER_POOL_FRAME_NUM_DEFAULT);
+    }
+
+    BufferPool::~BufferPool() {
+        flushAll();
+    }
+
+    RC BufferPool::initFrames(uint32_t frameNum) {
+        frames.clear();
+        pageTable.clear();
+        frameData.assign((size_t)frameNum * PAGE_SIZE, 0);
+        frames.resize(frameNum);
+        for(uint32_t i = 0; i < frameNum; i++) {
+            frames[i].pageIndex = 0;
+            frames[i].backend = nullptr;
+            frames[i].data = frameData.data() + (size_t)i * PAGE_SIZE;
+            frames[i].pinCount = 0;
+            frames[i].isDirty = false;
+            frames[i].refBit = false;
+            frames[i].isValid = false;
+            frames[i].isLoading = false;
+            frames[i].isWriting = false;
+            frames[i].isPrefetched = false;
+            frames[i].lsn = 0;
+            frames[i].dirtyVersion = 0;
+        }
+        clockHand = 0;
+        return 0;
+    }
+
+    RC BufferPool::setFrameNum(uint32_t frameNum) {
+        if(frameNum == 0) {
+            return ERR_BUFFER_POOL_FULL;
+        }
+        std::unique_lock<std::mutex> lock(poolMutex);
+        RC ret = flushAllFrames(lock);
+        if(ret) return ret;
+        // Checked after the write back, which releases the lock
+        for(auto& frame: frames) {
+            if(frame.isValid && (frame.pinCount > 0 || frame.isDirty)) {
+                LOG(ERROR) << "Frame still pinned, cannot resize @ BufferPool::setFrameNum" << std::endl;
+                return ERR_BUFFER_POOL_FULL;
+            }
+        }
+        return initFrames(frameNum);
+    }
+
+    uint32_t BufferPool::getFrameNum() {
+        std::lock_guard<std::mutex> guard(poolMutex);
+        return frames.size();
+    }
+
+    RC BufferPool::pinPage(uint64_t fileId, StorageBackend* backend, uint32_t pageIndex, bool loadFromDisk,
+                           uint8_t*& data, bool& isHit) {
+        RC ret = 0;
+        std::unique_lock<std::mutex> lock(poolMutex);
+        int32_t frameIndex = PFM::BUFFER_FRAME_NULL;
+        while(frameIndex == PFM::BUFFER_FRAME_NULL) {
+            frameIndex = findLoadedFrame(lock, fileId, pageIndex);
+            if(frameIndex != PFM::BUFFER_FRAME_NULL) {
+                BufferFrame& frame = frames[frameIndex];
+                accessFrame(frame);
+                data = frame.data;
+                isHit = true;
+                hitCounter++;
+                return 0;
+            }
+
+            // Page not cached, find a victim frame and load the page into it without the lock
+            ret = allocFrame(lock, fileId, backend, pageIndex, frameIndex);
+            if(ret) {
+                LOG(ERROR) << "All frames are pinned @ BufferPool::pinPage" << std::endl;
+                return ret;
+            }
+        }
+        isHit = false;
+        BufferFrame& frame = frames[frameIndex];
+        if(loadFromDisk) {
+            lock.unlock();
+            ret = readFromDisk(backend, pageIndex, frame.data);
+            lock.lock();
+        }
+        else {
+            bzero(frame.data, PAGE_SIZE);
+        }
+        frame.isLoading = false;
+        loadDone.notify_all();
+        if(ret) {
+            releaseFrame(frame);
+            return ret;
+        }
+        if(loadFromDisk) {
+            missCounter++;
+        }
+
+        data = frame.data;
+        return 0;
+    }
+
+    RC BufferPool::pinPages(uint64_t fileId, StorageBackend* backend, uint32_t firstPageIndex, uint32_t pageCount,
+                            bool loadFromDisk, std::vector<uint8_t*>& frameData, uint32_t& hitCount) {
+        RC ret = 0;
+        std::unique_lock<std::mutex> lock(poolMutex);
+        std::vector<int32_t> missFrames(pageCount, PFM::BUFFER_FRAME_NULL);
+        frameData.assign(pageCount, nullptr);
+        hitCount = 0;
+
+        // Pin cached pages and reserve frames for the others
+        uint32_t pinnedNum = 0;
+        while(pinnedNum < pageCount) {
+            uint32_t pageIndex = firstPageIndex + pinnedNum;
+            int32_t frameIndex = findLoadedFrame(lock, fileId, pageIndex);
+            if(frameIndex != PFM::BUFFER_FRAME_NULL) {
+                BufferFrame& frame = frames[frameIndex];
+                accessFrame(frame);
+                frameData[pinnedNum++] = frame.data;
+                hitCount++;
+                continue;
+            }
+            ret = allocFrame(lock, fileId, backend, pageIndex, frameIndex);
+            if(ret) {
+                LOG(ERROR) << "All frames are pinned @ BufferPool::pinPages" << std::endl;
+                break;
+            }
+            if(frameIndex == PFM::BUFFER_FRAME_NULL) {
+                continue;       // Cached by another thread meanwhile, look it up again
+            }
+            if(!loadFromDisk) {
+                bzero(frames[frameIndex].data, PAGE_SIZE);
+                frames[frameIndex].isLoading = false;
+            }
+            missFrames[pinnedNum] = frameIndex;
+            frameData[pinnedNum++] = frames[frameIndex].data;
+        }
+
+        // Load each run of missing pages with one vectored read, without the lock
+        if(!ret && loadFromDisk) {
+            lock.unlock();
+            std::vector<struct iovec> iov;
+            for(uint32_t i = 0; i <= pageCount; i++) {
+                if(i < pageCount && missFrames[i] != PFM::BUFFER_FRAME_NULL) {
+                    iov.push_back({frameData[i], PAGE_SIZE});
+                    continue;
+                }
+                if(iov.empty()) {
+                    continue;
+                }
+                uint32_t runStart = firstPageIndex + i - iov.size();
+                ret = backend ? backend->readv((uint64_t)runStart * PAGE_SIZE, iov.data(), iov.size()) : ERR_FILE_NOT_OPEN;
+                if(ret) {
+                    break;
+                }
+                iov.clear();
+            }
+            lock.lock();
+            for(uint32_t i = 0; i < pinnedNum; i++) {
+                if(missFrames[i] != PFM::BUFFER_FRAME_NULL) {
+                    frames[missFrames[i]].isLoading = false;
+                }
+            }
+            if(!ret) {
+                missCounter += pageCount - hitCount;
+            }
+        }
+
+        if(ret) {
+            // Undo the pins, reserved frames hold no valid page
+            for(uint32_t i = 0; i < pinnedNum; i++) {
+                if(missFrames[i] != PFM::BUFFER_FRAME_NULL) {
+                    releaseFrame(frames[missFrames[i]]);
+                }
+                else {
+                    frames[findFrame(fileId, firstPageIndex + i)].pinCount--;
+                }
+            }
+            loadDone.notify_all();
+            return ret;
+        }
+        loadDone.notify_all();
+        hitCounter += hitCount;
+        return 0;
+    }
+
+    RC BufferPool::writePages(uint64_t fileId, StorageBackend* backend, uint32_t firstPageIndex, uint32_t pageCount) {
+        // Frames stay in place while they are pinned
+        auto findRun = [this, fileId, firstPageIndex, pageCount](std::vector<BufferFrame*>& run) {
+            for(uint32_t i = 0; i < pageCount; i++) {
+                int32_t frameIndex = findFrame(fileId, firstPageIndex + i);
+                if(frameIndex == PFM::BUFFER_FRAME_NULL || frames[frameIndex].pinCount <= 0) {
+                    LOG(ERROR) << "Page is not pinned @ BufferPool::writePages" << std::endl;
+                    return ERR_PAGE_NOT_PINNED;
+                }
+                run.push_back(&frames[frameIndex]);
+            }
+            return 0;
+        };
+
+        // Pages are written through, log them first so that redo never replays an older image over them
+        std::unique_lock<std::mutex> lock(poolMutex);
+        std::vector<BufferFrame*> run;
+        RC ret = findRun(run);
+        if(ret) return ret;
+        for(BufferFrame* frame: run) {
+            frame->lsn = LogManager::instance().logPage(fileId, frame->pageIndex, frame->data);
+            frame->isDirty = true;
+            frame->dirtyVersion++;
+        }
+        return writeBackRun(lock, backend, run);
+    }
+
+    RC BufferPool::unpinPage(uint64_t fileId, StorageBackend* backend, uint32_t pageIndex, bool isDirty) {
+        {
+            std::lock_guard<std::mutex> guard(poolMutex);
+            int32_t frameIndex = findFrame(fileId, pageIndex);
+            if(frameIndex == PFM::BUFFER_FRAME_NULL || frames[frameIndex].pinCount <= 0) {
+                LOG(ERROR) << "Page is not pinned @ BufferPool::unpinPage" << std::endl;
+                return ERR_PAGE_NOT_PINNED;
+            }
+            BufferFrame& frame = frames[frameIndex];
+            frame.pinCount--;
+            if(!isDirty) {
+                return 0;
+            }
+            frame.isDirty = true;
+            frame.dirtyVersion++;
+            frame.backend = backend;    // Write back through the latest writer
+            frame.lsn = LogManager::instance().logPage(fileId, pageIndex, frame.data);
+        }
+        // Sync a full group without holding the pool
+        return LogManager::instance().commitGroup(fileId);
+    }
+
+    RC BufferPool::flushFile(uint64_t fileId, StorageBackend* backend, uint64_t& flushedLsn) {
+        RC ret = 0;
+        std::unique_lock<std::mutex> lock(poolMutex);
+        auto fileIter = pageTable.find(fileId);
+        if(fileIter == pageTable.end()) {
+            return 0;
+        }
+        std::vector<uint32_t> dirtyPages;
+        for(auto& p: fileIter->second) {
+            if(frames[p.second].isDirty) {
+                dirtyPages.push_back(p.first);
+            }
+        }
+        std::sort(dirtyPages.begin(), dirtyPages.end());
+
+        // Consecutive dirty pages are written back together, only the run being written is pinned
+        std::vector<BufferFrame*> run;
+        for(uint32_t i = 0; i <= dirtyPages.size(); i++) {
+            if(i == dirtyPages.size() || (!run.empty() && (run.size() == PFM::VECTORED_IO_PAGE_NUM ||
+                                                           run.back()->pageIndex + 1 != dirtyPages[i]))) {
+                if(!run.empty()) {
+                    ret = ret ? ret : writeBackRun(lock, backend, run);
+                    for(BufferFrame* runFrame: run) {
+                        runFrame->pinCount--;
+                    }
+                    run.clear();
+                }
+                if(i == dirtyPages.size()) {
+                    break;
+                }
+            }
+            // Looked up again, the page may be evicted or cleaned while the lock was released
+            // A pinned frame may be half changed, it is left dirty
+            int32_t frameIndex = findFrame(fileId, dirtyPages[i]);
+            BufferFrame* frame = frameIndex == PFM::BUFFER_FRAME_NULL ? nullptr : &frames[frameIndex];
+            if(frame && frame->isDirty && !frame->isWriting && frame->pinCount == 0) {
+                frame->pinCount++;
+                run.push_back(frame);
+            }
+        }
+        // Frames being written back before eviction are finished before the file counts as flushed
+        loadDone.wait(lock, [this, fileId]() {
+            auto fileIter = pageTable.find(fileId);
+            if(fileIter == pageTable.end()) {
+                return true;
+            }
+            for(auto& p: fileIter->second) {
+                if(frames[p.second].isWriting) {
+                    return false;
+                }
+            }
+            return true;
+        });
+        // Records of frames left dirty are still needed for redo
+        fileIter = pageTable.find(fileId);
+        if(fileIter != pageTable.end()) {
+            for(auto& p: fileIter->second) {
+                BufferFrame& frame = frames[p.second];
+                if(frame.isDirty && frame.lsn && frame.lsn <= flushedLsn) {
+                    flushedLsn = frame.lsn - 1;
+                }
+            }
+        }
+        return ret;
+    }
+
+    RC BufferPool::flushAll() {
+        std::unique_lock<std::mutex> lock(poolMutex);
+        return flushAllFrames(lock);
+    }
+
+    RC BufferPool::flushAllFrames(std::unique_lock<std::mutex>& lock) {
+        RC ret = 0;
+        for(auto& frame: frames) {
+            if(frame.isValid && frame.isDirty && !frame.isWriting) {
+                frame.pinCount++;
+                std::vector<BufferFrame*> run = {&frame};
+                ret = writeBackRun(lock, frame.backend, run);
+                frame.pinCount--;
+                if(ret) return ret;
+            }
+        }
+        return 0;
+    }
+
+    RC BufferPool::discardFile(const std::string& fileName) {
+        uint64_t fileId;
+        if(getFileId(fileName, fileId)) {
+            return 0;       // No such file, nothing cached
+        }
+        std::unique_lock<std::mutex> lock(poolMutex);
+        auto fileIter = pageTable.find(fileId);
+        while(fileIter != pageTable.end()) {
+            // Frames being loaded or written back are in use by another thread until it is done
+            bool isBusy = false;
+            for(auto& p: fileIter->second) {
+                isBusy |= frames[p.second].isLoading || frames[p.second].isWriting;
+            }
+            if(!isBusy) {
+                break;
+            }
+            loadDone.wait(lock);
+            fileIter = pageTable.find(fileId);
+        }
+        if(fileIter == pageTable.end()) {
+            return 0;
+        }
+        for(auto& p: fileIter->second) {
+            BufferFrame& frame = frames[p.second];
+            if(frame.isPrefetched) {
+                prefetchWastedCounter++;
+            }
+            frame.isValid = false;
+            frame.isDirty = false;
+            frame.isPrefetched = false;
+            frame.pinCount = 0;
+            frame.backend = nullptr;
+        }
+        pageTable.erase(fileIter);
+        return 0;
+    }
+
+    RC BufferPool::prefetchPages(uint64_t fileId, StorageBackend* backend, uint32_t firstPageIndex, uint32_t pageCount) {
+        if(!backend) {
+            return ERR_FILE_NOT_OPEN;
+        }
+
+        // Reserve frames for pages not cached yet, pinned so that they are neither evicted nor handed out
+        std::vector<int32_t> loadFrames;
+        std::unique_lock<std::mutex> lock(poolMutex);
+        for(uint32_t i = 0; i < pageCount; i++) {
+            uint32_t pageIndex = firstPageIndex + i;
+            if(findFrame(fileId, pageIndex) != PFM::BUFFER_FRAME_NULL) {
+                continue;
+            }
+            int32_t frameIndex;
+            if(allocFrame(lock, fileId, backend, pageIndex, frameIndex)) {
+                break;      // All frames are pinned, read ahead less
+            }
+            if(frameIndex == PFM::BUFFER_FRAME_NULL) {
+                continue;   // Cached by another thread meanwhile
+            }
+            loadFrames.push_back(frameIndex);
+        }
+        lock.unlock();
+
+        // Load each run of consecutive pages with one vectored read, without holding the lock
+        std::vector<RC> runResults(loadFrames.size(), 0);
+        std::vector<struct iovec> iov;
+        uint32_t runStart = 0;
+        for(uint32_t i = 0; i <= loadFrames.size(); i++) {
+            if(i < loadFrames.size() && !iov.empty() && iov.size() < PFM::VECTORED_IO_PAGE_NUM &&
+               frames[loadFrames[i - 1]].pageIndex + 1 == frames[loadFrames[i]].pageIndex) {
+                iov.push_back({frames[loadFrames[i]].data, PAGE_SIZE});
+                continue;
+            }
+            if(!iov.empty()) {
+                RC ret = backend->readv((uint64_t)frames[loadFrames[runStart]].pageIndex * PAGE_SIZE, iov.data(), iov.size());
+                for(uint32_t j = runStart; j < i; j++) {
+                    runResults[j] = ret;
+                }
+                iov.clear();
+            }
+            if(i < loadFrames.size()) {
+                runStart = i;
+                iov.push_back({frames[loadFrames[i]].data, PAGE_SIZE});
+            }
+        }
+
+        lock.lock();
+        for(uint32_t i = 0; i < loadFrames.size(); i++) {
+            BufferFrame& frame = frames[loadFrames[i]];
+            frame.isLoading = false;
+            if(runResults[i]) {
+                releaseFrame(frame);
+                continue;
+            }
+            frame.pinCount = 0;
+            frame.isPrefetched = true;
+            prefetchCounter++;
+        }
+        lock.unlock();
+        loadDone.notify_all();
+        return 0;
+    }
+
+    void BufferPool::collectCounterValues(uint32_t &hitCount, uint32_t &missCount, uint32_t &evictCount, uint32_t &writeBackCount) {
+        std::lock_guard<std::mutex> guard(poolMutex);
+        hitCount = hitCounter;
+        missCount = missCounter;
+        evictCount = evictCounter;
+        writeBackCount = writeBackCounter;
+    }
+
+    void BufferPool::collectPrefetchCounterValues(uint32_t &prefetchCount, uint32_t &prefetchHitCount,
+                                                  uint32_t &prefetchWastedCount) {
+        std::lock_guard<std::mutex> guard(poolMutex);
+        prefetchCount = prefetchCounter;
+        prefetchHitCount = prefetchHitCounter;
+        prefetchWastedCount = prefetchWastedCounter;
+    }
+
+    RC BufferPool::getFileId(const std::string& fileName, uint64_t& fileId) {
+        struct stat stFileInfo{};
+        if(stat(fileName.c_str(), &stFileInfo) != 0) {
+            return ERR_FILE_NOT_EXIST;
+        }
+        fileId = ((uint64_t)stFileInfo.st_dev << 32) ^ (uint64_t)stFileInfo.st_ino;
+        return 0;
+    }
+
+    int32_t BufferPool::findFrame(uint64_t fileId, uint32_t pageIndex) {
+        auto fileIter = pageTable.find(fileId);
+        if(fileIter == pageTable.end()) {
+            return PFM::BUFFER_FRAME_NULL;
+        }
+        auto pageIter = fileIter->second.find(pageIndex);
+        if(pageIter == fileIter->second.end()) {
+            return PFM::BUFFER_FRAME_NULL;
+        }
+        return pageIter->second;
+    }
+
+    // Same as findFrame, but wait until a frame being loaded or written back before eviction is done
+    int32_t BufferPool::findLoadedFrame(std::unique_lock<std::mutex>& lock, uint64_t fileId, uint32_t pageIndex) {
+        while(true) {
+            int32_t frameIndex = findFrame(fileId, pageIndex);
+            if(frameIndex == PFM::BUFFER_FRAME_NULL || (!frames[frameIndex].isLoading && !frames[frameIndex].isWriting)) {
+                return frameIndex;
+            }
+            loadDone.wait(lock);
+        }
+    }
+
+    void BufferPool::accessFrame(BufferFrame& frame) {
+        frame.pinCount++;
+        frame.refBit = true;
+        if(frame.isPrefetched) {
+            frame.isPrefetched = false;
+            prefetchHitCounter++;
+        }
+    }
+
+    // Bind a free or victim frame to the page, pinned once and not loaded
+    // A dirty victim keeps its page while it is written back, then the search starts over if it was taken meanwhile
+    RC BufferPool::allocFrame(std::unique_lock<std::mutex>& lock, uint64_t fileId, StorageBackend* backend,
+                              uint32_t pageIndex, int32_t& frameIndex) {
+        RC ret = 0;
+        bool isUnlocked = false;
+        while(true) {
+            ret = findVictim(frameIndex);
+            if(ret) {
+                return ret;
+            }
+            BufferFrame& frame = frames[frameIndex];
+            if(!frame.isValid || !frame.isDirty) {
+                break;
+            }
+            frame.pinCount++;
+            frame.isWriting = true;
+            std::vector<BufferFrame*> run = {&frame};
+            ret = writeBackRun(lock, frame.backend, run);
+            isUnlocked = true;
+            frame.isWriting = false;
+            frame.pinCount--;
+            loadDone.notify_all();
+            if(ret) return ret;
+            if(!frame.isValid || (frame.pinCount == 0 && !frame.isDirty)) {
+                break;
+            }
+        }
+        if(isUnlocked && findFrame(fileId, pageIndex) != PFM::BUFFER_FRAME_NULL) {
+            frameIndex = PFM::BUFFER_FRAME_NULL;
+            return 0;
+        }
+
+        BufferFrame& frame = frames[frameIndex];
+        if(frame.isValid) {
+            if(frame.isPrefetched) {
+                prefetchWastedCounter++;
+            }
+            releaseFrame(frame);
+            evictCounter++;
+        }
+
+        frame.fileId = fileId;
+        frame.pageIndex = pageIndex;
+        frame.backend = backend;
+        frame.pinCount = 1;
+        frame.isDirty = false;
+        frame.refBit = true;
+        frame.isValid = true;
+        frame.isLoading = true;
+        frame.isWriting = false;
+        frame.isPrefetched = false;
+        frame.lsn = 0;
+        pageTable[fileId][pageIndex] = frameIndex;
+        return 0;
+    }
+
+    // CLOCK: free frames first, otherwise sweep at most twice giving referenced frames a second chance
+    RC BufferPool::findVictim(int32_t& frameIndex) {
+        uint32_t frameNum = frames.size();
+        for(uint32_t i = 0; i < 2 * frameNum; i++) {
+            uint32_t cur = clockHand;
+            clockHand = (clockHand + 1) % frameNum;
+            BufferFrame& frame = frames[cur];
+            if(!frame.isValid) {
+                frameIndex = cur;
+                return 0;
+            }
+            if(frame.pinCount > 0) {
+                continue;
+            }
+            if(frame.refBit) {
+                frame.refBit = false;
+                continue;
+            }
+            frameIndex = cur;
+            return 0;
+        }
+        return ERR_BUFFER_POOL_FULL;
+    }
+
+    // Frames dirtied again while the lock is released stay dirty
+    RC BufferPool::writeBackRun(std::unique_lock<std::mutex>& lock, StorageBackend* backend, std::vector<BufferFrame*>& run) {
+        if(!backend) {
+            return ERR_FILE_NOT_OPEN;
+        }
+        std::vector<struct iovec> iov;
+        std::vector<uint32_t> dirtyVersions;
+        uint64_t lsn = 0;
+        uint64_t fileId = run.front()->fileId;
+        uint32_t firstPageIndex = run.front()->pageIndex;
+        for(BufferFrame* frame: run) {
+            iov.push_back({frame->data, PAGE_SIZE});
+            dirtyVersions.push_back(frame->dirtyVersion);
+            lsn = std::max(lsn, frame->lsn);
+        }
+        lock.unlock();
+        RC ret = LogManager::instance().forceLog(fileId, lsn);  // Write-ahead
+        if(!ret) {
+            ret = backend->writev((uint64_t)firstPageIndex * PAGE_SIZE, iov.data(), iov.size());
+        }
+        if(!ret) {
+            ret = backend->flush();
+        }
+        lock.lock();
+        if(ret) {
+            LOG(ERROR) << "Fail to write back " << run.size() << " frames of file " << fileId
+                       << " @ BufferPool::writeBackRun" << std::endl;
+            return ret;
+        }
+        for(uint32_t i = 0; i < run.size(); i++) {
+            run[i]->backend = backend;
+            if(run[i]->dirtyVersion == dirtyVersions[i]) {
+                run[i]->isDirty = false;
+            }
+        }
+        writeBackCounter += run.size();
+        return 0;
+    }
+
+    void BufferPool::releaseFrame(BufferFrame& frame) {
+        auto fileIter = pageTable.find(frame.fileId);
+        if(fileIter != pageTable.end()) {
+            fileIter->second.erase(frame.pageIndex);
+            if(fileIter->second.empty()) {
+                pageTable.erase(fileIter);
+            }
+        }
+        frame.isValid = false;
+        frame.isDirty = false;
+        frame.isLoading = false;
+        frame.isWriting = false;
+        frame.isPrefetched = false;
+        frame.lsn = 0;
+        frame.pinCount = 0;
+        frame.backend = nullptr;
+    }
+
+    RC BufferPool::readFromDisk(StorageBackend* backend, uint32_t pageIndex, uint8_t* data) {
+        if(!backend) {
+            return ERR_FILE_NOT_OPEN;
+        }
+        return backend->read((uint64_t)pageIndex * PAGE_SIZE, data, PAGE_SIZE);
+    }
+}
@@ -7,7 +7,7 @@ using std::ofstream;
 
 namespace PeterDB {
     bool FileHandle::isOpen() {
-        return fs && fs->is_open();
+        return backend && backend->isOpen();
     }
 
     FileHandle::FileHandle() {
@@ -15,11 +15,20 @@ namespace PeterDB {
         writePageCounter = 0;
         appendPageCounter = 0;
         pageCounter = 0;
-        fs = nullptr;
+        bufferHitCounter = 0;
+        bufferMissCounter = 0;
+        metadataFlushInterval = PFM::METADATA_FLUSH_INTERVAL_DEFAULT;
+        metadataDirtyOps = 0;
+        fileId = 0;
+        backend = nullptr;
+        prefetchDepth = PFM::PREFETCH_DEPTH_DEFAULT;
+        resetReadAhead();
     }
 
     FileHandle::~FileHandle() {
-        flushMetadata();
+        if(metadataDirtyOps) {
+            flushMetadata();
+        }
     }
 
     int FileHandle::getCounterNum() {
@@ -48,43 +57,161 @@ namespace PeterDB {
         if(!isOpen()) {
             return ERR_FILE_NOT_OPEN;
         }
-        fs->clear();
-        fs->seekg(fs->beg);
+        // Counters followed by the persisted part of the free space map
+        uint8_t hiddenPage[PAGE_SIZE];
+        RC ret = backend->read(0, hiddenPage, PAGE_SIZE);
+        if(ret) return ret;
         uint32_t counterNum = PeterDB::FileHandle::getCounterNum();
         uint32_t counters[counterNum];
-        for(uint32_t i = 0; i < counterNum; i++) {
-            fs->read(reinterpret_cast<char *>(counters + i), sizeof(uint32_t));
-        }
+        memcpy(counters, hiddenPage, getAllCounterLen());
         setCounters(counters);
 
+        // Counters are flushed lazily, pages are always appended to disk
+        // The file size is the source of truth for the page number
+        uint32_t filePageNum;
+        ret = getFilePageNum(filePageNum);
+        if(ret) return ret;
+        if(filePageNum != pageCounter) {
+            pageCounter = filePageNum;
+            metadataDirtyOps++;
+        }
+
+        // Entries of pages out of the hidden page are unknown until the pages are inspected again
+        freeSpaceMap.assign(pageCounter, PFM::FSM_BUCKET_UNKNOWN);
+        uint32_t persistedNum = std::min(pageCounter, PFM::FSM_HIDDEN_ENTRY_NUM);
+        memcpy(freeSpaceMap.data(), hiddenPage + PFM::FSM_COUNTER_LEN, persistedNum);
         return 0;
     }
 
     RC FileHandle::flushMetadata() {
         if(!isOpen())
             return ERR_FILE_NOT_OPEN;
-        fs->clear();
-        fs->seekp(fs->beg);
         uint32_t counterNum = PeterDB::FileHandle::getCounterNum();
         uint32_t counters[counterNum];
         getCounters(counters);
-        for(uint32_t i = 0; i < counterNum; i++) {
-            fs->write(reinterpret_cast<char *>(counters + i), sizeof(uint32_t));
+
+        // Counters and the free space map are written in one go
+        uint32_t persistedNum = std::min((uint32_t)freeSpaceMap.size(), PFM::FSM_HIDDEN_ENTRY_NUM);
+        uint8_t hiddenPage[PAGE_SIZE];
+        memcpy(hiddenPage, counters, getAllCounterLen());
+        memcpy(hiddenPage + PFM::FSM_COUNTER_LEN, freeSpaceMap.data(), persistedNum);
+        RC ret = backend->write(0, hiddenPage, PFM::FSM_COUNTER_LEN + persistedNum);
+        if(ret) return ret;
+        backend->flush();
+        metadataDirtyOps = 0;
+        return 0;
+    }
+
+    RC FileHandle::markMetadataDirty() {
+        metadataDirtyOps++;
+        if(metadataFlushInterval != PFM::METADATA_FLUSH_LAZY && metadataDirtyOps >= metadataFlushInterval) {
+            return flushMetadata();
+        }
+        return 0;
+    }
+
+    RC FileHandle::getFilePageNum(uint32_t& filePageNum) {
+        if(!isOpen()) {
+            return ERR_FILE_NOT_OPEN;
+        }
+        uint64_t fileSize;
+        RC ret = backend->getFileSize(fileSize);
+        if(ret) return ret;
+        if(fileSize < PAGE_SIZE) {
+            return ERR_READ_PAGE;
         }
-        fs->flush();
+        filePageNum = fileSize / PAGE_SIZE - 1;     // Exclude the hidden page
         return 0;
     }
 
+    RC FileHandle::checkpoint() {
+        if(!isOpen()) {
+            return ERR_FILE_NOT_OPEN;
+        }
+        uint64_t flushedLsn = LogManager::instance().getLastLsn(fileId);
+        RC ret = BufferPool::instance().flushFile(fileId, backend, flushedLsn);
+        if(ret) return ret;
+        ret = flushMetadata();
+        if(ret) return ret;
+        return syncAndDropLog(flushedLsn);
+    }
+
+    RC FileHandle::syncAndDropLog(uint64_t flushedLsn) {
+        LogManager& logManager = LogManager::instance();
+        if(logManager.getLogSize(fileId) == 0) {
+            return 0;       // Nothing changed since the last checkpoint
+        }
+        RC ret = backend->sync();
+        if(ret) return ret;
+        return logManager.checkpoint(fileId, flushedLsn);
+    }
+
+    void FileHandle::setMetadataFlushInterval(uint32_t interval) {
+        metadataFlushInterval = interval;
+    }
+
+    void FileHandle::setPrefetchDepth(uint32_t depth) {
+        prefetchDepth = depth;
+        resetReadAhead();
+    }
+
+    void FileHandle::resetReadAhead() {
+        lastReadPage = PFM::PREFETCH_NO_PAGE;
+        sequentialRun = 0;
+        prefetchedUntil = 0;
+    }
+
+    // Once reads have been sequential for a while, keep up to prefetchDepth pages ahead of the reader
+    // A new request is issued when the reader is halfway through the pages already requested
+    void FileHandle::detectSequentialRead(PageNum pageNum) {
+        if(lastReadPage != PFM::PREFETCH_NO_PAGE && pageNum == lastReadPage + 1) {
+            sequentialRun++;
+        }
+        else if(pageNum != lastReadPage) {
+            sequentialRun = 1;
+            prefetchedUntil = 0;
+        }
+        lastReadPage = pageNum;
+
+        if(prefetchDepth == 0 || sequentialRun < PFM::PREFETCH_TRIGGER_RUN || !backend->isThreadSafe()) {
+            return;
+        }
+        if(prefetchedUntil > pageNum + prefetchDepth / 2) {
+            return;
+        }
+        PageNum first = std::max(prefetchedUntil, pageNum + 1);
+        PageNum last = std::min(pageNum + 1 + prefetchDepth, pageCounter);
+        if(first >= last) {
+            return;
+        }
+        Prefetcher::instance().request(fileId, backend, first + 1, last - first);  // Page is 1-indexed
+        prefetchedUntil = last;
+    }
+
     RC FileHandle::open(const std::string& tmpFileName) {
         if(isOpen()) {
             return ERR_OPEN_FILE_ALREADY_OPEN;
         }
 
         fileName = tmpFileName;
-        fs = new fstream(fileName, std::fstream::in | std::fstream::out | std::fstream::binary);
-        if(!isOpen()) {
+        backend = PagedFileManager::instance().createStorageBackend();
+        if(backend->open(fileName)) {
+            delete backend;
+            backend = nullptr;
             return ERR_OPEN_FILE;
         }
+        RC ret = BufferPool::getFileId(fileName, fileId);
+        if(ret) return ret;
+
+        resetReadAhead();
+
+        // Changes lost in a crash are redone into the data file, cached pages are stale
+        uint32_t redoPageNum;
+        ret = LogManager::instance().openLog(fileId, fileName, backend, redoPageNum);
+        if(ret) return ret;
+        if(redoPageNum) {
+            BufferPool::instance().discardFile(fileName);
+        }
 
         // Read Metadata From the header page
         RC rc = readMetadata();
@@ -98,14 +225,38 @@ namespace PeterDB {
         if(!isOpen()) {
             return ERR_FILE_NOT_OPEN;
         }
-        flushMetadata();
+        Prefetcher::instance().cancel(backend);
+        // The file is closed anyway, the first failure is reported
+        uint64_t flushedLsn = LogManager::instance().getLastLsn(fileId);
+        RC ret = BufferPool::instance().flushFile(fileId, backend, flushedLsn);
+        if(metadataDirtyOps) {
+            RC metadataRet = flushMetadata();
+            ret = ret ? ret : metadataRet;
+        }
+        if(!ret) {
+            // Keep the log for redo if pages could not be written back
+            ret = syncAndDropLog(flushedLsn);
+        }
+        LogManager::instance().closeLog(fileId);
 
-        delete fs;
-        fs = nullptr;
-        return 0;
+        RC closeRet = backend->close();
+        ret = ret ? ret : closeRet;
+        delete backend;
+        backend = nullptr;
+        return ret;
     }
 
     RC FileHandle::readPage(PageNum pageNum, void *data) {
+        uint8_t* frameData = nullptr;
+        RC ret = pinPage(pageNum, frameData);
+        if(ret) {
+            return ret;
+        }
+        memcpy(data, frameData, PAGE_SIZE);
+        return BufferPool::instance().unpinPage(fileId, backend, pageNum + 1, false);
+    }
+
+    RC FileHandle::writePage(PageNum pageNum, const void *data) {
         // Not Bound to a file
         if(!isOpen())
             return ERR_FILE_NOT_OPEN;
@@ -113,53 +264,128 @@ namespace PeterDB {
         if(pageNum >= pageCounter)
             return ERR_PAGE_NOT_EXIST;
 
-        fs->clear();
-        fs->seekg((pageNum + 1) * PAGE_SIZE, fs->beg);  // Page is 1-indexed
-        fs->read((char *)data, PAGE_SIZE);
-        if(!fs->good()) {
-            return ERR_READ_PAGE;
+        // The whole page is overwritten, no need to load it from disk
+        uint8_t* frameData = nullptr;
+        bool isHit;
+        RC ret = BufferPool::instance().pinPage(fileId, backend, pageNum + 1, false, frameData, isHit);  // Page is 1-indexed
+        if(ret) {
+            return ERR_WRITE_PAGE;
+        }
+        if(frameData != data) {
+            memcpy(frameData, data, PAGE_SIZE);
+        }
+        return unpinPage(pageNum, true);
+    }
+
+    RC FileHandle::appendPage(const void *data) {
+        // Not Bound to a file
+        if(!isOpen())
+            return ERR_FILE_NOT_OPEN;
+
+        if(backend->write((uint64_t)(pageCounter + 1) * PAGE_SIZE, data, PAGE_SIZE) || backend->flush()) {
+            return ERR_APPEND_PAGE;
+        }
+        LogManager::instance().logPage(fileId, pageCounter + 1, data);
+        LogManager::instance().commitGroup(fileId);
+        appendPageCounter++;
+        pageCounter++;
+        freeSpaceMap.resize(pageCounter, PFM::FSM_BUCKET_UNKNOWN);
+        markMetadataDirty();
+
+        // Keep the new page cached, it is likely to be accessed right away
+        uint8_t* frameData = nullptr;
+        bool isHit;
+        if(BufferPool::instance().pinPage(fileId, backend, pageCounter, false, frameData, isHit) == 0) {
+            memcpy(frameData, data, PAGE_SIZE);
+            BufferPool::instance().unpinPage(fileId, backend, pageCounter, false);
         }
-        readPageCounter++;
-        flushMetadata();
         return 0;
     }
 
-    RC FileHandle::writePage(PageNum pageNum, const void *data) {
+    RC FileHandle::readPages(PageNum firstPage, uint32_t pageCount, void *data) {
         // Not Bound to a file
         if(!isOpen())
             return ERR_FILE_NOT_OPEN;
         // Page Not Exist
-        if(pageNum >= pageCounter)
+        if((uint64_t)firstPage + pageCount > pageCounter)
             return ERR_PAGE_NOT_EXIST;
 
-        fs->clear();
-        fs->seekp((pageNum + 1) * PAGE_SIZE, fs->beg);  // Page is 1-indexed
-        fs->write((char *)data, PAGE_SIZE);
-        fs->flush(); // IMPORTANT!
-        if(!fs->good()) {
-            return ERR_WRITE_PAGE;
+        BufferPool& bufferPool = BufferPool::instance();
+        std::vector<uint8_t*> frameData;
+        uint32_t done = 0;
+        while(done < pageCount) {
+            uint32_t chunk = std::min(pageCount - done, PFM::VECTORED_IO_PAGE_NUM);
+            uint32_t hitCount;
+            RC ret = bufferPool.pinPages(fileId, backend, firstPage + done + 1, chunk, true, frameData, hitCount);  // Page is 1-indexed
+            if(ret) {
+                return ERR_READ_PAGE;
+            }
+            for(uint32_t i = 0; i < chunk; i++) {
+                memcpy((uint8_t *)data + (size_t)(done + i) * PAGE_SIZE, frameData[i], PAGE_SIZE);
+                bufferPool.unpinPage(fileId, backend, firstPage + done + i + 1, false);
+            }
+            bufferHitCounter += hitCount;
+            bufferMissCounter += chunk - hitCount;
+            readPageCounter += chunk;
+            done += chunk;
         }
-        writePageCounter++;
-        flushMetadata();
-        return 0;
+        return markMetadataDirty();
     }
 
-    RC FileHandle::appendPage(const void *data) {
+    RC FileHandle::writePages(PageNum firstPage, uint32_t pageCount, const void *data) {
+        // Not Bound to a file
+        if(!isOpen())
+            return ERR_FILE_NOT_OPEN;
+        // Page Not Exist
+        if((uint64_t)firstPage + pageCount > pageCounter)
+            return ERR_PAGE_NOT_EXIST;
+
+        // Pages are copied into their frames and written through together
+        BufferPool& bufferPool = BufferPool::instance();
+        std::vector<uint8_t*> frameData;
+        uint32_t done = 0;
+        while(done < pageCount) {
+            uint32_t chunk = std::min(pageCount - done, PFM::VECTORED_IO_PAGE_NUM);
+            uint32_t hitCount;
+            RC ret = bufferPool.pinPages(fileId, backend, firstPage + done + 1, chunk, false, frameData, hitCount);  // Page is 1-indexed
+            if(ret) {
+                return ERR_WRITE_PAGE;
+            }
+            for(uint32_t i = 0; i < chunk; i++) {
+                memcpy(frameData[i], (const uint8_t *)data + (size_t)(done + i) * PAGE_SIZE, PAGE_SIZE);
+            }
+            ret = bufferPool.writePages(fileId, backend, firstPage + done + 1, chunk);
+            for(uint32_t i = 0; i < chunk; i++) {
+                bufferPool.unpinPage(fileId, backend, firstPage + done + i + 1, ret != 0);    // Keep failed pages dirty
+            }
+            if(ret) {
+                return ERR_WRITE_PAGE;
+            }
+            writePageCounter += chunk;
+            done += chunk;
+        }
+        return markMetadataDirty();
+    }
+
+    RC FileHandle::appendPages(const void *data, uint32_t pageCount) {
         // Not Bound to a file
         if(!isOpen())
             return ERR_FILE_NOT_OPEN;
+        if(pageCount == 0)
+            return 0;
 
-        fs->clear();
-        fs->seekp((pageCounter + 1) * PAGE_SIZE);
-        fs->write((char *)data, PAGE_SIZE);
-        fs->flush(); // IMPORTANT!
-        if(!fs->good()) {
+        // Pages are not cached, bulk appended pages are rarely read back right away
+        if(backend->write((uint64_t)(pageCounter + 1) * PAGE_SIZE, data, pageCount * PAGE_SIZE) || backend->flush()) {
             return ERR_APPEND_PAGE;
         }
-        appendPageCounter++;
-        pageCounter++;
-        flushMetadata();
-        return 0;
+        for(uint32_t i = 0; i < pageCount; i++) {
+            LogManager::instance().logPage(fileId, pageCounter + 1 + i, (const uint8_t *)data + (size_t)i * PAGE_SIZE);
+        }
+        LogManager::instance().commitGroup(fileId);
+        appendPageCounter += pageCount;
+        pageCounter += pageCount;
+        freeSpaceMap.resize(pageCounter, PFM::FSM_BUCKET_UNKNOWN);
+        return markMetadataDirty();
     }
 
     uint32_t FileHandle::getNumberOfPages() {
@@ -172,4 +398,89 @@ namespace PeterDB {
         appendPageCount = this->appendPageCounter;
         return 0;
     }
+
+    RC FileHandle::collectCounterValues(uint32_t &readPageCount, uint32_t &writePageCount, uint32_t &appendPageCount,
+                                        uint32_t &bufferHitCount, uint32_t &bufferMissCount) {
+        collectCounterValues(readPageCount, writePageCount, appendPageCount);
+        bufferHitCount = this->bufferHitCounter;
+        bufferMissCount = this->bufferMissCounter;
+        return 0;
+    }
+
+    RC FileHandle::pinPage(PageNum pageNum, uint8_t*& frameData) {
+        // Not Bound to a file
+        if(!isOpen())
+            return ERR_FILE_NOT_OPEN;
+        // Page Not Exist
+        if(pageNum >= pageCounter)
+            return ERR_PAGE_NOT_EXIST;
+
+        bool isHit;
+        RC ret = BufferPool::instance().pinPage(fileId, backend, pageNum + 1, true, frameData, isHit);  // Page is 1-indexed
+        if(ret) {
+            return ERR_READ_PAGE;
+        }
+        isHit ? bufferHitCounter++ : bufferMissCounter++;
+        readPageCounter++;
+        markMetadataDirty();
+        detectSequentialRead(pageNum);
+        return 0;
+    }
+
+    RC FileHandle::unpinPage(PageNum pageNum, bool isDirty) {
+        RC ret = BufferPool::instance().unpinPage(fileId, backend, pageNum + 1, isDirty);
+        if(ret) {
+            return ret;
+        }
+        if(isDirty) {
+            writePageCounter++;
+            markMetadataDirty();
+            if(LogManager::instance().getLogSize(fileId) >= PFM::WAL_CHECKPOINT_BYTES) {
+                return checkpoint();
+            }
+        }
+        return 0;
+    }
+
+    RC FileHandle::setPageFreeSpace(PageNum pageNum, uint16_t freeBytes) {
+        if(pageNum >= pageCounter)
+            return ERR_PAGE_NOT_EXIST;
+        if(freeSpaceMap.size() < pageCounter) {
+            freeSpaceMap.resize(pageCounter, PFM::FSM_BUCKET_UNKNOWN);
+        }
+
+        uint8_t bucket = std::min(freeBytes / PFM::FSM_BUCKET_BYTES + 1, (int)PFM::FSM_BUCKET_MAX);
+        if(freeSpaceMap[pageNum] == bucket) {
+            return 0;
+        }
+        freeSpaceMap[pageNum] = bucket;
+        return markMetadataDirty();
+    }
+
+    bool FileHandle::isPageFreeSpaceKnown(PageNum pageNum) {
+        return pageNum < freeSpaceMap.size() && freeSpaceMap[pageNum] != PFM::FSM_BUCKET_UNKNOWN;
+    }
+
+    uint16_t FileHandle::getPageFreeSpace(PageNum pageNum) {
+        if(!isPageFreeSpaceKnown(pageNum)) {
+            return 0;
+        }
+        return (freeSpaceMap[pageNum] - 1) * PFM::FSM_BUCKET_BYTES;
+    }
+
+    RC FileHandle::findPageWithFreeSpace(uint16_t freeBytes, PageNum startPage, PageNum& pageNum) {
+        if(freeSpaceMap.size() < pageCounter) {
+            freeSpaceMap.resize(pageCounter, PFM::FSM_BUCKET_UNKNOWN);
+        }
+        // Smallest bucket whose lower bound covers freeBytes
+        uint32_t minBucket = (freeBytes + PFM::FSM_BUCKET_BYTES - 1) / PFM::FSM_BUCKET_BYTES + 1;
+        for(PageNum i = startPage; i < pageCounter; i++) {
+            uint8_t bucket = freeSpaceMap[i];
+            if(bucket == PFM::FSM_BUCKET_UNKNOWN || bucket >= minBucket) {
+                pageNum = i;
+                return 0;
+            }
+        }
+        return ERR_NO_FREE_PAGE;
+    }
 }
@@ -0,0 +1,442 @@
+#include <fcntl.h>
+#include <unistd.h>
+#include <cerrno>
+
+#include "src/include/pfm.h"
+
+namespace PeterDB {
+    LogManager &LogManager::instance() {
+        static LogManager _log_manager;
+        return _log_manager;
+    }
+
+    LogManager::LogManager() {
+        groupCommitSize = PFM::WAL_GROUP_COMMIT_DEFAULT;
+        groupCommitInterval = PFM::WAL_GROUP_COMMIT_INTERVAL_MS;
+        isStopping = false;
+        logPageCounter = 0;
+        logSyncCounter = 0;
+        redoPageCounter = 0;
+    }
+
+    LogManager::~LogManager() {
+        {
+            std::lock_guard<std::mutex> guard(logMutex);
+            isStopping = true;
+        }
+        flusherWake.notify_all();
+        if(flusher.joinable()) {
+            flusher.join();
+        }
+
+        // Records are kept for redo, handles left open are not checkpointed
+        std::unique_lock<std::mutex> lock(logMutex);
+        for(auto& p: logFiles) {
+            writeBuffer(lock, p.second);
+            closeLogFile(p.second);
+        }
+    }
+
+    RC LogManager::openLog(uint64_t fileId, const std::string& fileName, StorageBackend* dataBackend,
+                           uint32_t& redoPageNum) {
+        std::lock_guard<std::mutex> guard(logMutex);
+        redoPageNum = 0;
+        auto logIter = logFiles.find(fileId);
+        if(logIter != logFiles.end()) {
+            logIter->second.refCount++;
+            return 0;
+        }
+
+        LogFile& log = logFiles[fileId];
+        log.logFileName = getLogFileName(fileName);
+        log.fd = -1;
+        log.refCount = 1;
+        log.logSize = 0;
+        log.nextLsn = 1;
+        log.durableLsn = 0;
+        log.pendingChangeNum = 0;
+        log.writingLen = 0;
+        log.isWriting = false;
+
+        // A log left behind means the data file was not checkpointed
+        struct stat stFileInfo{};
+        if(stat(log.logFileName.c_str(), &stFileInfo) != 0) {
+            return 0;
+        }
+        log.fd = ::open(log.logFileName.c_str(), O_RDWR);
+        if(log.fd < 0) {
+            LOG(ERROR) << "Fail to open " << log.logFileName << ", errno " << errno << " @ LogManager::openLog" << std::endl;
+            logFiles.erase(fileId);
+            return ERR_OPEN_FILE;
+        }
+        log.logSize = stFileInfo.st_size;
+        RC ret = redo(log, dataBackend, redoPageNum);
+        if(ret) {
+            closeLogFile(log);
+            logFiles.erase(fileId);
+            return ret;
+        }
+        return 0;
+    }
+
+    RC LogManager::closeLog(uint64_t fileId) {
+        std::unique_lock<std::mutex> lock(logMutex);
+        LogFile* log = waitForWrite(lock, fileId);
+        if(!log) {
+            return 0;       // Log removed with the data file
+        }
+        if(--log->refCount > 0) {
+            return 0;
+        }
+        RC ret = writeBuffer(lock, *log);
+        if(log->refCount > 0) {
+            return ret;     // Attached again while the last group was written
+        }
+        closeLogFile(*log);
+        logFiles.erase(fileId);
+        return ret;
+    }
+
+    uint64_t LogManager::logPage(uint64_t fileId, uint32_t pageIndex, const void* data) {
+        std::lock_guard<std::mutex> guard(logMutex);
+        auto logIter = logFiles.find(fileId);
+        if(logIter == logFiles.end()) {
+            return 0;
+        }
+        LogFile& log = logIter->second;
+        uint64_t lsn = log.nextLsn++;
+
+        // Overwrite the image buffered by an earlier change of the page
+        auto pageIter = log.bufferedPages.find(pageIndex);
+        uint32_t offset;
+        if(pageIter != log.bufferedPages.end()) {
+            offset = pageIter->second;
+        }
+        else {
+            offset = log.buffer.size();
+            log.buffer.resize(offset + PFM::WAL_RECORD_HEADER_LEN + PAGE_SIZE);
+            log.bufferedPages[pageIndex] = offset;
+        }
+        uint8_t* record = log.buffer.data() + offset;
+        memcpy(record, &lsn, sizeof(lsn));
+        memcpy(record + sizeof(lsn), &pageIndex, sizeof(pageIndex));
+        memcpy(record + PFM::WAL_RECORD_HEADER_LEN, data, PAGE_SIZE);
+        logPageCounter++;
+
+        // The group is synced by commitGroup or the flusher, never here
+        if(log.pendingChangeNum++ == 0) {
+            log.firstPendingTime = std::chrono::steady_clock::now();
+            if(!flusher.joinable() && !isStopping) {
+                flusher = std::thread(&LogManager::runFlusher, this);
+            }
+        }
+        return lsn;
+    }
+
+    RC LogManager::commitGroup(uint64_t fileId) {
+        std::unique_lock<std::mutex> lock(logMutex);
+        LogFile* log = waitForWrite(lock, fileId);
+        if(!log || groupCommitSize == 0 || log->pendingChangeNum < groupCommitSize) {
+            return 0;
+        }
+        return writeBuffer(lock, *log);
+    }
+
+    RC LogManager::forceLog(uint64_t fileId, uint64_t lsn) {
+        std::unique_lock<std::mutex> lock(logMutex);
+        LogFile* log = waitForWrite(lock, fileId);
+        if(!log || lsn <= log->durableLsn) {
+            return 0;
+        }
+        return writeBuffer(lock, *log);
+    }
+
+    // Records after flushedLsn are kept, a log file holding any of them is kept as a whole
+    // Buffered records are the latest image of their page, so redoing one never rolls a page back
+    RC LogManager::checkpoint(uint64_t fileId, uint64_t flushedLsn) {
+        std::unique_lock<std::mutex> lock(logMutex);
+        LogFile* logPtr = waitForWrite(lock, fileId);
+        if(!logPtr) {
+            return 0;
+        }
+        LogFile& log = *logPtr;
+        if(flushedLsn + 1 >= log.nextLsn) {
+            log.buffer.clear();
+            log.bufferedPages.clear();
+            log.pendingChangeNum = 0;
+            log.durableLsn = log.nextLsn - 1;
+        }
+        else if(log.durableLsn <= flushedLsn) {
+            log.durableLsn = flushedLsn;    // Later records are all still buffered
+        }
+        else {
+            return 0;
+        }
+        if(log.fd < 0) {
+            return 0;
+        }
+        // Without the log file a reopen has nothing to redo
+        closeLogFile(log);
+        log.logSize = 0;
+        if(::remove(log.logFileName.c_str()) != 0) {
+            return ERR_DELETE_FILE;
+        }
+        return 0;
+    }
+
+    uint64_t LogManager::getLastLsn(uint64_t fileId) {
+        std::lock_guard<std::mutex> guard(logMutex);
+        auto logIter = logFiles.find(fileId);
+        if(logIter == logFiles.end()) {
+            return 0;
+        }
+        return logIter->second.nextLsn - 1;
+    }
+
+    uint64_t LogManager::getLogSize(uint64_t fileId) {
+        std::lock_guard<std::mutex> guard(logMutex);
+        auto logIter = logFiles.find(fileId);
+        if(logIter == logFiles.end()) {
+            return 0;
+        }
+        return logIter->second.logSize + logIter->second.writingLen + logIter->second.buffer.size();
+    }
+
+    RC LogManager::removeLog(const std::string& fileName) {
+        std::unique_lock<std::mutex> lock(logMutex);
+        std::string logFileName = getLogFileName(fileName);
+        writeDone.wait(lock, [this, &logFileName]() {
+            for(auto& p: logFiles) {
+                if(p.second.logFileName == logFileName && p.second.isWriting) {
+                    return false;
+                }
+            }
+            return true;
+        });
+        for(auto logIter = logFiles.begin(); logIter != logFiles.end();) {
+            if(logIter->second.logFileName == logFileName) {
+                closeLogFile(logIter->second);
+                logIter = logFiles.erase(logIter);
+            }
+            else {
+                logIter++;
+            }
+        }
+        struct stat stFileInfo{};
+        if(stat(logFileName.c_str(), &stFileInfo) == 0 && ::remove(logFileName.c_str()) != 0) {
+            return ERR_DELETE_FILE;
+        }
+        return 0;
+    }
+
+    std::string LogManager::getLogFileName(const std::string& fileName) {
+        size_t slashPos = fileName.rfind('/');
+        if(slashPos == std::string::npos) {
+            return std::string(PFM::WAL_DIR_NAME) + "/" + fileName;
+        }
+        return fileName.substr(0, slashPos + 1) + PFM::WAL_DIR_NAME + fileName.substr(slashPos);
+    }
+
+    void LogManager::setGroupCommitSize(uint32_t changeNum) {
+        std::lock_guard<std::mutex> guard(logMutex);
+        groupCommitSize = changeNum;
+    }
+
+    void LogManager::setGroupCommitInterval(uint32_t intervalMs) {
+        {
+            std::lock_guard<std::mutex> guard(logMutex);
+            groupCommitInterval = intervalMs;
+        }
+        flusherWake.notify_all();
+    }
+
+    void LogManager::collectCounterValues(uint32_t &logPageCount, uint32_t &logSyncCount, uint32_t &redoPageCount) {
+        std::lock_guard<std::mutex> guard(logMutex);
+        logPageCount = logPageCounter;
+        logSyncCount = logSyncCounter;
+        redoPageCount = redoPageCounter;
+    }
+
+    LogFile* LogManager::waitForWrite(std::unique_lock<std::mutex>& lock, uint64_t fileId) {
+        while(true) {
+            auto logIter = logFiles.find(fileId);
+            if(logIter == logFiles.end()) {
+                return nullptr;
+            }
+            if(!logIter->second.isWriting) {
+                return &logIter->second;
+            }
+            writeDone.wait(lock);
+        }
+    }
+
+    // The log stays in logFiles while isWriting is set, closeLog, removeLog and checkpoint wait for it
+    RC LogManager::writeBuffer(std::unique_lock<std::mutex>& lock, LogFile& log) {
+        if(log.buffer.empty()) {
+            return 0;
+        }
+        if(log.fd < 0) {
+            std::string logDirName = log.logFileName.substr(0, log.logFileName.rfind('/'));
+            if(::mkdir(logDirName.c_str(), 0755) != 0 && errno != EEXIST) {
+                LOG(ERROR) << "Fail to create " << logDirName << ", errno " << errno << " @ LogManager::writeBuffer" << std::endl;
+                return ERR_WRITE_LOG;
+            }
+            log.fd = ::open(log.logFileName.c_str(), O_RDWR | O_CREAT, 0644);
+            if(log.fd < 0) {
+                LOG(ERROR) << "Fail to create " << log.logFileName << ", errno " << errno << " @ LogManager::writeBuffer" << std::endl;
+                return ERR_WRITE_LOG;
+            }
+        }
+
+        // Take the group out, changes logged meanwhile go to an empty buffer
+        std::vector<uint8_t> group;
+        group.swap(log.buffer);
+        log.bufferedPages.clear();
+        uint32_t changeNum = log.pendingChangeNum;
+        log.pendingChangeNum = 0;
+        uint64_t groupLsn = log.nextLsn - 1;
+        uint64_t groupOffset = log.logSize;
+        log.writingLen = group.size();
+        log.isWriting = true;
+        lock.unlock();
+
+        // Checksums are computed once per group, buffered images may have been overwritten
+        RC ret = 0;
+        uint32_t recordLen = PFM::WAL_RECORD_HEADER_LEN + PAGE_SIZE;
+        for(uint32_t offset = 0; offset < group.size(); offset += recordLen) {
+            uint8_t* record = group.data() + offset;
+            uint32_t sum = checksum(record + PFM::WAL_RECORD_HEADER_LEN, PAGE_SIZE);
+            memcpy(record + sizeof(uint64_t) + sizeof(uint32_t), &sum, sizeof(sum));
+        }
+
+        uint32_t done = 0;
+        while(done < group.size()) {
+            ssize_t n = ::pwrite(log.fd, group.data() + done, group.size() - done, groupOffset + done);
+            if(n < 0 && errno == EINTR) {
+                continue;
+            }
+            if(n <= 0) {
+                LOG(ERROR) << "Fail to write " << log.logFileName << ", errno " << errno << " @ LogManager::writeBuffer" << std::endl;
+                ret = ERR_WRITE_LOG;
+                break;
+            }
+            done += n;
+        }
+        if(!ret && ::fdatasync(log.fd) != 0) {
+            ret = ERR_WRITE_LOG;
+        }
+
+        lock.lock();
+        log.isWriting = false;
+        log.writingLen = 0;
+        if(ret) {
+            // Put the group back in front of the changes logged meanwhile, later images of a page still win on redo
+            for(auto& p: log.bufferedPages) {
+                p.second += group.size();
+            }
+            for(uint32_t offset = 0; offset < group.size(); offset += recordLen) {
+                uint32_t pageIndex;
+                memcpy(&pageIndex, group.data() + offset + sizeof(uint64_t), sizeof(pageIndex));
+                log.bufferedPages.emplace(pageIndex, offset);
+            }
+            group.insert(group.end(), log.buffer.begin(), log.buffer.end());
+            log.buffer.swap(group);
+            if(log.pendingChangeNum == 0) {
+                log.firstPendingTime = std::chrono::steady_clock::now();
+            }
+            log.pendingChangeNum += changeNum;
+        }
+        else {
+            log.logSize += group.size();
+            log.durableLsn = std::max(log.durableLsn, groupLsn);
+            logSyncCounter++;
+        }
+        writeDone.notify_all();
+        return ret;
+    }
+
+    // Syncs groups whose oldest change waited longer than the interval, a lone writer never waits for a full group
+    void LogManager::runFlusher() {
+        std::unique_lock<std::mutex> lock(logMutex);
+        while(!isStopping) {
+            if(groupCommitInterval == 0) {
+                flusherWake.wait(lock);
+                continue;
+            }
+            std::chrono::milliseconds interval(groupCommitInterval);
+            flusherWake.wait_for(lock, interval);
+
+            std::vector<uint64_t> agedFileIds;
+            std::chrono::steady_clock::time_point now = std::chrono::steady_clock::now();
+            for(auto& p: logFiles) {
+                if(p.second.pendingChangeNum && now - p.second.firstPendingTime >= interval) {
+                    agedFileIds.push_back(p.first);
+                }
+            }
+            for(uint64_t fileId: agedFileIds) {
+                LogFile* log = waitForWrite(lock, fileId);
+                if(log && log->pendingChangeNum && !isStopping) {
+                    writeBuffer(lock, *log);
+                }
+            }
+        }
+    }
+
+    // Records are replayed in log order, later images of a page win
+    // A torn or corrupted record ends the log
+    RC LogManager::redo(LogFile& log, StorageBackend* dataBackend, uint32_t& redoPageNum) {
+        RC ret = 0;
+        uint32_t recordLen = PFM::WAL_RECORD_HEADER_LEN + PAGE_SIZE;
+        std::vector<uint8_t> record(recordLen);
+        uint64_t offset = 0;
+        for(; offset + recordLen <= log.logSize; offset += recordLen) {
+            if(::pread(log.fd, record.data(), recordLen, offset) != (ssize_t)recordLen) {
+                break;
+            }
+            uint64_t lsn;
+            uint32_t pageIndex, sum;
+            memcpy(&lsn, record.data(), sizeof(lsn));
+            memcpy(&pageIndex, record.data() + sizeof(lsn), sizeof(pageIndex));
+            memcpy(&sum, record.data() + sizeof(lsn) + sizeof(pageIndex), sizeof(sum));
+            if(sum != checksum(record.data() + PFM::WAL_RECORD_HEADER_LEN, PAGE_SIZE)) {
+                break;
+            }
+            ret = dataBackend->write((uint64_t)pageIndex * PAGE_SIZE, record.data() + PFM::WAL_RECORD_HEADER_LEN, PAGE_SIZE);
+            if(ret) {
+                LOG(ERROR) << "Fail to redo page " << pageIndex << " @ LogManager::redo" << std::endl;
+                return ret;
+            }
+            log.nextLsn = std::max(log.nextLsn, lsn + 1);
+            redoPageNum++;
+        }
+        redoPageCounter += redoPageNum;
+
+        // Replayed pages are durable in the data file, start a new log
+        ret = dataBackend->sync();
+        if(ret) return ret;
+        closeLogFile(log);
+        if(::remove(log.logFileName.c_str()) != 0) {
+            return ERR_DELETE_FILE;
+        }
+        log.logSize = 0;
+        log.durableLsn = log.nextLsn - 1;
+        return 0;
+    }
+
+    void LogManager::closeLogFile(LogFile& log) {
+        if(log.fd >= 0) {
+            ::close(log.fd);
+            log.fd = -1;
+        }
+    }
+
+    // FNV-1a
+    uint32_t LogManager::checksum(const uint8_t* data, uint32_t len) {
+        uint32_t hash = 2166136261u;
+        for(uint32_t i = 0; i < len; i++) {
+            hash ^= data[i];
+            hash *= 16777619u;
+        }
+        return hash;
+    }
+}
@@ -0,0 +1,76 @@
+#include "src/include/pfm.h"
+
+namespace PeterDB {
+    Prefetcher &Prefetcher::instance() {
+        static Prefetcher _prefetcher;
+        return _prefetcher;
+    }
+
+    Prefetcher::Prefetcher() {
+        BufferPool::instance();     // Constructed first so that it outlives the worker
+        activeBackend = nullptr;
+        isStopping = false;
+    }
+
+    Prefetcher::~Prefetcher() {
+        {
+            std::lock_guard<std::mutex> guard(queueMutex);
+            isStopping = true;
+            requests.clear();
+        }
+        queueChanged.notify_all();
+        if(worker.joinable()) {
+            worker.join();
+        }
+    }
+
+    void Prefetcher::request(uint64_t fileId, StorageBackend* backend, uint32_t firstPageIndex, uint32_t pageCount) {
+        if(!backend || pageCount == 0) {
+            return;
+        }
+        {
+            std::lock_guard<std::mutex> guard(queueMutex);
+            if(isStopping || requests.size() >= PFM::PREFETCH_QUEUE_MAX) {
+                return;     // Read-ahead is only a hint
+            }
+            requests.push_back({fileId, backend, firstPageIndex, pageCount});
+            if(!worker.joinable()) {
+                worker = std::thread(&Prefetcher::run, this);
+            }
+        }
+        queueChanged.notify_all();
+    }
+
+    void Prefetcher::cancel(StorageBackend* backend) {
+        std::unique_lock<std::mutex> lock(queueMutex);
+        requests.erase(std::remove_if(requests.begin(), requests.end(), [backend](const PrefetchRequest& r) {
+            return r.backend == backend;
+        }), requests.end());
+        queueChanged.wait(lock, [this, backend]() { return activeBackend != backend; });
+    }
+
+    void Prefetcher::waitIdle() {
+        std::unique_lock<std::mutex> lock(queueMutex);
+        queueChanged.wait(lock, [this]() { return requests.empty() && !activeBackend; });
+    }
+
+    void Prefetcher::run() {
+        std::unique_lock<std::mutex> lock(queueMutex);
+        while(true) {
+            queueChanged.wait(lock, [this]() { return isStopping || !requests.empty(); });
+            if(isStopping) {
+                return;
+            }
+            PrefetchRequest r = requests.front();
+            requests.pop_front();
+            activeBackend = r.backend;
+            lock.unlock();
+
+            BufferPool::instance().prefetchPages(r.fileId, r.backend, r.firstPageIndex, r.pageCount);
+
+            lock.lock();
+            activeBackend = nullptr;
+            queueChanged.notify_all();
+        }
+    }
+}
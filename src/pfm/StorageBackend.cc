@@ -0,0 +1,291 @@
+#include <fcntl.h>
+#include <unistd.h>
+#include <cerrno>
+
+#include "src/include/pfm.h"
+
+namespace PeterDB {
+    /*
+     * Default vectored I/O
+     */
+
+    RC StorageBackend::readv(uint64_t offset, const struct iovec* iov, int iovCount) {
+        for(int i = 0; i < iovCount; i++) {
+            RC ret = read(offset, iov[i].iov_base, iov[i].iov_len);
+            if(ret) return ret;
+            offset += iov[i].iov_len;
+        }
+        return 0;
+    }
+
+    RC StorageBackend::writev(uint64_t offset, const struct iovec* iov, int iovCount) {
+        for(int i = 0; i < iovCount; i++) {
+            RC ret = write(offset, iov[i].iov_base, iov[i].iov_len);
+            if(ret) return ret;
+            offset += iov[i].iov_len;
+        }
+        return 0;
+    }
+
+    /*
+     * File descriptor backend
+     */
+
+    FdStorageBackend::FdStorageBackend() {
+        fd = -1;
+    }
+
+    FdStorageBackend::~FdStorageBackend() {
+        close();
+    }
+
+    RC FdStorageBackend::open(const std::string& fileName) {
+        if(isOpen()) {
+            return ERR_OPEN_FILE_ALREADY_OPEN;
+        }
+        fd = ::open(fileName.c_str(), O_RDWR);
+        if(fd < 0) {
+            LOG(ERROR) << "Fail to open " << fileName << ", errno " << errno << " @ FdStorageBackend::open" << std::endl;
+            return ERR_OPEN_FILE;
+        }
+        return 0;
+    }
+
+    RC FdStorageBackend::close() {
+        if(!isOpen()) {
+            return ERR_FILE_NOT_OPEN;
+        }
+        ::close(fd);
+        fd = -1;
+        return 0;
+    }
+
+    bool FdStorageBackend::isOpen() {
+        return fd >= 0;
+    }
+
+    RC FdStorageBackend::read(uint64_t offset, void* data, uint32_t len) {
+        if(!isOpen()) {
+            return ERR_FILE_NOT_OPEN;
+        }
+        uint32_t done = 0;
+        while(done < len) {
+            ssize_t n = ::pread(fd, (uint8_t *)data + done, len - done, offset + done);
+            if(n < 0 && errno == EINTR) {
+                continue;
+            }
+            if(n <= 0) {
+                return ERR_READ_PAGE;       // Error or reading beyond EOF
+            }
+            done += n;
+        }
+        return 0;
+    }
+
+    RC FdStorageBackend::write(uint64_t offset, const void* data, uint32_t len) {
+        if(!isOpen()) {
+            return ERR_FILE_NOT_OPEN;
+        }
+        uint32_t done = 0;
+        while(done < len) {
+            ssize_t n = ::pwrite(fd, (const uint8_t *)data + done, len - done, offset + done);
+            if(n < 0 && errno == EINTR) {
+                continue;
+            }
+            if(n <= 0) {
+                return ERR_WRITE_PAGE;
+            }
+            done += n;
+        }
+        return 0;
+    }
+
+    RC FdStorageBackend::readv(uint64_t offset, const struct iovec* iov, int iovCount) {
+        if(!isOpen()) {
+            return ERR_FILE_NOT_OPEN;
+        }
+        ssize_t n;
+        do {
+            n = ::preadv(fd, iov, iovCount, offset);
+        } while(n < 0 && errno == EINTR);
+        if(n < 0) {
+            return ERR_READ_PAGE;
+        }
+
+        // Finish a short transfer buffer by buffer
+        for(int i = 0; i < iovCount; i++) {
+            uint32_t len = iov[i].iov_len;
+            if((size_t)n >= len) {
+                n -= len;
+            }
+            else {
+                RC ret = read(offset + n, (uint8_t *)iov[i].iov_base + n, len - n);
+                if(ret) return ret;
+                n = 0;
+            }
+            offset += len;
+        }
+        return 0;
+    }
+
+    RC FdStorageBackend::writev(uint64_t offset, const struct iovec* iov, int iovCount) {
+        if(!isOpen()) {
+            return ERR_FILE_NOT_OPEN;
+        }
+        ssize_t n;
+        do {
+            n = ::pwritev(fd, iov, iovCount, offset);
+        } while(n < 0 && errno == EINTR);
+        if(n < 0) {
+            return ERR_WRITE_PAGE;
+        }
+
+        // Finish a short transfer buffer by buffer
+        for(int i = 0; i < iovCount; i++) {
+            uint32_t len = iov[i].iov_len;
+            if((size_t)n >= len) {
+                n -= len;
+            }
+            else {
+                RC ret = write(offset + n, (const uint8_t *)iov[i].iov_base + n, len - n);
+                if(ret) return ret;
+                n = 0;
+            }
+            offset += len;
+        }
+        return 0;
+    }
+
+    RC FdStorageBackend::flush() {
+        // Nothing is buffered in user space
+        return isOpen() ? 0 : ERR_FILE_NOT_OPEN;
+    }
+
+    RC FdStorageBackend::sync() {
+        if(!isOpen()) {
+            return ERR_FILE_NOT_OPEN;
+        }
+        if(::fdatasync(fd) != 0) {
+            return ERR_WRITE_PAGE;
+        }
+        return 0;
+    }
+
+    RC FdStorageBackend::getFileSize(uint64_t& fileSize) {
+        if(!isOpen()) {
+            return ERR_FILE_NOT_OPEN;
+        }
+        struct stat stFileInfo{};
+        if(fstat(fd, &stFileInfo) != 0) {
+            return ERR_READ_PAGE;
+        }
+        fileSize = stFileInfo.st_size;
+        return 0;
+    }
+
+    /*
+     * fstream backend
+     */
+
+    FstreamStorageBackend::FstreamStorageBackend() {
+        fs = nullptr;
+    }
+
+    FstreamStorageBackend::~FstreamStorageBackend() {
+        close();
+    }
+
+    RC FstreamStorageBackend::open(const std::string& fileName) {
+        std::lock_guard<std::mutex> guard(ioMutex);
+        if(isOpen()) {
+            return ERR_OPEN_FILE_ALREADY_OPEN;
+        }
+        delete fs;
+        fs = new std::fstream(fileName, std::fstream::in | std::fstream::out | std::fstream::binary);
+        if(!isOpen()) {
+            return ERR_OPEN_FILE;
+        }
+        this->fileName = fileName;
+        return 0;
+    }
+
+    RC FstreamStorageBackend::close() {
+        std::lock_guard<std::mutex> guard(ioMutex);
+        if(!isOpen()) {
+            return ERR_FILE_NOT_OPEN;
+        }
+        fs->flush();
+        delete fs;
+        fs = nullptr;
+        return 0;
+    }
+
+    bool FstreamStorageBackend::isOpen() {
+        return fs && fs->is_open();
+    }
+
+    RC FstreamStorageBackend::read(uint64_t offset, void* data, uint32_t len) {
+        std::lock_guard<std::mutex> guard(ioMutex);
+        if(!isOpen()) {
+            return ERR_FILE_NOT_OPEN;
+        }
+        fs->clear();
+        fs->seekg(offset, fs->beg);
+        fs->read((char *)data, len);
+        if(!fs->good()) {
+            return ERR_READ_PAGE;
+        }
+        return 0;
+    }
+
+    RC FstreamStorageBackend::write(uint64_t offset, const void* data, uint32_t len) {
+        std::lock_guard<std::mutex> guard(ioMutex);
+        if(!isOpen()) {
+            return ERR_FILE_NOT_OPEN;
+        }
+        fs->clear();
+        fs->seekp(offset, fs->beg);
+        fs->write((const char *)data, len);
+        if(!fs->good()) {
+            return ERR_WRITE_PAGE;
+        }
+        return 0;
+    }
+
+    RC FstreamStorageBackend::flush() {
+        std::lock_guard<std::mutex> guard(ioMutex);
+        if(!isOpen()) {
+            return ERR_FILE_NOT_OPEN;
+        }
+        fs->flush(); // IMPORTANT!
+        return 0;
+    }
+
+    // A stream has no descriptor to sync, a second one on the same file syncs its data as well
+    RC FstreamStorageBackend::sync() {
+        RC ret = flush();
+        if(ret) return ret;
+        int fd = ::open(fileName.c_str(), O_RDONLY);
+        if(fd < 0) {
+            LOG(ERROR) << "Fail to open " << fileName << ", errno " << errno << " @ FstreamStorageBackend::sync" << std::endl;
+            return ERR_OPEN_FILE;
+        }
+        ret = ::fdatasync(fd) == 0 ? 0 : ERR_WRITE_PAGE;
+        if(ret) {
+            LOG(ERROR) << "Fail to sync " << fileName << ", errno " << errno << " @ FstreamStorageBackend::sync" << std::endl;
+        }
+        ::close(fd);
+        return ret;
+    }
+
+    RC FstreamStorageBackend::getFileSize(uint64_t& fileSize) {
+        std::lock_guard<std::mutex> guard(ioMutex);
+        if(!isOpen()) {
+            return ERR_FILE_NOT_OPEN;
+        }
+        fs->clear();
+        fs->seekg(0, fs->end);
+        fileSize = fs->tellg();
+        return 0;
+    }
+}
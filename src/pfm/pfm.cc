@@ -11,7 +11,9 @@ namespace PeterDB {
         return _pf_manager;
     }
 
-    PagedFileManager::PagedFileManager() = default;
+    PagedFileManager::PagedFileManager() {
+        storageBackendType = StorageFd;
+    }
 
     PagedFileManager::~PagedFileManager() = default;
 
@@ -33,7 +35,11 @@ namespace PeterDB {
         out_fs.write(buffer, PAGE_SIZE);
         out_fs.flush();
         out_fs.close();
-        return 0;
+
+        // The inode may be reused from a removed file, its frames are stale
+        // Frames of a removed file are left alone since stale handles may still write to it
+        BufferPool::instance().discardFile(fileName);
+        return LogManager::instance().removeLog(fileName);
     }
 
     RC PagedFileManager::destroyFile(const std::string &fileName) {
@@ -44,7 +50,7 @@ namespace PeterDB {
         if(remove(fileName.c_str()) != 0) {
             return ERR_DELETE_FILE;
         }
-        return 0;
+        return LogManager::instance().removeLog(fileName);
     }
 
     RC PagedFileManager::openFile(const std::string &fileName, FileHandle &fileHandle) {
@@ -68,6 +74,24 @@ namespace PeterDB {
         return rc;
     }
 
+    void PagedFileManager::setStorageBackendType(StorageBackendType type) {
+        storageBackendType = type;
+    }
+
+    StorageBackendType PagedFileManager::getStorageBackendType() {
+        return storageBackendType;
+    }
+
+    StorageBackend* PagedFileManager::createStorageBackend() {
+        switch (storageBackendType) {
+            case StorageFstream:
+                return new FstreamStorageBackend();
+            case StorageFd:
+            default:
+                return new FdStorageBackend();
+        }
+    }
+
     bool PagedFileManager::isFileExists(std::string fileName) {
         struct stat stFileInfo{};
         return stat(fileName.c_str(), &stFileInfo) == 0;
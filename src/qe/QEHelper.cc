@@ -44,4 +44,11 @@ namespace PeterDB {
         }
         return false;
     }
+
+    bool QEHelper::isRIDLess(const RID& rid1, const RID& rid2) {
+        if(rid1.pageNum != rid2.pageNum) {
+            return rid1.pageNum < rid2.pageNum;
+        }
+        return rid1.slotNum < rid2.slotNum;
+    }
 }
\ No newline at end of file
@@ -1,6 +1,165 @@
 #include "src/include/qe.h"
 
 namespace PeterDB {
+    IndexOnlyScan::IndexOnlyScan(RelationManager &rm, const std::string &tableName,
+                                 const std::vector<std::string> &keyAttrNames,
+                                 const std::vector<std::string> &attrNames, const char *alias) : rm(rm) {
+        this->tableName = tableName;
+        this->keyAttrNames = keyAttrNames;
+        this->attrNames = attrNames;
+
+        this->relName = alias ? alias : tableName;
+
+        setIterator(NULL, NULL, true, true);
+    }
+
+    IndexOnlyScan::~IndexOnlyScan() {
+        iter.close();
+    }
+
+    void IndexOnlyScan::setIterator(void *lowKey, void *highKey, bool lowKeyInclusive, bool highKeyInclusive) {
+        iter.close();
+        indexAttrs.clear();
+        // Only an index carrying every projected attribute can be used
+        RC ret = rm.indexScan(tableName, keyAttrNames, attrNames, lowKey, highKey, lowKeyInclusive, highKeyInclusive, iter);
+        if(ret) {
+            LOG(ERROR) << "No covering index on " << tableName << " @ IndexOnlyScan::setIterator" << std::endl;
+            return;
+        }
+        iter.getKeyAttributes(indexAttrs);
+        resolveProjection();
+    }
+
+    RC IndexOnlyScan::resolveProjection() {
+        projectedIndex.clear();
+        for(const std::string& attrName: attrNames) {
+            uint32_t i;
+            for(i = 0; i < indexAttrs.size(); i++) {
+                if(indexAttrs[i].name == attrName) {
+                    break;
+                }
+            }
+            if(i >= indexAttrs.size()) {
+                return ERR_ATTR_NOT_EXIST;
+            }
+            projectedIndex.push_back(i);
+        }
+        return 0;
+    }
+
+    RC IndexOnlyScan::getNextTuple(void *data) {
+        if(indexAttrs.empty()) {
+            return QE_EOF;
+        }
+        RC ret = iter.getNextEntry(rid, entry);
+        if(ret) return QE_EOF;
+
+        std::vector<int16_t> dict(indexAttrs.size());
+        ApiDataHelper::buildDict(entry, indexAttrs, dict);
+
+        int16_t nullByteLen = ceil(projectedIndex.size() / 8.0);
+        int16_t outputPos = nullByteLen;
+        bzero((uint8_t *)data, nullByteLen);
+        for(uint32_t i = 0; i < projectedIndex.size(); i++) {
+            uint32_t index = projectedIndex[i];
+            if(RecordHelper::isAttrNull(entry, index)) {
+                RecordHelper::setAttrNull((uint8_t *)data, i);
+                continue;
+            }
+            int16_t attrLen = ApiDataHelper::getAttrLen(entry, dict[index], indexAttrs[index]);
+            memcpy((uint8_t *)data + outputPos, entry + dict[index], attrLen);
+            outputPos += attrLen;
+        }
+        return 0;
+    }
+
+    RC IndexOnlyScan::getAttributes(std::vector<Attribute> &attrs) const {
+        attrs.clear();
+        for(uint32_t index: projectedIndex) {
+            attrs.push_back(indexAttrs[index]);
+            attrs.back().name = relName + "." + attrs.back().name;
+        }
+        return 0;
+    }
+
+    BitmapHeapScan::BitmapHeapScan(RelationManager &rm, const std::string &tableName, const char *alias) : rm(rm) {
+        this->tableName = tableName;
+        this->relName = alias ? alias : tableName;
+        rm.getAttributes(tableName, attrs);
+    }
+
+    BitmapHeapScan::~BitmapHeapScan() = default;
+
+    RC BitmapHeapScan::addIndexRange(const std::string &attrName, void *lowKey, void *highKey,
+                                     bool lowKeyInclusive, bool highKeyInclusive, BitmapOp op) {
+        RC ret = 0;
+        RM_IndexScanIterator iter;
+        ret = rm.indexScan(tableName, attrName, lowKey, highKey, lowKeyInclusive, highKeyInclusive, iter);
+        if(ret) return ret;
+        std::vector<RID> rangeRids;
+        RID rid;
+        uint8_t key[PAGE_SIZE];
+        while(iter.getNextEntry(rid, key) == 0) {
+            rangeRids.push_back(rid);
+        }
+        iter.close();
+        std::sort(rangeRids.begin(), rangeRids.end(), QEHelper::isRIDLess);
+        auto isSameRID = [](const RID& rid1, const RID& rid2) {
+            return rid1.pageNum == rid2.pageNum && rid1.slotNum == rid2.slotNum;
+        };
+        rangeRids.erase(std::unique(rangeRids.begin(), rangeRids.end(), isSameRID), rangeRids.end());
+
+        if(!hasRange) {
+            rids = std::move(rangeRids);
+            hasRange = true;
+        }
+        else {
+            std::vector<RID> combined;
+            if(op == BITMAP_AND) {
+                std::set_intersection(rids.begin(), rids.end(), rangeRids.begin(), rangeRids.end(),
+                                      std::back_inserter(combined), QEHelper::isRIDLess);
+            }
+            else {
+                std::set_union(rids.begin(), rids.end(), rangeRids.begin(), rangeRids.end(),
+                               std::back_inserter(combined), QEHelper::isRIDLess);
+            }
+            rids = std::move(combined);
+        }
+        nextRid = 0;
+        pageTuples.clear();
+        nextTuple = 0;
+        return 0;
+    }
+
+    RC BitmapHeapScan::getNextTuple(void *data) {
+        if(nextTuple >= pageTuples.size()) {
+            if(nextRid >= rids.size()) {
+                return QE_EOF;
+            }
+            // Fetch every tuple of the next heap page
+            uint32_t runEnd = nextRid;
+            while(runEnd < rids.size() && rids[runEnd].pageNum == rids[nextRid].pageNum) {
+                runEnd++;
+            }
+            std::vector<RID> pageRids(rids.begin() + nextRid, rids.begin() + runEnd);
+            nextRid = runEnd;
+            nextTuple = 0;
+            RC ret = rm.readTuples(tableName, pageRids, pageTuples);
+            if(ret) return QE_EOF;
+        }
+        memcpy(data, pageTuples[nextTuple].data(), pageTuples[nextTuple].size());
+        nextTuple++;
+        return 0;
+    }
+
+    RC BitmapHeapScan::getAttributes(std::vector<Attribute> &attrs) const {
+        attrs = this->attrs;
+        for(Attribute &attr: attrs) {
+            attr.name = relName + "." + attr.name;
+        }
+        return 0;
+    }
+
     Filter::Filter(Iterator *input, const Condition &condition) {
         this->iter = input;
         this->condtion = condition;
@@ -3,9 +3,13 @@
 namespace PeterDB {
     RBFM_ScanIterator::RBFM_ScanIterator() {
         conditionAttrValue = new uint8_t[4096];
+        curPageHandle = nullptr;
+        fileHandle = nullptr;
+        pageNum = 0;
     }
 
     RBFM_ScanIterator::~RBFM_ScanIterator() {
+        releaseCurPage();
         if(conditionAttrValue) {
             delete[] conditionAttrValue;
         }
@@ -14,7 +18,9 @@ namespace PeterDB {
     RC RBFM_ScanIterator::open(FileHandle &fileHandle, const std::vector<Attribute> &recordDescriptor,
                                const std::string &conditionAttribute, const CompOp compOp, const void *value,
                                const std::vector<std::string> &attributeNames) {
-        this->fileHandle = fileHandle;
+        releaseCurPage();   // In case not closed since last time
+        this->fileHandle = &fileHandle;
+        this->pageNum = fileHandle.getNumberOfPages();
         this->recordDesc = recordDescriptor;
 
         this->selectedAttrIndex.clear();    // In case not closed since last time
@@ -69,6 +75,8 @@ namespace PeterDB {
     }
 
     RC RBFM_ScanIterator::close() {
+        releaseCurPage();
+        fileHandle = nullptr;
         recordDesc.clear();
         selectedAttrIndex.clear();
         bzero(recordByteSeq, PAGE_SIZE);
@@ -77,16 +85,30 @@ namespace PeterDB {
 
     RC RBFM_ScanIterator::getNextRecord(RID &recordRid, void *data) {
         RC ret = 0;
-        if(curPageIndex >= fileHandle.getNumberOfPages()) {
+        if(!fileHandle || curPageIndex >= pageNum) {
             return RBFM_EOF;
         }
         // Try to find next record
         uint8_t attrData[PAGE_SIZE];
         int16_t attrLen;
-        while(curPageIndex < fileHandle.getNumberOfPages()) {
-            RecordPageHandle curPageHandle(fileHandle, curPageIndex);
-            ret = curPageHandle.getNextRecord(curSlotIndex, recordByteSeq, recordLen);
+        while(curPageIndex < pageNum) {
+            // Pin the page once and keep it until all of its slots are visited
+            if(curPageHandle) {
+                curPageHandle->refreshHeader();
+            }
+            else {
+                curPageHandle = new RecordPageHandle(*fileHandle, curPageIndex, PageReadOnly);
+                ret = curPageHandle->getPinStatus();
+                if(ret) {
+                    // The scan ends here, later calls return RBFM_EOF
+                    releaseCurPage();
+                    curPageIndex = pageNum;
+                    return ret;
+                }
+            }
+            ret = curPageHandle->getNextRecord(curSlotIndex, recordByteSeq, recordLen);
             if(ret) {
+                releaseCurPage();
                 curPageIndex++;     // No next record in current page, go to next page
                 curSlotIndex = 0;   // Reset slot index to 0, so that next round it will begin searching at 1
                 continue;
@@ -95,19 +117,19 @@ namespace PeterDB {
             if(compOp == NO_OP) {
                 break;      // No comparison
             }
-            else if(curPageHandle.isAttrNull(curSlotIndex, conditionAttrIndex)) {
+            else if(curPageHandle->isAttrNull(curSlotIndex, conditionAttrIndex)) {
                 continue;   // All comparison operations with NULL is FALSE
             }
             else {
                 // Get comparison attribute value and check if attribute meets condition
-                curPageHandle.getRecordAttr(curSlotIndex, conditionAttrIndex, attrData);
-                attrLen = curPageHandle.getAttrLen(curSlotIndex, conditionAttrIndex);
+                curPageHandle->getRecordAttr(curSlotIndex, conditionAttrIndex, attrData);
+                attrLen = curPageHandle->getAttrLen(curSlotIndex, conditionAttrIndex);
                 if (isRecordMeetCondition(attrData, attrLen)) {
                     break;
                 }
             }
         }
-        if(curPageIndex >= fileHandle.getNumberOfPages()) {
+        if(curPageIndex >= pageNum) {
             return RBFM_EOF;
         }
 
@@ -218,4 +240,8 @@ namespace PeterDB {
         return meetCondition;
     }
 
+    void RBFM_ScanIterator::releaseCurPage() {
+        delete curPageHandle;
+        curPageHandle = nullptr;
+    }
 }
@@ -1,14 +1,49 @@
 #include "src/include/rbfm.h"
 
 namespace PeterDB {
-    RecordPageHandle::RecordPageHandle(FileHandle& fileHandle, PageNum pageNum): fh(fileHandle), pageNum(pageNum) {
-        fileHandle.readPage(pageNum, data);
+    RecordPageHandle::RecordPageHandle(FileHandle& fileHandle, PageNum pageNum, PageAccessMode mode):
+        fh(fileHandle), pageNum(pageNum) {
+        isReadOnly = mode == PageReadOnly;
+        isDirty = false;
+        pinStatus = fileHandle.pinPage(pageNum, data);
+        isPinned = pinStatus == 0;
+        ownsData = !isPinned;
+        if(!isPinned) {
+            LOG(ERROR) << "Fail to pin page " << pageNum << " @ RecordPageHandle::RecordPageHandle" << std::endl;
+            data = new uint8_t[PAGE_SIZE]();
+        }
+        freeBytePointer = getFreeBytePointer();
+        slotCounter = getSlotCounter();
+    }
+
+    RecordPageHandle::RecordPageHandle(FileHandle& fileHandle, PageNum pageNum, uint8_t* pageData):
+        fh(fileHandle), pageNum(pageNum) {
+        isReadOnly = false;
+        isDirty = false;
+        pinStatus = 0;
+        isPinned = false;
+        ownsData = false;
+        data = pageData;
         freeBytePointer = getFreeBytePointer();
         slotCounter = getSlotCounter();
     }
 
     RecordPageHandle::~RecordPageHandle() {
-        fh.writePage(pageNum, data);
+        if(isPinned) {
+            fh.unpinPage(pageNum, isDirty);
+        }
+        if(ownsData) {
+            delete[] data;
+        }
+    }
+
+    RC RecordPageHandle::getPinStatus() {
+        return pinStatus;
+    }
+
+    void RecordPageHandle::refreshHeader() {
+        freeBytePointer = getFreeBytePointer();
+        slotCounter = getSlotCounter();
     }
 
     /*
@@ -89,7 +124,10 @@ namespace PeterDB {
      * Insert Record
      */
     RC RecordPageHandle::insertRecord(uint8_t byteSeq[], int16_t byteSeqLen, RID& rid) {
-        RC ret = 0;
+        if(isReadOnly) {
+            LOG(ERROR) << "Page is read-only @ RecordPageHandle::insertRecord" << std::endl;
+            return ERR_PAGE_READ_ONLY;
+        }
 
         // Get Slot Index while maintaining SlotCounter
         int16_t slotIndex = findAvailSlot();
@@ -97,6 +135,7 @@ namespace PeterDB {
         // Pad the data if necessary and append padded record data to the end
         uint16_t recordLen = std::max(byteSeqLen, RECORD_MIN_LEN);
         memcpy(data + freeBytePointer, byteSeq, byteSeqLen);
+        isDirty = true;
 
         // Fill in offset and length of record
         setRecordOffset(slotIndex, freeBytePointer);
@@ -106,12 +145,8 @@ namespace PeterDB {
         freeBytePointer += recordLen;
         setFreeBytePointer(freeBytePointer);
 
-        // Flush page
-        ret = fh.writePage(pageNum, data);
-        if(ret) {
-            LOG(ERROR) << "Fail to flush page data into file! @ RecordPageHandle::insertRecord" << std::endl;
-            return ret;
-        }
+        // Page is written back when the handle unpins it
+        fh.setPageFreeSpace(pageNum, getFreeSpace());
 
         rid.pageNum = this->pageNum;
         rid.slotNum = slotIndex;
@@ -124,6 +159,10 @@ namespace PeterDB {
      */
     RC RecordPageHandle::deleteRecord(const int16_t slotIndex) {
         RC ret = 0;
+        if(isReadOnly) {
+            LOG(ERROR) << "Page is read-only @ RecordPageHandle::deleteRecord" << std::endl;
+            return ERR_PAGE_READ_ONLY;
+        }
         if(slotIndex > slotCounter) {
             LOG(ERROR) << "Slot not exist! SlotIndex: " << slotIndex << ", SlotCounter: " << slotCounter << " @ RecordPageHandle::deleteRecord" << std::endl;
             return ERR_SLOT_NOT_EXIST_OR_DELETED;
@@ -148,12 +187,9 @@ namespace PeterDB {
         setRecordOffset(slotIndex, PAGE_EMPTY_SLOT_OFFSET);
         setRecordLen(slotIndex, PAGE_EMPTY_SLOT_LEN);
 
-        // Flush page to disk, actually OS handle it, may not flush to disk immediately
-        ret = fh.writePage(pageNum, data);
-        if(ret) {
-            LOG(ERROR) << "Fail to flush page data into file @ RecordPageHandle::deleteRecord" << std::endl;
-        }
-        return ret;
+        // Page is written back when the handle unpins it
+        fh.setPageFreeSpace(pageNum, getFreeSpace());
+        return 0;
     }
 
     bool RecordPageHandle::isRecordDeleted(int16_t slotIndex) {
@@ -165,7 +201,10 @@ namespace PeterDB {
      * Update Record
      */
     RC RecordPageHandle::updateRecord(int16_t slotIndex, uint8_t byteSeq[], int16_t recordLen) {
-        RC ret = 0;
+        if(isReadOnly) {
+            LOG(ERROR) << "Page is read-only @ RecordPageHandle::updateRecord" << std::endl;
+            return ERR_PAGE_READ_ONLY;
+        }
         if(slotIndex > slotCounter || isRecordDeleted(slotIndex)) {
             LOG(ERROR) << "Slot not exist or deleted! SlotIndex: " << slotIndex << ", SlotCounter: " << slotCounter << " @ RecordPageHandle::deleteRecord" << std::endl;
             return ERR_SLOT_NOT_EXIST_OR_DELETED;
@@ -184,16 +223,13 @@ namespace PeterDB {
 
         // Write Record Data
         memcpy(data + recordOffset, byteSeq, recordLen);
+        isDirty = true;
 
         // Update Record Length in slot
         setRecordLen(slotIndex, recordLen);
 
-        // Flush page
-        ret = fh.writePage(pageNum, data);
-        if(ret) {
-            LOG(ERROR) << "Fail to flush page data into file! @ RecordPageHandle::updateRecord" << std::endl;
-            return ret;
-        }
+        // Page is written back when the handle unpins it
+        fh.setPageFreeSpace(pageNum, getFreeSpace());
         return 0;
     }
 
@@ -201,6 +237,10 @@ namespace PeterDB {
     // | Mask | Page Index | SlotIndex|
     // | 1 |   4   |  2  |
     RC RecordPageHandle::setRecordPointToNewRecord(int16_t curSlotIndex, const RID& newRecordPos) {
+        if(isReadOnly) {
+            LOG(ERROR) << "Page is read-only @ RecordPageHandle::setRecordPointToNewRecord" << std::endl;
+            return ERR_PAGE_READ_ONLY;
+        }
         int16_t recordOffset = getRecordOffset(curSlotIndex);
         int16_t oldRecordLen = getRecordLen(curSlotIndex);
         // Set record mask
@@ -209,6 +249,7 @@ namespace PeterDB {
         memcpy(data + recordOffset + RECORD_MASK_LEN, &newRecordPos.pageNum, PTRRECORD_PAGE_INDEX_LEN);
         // Write slot index
         memcpy(data + recordOffset + RECORD_MASK_LEN + PTRRECORD_PAGE_INDEX_LEN, &newRecordPos.slotNum, PTRRECORD_SLOT_INDEX_LEN);
+        isDirty = true;
 
         // Update Record Length
         int16_t newRecordLen = RECORD_MASK_LEN + PTRRECORD_PAGE_INDEX_LEN + PTRRECORD_SLOT_INDEX_LEN;
@@ -217,6 +258,7 @@ namespace PeterDB {
         // Shift records left
         int16_t dist = oldRecordLen - newRecordLen;
         shiftRecord(recordOffset + oldRecordLen, dist, true);
+        fh.setPageFreeSpace(pageNum, getFreeSpace());
 
         return 0;
     }
@@ -234,6 +276,7 @@ namespace PeterDB {
         }
 
         if(dataNeedMoveLen != 0) {
+            isDirty = true;
             // Must Use Memmove! Source and Destination May Overlap
             if(shiftLeft)
                 memmove(data + dataNeedShiftStartPos - dist, data + dataNeedShiftStartPos, dataNeedMoveLen);
@@ -308,6 +351,7 @@ namespace PeterDB {
     }
     void RecordPageHandle::setFreeBytePointer(int16_t ptr) {
         memcpy(data + getFreeBytePointerOffset(), &ptr, PAGE_FREEBYTE_PTR_LEN);
+        isDirty = true;
     }
 
     int16_t RecordPageHandle::getSlotCounterOffset() {
@@ -320,6 +364,7 @@ namespace PeterDB {
     }
     void RecordPageHandle::setSlotCounter(int16_t slotCounter) {
         memcpy(data + getSlotCounterOffset(), &slotCounter, PAGE_SLOTCOUNTER_LEN);
+        isDirty = true;
     }
 
     int16_t RecordPageHandle::getSlotOffset(int16_t slotIndex) {
@@ -333,6 +378,7 @@ namespace PeterDB {
     }
     void RecordPageHandle::setRecordOffset(int16_t slotIndex, int16_t recordOffset) {
         memcpy(data + getSlotOffset(slotIndex), &recordOffset, PAGE_SLOT_RECORD_PTR_LEN);
+        isDirty = true;
     }
 
     int16_t RecordPageHandle::getRecordLen(int16_t slotIndex) {
@@ -342,6 +388,7 @@ namespace PeterDB {
     }
     void RecordPageHandle::setRecordLen(int16_t slotIndex, int16_t recordLen) {
         memcpy(data + getSlotOffset(slotIndex) + PAGE_SLOT_RECORD_PTR_LEN, &recordLen, PAGE_SLOT_RECORD_LEN_LEN);
+        isDirty = true;
     }
 
     int8_t RecordPageHandle::getRecordMask(int16_t slotIndex) {
@@ -351,6 +398,7 @@ namespace PeterDB {
     }
     void RecordPageHandle::setRecordMask(int16_t slotIndex, int8_t mask) {
         memcpy(data + getRecordOffset(slotIndex), &mask, RECORD_MASK_LEN);
+        isDirty = true;
     }
 
     int8_t RecordPageHandle::getRecordVersion(int16_t slotIndex) {
@@ -360,6 +408,7 @@ namespace PeterDB {
     }
     void RecordPageHandle::setRecordVersion(int16_t slotIndex, int8_t recordVersion) {
         memcpy(data + getRecordOffset(slotIndex) + RECORD_MASK_LEN, &recordVersion, RECORD_VERSION_LEN);
+        isDirty = true;
     }
 
     int16_t RecordPageHandle::getRecordAttrNum(int16_t slotIndex) {
@@ -369,6 +418,7 @@ namespace PeterDB {
     }
     void RecordPageHandle::setRecordAttrNum(int16_t slotIndex, int16_t attrNum) {
         memcpy(data + getRecordOffset(slotIndex) + RECORD_MASK_LEN + RECORD_VERSION_LEN, &attrNum, RECORD_ATTRNUM_LEN);
+        isDirty = true;
     }
 
     bool RecordPageHandle::isRecordPointer(int16_t slotNum) {
@@ -64,6 +64,8 @@ namespace PeterDB {
 
         // 3. Insert Record via Record Page Handle
         RecordPageHandle recordPageHandle(fileHandle, pageIndex);
+        ret = recordPageHandle.getPinStatus();
+        if(ret) return ret;
         ret = recordPageHandle.insertRecord(byteSeq, recordLen, rid);
         if(ret) {
             LOG(ERROR) << "Fail to insert record's byte sequence via RecordPageHandle @ RecordBasedFileManager::insertRecord" << std::endl;
@@ -72,6 +74,83 @@ namespace PeterDB {
         return 0;
     }
 
+    RC RecordBasedFileManager::insertRecords(FileHandle &fileHandle, const std::vector<Attribute> &recordDescriptor,
+                                             const std::vector<const void *> &records, std::vector<RID> &rids) {
+        return insertRecords(fileHandle, recordDescriptor, records, RECORD_VERSION_INITIAL, rids);
+    }
+
+    RC RecordBasedFileManager::insertRecords(FileHandle &fileHandle, const std::vector<Attribute> &recordDescriptor,
+                                             const std::vector<const void *> &records, const int8_t version,
+                                             std::vector<RID> &rids) {
+        RC ret = 0;
+        if(!fileHandle.isOpen()) {
+            LOG(ERROR) << "FileHandle NOT bound to a file! @ RecordBasedFileManager::insertRecords" << std::endl;
+            return ERR_FILE_NOT_OPEN;
+        }
+
+        rids.clear();
+        rids.reserve(records.size());
+        std::vector<uint8_t> pages((size_t)INSERT_BATCH_PAGE_NUM * PAGE_SIZE);
+        std::vector<int16_t> batchFreeSpace(INSERT_BATCH_PAGE_NUM);
+        uint32_t pagesInBatch = 0;
+        uint32_t batchFirstRecord = 0;      // Records before it are on disk
+        uint8_t byteSeq[PAGE_SIZE] = {};
+        int16_t recordLen = 0;
+        RID rid;
+
+        for(uint32_t i = 0; i < records.size(); i++) {
+            // 1. Transform Record to Byte Sequence
+            ret = RecordHelper::APIFormatToRecordByteSeq(version, (uint8_t *)records[i], recordDescriptor, byteSeq, recordLen);
+            if(ret) {
+                LOG(ERROR) << "Fail to Transform Record " << i << " to Byte Seq @ RecordBasedFileManager::insertRecords" << std::endl;
+                break;
+            }
+
+            // 2. Pack it into the first page of the batch with enough space, start a new page if none fits
+            uint32_t batchPageIndex;
+            for(batchPageIndex = 0; batchPageIndex < pagesInBatch; batchPageIndex++) {
+                if(batchFreeSpace[batchPageIndex] >= recordLen + PAGE_SLOT_LEN) {
+                    break;
+                }
+            }
+            if(batchPageIndex == pagesInBatch) {
+                if(pagesInBatch == INSERT_BATCH_PAGE_NUM) {
+                    ret = appendBatchPages(fileHandle, pages.data(), pagesInBatch);
+                    if(ret) {
+                        rids.resize(batchFirstRecord);
+                        return ret;
+                    }
+                    pagesInBatch = 0;
+                    batchFirstRecord = i;
+                }
+                batchPageIndex = pagesInBatch++;
+                bzero(pages.data() + (size_t)batchPageIndex * PAGE_SIZE, PAGE_SIZE);
+            }
+            RecordPageHandle pageHandle(fileHandle, fileHandle.getNumberOfPages() + batchPageIndex,
+                                        pages.data() + (size_t)batchPageIndex * PAGE_SIZE);
+            if(!pageHandle.hasEnoughSpaceForRecord(recordLen)) {
+                LOG(ERROR) << "Record " << i << " does not fit in a page @ RecordBasedFileManager::insertRecords" << std::endl;
+                ret = ERR_RECORD_TOO_LARGE;
+                break;
+            }
+            ret = pageHandle.insertRecord(byteSeq, recordLen, rid);
+            if(ret) {
+                LOG(ERROR) << "Fail to insert Record " << i << " @ RecordBasedFileManager::insertRecords" << std::endl;
+                break;
+            }
+            batchFreeSpace[batchPageIndex] = pageHandle.getFreeSpace();
+            rids.push_back(rid);
+        }
+
+        // 3. Append the rest of the batch, records before a failing one stay inserted
+        RC appendRet = appendBatchPages(fileHandle, pages.data(), pagesInBatch);
+        if(appendRet) {
+            rids.resize(batchFirstRecord);
+            return appendRet;
+        }
+        return ret;
+    }
+
     RC RecordBasedFileManager::readRecord(FileHandle &fileHandle, const std::vector<Attribute> &recordDescriptor,
                                           const RID &rid, void *data) {
         return readRecord(fileHandle, recordDescriptor, recordDescriptor, rid, data);
@@ -93,7 +172,10 @@ namespace PeterDB {
         int curPageIndex = rid.pageNum;
         int16_t curSlotIndex = rid.slotNum;
         while(curPageIndex < fileHandle.getNumberOfPages()) {
-            RecordPageHandle curPageHandle(fileHandle, curPageIndex);
+            RecordPageHandle curPageHandle(fileHandle, curPageIndex, PageReadOnly);
+            if(curPageHandle.getPinStatus()) {
+                return curPageHandle.getPinStatus();
+            }
             if(!curPageHandle.isRecordReadable(curSlotIndex)) {
                 return ERR_SLOT_NOT_EXIST_OR_DELETED;
             }
@@ -109,7 +191,9 @@ namespace PeterDB {
         }
 
         // 2. Read Record Byte Seq
-        RecordPageHandle pageHandle(fileHandle, curPageIndex);
+        RecordPageHandle pageHandle(fileHandle, curPageIndex, PageReadOnly);
+        ret = pageHandle.getPinStatus();
+        if(ret) return ret;
         uint8_t byteSeq[PAGE_SIZE] = {};
         int16_t recordLen = 0;
 
@@ -138,52 +222,101 @@ namespace PeterDB {
         return 0;
     }
 
+    RC RecordBasedFileManager::readRecordsOnPage(FileHandle &fileHandle, const std::vector<Attribute> &recordDescriptor,
+                                                 PageNum pageNum, const std::vector<uint16_t> &slots, int8_t version,
+                                                 std::vector<std::vector<uint8_t>> &data) {
+        RC ret = 0;
+        if(!fileHandle.isOpen()) {
+            LOG(ERROR) << "FileHandle NOT bound to a file! @ RecordBasedFileManager::readRecordsOnPage" << std::endl;
+            return ERR_FILE_NOT_OPEN;
+        }
+        if(pageNum >= fileHandle.getNumberOfPages()) {
+            return ERR_PAGE_NOT_EXIST;
+        }
+        data.assign(slots.size(), std::vector<uint8_t>());
+
+        std::vector<uint32_t> selectedAttrIndex;
+        for(uint32_t i = 0; i < recordDescriptor.size(); i++) {
+            selectedAttrIndex.push_back(i);
+        }
+        uint8_t byteSeq[PAGE_SIZE] = {};
+        uint8_t apiData[PAGE_SIZE] = {};
+        int16_t recordLen = 0;
+        RecordPageHandle pageHandle(fileHandle, pageNum, PageReadOnly);
+        ret = pageHandle.getPinStatus();
+        if(ret) return ret;
+        for(uint32_t i = 0; i < slots.size(); i++) {
+            if(!pageHandle.isRecordReadable(slots[i])) {
+                return ERR_SLOT_NOT_EXIST_OR_DELETED;
+            }
+            if(pageHandle.isRecordPointer(slots[i])) {
+                // The record was moved to another page
+                RID rid{pageNum, slots[i]};
+                int8_t recordVersion;
+                ret = readRecordVersion(fileHandle, rid, recordVersion);
+                if(ret) return ret;
+                if(recordVersion != version) {
+                    continue;
+                }
+                ret = readRecord(fileHandle, recordDescriptor, rid, apiData);
+                if(ret) return ret;
+            }
+            else {
+                if(pageHandle.getRecordVersion(slots[i]) != version) {
+                    continue;
+                }
+                ret = pageHandle.getRecordByteSeq(slots[i], byteSeq, recordLen);
+                if(ret) return ret;
+                ret = RecordHelper::recordByteSeqToAPIFormat(byteSeq, recordDescriptor, selectedAttrIndex, apiData);
+                if(ret) return ret;
+            }
+            data[i].assign(apiData, apiData + ApiDataHelper::getDataLen(apiData, recordDescriptor));
+        }
+        return 0;
+    }
+
     RC RecordBasedFileManager::transformSchema(const std::vector<Attribute>& originSche, uint8_t* originData,
                                                const std::vector<Attribute>& newSche, uint8_t* newData) {
-        RC ret = 0;
-        int16_t newDataNullByteLen = ceil(newSche.size() / 8.0);
-        bzero(newData, newDataNullByteLen);
-        int16_t originPos = ceil(originSche.size() / 8.0);
-        int16_t newPos = newDataNullByteLen;
+        SchemaTransformPlan plan;
+        RC ret = buildTransformPlan(originSche, newSche, plan);
+        if(ret) return ret;
+        return transformSchema(plan, originSche, originData, newSche, newData);
+    }
+
+    RC RecordBasedFileManager::buildTransformPlan(const std::vector<Attribute>& originSche, const std::vector<Attribute>& newSche,
+                                                  SchemaTransformPlan& plan) {
+        plan.originIndex.assign(newSche.size(), -1);
         for(int16_t i = 0; i < newSche.size(); i++) {
-            int16_t oldIndex;
-            for(oldIndex = 0; oldIndex < originSche.size(); oldIndex++) {
+            for(int16_t oldIndex = 0; oldIndex < originSche.size(); oldIndex++) {
                 if(originSche[oldIndex].name == newSche[i].name && originSche[oldIndex].type == newSche[i].type) {
+                    plan.originIndex[i] = oldIndex;
                     break;
                 }
             }
-            if(oldIndex >= originSche.size()) {
-                RecordHelper::setAttrNull(newData, i);
-                continue;
-            }
+        }
+        return 0;
+    }
 
-            if(RecordHelper::isAttrNull(originData, oldIndex)) {
+    RC RecordBasedFileManager::transformSchema(const SchemaTransformPlan& plan, const std::vector<Attribute>& originSche,
+                                               uint8_t* originData, const std::vector<Attribute>& newSche, uint8_t* newData) {
+        if(plan.originIndex.size() != newSche.size()) {
+            return ERR_IMPOSSIBLE;
+        }
+        std::vector<int16_t> dict(originSche.size());
+        ApiDataHelper::buildDict(originData, originSche, dict);
+
+        int16_t newDataNullByteLen = ceil(newSche.size() / 8.0);
+        bzero(newData, newDataNullByteLen);
+        int16_t newPos = newDataNullByteLen;
+        for(int16_t i = 0; i < newSche.size(); i++) {
+            int16_t oldIndex = plan.originIndex[i];
+            if(oldIndex < 0 || RecordHelper::isAttrNull(originData, oldIndex)) {
                 RecordHelper::setAttrNull(newData, i);
                 continue;
             }
-
-            switch (newSche[i].type) {
-                case TypeInt:
-                    memcpy(newData + newPos, originData + originPos, sizeof(int32_t));
-                    originPos += sizeof(int32_t);
-                    newPos += sizeof(int32_t);
-                    break;
-                case TypeReal:
-                    memcpy(newData + newPos, originData + originPos, sizeof(float));
-                    originPos += sizeof(float);
-                    newPos += sizeof(float);
-                    break;
-                case TypeVarChar:
-                    int32_t strLen;
-                    memcpy(&strLen, originData + originPos, sizeof(int32_t));
-                    memcpy(newData + newPos, originData + originPos, sizeof(int32_t));
-                    originPos += sizeof(int32_t);
-                    newPos += sizeof(int32_t);
-                    memcpy(newData + newPos, originData + originPos, strLen);
-                    originPos += strLen;
-                    newPos += strLen;
-                    break;
-            }
+            int16_t attrLen = ApiDataHelper::getAttrLen(originData, dict[oldIndex], originSche[oldIndex]);
+            memcpy(newData + newPos, originData + dict[oldIndex], attrLen);
+            newPos += attrLen;
         }
         return 0;
     }
@@ -200,7 +333,10 @@ namespace PeterDB {
         int curPageIndex = rid.pageNum;
         int16_t curSlotIndex = rid.slotNum;
         while(curPageIndex < fileHandle.getNumberOfPages()) {
-            RecordPageHandle curPageHandle(fileHandle, curPageIndex);
+            RecordPageHandle curPageHandle(fileHandle, curPageIndex, PageReadOnly);
+            if(curPageHandle.getPinStatus()) {
+                return curPageHandle.getPinStatus();
+            }
             if(!curPageHandle.isRecordReadable(curSlotIndex)) {
                 return ERR_SLOT_NOT_EXIST_OR_DELETED;
             }
@@ -215,7 +351,10 @@ namespace PeterDB {
         }
 
         // 2. Read Record Version
-        RecordPageHandle pageHandle(fileHandle, curPageIndex);
+        RecordPageHandle pageHandle(fileHandle, curPageIndex, PageReadOnly);
+        if(pageHandle.getPinStatus()) {
+            return pageHandle.getPinStatus();
+        }
         version = pageHandle.getRecordVersion(curSlotIndex);
         return 0;
     }
@@ -237,6 +376,8 @@ namespace PeterDB {
         int16_t curSlot = rid.slotNum;
         while(curPage < fileHandle.getNumberOfPages()) {
             RecordPageHandle curPageHandle(fileHandle, curPage);
+            ret = curPageHandle.getPinStatus();
+            if(ret) return ret;
             // Break the loop when real record is found
             if(!curPageHandle.isRecordReadable(curSlot)) {
                 return ERR_SLOT_NOT_EXIST_OR_DELETED;
@@ -256,6 +397,8 @@ namespace PeterDB {
 
         // 2. Delete the real record
         RecordPageHandle pageContainTargetRecord(fileHandle, curPage);
+        ret = pageContainTargetRecord.getPinStatus();
+        if(ret) return ret;
         ret = pageContainTargetRecord.deleteRecord(curSlot);
 
         if(ret) {
@@ -335,7 +478,10 @@ namespace PeterDB {
         int32_t curPageIndex = rid.pageNum;
         int16_t curSlotIndex = rid.slotNum;
         while(curPageIndex < fileHandle.getNumberOfPages()) {
-            RecordPageHandle curPageHandle(fileHandle, curPageIndex);
+            RecordPageHandle curPageHandle(fileHandle, curPageIndex, PageReadOnly);
+            if(curPageHandle.getPinStatus()) {
+                return curPageHandle.getPinStatus();
+            }
             if(!curPageHandle.isRecordReadable(curSlotIndex)) {
                 return ERR_SLOT_NOT_EXIST_OR_DELETED;
             }
@@ -368,6 +514,8 @@ namespace PeterDB {
         // Case 3: new byte seq is longer, no enough space in cur page -> insert record in a new page && update old record to a pointer
         PageNum pageToStore;
         RecordPageHandle curPageHandle(fileHandle, curPageIndex);
+        ret = curPageHandle.getPinStatus();
+        if(ret) return ret;
         int16_t oldRecordOffset = curPageHandle.getRecordOffset(curSlotIndex);
         int16_t oldRecordLen = curPageHandle.getRecordLen(curSlotIndex);
 
@@ -389,6 +537,8 @@ namespace PeterDB {
                 return ret;
             }
             RecordPageHandle newPageHandle(fileHandle, pageToStore);
+            ret = newPageHandle.getPinStatus();
+            if(ret) return ret;
             RID newRecordRID;
             ret = newPageHandle.insertRecord(byteSeq, recordLen, newRecordRID);
             if(ret) {
@@ -425,7 +575,9 @@ namespace PeterDB {
             return 3;
         }
 
-        RecordPageHandle pageHandle(fileHandle, rid.pageNum);
+        RecordPageHandle pageHandle(fileHandle, rid.pageNum, PageReadOnly);
+        ret = pageHandle.getPinStatus();
+        if(ret) return ret;
         uint8_t recordByteSeq[PAGE_SIZE];
         int16_t recordLen;
         ret = pageHandle.getRecordByteSeq(rid.slotNum, recordByteSeq, recordLen);
@@ -452,28 +604,50 @@ namespace PeterDB {
     }
 
     // Page Organizer Functions
+    // Candidates come from the free space map of the file handle, only candidates are read
+    // Unknown entries are filled a few per call, so a reopened large file is not read all at once
     RC RecordBasedFileManager::findAvailPage(FileHandle& fileHandle, int16_t recordLen, PageNum& availPageIndex) {
         RC ret = 0;
         uint8_t buffer[PAGE_SIZE] = {};
         unsigned pageCount = fileHandle.getNumberOfPages();
+        uint16_t spaceNeeded = recordLen + PAGE_SLOT_LEN;
 
         if(pageCount > 0) {
-            // Try to insert into the lastest page
-            RecordPageHandle lastPage(fileHandle, pageCount - 1);
-            if (lastPage.hasEnoughSpaceForRecord(recordLen)) {
-                availPageIndex = pageCount - 1;
-                return 0;
-            }
-
-            // Traverse all pages to find an available page
-            for (PageNum i = 0; i < pageCount - 1; i++) {
-                RecordPageHandle page(fileHandle, i);
-                // Find an available page
-                if (page.hasEnoughSpaceForRecord(recordLen)) {
-                    availPageIndex = i;
+            // Try to insert into the lastest page, it is likely to be cached
+            // Buckets round free space down, so probe it whenever the record may still fit
+            PageNum lastPageIndex = pageCount - 1;
+            if(!fileHandle.isPageFreeSpaceKnown(lastPageIndex) ||
+               fileHandle.getPageFreeSpace(lastPageIndex) + PFM::FSM_BUCKET_BYTES > spaceNeeded) {
+                RecordPageHandle lastPage(fileHandle, lastPageIndex, PageReadOnly);
+                ret = lastPage.getPinStatus();
+                if(ret) return ret;
+                fileHandle.setPageFreeSpace(lastPageIndex, lastPage.getFreeSpace());
+                if (lastPage.hasEnoughSpaceForRecord(recordLen)) {
+                    availPageIndex = lastPageIndex;
                     return 0;
                 }
             }
+
+            // Map entries may be unknown or stale, verify the candidate and correct its entry
+            PageNum candidate = 0;
+            uint32_t unknownProbeNum = 0;
+            while(fileHandle.findPageWithFreeSpace(spaceNeeded, candidate, candidate) == 0) {
+                if(!fileHandle.isPageFreeSpaceKnown(candidate) && unknownProbeNum++ >= PFM::FSM_UNKNOWN_PROBE_MAX) {
+                    candidate++;
+                    continue;
+                }
+                if(candidate != lastPageIndex) {
+                    RecordPageHandle page(fileHandle, candidate, PageReadOnly);
+                    ret = page.getPinStatus();
+                    if(ret) return ret;
+                    fileHandle.setPageFreeSpace(candidate, page.getFreeSpace());
+                    if (page.hasEnoughSpaceForRecord(recordLen)) {
+                        availPageIndex = candidate;
+                        return 0;
+                    }
+                }
+                candidate++;
+            }
         }
 
         // No available page. Append a new page
@@ -483,6 +657,21 @@ namespace PeterDB {
             return ret;
         }
         availPageIndex = fileHandle.getNumberOfPages() - 1;
+        fileHandle.setPageFreeSpace(availPageIndex, PAGE_SIZE - PAGE_HEADER_LEN);
+        return 0;
+    }
+
+    RC RecordBasedFileManager::appendBatchPages(FileHandle& fileHandle, uint8_t* pages, uint32_t pageCount) {
+        PageNum firstPageIndex = fileHandle.getNumberOfPages();
+        RC ret = fileHandle.appendPages(pages, pageCount);
+        if(ret) {
+            LOG(ERROR) << "Fail to append pages @ RecordBasedFileManager::appendBatchPages" << std::endl;
+            return ret;
+        }
+        for(uint32_t i = 0; i < pageCount; i++) {
+            RecordPageHandle pageHandle(fileHandle, firstPageIndex + i, pages + (size_t)i * PAGE_SIZE);
+            fileHandle.setPageFreeSpace(firstPageIndex + i, pageHandle.getFreeSpace());
+        }
         return 0;
     }
 
@@ -0,0 +1,169 @@
+#include "src/include/rm.h"
+
+namespace PeterDB {
+    FileHandleCache::FileHandleCache(uint32_t capacity) {
+        this->capacity = capacity ? capacity : 1;
+        nextOpenSeq = 1;
+        hitCounter = 0;
+        missCounter = 0;
+        openCounter = 0;
+    }
+
+    // Handles left open are released by their destructors, the buffer pool may already be gone
+    FileHandleCache::~FileHandleCache() = default;
+
+    RC FileHandleCache::getFileHandle(const std::string& fileName, FileHandle*& fileHandle) {
+        CachedFile* file;
+        RC ret = lookup(fileName, false, file);
+        if(ret) return ret;
+        fileHandle = file->fileHandle.get();
+        return 0;
+    }
+
+    RC FileHandleCache::getIXFileHandle(const std::string& fileName, IXFileHandle*& ixFileHandle) {
+        CachedFile* file;
+        RC ret = lookup(fileName, true, file);
+        if(ret) return ret;
+        ixFileHandle = file->ixFileHandle.get();
+        return 0;
+    }
+
+    RC FileHandleCache::lookup(const std::string& fileName, bool isIndex, CachedFile*& file) {
+        auto fileIter = files.find(fileName);
+        if(fileIter != files.end()) {
+            file = &fileIter->second;
+            if(isIndex != (bool)file->ixFileHandle) {
+                return ERR_IMPOSSIBLE;
+            }
+            hitCounter++;
+            lruList.splice(lruList.begin(), lruList, file->lruPos);
+            return 0;
+        }
+
+        missCounter++;
+        CachedFile newFile;
+        RC ret = 0;
+        if(isIndex) {
+            newFile.ixFileHandle.reset(new IXFileHandle);
+            ret = IndexManager::instance().openFile(fileName, *newFile.ixFileHandle);
+        }
+        else {
+            newFile.fileHandle.reset(new FileHandle);
+            ret = RecordBasedFileManager::instance().openFile(fileName, *newFile.fileHandle);
+        }
+        if(ret) return ret;
+        openCounter++;
+
+        evict(capacity - 1);
+        newFile.openSeq = nextOpenSeq++;
+        lruList.push_front(fileName);
+        newFile.lruPos = lruList.begin();
+        file = &(files[fileName] = std::move(newFile));
+        return 0;
+    }
+
+    // Close unpinned files from the least recently used end until at most maxFileNum are open
+    void FileHandleCache::evict(uint32_t maxFileNum) {
+        auto lruIter = lruList.end();
+        while(files.size() > maxFileNum && lruIter != lruList.begin()) {
+            lruIter--;
+            auto fileIter = files.find(*lruIter);
+            if(fileIter->second.pinCount) {
+                continue;
+            }
+            close(fileIter->second);
+            lruIter = lruList.erase(lruIter);
+            files.erase(fileIter);
+        }
+    }
+
+    void FileHandleCache::close(CachedFile& file) {
+        if(file.fileHandle) {
+            file.fileHandle->close();
+        }
+        if(file.ixFileHandle) {
+            file.ixFileHandle->close();
+        }
+    }
+
+    RC FileHandleCache::pin(const std::string& fileName, uint64_t& openSeq) {
+        auto fileIter = files.find(fileName);
+        if(fileIter == files.end()) {
+            return ERR_FILE_NOT_CACHED;
+        }
+        fileIter->second.pinCount++;
+        openSeq = fileIter->second.openSeq;
+        return 0;
+    }
+
+    void FileHandleCache::unpin(const std::string& fileName, uint64_t openSeq) {
+        auto closingIter = closingFiles.find(openSeq);
+        if(closingIter != closingFiles.end()) {
+            if(--closingIter->second.pinCount == 0) {
+                close(closingIter->second);
+                closingFiles.erase(closingIter);
+            }
+            return;
+        }
+        auto fileIter = files.find(fileName);
+        if(fileIter == files.end() || fileIter->second.openSeq != openSeq || fileIter->second.pinCount == 0) {
+            return;
+        }
+        fileIter->second.pinCount--;
+        // Files kept open beyond the capacity by pins are closed once released
+        // The most recently used file stays next to the pinned ones, so one used alongside a long scan is not reopened every call
+        uint32_t pinnedFileNum = 0;
+        for(auto& file: files) {
+            if(file.second.pinCount) {
+                pinnedFileNum++;
+            }
+        }
+        evict(std::max(capacity, pinnedFileNum + 1));
+    }
+
+    void FileHandleCache::closeFile(const std::string& fileName) {
+        auto fileIter = files.find(fileName);
+        if(fileIter == files.end()) {
+            return;
+        }
+        lruList.erase(fileIter->second.lruPos);
+        // Scans still hold the handle, it keeps reading the removed file until they are done
+        if(fileIter->second.pinCount) {
+            uint64_t openSeq = fileIter->second.openSeq;
+            closingFiles[openSeq] = std::move(fileIter->second);
+        }
+        else {
+            close(fileIter->second);
+        }
+        files.erase(fileIter);
+    }
+
+    void FileHandleCache::closeAll() {
+        while(!lruList.empty()) {
+            closeFile(lruList.front());
+        }
+    }
+
+    RC FileHandleCache::setCapacity(uint32_t capacity) {
+        if(capacity == 0) {
+            return ERR_CACHE_SIZE_INVALID;
+        }
+        this->capacity = capacity;
+        evict(capacity);
+        return 0;
+    }
+
+    uint32_t FileHandleCache::getCapacity() {
+        return capacity;
+    }
+
+    uint32_t FileHandleCache::getOpenFileNum() {
+        return files.size();
+    }
+
+    void FileHandleCache::collectCounterValues(uint32_t &hitCount, uint32_t &missCount, uint32_t &openCount) {
+        hitCount = hitCounter;
+        missCount = missCounter;
+        openCount = openCounter;
+    }
+}
@@ -5,27 +5,135 @@ using namespace PeterDB::RM;
 namespace PeterDB {
     RM_IndexScanIterator::RM_IndexScanIterator() = default;
 
-    RM_IndexScanIterator::~RM_IndexScanIterator() = default;
+    RM_IndexScanIterator::~RM_IndexScanIterator() {
+        close();
+    }
 
     RC RM_IndexScanIterator::getNextEntry(RID &rid, void *key) {
-        RC ret = ixIter.getNextEntry(rid, key);
+        if(keyAttrs.empty()) {
+            RC ret = ixIter.getNextEntry(rid, key);
+            if(ret) {
+                return RM_EOF;
+            }
+            return 0;
+        }
+        if(!isCompositeKey) {
+            // The raw value of a single attribute, behind its null indicator
+            ((uint8_t *)key)[0] = 0;
+            if(ixIter.getNextEntry(rid, (uint8_t *)key + 1)) {
+                return RM_EOF;
+            }
+            return 0;
+        }
+        uint8_t compositeKey[PAGE_SIZE];
+        RC ret = ixIter.getNextEntry(rid, compositeKey);
         if(ret) {
             return RM_EOF;
         }
-        return 0;
+        return CompositeKeyHelper::decode(compositeKey, keyAttrs, (uint8_t *)key);
     }
 
-    RC RM_IndexScanIterator::open(IXFileHandle* ixFileHandle, const Attribute& attr,
+    RC RM_IndexScanIterator::open(FileHandleCache& fileHandleCache, const std::string& fileName, const Attribute& attr,
             const uint8_t* lowKey, const uint8_t* highKey,
             bool lowKeyInclusive, bool highKeyInclusive) {
         RC ret = 0;
+        IXFileHandle* ixFileHandle;
+        ret = pinIndexFile(fileHandleCache, fileName, ixFileHandle);
+        if(ret) return ret;
+        keyAttrs.clear();
+        isCompositeKey = false;
         ret = ixIter.open(ixFileHandle, attr, lowKey, highKey, lowKeyInclusive, highKeyInclusive);
         if(ret) return ret;
         return 0;
     }
 
+    RC RM_IndexScanIterator::open(FileHandleCache& fileHandleCache, const std::string& fileName,
+            const std::vector<Attribute>& keyAttrs, uint32_t prefixLen,
+            const uint8_t* lowKey, const uint8_t* highKey,
+            bool lowKeyInclusive, bool highKeyInclusive) {
+        RC ret = 0;
+        if(prefixLen == 0 || prefixLen > keyAttrs.size()) {
+            return ERR_ATTR_NOT_EXIST;
+        }
+        IXFileHandle* ixFileHandle;
+        if(keyAttrs.size() == 1) {
+            // Keys of a single attribute index are raw values, null values are never indexed
+            if(lowKey && RecordHelper::isAttrNull((uint8_t *)lowKey, 0)) return ERR_KEY_NOT_EXIST;
+            if(highKey && RecordHelper::isAttrNull((uint8_t *)highKey, 0)) return ERR_KEY_NOT_EXIST;
+            ret = pinIndexFile(fileHandleCache, fileName, ixFileHandle);
+            if(ret) return ret;
+            this->keyAttrs = keyAttrs;
+            isCompositeKey = false;
+            return ixIter.open(ixFileHandle, keyAttrs[0], lowKey ? lowKey + 1 : nullptr, highKey ? highKey + 1 : nullptr,
+                               lowKeyInclusive, highKeyInclusive);
+        }
+        ret = pinIndexFile(fileHandleCache, fileName, ixFileHandle);
+        if(ret) return ret;
+        this->keyAttrs = keyAttrs;
+        isCompositeKey = true;
+        std::vector<Attribute> prefixAttrs(keyAttrs.begin(), keyAttrs.begin() + prefixLen);
+        std::vector<uint32_t> prefixAttrIndex;
+        for(uint32_t i = 0; i < prefixLen; i++) {
+            prefixAttrIndex.push_back(i);
+        }
+
+        // Every key starting with an encoded prefix sorts after the prefix itself and before
+        // the prefix followed by COMPKEY_PREFIX_END, since no attribute encoding starts with it.
+        auto encodeBound = [&](const uint8_t* bound, bool appendPrefixEnd, std::vector<uint8_t>& keyData) -> RC {
+            keyData.assign(PAGE_SIZE, 0);
+            RC ret = CompositeKeyHelper::encode(bound, prefixAttrs, prefixAttrIndex, keyData.data());
+            if(ret) return ret;
+            if(appendPrefixEnd) {
+                int32_t keyLen;
+                memcpy(&keyLen, keyData.data(), sizeof(int32_t));
+                keyData[sizeof(int32_t) + keyLen] = IX::COMPKEY_PREFIX_END;
+                keyLen++;
+                memcpy(keyData.data(), &keyLen, sizeof(int32_t));
+            }
+            return 0;
+        };
+        const uint8_t* low = nullptr;
+        const uint8_t* high = nullptr;
+        if(lowKey) {
+            ret = encodeBound(lowKey, !lowKeyInclusive, lowKeyData);
+            if(ret) return ret;
+            low = lowKeyData.data();
+            lowKeyInclusive = true;
+        }
+        if(highKey) {
+            ret = encodeBound(highKey, highKeyInclusive, highKeyData);
+            if(ret) return ret;
+            high = highKeyData.data();
+            highKeyInclusive = false;
+        }
+        Attribute keyAttr = CompositeKeyHelper::getKeyAttribute("", keyAttrs);
+        return ixIter.open(ixFileHandle, keyAttr, low, high, lowKeyInclusive, highKeyInclusive);
+    }
+
     RC RM_IndexScanIterator::close() {
-        return ixIter.close();
+        ixIter.close();
+        if(fileHandleCache) {
+            fileHandleCache->unpin(fileName, openSeq);
+            fileHandleCache = nullptr;
+        }
+        return 0;
+    }
+
+    RC RM_IndexScanIterator::pinIndexFile(FileHandleCache& fileHandleCache, const std::string& fileName,
+                                          IXFileHandle*& ixFileHandle) {
+        close();    // In case not closed since last time
+        RC ret = fileHandleCache.getIXFileHandle(fileName, ixFileHandle);
+        if(ret) return ret;
+        ret = fileHandleCache.pin(fileName, openSeq);
+        if(ret) return ret;
+        this->fileHandleCache = &fileHandleCache;
+        this->fileName = fileName;
+        return 0;
+    }
+
+    RC RM_IndexScanIterator::getKeyAttributes(std::vector<Attribute> &attrs) const {
+        attrs = keyAttrs;
+        return 0;
     }
 }
 
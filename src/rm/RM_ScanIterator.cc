@@ -5,13 +5,25 @@ using namespace PeterDB::RM;
 namespace PeterDB {
     RM_ScanIterator::RM_ScanIterator() = default;
 
-    RM_ScanIterator::~RM_ScanIterator() = default;
+    RM_ScanIterator::~RM_ScanIterator() {
+        close();
+    }
 
-    RC RM_ScanIterator::open(FileHandle &fileHandle, const std::vector<Attribute> &recordDescriptor,
+    RC RM_ScanIterator::open(FileHandleCache &fileHandleCache, const std::string &fileName,
+            const std::vector<Attribute> &recordDescriptor,
             const std::string &conditionAttribute, const CompOp compOp, const void *value,
             const std::vector<std::string> &attributeNames) {
         RC ret;
-        ret = rbfmIter.open(fileHandle, recordDescriptor, conditionAttribute, compOp, value, attributeNames);
+        close();    // In case not closed since last time
+        FileHandle* fileHandle;
+        ret = fileHandleCache.getFileHandle(fileName, fileHandle);
+        if(ret) return ret;
+        ret = fileHandleCache.pin(fileName, openSeq);
+        if(ret) return ret;
+        this->fileHandleCache = &fileHandleCache;
+        this->fileName = fileName;
+
+        ret = rbfmIter.open(*fileHandle, recordDescriptor, conditionAttribute, compOp, value, attributeNames);
         if(ret) {
             LOG(ERROR) << "Fail to open RM scan iterator @ RM_ScanIterator::open" << std::endl;
             return ret;
@@ -29,6 +41,12 @@ namespace PeterDB {
     }
 
     RC RM_ScanIterator::close() {
-        return rbfmIter.close();
+        // The current page is released before the file may be closed by unpinning it
+        RC ret = rbfmIter.close();
+        if(fileHandleCache) {
+            fileHandleCache->unpin(fileName, openSeq);
+            fileHandleCache = nullptr;
+        }
+        return ret;
     }
 }
@@ -0,0 +1,230 @@
+#include "src/include/rm.h"
+
+using namespace PeterDB::RM;
+
+namespace PeterDB {
+    TableHandle::TableHandle() {
+        rm = nullptr;
+        isWritable = false;
+        catalogVersion = 0;
+        attrs = nullptr;
+        fileHandle = nullptr;
+        fileOpenSeq = 0;
+    }
+
+    TableHandle::~TableHandle() {
+        close();
+    }
+
+    RC TableHandle::resolve() {
+        RC ret = 0;
+        release();
+
+        // 1. Schema of every version and indexes, shared with the catalog cache
+        ret = rm->getCatalogCacheEntry(tableName, catalogEntry);
+        if(ret) return ret;
+        auto versionIter = catalogEntry->attrVersionMap.find(catalogEntry->tableRecord.tableVersion);
+        if(versionIter == catalogEntry->attrVersionMap.end() || versionIter->second.empty()) {
+            return ERR_GET_METADATA;
+        }
+        attrs = &versionIter->second;
+
+        // 2. Table file and index files stay open as long as the handle
+        FileHandleCache& fileHandleCache = rm->getFileHandleCache();
+        ret = fileHandleCache.getFileHandle(catalogEntry->tableRecord.fileName, fileHandle);
+        if(ret) return ret;
+        ret = fileHandleCache.pin(catalogEntry->tableRecord.fileName, fileOpenSeq);
+        if(ret) return ret;
+
+        ixFileHandles.reserve(catalogEntry->indexes.size());
+        ixOpenSeqs.reserve(catalogEntry->indexes.size());
+        for(const TableIndex& index: catalogEntry->indexes) {
+            IXFileHandle* ixFileHandle;
+            uint64_t openSeq;
+            ret = fileHandleCache.getIXFileHandle(index.fileName, ixFileHandle);
+            if(ret) return ret;
+            ret = fileHandleCache.pin(index.fileName, openSeq);
+            if(ret) return ret;
+            ixFileHandles.push_back(ixFileHandle);
+            ixOpenSeqs.push_back(openSeq);
+        }
+        catalogVersion = rm->getCatalogVersion();
+        return 0;
+    }
+
+    RC TableHandle::checkCatalogVersion() {
+        if(!rm) {
+            return ERR_FILE_NOT_OPEN;
+        }
+        // Resolving failed last time or the catalog changed since
+        if(fileHandle && rm->getCatalogVersion() == catalogVersion) {
+            return 0;
+        }
+        return resolve();
+    }
+
+    void TableHandle::release() {
+        if(!rm) {
+            return;
+        }
+        FileHandleCache& fileHandleCache = rm->getFileHandleCache();
+        if(fileHandle) {
+            fileHandleCache.unpin(catalogEntry->tableRecord.fileName, fileOpenSeq);
+            fileHandle = nullptr;
+        }
+        for(uint32_t i = 0; i < ixOpenSeqs.size(); i++) {
+            fileHandleCache.unpin(catalogEntry->indexes[i].fileName, ixOpenSeqs[i]);
+        }
+        ixFileHandles.clear();
+        ixOpenSeqs.clear();
+    }
+
+    RC TableHandle::close() {
+        release();
+        rm = nullptr;
+        attrs = nullptr;
+        catalogEntry.reset();
+        return 0;
+    }
+
+    bool TableHandle::isOpen() const {
+        return rm != nullptr;
+    }
+
+    const std::string& TableHandle::getTableName() const {
+        return tableName;
+    }
+
+    const std::vector<Attribute>& TableHandle::getAttributes() const {
+        static const std::vector<Attribute> noAttrs;
+        return attrs ? *attrs : noAttrs;
+    }
+
+    RC TableHandle::updateIndexes(const uint8_t* data, const RID& rid, bool isInsert) {
+        const std::vector<TableIndex>& indexes = catalogEntry->indexes;
+        if(indexes.empty()) {
+            return 0;
+        }
+        std::vector<int16_t> dict(attrs->size());
+        ApiDataHelper::buildDict((uint8_t *)data, *attrs, dict);
+        for(uint32_t i = 0; i < indexes.size(); i++) {
+            RC ret = rm->updateIndex(*ixFileHandles[i], indexes[i], *attrs, data, dict, rid, isInsert);
+            if(ret) return ret;
+        }
+        return 0;
+    }
+
+    RC TableHandle::insertTuple(const void *data, RID &rid) {
+        RC ret = checkCatalogVersion();
+        if(ret) return ret;
+        if(!isWritable) {
+            return ERR_ACCESS_DENIED_SYS_TABLE;
+        }
+        RecordBasedFileManager& rbfm = RecordBasedFileManager::instance();
+        ret = rbfm.insertRecord(*fileHandle, *attrs, data, (int8_t)catalogEntry->tableRecord.tableVersion, rid);
+        if(ret) return ret;
+        return updateIndexes((const uint8_t *)data, rid, true);
+    }
+
+    RC TableHandle::insertTuples(const std::vector<const void *> &tuples, std::vector<RID> &rids) {
+        RC ret = checkCatalogVersion();
+        if(ret) return ret;
+        if(!isWritable) {
+            return ERR_ACCESS_DENIED_SYS_TABLE;
+        }
+        RecordBasedFileManager& rbfm = RecordBasedFileManager::instance();
+        RC insertRet = rbfm.insertRecords(*fileHandle, *attrs, tuples, (int8_t)catalogEntry->tableRecord.tableVersion, rids);
+        // Index entries go in after all tuples, sorted by key
+        // Tuples inserted before a failing one are indexed as well
+        const std::vector<TableIndex>& indexes = catalogEntry->indexes;
+        std::vector<const void *> insertedTuples(tuples.begin(), tuples.begin() + rids.size());
+        for(uint32_t i = 0; i < indexes.size(); i++) {
+            ret = rm->insertIndexEntries(*ixFileHandles[i], indexes[i], *attrs, insertedTuples, rids);
+            if(ret) return ret;
+        }
+        return insertRet;
+    }
+
+    RC TableHandle::deleteTuple(const RID &rid) {
+        RC ret = checkCatalogVersion();
+        if(ret) return ret;
+        if(!isWritable) {
+            return ERR_ACCESS_DENIED_SYS_TABLE;
+        }
+        RecordBasedFileManager& rbfm = RecordBasedFileManager::instance();
+        // The heap goes first, indexes are left alone if the tuple cannot be deleted
+        uint8_t data[PAGE_SIZE] = {};
+        if(!catalogEntry->indexes.empty()) {
+            ret = readTuple(rid, data);
+            if(ret) return ret;
+        }
+        ret = rbfm.deleteRecord(*fileHandle, *attrs, rid);
+        if(ret) return ret;
+        return updateIndexes(data, rid, false);
+    }
+
+    RC TableHandle::updateTuple(const void *data, const RID &rid) {
+        RC ret = checkCatalogVersion();
+        if(ret) return ret;
+        if(!isWritable) {
+            return ERR_ACCESS_DENIED_SYS_TABLE;
+        }
+        RecordBasedFileManager& rbfm = RecordBasedFileManager::instance();
+        // The heap goes first, indexes are left alone if the tuple cannot be updated
+        uint8_t oldData[PAGE_SIZE] = {};
+        if(!catalogEntry->indexes.empty()) {
+            ret = readTuple(rid, oldData);
+            if(ret) return ret;
+        }
+        ret = rbfm.updateRecord(*fileHandle, *attrs, data, rid);
+        if(ret) return ret;
+        ret = updateIndexes(oldData, rid, false);
+        if(ret) return ret;
+        return updateIndexes((const uint8_t *)data, rid, true);
+    }
+
+    RC TableHandle::readTuple(const RID &rid, void *data) {
+        RC ret = checkCatalogVersion();
+        if(ret) return ret;
+        RecordBasedFileManager& rbfm = RecordBasedFileManager::instance();
+        int8_t recordVersion;
+        ret = rbfm.readRecordVersion(*fileHandle, rid, recordVersion);
+        if(ret) return ret;
+        if(recordVersion == catalogEntry->tableRecord.tableVersion) {
+            return rbfm.readRecord(*fileHandle, *attrs, rid, data);
+        }
+
+        // Tuples of older versions are read with the attributes still present, then laid out as the current version
+        auto planIter = catalogEntry->transformPlans.find(recordVersion);
+        if(planIter == catalogEntry->transformPlans.end()) {
+            return ERR_VERSION_NOT_EXIST;
+        }
+        const std::vector<Attribute>& projAttrs = catalogEntry->projAttrVersionMap.at(recordVersion);
+        uint8_t apiData[PAGE_SIZE];
+        ret = rbfm.readRecord(*fileHandle, catalogEntry->attrVersionMap.at(recordVersion), projAttrs, rid, apiData);
+        if(ret) return ret;
+        return rbfm.transformSchema(planIter->second, projAttrs, apiData, *attrs, (uint8_t *)data);
+    }
+
+    RC TableHandle::scan(const std::string &conditionAttribute, const CompOp compOp, const void *value,
+                         const std::vector<std::string> &attributeNames, RM_ScanIterator &rm_ScanIterator) {
+        RC ret = checkCatalogVersion();
+        if(ret) return ret;
+        return rm_ScanIterator.open(rm->getFileHandleCache(), catalogEntry->tableRecord.fileName, *attrs,
+                                    conditionAttribute, compOp, value, attributeNames);
+    }
+
+    RC TableHandle::indexScan(const std::string &attrName, const void *lowKey, const void *highKey,
+                              bool lowKeyInclusive, bool highKeyInclusive, RM_IndexScanIterator &rm_IndexScanIterator) {
+        RC ret = checkCatalogVersion();
+        if(ret) return ret;
+        for(const TableIndex& index: catalogEntry->indexes) {
+            if(index.indexName == attrName) {
+                return rm_IndexScanIterator.open(rm->getFileHandleCache(), index.fileName, index.keyAttr,
+                                                 (const uint8_t *)lowKey, (const uint8_t *)highKey,
+                                                 lowKeyInclusive, highKeyInclusive);
+            }
+        }
+        return ERR_INDEX_NOT_EXIST;
+    }
+}
@@ -1,33 +1,22 @@
 #include "src/include/rm.h"
+#include <algorithm>
 
 using namespace PeterDB::RM;
 
 namespace PeterDB {
     RelationManager &RelationManager::instance() {
-        static RelationManager _relation_manager = RelationManager();
+        static RelationManager _relation_manager;
         return _relation_manager;
     }
 
     RelationManager::RelationManager() = default;
 
-    RelationManager::~RelationManager() {
-        for(auto& fh: ixScanFHList) {
-            delete fh;
-        }
-        for(auto& p: ixFHMap) {
-            delete p.second;
-        }
-        ixScanFHList.clear();
-        ixFHMap.clear();
-    }
-
-    RelationManager::RelationManager(const RelationManager &) = default;
-
-    RelationManager &RelationManager::operator=(const RelationManager &) = default;
+    RelationManager::~RelationManager() = default;
 
     RC RelationManager::createCatalog() {
         RC ret;
         RecordBasedFileManager& rbfm = RecordBasedFileManager::instance();
+        invalidateCatalogCache();
         ret = rbfm.createFile(catalogTablesName);
         if(ret) {
             LOG(ERROR) << "Fail to create TABLES catalog! @ RelationManager::createCatalog" << std::endl;
@@ -103,9 +92,11 @@ namespace PeterDB {
     RC RelationManager::deleteCatalog() {
         RC ret = 0;
         RecordBasedFileManager& rbfm = RecordBasedFileManager::instance();
+        invalidateCatalogCache();
         catalogTablesFH.close();
         catalogColumnsFH.close();
         catalogIndexesFH.close();
+        fileHandleCache.closeAll();
         ret = rbfm.destroyFile(catalogTablesName);
         if(ret) {
             if(ret == ERR_FILE_NOT_EXIST)
@@ -164,6 +155,15 @@ namespace PeterDB {
     }
 
     RC RelationManager::createIndex(const std::string &tableName, const std::string &attrName) {
+        return createIndex(tableName, std::vector<std::string>{attrName});
+    }
+
+    RC RelationManager::createIndex(const std::string &tableName, const std::vector<std::string> &attrNames) {
+        return createIndex(tableName, attrNames, std::vector<std::string>{});
+    }
+
+    RC RelationManager::createIndex(const std::string &tableName, const std::vector<std::string> &keyAttrNames,
+                                    const std::vector<std::string> &includedAttrNames) {
         if(!isTableAccessible(tableName)) {
             return ERR_ACCESS_DENIED_SYS_TABLE;
         }
@@ -171,71 +171,132 @@ namespace PeterDB {
             return ERR_TABLE_NAME_INVALID;
         }
         RC ret = 0;
-        RecordBasedFileManager& rbfm = RecordBasedFileManager::instance();
         IndexManager& ix = IndexManager::instance();
 
-        // 1. Create Index File
-        std::string ixFileName = getIndexFileName(tableName, attrName);
-        ret = ix.createFile(ixFileName);
+        // 0. Find the key attributes, in the order given
+        std::vector<Attribute> attrs;
+        ret = getAttributes(tableName, attrs);
         if(ret) {
-            LOG(ERROR) << "Fail to create table's file! @ RelationManager::createIndex" << std::endl;
-            return ret;
+            return ERR_GET_METADATA;
         }
+        // Names with a delimiter could not be split back, names longer than the catalog columns would be cut
+        for(const std::vector<std::string>* names: {&keyAttrNames, &includedAttrNames}) {
+            for(const std::string& attrName: *names) {
+                if(attrName.find(CATALOG_INDEXES_ATTRNAME_DELIM) != std::string::npos ||
+                   attrName.find(CATALOG_INDEXES_INCLUDE_DELIM) != std::string::npos) {
+                    LOG(ERROR) << "Attribute name " << attrName << " contains an index name delimiter @ RelationManager::createIndex" << std::endl;
+                    return ERR_INDEX_ATTR_NAME_INVALID;
+                }
+            }
+        }
+        // Included attributes are appended to the key, so leaf entries carry their values
+        std::string indexName = getIndexName(keyAttrNames, includedAttrNames);
+        std::string ixFileName = getIndexFileName(tableName, indexName);
+        if(indexName.size() > (size_t)CATALOG_INDEXES_ATTRNAME_LEN || ixFileName.size() > (size_t)CATALOG_INDEXES_FILENAME_LEN) {
+            LOG(ERROR) << "Index name " << indexName << " does not fit in the catalog @ RelationManager::createIndex" << std::endl;
+            return ERR_INDEX_NAME_TOO_LONG;
+        }
+        std::vector<uint32_t> keyAttrIndex;
+        Attribute keyAttr;
+        ret = getIndexKeyAttrs(attrs, indexName, keyAttrIndex, keyAttr);
+        if(ret) return ret;
 
-        // 2. Insert index metadata into INDEXES catalog
+        // 1. Get Table ID
         ret = openCatalog();
         if(ret) {
             return ERR_CATALOG_NOT_OPEN;
         }
-        // Get Table ID
         CatalogTablesRecord tableRecord;
         ret = getTableMetaData(tableName, tableRecord);
         if(ret) return ret;
-        ret = insertIndexIntoCatalog(tableRecord.tableID, attrName, ixFileName);
-        if(ret) return ret;
 
-        // 3. Scan table and insert every record into corresponding index
-        // Get all attributes and search for the target attribute
-        std::vector<Attribute> attrs;
-        ret = getAttributes(tableName, attrs);
+        // 2. Create Index File
+        ret = ix.createFile(ixFileName);
         if(ret) {
-            return ERR_GET_METADATA;
+            LOG(ERROR) << "Fail to create table's file! @ RelationManager::createIndex" << std::endl;
+            return ret;
         }
-        int32_t attr_pos = 0;
-        for(attr_pos = 0; attr_pos < attrs.size(); attr_pos++) {
-            if(attrs[attr_pos].name == attrName) {
-                break;
-            }
+
+        // 3. Insert index metadata into INDEXES catalog
+        ret = insertIndexIntoCatalog(tableRecord.tableID, indexName, ixFileName);
+        if(ret) {
+            ix.destroyFile(ixFileName);
+            return ret;
         }
-        if(attr_pos >= attrs.size()) {
-            return ERR_ATTR_NOT_EXIST;
+
+        // 4. Scan table and build the B+ tree bottom-up, a half built index is dropped again
+        ret = bulkLoadIndex(tableRecord.fileName, attrs, keyAttrIndex, keyAttrNames.size(), keyAttr, ixFileName);
+        if(ret) {
+            LOG(ERROR) << "Fail to build index " << indexName << ", drop it @ RelationManager::createIndex" << std::endl;
+            deleteIndexFromCatalog(tableRecord.tableID, indexName);
+            closeIndexFileHandle(ixFileName);
+            ix.destroyFile(ixFileName);
+            return ret;
         }
+        return 0;
+    }
 
+    RC RelationManager::bulkLoadIndex(const std::string& tableFileName, const std::vector<Attribute>& attrs,
+                                      const std::vector<uint32_t>& keyAttrIndex, uint32_t keyAttrNum,
+                                      const Attribute& keyAttr, const std::string& ixFileName) {
+        RC ret = 0;
+        RecordBasedFileManager& rbfm = RecordBasedFileManager::instance();
+        IndexManager& ix = IndexManager::instance();
+
+        // 1. Scan the indexed attributes of every record
         RBFM_ScanIterator tableScanIter;
-        FileHandle fh;
-        ret = rbfm.openFile(tableRecord.fileName, fh);
+        FileHandle* fh;
+        ret = getTableFileHandle(tableFileName, fh);
         if(ret) return ret;
-        std::vector<std::string> indexedAttr = {attrs[attr_pos].name};
-        ret = rbfm.scan(fh, attrs, "", NO_OP, nullptr, {}, tableScanIter);
+        std::vector<std::string> indexedAttr;
+        std::vector<Attribute> indexedAttrs;
+        std::vector<uint32_t> indexedAttrIndex;
+        for(uint32_t index: keyAttrIndex) {
+            indexedAttrIndex.push_back(indexedAttr.size());
+            indexedAttr.push_back(attrs[index].name);
+            indexedAttrs.push_back(attrs[index]);
+        }
+        ret = rbfm.scan(*fh, attrs, "", NO_OP, nullptr, indexedAttr, tableScanIter);
         if(ret) return ret;
+        IXFileHandle ixFileHandle;
+        ret = ix.openFile(ixFileName, ixFileHandle);
+        if(ret) {
+            tableScanIter.close();
+            return ret;
+        }
 
+        // 2. Sort all (key, rid) pairs and build the B+ tree bottom-up
+        // Every failure falls through to closing the scan, the loader and the file
         RID rid;
-        uint8_t recordData[PAGE_SIZE] = {};
         uint8_t attrData[PAGE_SIZE] = {};
-        uint8_t keyData[PAGE_SIZE] = {};
-        IXFileHandle ixFileHandle;
-        ret = ix.openFile(ixFileName, ixFileHandle);
-        if(ret) return ret;
-        while(tableScanIter.getNextRecord(rid, recordData) == 0) {
-            ret = rbfm.readAttribute(fh, attrs, rid, attrs[attr_pos].name, attrData);
-            if(ret) return ret;
-            // Convert api format to raw key
-            ret = ApiDataHelper::getRawAttr(attrData, {attrs[attr_pos]}, attrs[attr_pos].name, keyData);
-            if(ret) return ret;
-            ret = ix.insertEntry(ixFileHandle, attrs[attr_pos], keyData, rid);
-            if(ret) return ret;
+        uint8_t key[PAGE_SIZE];
+        IX_BulkLoader bulkLoader;
+        ret = bulkLoader.open(&ixFileHandle, keyAttr);
+        if(!ret) {
+            bulkLoader.setFillFactor(indexFillFactor);
+        }
+        while(!ret && tableScanIter.getNextRecord(rid, attrData) == 0) {
+            // Null keys are not indexed, same as insertTuple
+            if(isIndexKeyNull(attrData, indexedAttrIndex, keyAttrNum)) {
+                continue;
+            }
+            if(indexedAttrIndex.size() == 1) {
+                ret = bulkLoader.addEntry(attrData + 1, rid);
+            }
+            else {
+                ret = CompositeKeyHelper::encode(attrData, indexedAttrs, indexedAttrIndex, key);
+                if(!ret) {
+                    ret = bulkLoader.addEntry(key, rid);
+                }
+            }
         }
-        return 0;
+        tableScanIter.close();
+        if(!ret) {
+            ret = bulkLoader.close();
+        }
+        bulkLoader.abort();
+        RC closeRet = ix.closeFile(ixFileHandle);
+        return ret ? ret : closeRet;
     }
 
     RC RelationManager::deleteTable(const std::string &tableName) {
@@ -267,6 +328,7 @@ namespace PeterDB {
         for(auto& p: indexedAttrAndFileName) {
             ret = deleteIndexFromCatalog(tableRecord.tableID, p.first);
             if(ret) return ret;
+            closeIndexFileHandle(p.second);
             ret = ix.destroyFile(p.second);
             if(ret) return ret;
         }
@@ -279,27 +341,33 @@ namespace PeterDB {
         ret = deleteTableColFromCatalog(tableRecord.tableID);
         if(ret) return ret;
 
-        // Delete table file
+        // Delete table file, a cached handle must not outlive it
+        fileHandleCache.closeFile(tableName);
         ret = rbfm.destroyFile(tableName);
         if(ret) {
             LOG(ERROR) << "Fail to destroy table file! @ RelationManager::deleteTable" << std::endl;
             return ret;
         }
-
-        // Close FileHandle if it is bound to the deleted table
-        if(tableFileHandle.fileName == tableName) {
-            tableFileHandle.close();
-        }
         return 0;
     }
 
     RC RelationManager::destroyIndex(const std::string &tableName, const std::string &attrName) {
+        return destroyIndex(tableName, std::vector<std::string>{attrName});
+    }
+
+    RC RelationManager::destroyIndex(const std::string &tableName, const std::vector<std::string> &attrNames) {
+        return destroyIndex(tableName, attrNames, std::vector<std::string>{});
+    }
+
+    RC RelationManager::destroyIndex(const std::string &tableName, const std::vector<std::string> &keyAttrNames,
+                                     const std::vector<std::string> &includedAttrNames) {
         if(!isTableAccessible(tableName)) {
             return ERR_ACCESS_DENIED_SYS_TABLE;
         }
         if(!isTableNameValid(tableName)) {
             return ERR_TABLE_NAME_INVALID;
         }
+        std::string attrName = getIndexName(keyAttrNames, includedAttrNames);
         RC ret = 0;
         RecordBasedFileManager& rbfm = RecordBasedFileManager::instance();
         IndexManager& ix = IndexManager::instance();
@@ -330,316 +398,150 @@ namespace PeterDB {
         if(ret) return ret;
 
         // 4. Delete index file
+        closeIndexFileHandle(ixFileName);
         ret = ix.destroyFile(ixFileName);
         if(ret) return ret;
 
         return 0;
     }
 
+    void RelationManager::setIndexFillFactor(float factor) {
+        indexFillFactor = factor;
+    }
+
     RC RelationManager::getAttributes(const std::string &tableName, std::vector<Attribute> &attrs) {
         RC ret = 0;
-        ret = openCatalog();
-        if(ret) {
-            return ERR_CATALOG_NOT_OPEN;
-        }
-        RecordBasedFileManager& rbfm = RecordBasedFileManager::instance();
-        CatalogTablesRecord tablesRecord;
-        ret = getTableMetaData(tableName, tablesRecord);
+        std::shared_ptr<CatalogCacheEntry> catalogEntry;
+        ret = getCatalogCacheEntry(tableName, catalogEntry);
         if(ret) {
             LOG(ERROR) << "Fail to get table meta data @ RelationManager::getAttributes" << std::endl;
             return ret;
         }
 
-        RBFM_ScanIterator colIter;
-        std::vector<std::string> colAttrName = {
-                CATALOG_COLUMNS_COLUMNNAME, CATALOG_COLUMNS_COLUMNTYPE, CATALOG_COLUMNS_COLUMNLENGTH, CATALOG_COLUMNS_COLUMNVERSION
-        };
-        ret = rbfm.scan(catalogColumnsFH, catalogColumnsSchema, CATALOG_COLUMNS_TABLEID,
-                        EQ_OP, &tablesRecord.tableID, colAttrName, colIter);
-        if(ret) {
-            return ret;
-        }
-        RID curRID;
-        uint8_t apiData[PAGE_SIZE];
-        while(colIter.getNextRecord(curRID, apiData) == 0) {
-            CatalogColumnsRecord curCol(apiData, colAttrName);
-            if(curCol.columnVersion == tablesRecord.tableVersion) {
-                attrs.push_back(curCol.getAttribute());
-            }
+        auto versionIter = catalogEntry->attrVersionMap.find(catalogEntry->tableRecord.tableVersion);
+        if(versionIter != catalogEntry->attrVersionMap.end()) {
+            attrs.insert(attrs.end(), versionIter->second.begin(), versionIter->second.end());
         }
-
         return 0;
     }
 
-    RC RelationManager::insertTuple(const std::string &tableName, const void *data, RID &rid) {
-        if(!isTableAccessible(tableName)) {
-            return ERR_ACCESS_DENIED_SYS_TABLE;
-        }
+    RC RelationManager::openTable(const std::string &tableName, TableHandle &tableHandle) {
         if(!isTableNameValid(tableName)) {
             return ERR_TABLE_NAME_INVALID;
         }
-
-        RC ret = 0;
-        std::vector<Attribute> attrs;
-        CatalogTablesRecord tableRecord;
-        RecordBasedFileManager& rbfm = RecordBasedFileManager::instance();
-        if(!tableFileHandle.isOpen() || tableFileHandle.fileName != tableName) {
-            tableFileHandle.close();
-            ret = rbfm.openFile(tableName, tableFileHandle);
-            if(ret) {
-                return ret;
-            }
-        }
-
-        // 1. Insert Record into Table
-        ret = getAttributes(tableName, attrs);
-        if(ret || attrs.empty()) {
-            LOG(ERROR) << "Fail to get meta data @ RelationManager::insertTuple" << std::endl;
-            return ERR_GET_METADATA;
-        }
-        ret = getTableMetaData(tableName, tableRecord);
-        if(ret) return ret;
-
-        ret = rbfm.insertRecord(tableFileHandle, attrs, data, (int8_t)tableRecord.tableVersion, rid);
+        RC ret = openCatalog();
         if(ret) {
-            return ret;
+            return ERR_CATALOG_NOT_OPEN;
         }
-
-        // 2. Insert Record into Index
-        IndexManager& ix = IndexManager::instance();
-        // Find all indexes associated with this table and corresponding file names
-        std::unordered_map<std::string, std::string> indexedAttrAndFileName;
-        ret = getIndexes(tableName, indexedAttrAndFileName);
+        tableHandle.close();
+        tableHandle.rm = this;
+        tableHandle.tableName = tableName;
+        tableHandle.isWritable = isTableAccessible(tableName);
+        ret = tableHandle.resolve();
         if(ret) {
+            tableHandle.close();
             return ret;
         }
-
-        int32_t dataPos = ceil(attrs.size() / 8.0);
-        for(int i = 0; i < attrs.size(); i++) {
-            if(RecordHelper::isAttrNull((uint8_t *)data, i)) {
-                continue;
-            }
-            if(indexedAttrAndFileName.find(attrs[i].name) != indexedAttrAndFileName.end()) {
-                // insert entry into each index
-                if(ixFHMap.find(indexedAttrAndFileName[attrs[i].name]) == ixFHMap.end()) {
-                    IXFileHandle* fh = new IXFileHandle;
-                    ret = ix.openFile(indexedAttrAndFileName[attrs[i].name], *fh);
-                    if(ret) return ret;
-                    ixFHMap[indexedAttrAndFileName[attrs[i].name]] = fh;
-                }
-                ret = ix.insertEntry(*ixFHMap[indexedAttrAndFileName[attrs[i].name]], attrs[i], (uint8_t *)data + dataPos, rid);
-                if(ret) return ret;
-            }
-            switch (attrs[i].type) {
-                case TypeInt:
-                    dataPos += sizeof(int32_t);
-                    break;
-                case TypeReal:
-                    dataPos += sizeof(float);
-                    break;
-                case TypeVarChar:
-                    int32_t tmpStrLen;
-                    memcpy(&tmpStrLen, (uint8_t *)data + dataPos, sizeof(int32_t));
-                    dataPos += sizeof(int32_t);
-                    dataPos += tmpStrLen;
-                    break;
-            }
-        }
-
-        tableFileHandle.flushMetadata();
-
         return 0;
     }
 
-    RC RelationManager::deleteTuple(const std::string &tableName, const RID &rid) {
+    // DML goes through a TableHandle, it keeps the table file and every index file pinned for the whole call
+    // A file looked up later would otherwise evict one still in use from the file handle cache
+    RC RelationManager::insertTuple(const std::string &tableName, const void *data, RID &rid) {
         if(!isTableAccessible(tableName)) {
             return ERR_ACCESS_DENIED_SYS_TABLE;
         }
-        if(!isTableNameValid(tableName)) {
-            return ERR_TABLE_NAME_INVALID;
-        }
-
-        RC ret = 0;
-        RecordBasedFileManager& rbfm = RecordBasedFileManager::instance();
-        std::vector<Attribute> attrs;
-        ret = getAttributes(tableName, attrs);
-        if(ret) {
-            LOG(ERROR) << "Fail to get meta data @ RelationManager::deleteTuple" << std::endl;
-            return ERR_GET_METADATA;
-        }
-
-        if(!tableFileHandle.isOpen() || tableFileHandle.fileName != tableName) {
-            tableFileHandle.close();
-            ret = rbfm.openFile(tableName, tableFileHandle);
-            if(ret) {
-                return ret;
-            }
-        }
-
-        // 1. Get tuple data and delete entries in each index
-        uint8_t data[PAGE_SIZE] = {};
-        ret = rbfm.readRecord(tableFileHandle, attrs, rid, data);
-        if(ret) return ret;
-        IndexManager& ix = IndexManager::instance();
-        // Find all indexes associated with this table and corresponding file names
-        std::unordered_map<std::string, std::string> indexedAttrAndFileName;
-        ret = getIndexes(tableName, indexedAttrAndFileName);
+        TableHandle table;
+        RC ret = openTable(tableName, table);
         if(ret) return ret;
+        return table.insertTuple(data, rid);
+    }
 
-        int32_t dataPos = ceil(attrs.size() / 8.0);
-        for(int i = 0; i < attrs.size(); i++) {
-            if(RecordHelper::isAttrNull(data, i)) {
-                continue;
-            }
-            if(indexedAttrAndFileName.find(attrs[i].name) != indexedAttrAndFileName.end()) {
-                // delete entry from each index
-                if(ixFHMap.find(indexedAttrAndFileName[attrs[i].name]) == ixFHMap.end()) {
-                    IXFileHandle* fh = new IXFileHandle;
-                    ret = ix.openFile(indexedAttrAndFileName[attrs[i].name], *fh);
-                    if(ret) return ret;
-                    ixFHMap[indexedAttrAndFileName[attrs[i].name]] = fh;
-                }
-                ret = ix.deleteEntry(*ixFHMap[indexedAttrAndFileName[attrs[i].name]], attrs[i], (uint8_t *)data + dataPos, rid);
-                if(ret) return ret;
-            }
-            switch (attrs[i].type) {
-                case TypeInt:
-                    dataPos += sizeof(int32_t);
-                    break;
-                case TypeReal:
-                    dataPos += sizeof(float);
-                    break;
-                case TypeVarChar:
-                    int32_t tmpStrLen;
-                    memcpy(&tmpStrLen, (uint8_t *)data + dataPos, sizeof(int32_t));
-                    dataPos += sizeof(int32_t);
-                    dataPos += tmpStrLen;
-                    break;
-            }
+    RC RelationManager::insertTuples(const std::string &tableName, const std::vector<const void *> &tuples, std::vector<RID> &rids) {
+        if(!isTableAccessible(tableName)) {
+            return ERR_ACCESS_DENIED_SYS_TABLE;
         }
+        TableHandle table;
+        RC ret = openTable(tableName, table);
+        if(ret) return ret;
+        return table.insertTuples(tuples, rids);
+    }
 
-        // 2. Delete tuple in the table
-        ret = rbfm.deleteRecord(tableFileHandle, attrs, rid);
-        if(ret) {
-            return ret;
+    RC RelationManager::deleteTuple(const std::string &tableName, const RID &rid) {
+        if(!isTableAccessible(tableName)) {
+            return ERR_ACCESS_DENIED_SYS_TABLE;
         }
-
-        tableFileHandle.flushMetadata();
-
-        return 0;
+        TableHandle table;
+        RC ret = openTable(tableName, table);
+        if(ret) return ret;
+        return table.deleteTuple(rid);
     }
 
     RC RelationManager::updateTuple(const std::string &tableName, const void *newData, const RID &rid) {
         if(!isTableAccessible(tableName)) {
             return ERR_ACCESS_DENIED_SYS_TABLE;
         }
+        TableHandle table;
+        RC ret = openTable(tableName, table);
+        if(ret) return ret;
+        return table.updateTuple(newData, rid);
+    }
+
+    RC RelationManager::readTuple(const std::string &tableName, const RID &rid, void *data) {
         if(!isTableNameValid(tableName)) {
             return ERR_TABLE_NAME_INVALID;
         }
 
         RC ret = 0;
         RecordBasedFileManager& rbfm = RecordBasedFileManager::instance();
-        std::vector<Attribute> attrs;
-        ret = getAttributes(tableName, attrs);
+        ret = openCatalog();
         if(ret) {
-            LOG(ERROR) << "Fail to get meta data @ RelationManager::updateTuple" << std::endl;
-            return ERR_GET_METADATA;
+            return ERR_CATALOG_NOT_OPEN;
         }
-
-        if(!tableFileHandle.isOpen() || tableFileHandle.fileName != tableName) {
-            tableFileHandle.close();
-            ret = rbfm.openFile(tableName, tableFileHandle);
-            if(ret) {
-                return ret;
-            }
+        FileHandle* tableFileHandle;
+        ret = getTableFileHandle(tableName, tableFileHandle);
+        if(ret) {
+            return ret;
         }
 
-        // 1. Update tuple in index
-        IndexManager& ix = IndexManager::instance();
-        std::unordered_map<std::string, std::string> indexedAttrAndFileName;
-        ret = getIndexes(tableName, indexedAttrAndFileName);
+        // 0. Get table version and record version
+        std::shared_ptr<CatalogCacheEntry> catalogEntry;
+        ret = getCatalogCacheEntry(tableName, catalogEntry);
         if(ret) return ret;
+        const CatalogTablesRecord& tableRecord = catalogEntry->tableRecord;
 
-        uint8_t oldData[PAGE_SIZE] = {};
-        ret = rbfm.readRecord(tableFileHandle, attrs, rid, oldData);
+        int8_t recordVersion;
+        ret = rbfm.readRecordVersion(*tableFileHandle, rid, recordVersion);
         if(ret) return ret;
 
-        // Delete and re-insert
-        int32_t dataPos = ceil(attrs.size() / 8.0);
-        for(int i = 0; i < attrs.size(); i++) {
-            if(RecordHelper::isAttrNull(oldData, i)) {
-                continue;
-            }
-            if(indexedAttrAndFileName.find(attrs[i].name) != indexedAttrAndFileName.end()) {
-                // delete old entry and insert new entry
-                if(ixFHMap.find(indexedAttrAndFileName[attrs[i].name]) == ixFHMap.end()) {
-                    IXFileHandle* fh = new IXFileHandle;
-                    ret = ix.openFile(indexedAttrAndFileName[attrs[i].name], *fh);
-                    if(ret) return ret;
-                    ixFHMap[indexedAttrAndFileName[attrs[i].name]] = fh;
-                }
-                ret = ix.deleteEntry(*ixFHMap[indexedAttrAndFileName[attrs[i].name]], attrs[i], (uint8_t *)oldData + dataPos, rid);
-                if(ret) return ret;
-            }
-            switch (attrs[i].type) {
-                case TypeInt:
-                    dataPos += sizeof(int32_t);
-                    break;
-                case TypeReal:
-                    dataPos += sizeof(float);
-                    break;
-                case TypeVarChar:
-                    int32_t tmpStrLen;
-                    memcpy(&tmpStrLen, (uint8_t *)oldData + dataPos, sizeof(int32_t));
-                    dataPos += sizeof(int32_t);
-                    dataPos += tmpStrLen;
-                    break;
-            }
+        // 1. Get all versions of schema
+        std::unordered_map<int32_t, std::vector<Attribute>>& originAttrVersionMap = catalogEntry->attrVersionMap;
+        if(tableRecord.tableVersion == recordVersion) {
+            return rbfm.readRecord(*tableFileHandle, originAttrVersionMap[tableRecord.tableVersion], rid, data);
         }
 
-        dataPos = ceil(attrs.size() / 8.0);
-        for(int i = 0; i < attrs.size(); i++) {
-            if(RecordHelper::isAttrNull((uint8_t *)newData, i)) {
-                continue;
-            }
-            if(indexedAttrAndFileName.find(attrs[i].name) != indexedAttrAndFileName.end()) {
-                // insert entry into each index
-                if(ixFHMap.find(indexedAttrAndFileName[attrs[i].name]) == ixFHMap.end()) {
-                    IXFileHandle* fh = new IXFileHandle;
-                    ret = ix.openFile(indexedAttrAndFileName[attrs[i].name], *fh);
-                    if(ret) return ret;
-                    ixFHMap[indexedAttrAndFileName[attrs[i].name]] = fh;
-                }
-                ret = ix.insertEntry(*ixFHMap[indexedAttrAndFileName[attrs[i].name]], attrs[i], (uint8_t *)newData + dataPos, rid);
-                if(ret) return ret;
-            }
-            switch (attrs[i].type) {
-                case TypeInt:
-                    dataPos += sizeof(int32_t);
-                    break;
-                case TypeReal:
-                    dataPos += sizeof(float);
-                    break;
-                case TypeVarChar:
-                    int32_t tmpStrLen;
-                    memcpy(&tmpStrLen, (uint8_t *)newData + dataPos, sizeof(int32_t));
-                    dataPos += sizeof(int32_t);
-                    dataPos += tmpStrLen;
-                    break;
-            }
+        // 2. Read record and select certain attributes
+        auto planIter = catalogEntry->transformPlans.find(recordVersion);
+        if(planIter == catalogEntry->transformPlans.end()) {
+            return ERR_VERSION_NOT_EXIST;
         }
-
-        // 2. Update tuple in table
-        ret = rbfm.updateRecord(tableFileHandle, attrs, newData, rid);
+        std::vector<Attribute>& projAttrs = catalogEntry->projAttrVersionMap[recordVersion];
+        uint8_t apiData[PAGE_SIZE];
+        ret = rbfm.readRecord(*tableFileHandle, originAttrVersionMap[recordVersion], projAttrs, rid, apiData);
         if(ret) {
             return ret;
         }
-        tableFileHandle.flushMetadata();
+
+        // 3. Construct Api format based on current format
+        ret = rbfm.transformSchema(planIter->second, projAttrs, apiData,
+                                   originAttrVersionMap[tableRecord.tableVersion], (uint8_t *)data);
+        if(ret) return ret;
 
         return 0;
     }
 
-    RC RelationManager::readTuple(const std::string &tableName, const RID &rid, void *data) {
+    RC RelationManager::readTuples(const std::string &tableName, const std::vector<RID> &rids,
+                                   std::vector<std::vector<uint8_t>> &tuples) {
         if(!isTableNameValid(tableName)) {
             return ERR_TABLE_NAME_INVALID;
         }
@@ -650,81 +552,46 @@ namespace PeterDB {
         if(ret) {
             return ERR_CATALOG_NOT_OPEN;
         }
-        if(!tableFileHandle.isOpen() || tableFileHandle.fileName != tableName) {
-            tableFileHandle.close();
-            ret = rbfm.openFile(tableName, tableFileHandle);
-            if(ret) {
-                return ret;
-            }
+        FileHandle* tableFileHandle;
+        ret = getTableFileHandle(tableName, tableFileHandle);
+        if(ret) {
+            return ret;
         }
 
-        // 0. Get table version and record version
+        // Catalog lookups are done once for all tuples
         CatalogTablesRecord tableRecord;
         ret = getTableMetaData(tableName, tableRecord);
         if(ret) return ret;
-
-        int8_t recordVersion;
-        ret = rbfm.readRecordVersion(tableFileHandle, rid, recordVersion);
+        std::vector<Attribute> attrs;
+        ret = getAttributes(tableName, attrs);
         if(ret) return ret;
 
-        if(tableRecord.tableVersion == recordVersion) {
-            std::vector<Attribute> attrs;
-            ret = getAttributes(tableName, attrs);
-            if(ret) return ret;
-            return rbfm.readRecord(tableFileHandle, attrs, rid, data);
-        }
-
-        // 1. Get all versions of schema
-        std::unordered_map<int32_t, std::vector<Attribute>> originAttrVersionMap;
-        std::unordered_map<int32_t, std::vector<Attribute>> projAttrVersionMap;
-        RBFM_ScanIterator colIter;
-        std::vector<std::string> colAttrName = {
-                CATALOG_COLUMNS_COLUMNNAME, CATALOG_COLUMNS_COLUMNTYPE, CATALOG_COLUMNS_COLUMNLENGTH, CATALOG_COLUMNS_COLUMNVERSION
-        };
-        ret = rbfm.scan(catalogColumnsFH, catalogColumnsSchema, CATALOG_COLUMNS_TABLEID,
-                        EQ_OP, &tableRecord.tableID, colAttrName, colIter);
-        if(ret) {
-            return ret;
-        }
-        RID curRID;
+        tuples.clear();
         uint8_t apiData[PAGE_SIZE];
-        while(colIter.getNextRecord(curRID, apiData) == 0) {
-            CatalogColumnsRecord curCol(apiData, colAttrName);
-            originAttrVersionMap[curCol.columnVersion].push_back(curCol.getAttribute());
-        }
-
-        projAttrVersionMap[tableRecord.tableVersion] = originAttrVersionMap[tableRecord.tableVersion];
-        for(int32_t v = tableRecord.tableVersion - 1; v >= 0; v--) {
-            for(auto& attr: originAttrVersionMap[v]) {
-                uint32_t index;
-                for(index = 0; index < projAttrVersionMap[v + 1].size(); index++) {
-                    if (projAttrVersionMap[v + 1][index].name == attr.name) {
-                        break;
-                    }
-                }
-                if(index < projAttrVersionMap[v + 1].size()) {
-                    projAttrVersionMap[v].push_back(attr);
+        uint32_t runStart = 0;
+        while(runStart < rids.size()) {
+            // Read all rids of a page at a time
+            uint32_t runEnd = runStart;
+            std::vector<uint16_t> slots;
+            while(runEnd < rids.size() && rids[runEnd].pageNum == rids[runStart].pageNum) {
+                slots.push_back(rids[runEnd].slotNum);
+                runEnd++;
+            }
+            std::vector<std::vector<uint8_t>> pageTuples;
+            ret = rbfm.readRecordsOnPage(*tableFileHandle, attrs, rids[runStart].pageNum, slots,
+                                         tableRecord.tableVersion, pageTuples);
+            if(ret) return ret;
+            for(uint32_t i = 0; i < pageTuples.size(); i++) {
+                // Tuples of older schema versions go through readTuple
+                if(pageTuples[i].empty()) {
+                    ret = readTuple(tableName, rids[runStart + i], apiData);
+                    if(ret) return ret;
+                    pageTuples[i].assign(apiData, apiData + ApiDataHelper::getDataLen(apiData, attrs));
                 }
+                tuples.push_back(std::move(pageTuples[i]));
             }
+            runStart = runEnd;
         }
-
-        // 2. Read record and select certain attributes
-        if(originAttrVersionMap.find(recordVersion) == originAttrVersionMap.end()) {
-            return ERR_VERSION_NOT_EXIST;
-        }
-        ret = rbfm.readRecord(tableFileHandle, originAttrVersionMap[recordVersion],
-                              projAttrVersionMap[recordVersion], rid, apiData);
-        if(ret) {
-            return ret;
-        }
-
-        // 3. Construct Api format based on current format
-        ret = rbfm.transformSchema(projAttrVersionMap[recordVersion], apiData,
-                                   projAttrVersionMap[tableRecord.tableVersion], (uint8_t *)data);
-        if(ret) return ret;
-
-        tableFileHandle.flushMetadata();
-
         return 0;
     }
 
@@ -787,14 +654,7 @@ namespace PeterDB {
             LOG(ERROR) << "Fail to get meta data @ RelationManager::readTuple" << std::endl;
             return ERR_GET_METADATA;
         }
-        RecordBasedFileManager& rbfm = RecordBasedFileManager::instance();
-        FileHandle fh;
-        ret = rbfm.openFile(tableName, fh);
-        if(ret) {
-            return ret;
-        }
-
-        ret = rm_ScanIterator.open(fh, attrs, conditionAttribute, compOp, value, attributeNames);
+        ret = rm_ScanIterator.open(fileHandleCache, tableName, attrs, conditionAttribute, compOp, value, attributeNames);
         if(ret) {
             return ret;
         }
@@ -817,7 +677,6 @@ namespace PeterDB {
         }
         RC ret = 0;
         RecordBasedFileManager& rbfm = RecordBasedFileManager::instance();
-        IndexManager& ix = IndexManager::instance();
 
         std::vector<Attribute> attrs;
         ret = getAttributes(tableName, attrs);
@@ -842,12 +701,104 @@ namespace PeterDB {
         }
         std::string ixFileName = indexedAttrAndFileName[attrName];
 
-        IXFileHandle* ixScanFH = new IXFileHandle;
-        ret = ix.openFile(ixFileName, *ixScanFH);
+        ret = rm_IndexScanIterator.open(fileHandleCache, ixFileName, attrs[attr_pos], (uint8_t *)lowKey, (uint8_t *)highKey,
+                                        lowKeyInclusive, highKeyInclusive);
+        if(ret) return ret;
+
+        return 0;
+    }
+
+    RC RelationManager::indexScan(const std::string &tableName,
+                 const std::vector<std::string> &attrNames,
+                 const void *lowKey,
+                 const void *highKey,
+                 bool lowKeyInclusive,
+                 bool highKeyInclusive,
+                 RM_IndexScanIterator &rm_IndexScanIterator) {
+        return indexScan(tableName, attrNames, std::vector<std::string>{}, lowKey, highKey,
+                         lowKeyInclusive, highKeyInclusive, rm_IndexScanIterator);
+    }
+
+    RC RelationManager::indexScan(const std::string &tableName,
+                 const std::vector<std::string> &attrNames,
+                 const std::vector<std::string> &coveredAttrNames,
+                 const void *lowKey,
+                 const void *highKey,
+                 bool lowKeyInclusive,
+                 bool highKeyInclusive,
+                 RM_IndexScanIterator &rm_IndexScanIterator) {
+        if(!isTableAccessible(tableName)) {
+            return ERR_ACCESS_DENIED_SYS_TABLE;
+        }
+        if(!isTableNameValid(tableName)) {
+            return ERR_TABLE_NAME_INVALID;
+        }
+        if(attrNames.empty()) {
+            return ERR_ATTR_NOT_EXIST;
+        }
+        RC ret = 0;
+
+        std::vector<Attribute> attrs;
+        ret = getAttributes(tableName, attrs);
+        if(ret) {
+            return ERR_GET_METADATA;
+        }
+        std::unordered_map<std::string, std::string> indexedAttrAndFileName;
+        ret = getIndexes(tableName, indexedAttrAndFileName);
+        if(ret) return ret;
+
+        // A single attribute index is preferred, its keys are the raw attribute values
+        if(attrNames.size() == 1 && coveredAttrNames.empty() && indexedAttrAndFileName.find(attrNames[0]) != indexedAttrAndFileName.end()) {
+            const uint8_t* low = (const uint8_t *)lowKey;
+            const uint8_t* high = (const uint8_t *)highKey;
+            if(low && RecordHelper::isAttrNull((uint8_t *)low, 0)) return ERR_KEY_NOT_EXIST;
+            if(high && RecordHelper::isAttrNull((uint8_t *)high, 0)) return ERR_KEY_NOT_EXIST;
+            return indexScan(tableName, attrNames[0], low ? low + 1 : nullptr, high ? high + 1 : nullptr,
+                             lowKeyInclusive, highKeyInclusive, rm_IndexScanIterator);
+        }
+
+        // Otherwise find the shortest index that starts with attrNames and carries coveredAttrNames,
+        // a single attribute index qualifies when it covers the projection by itself
+        std::string indexName;
+        size_t indexAttrNum = 0;
+        for(auto& index: indexedAttrAndFileName) {
+            std::vector<std::string> indexAttrNames = splitIndexName(index.first);
+            if(indexAttrNames.size() < attrNames.size()) {
+                continue;
+            }
+            if(!std::equal(attrNames.begin(), attrNames.end(), indexAttrNames.begin())) {
+                continue;
+            }
+            bool isCovering = true;
+            for(const std::string& attrName: coveredAttrNames) {
+                if(std::find(indexAttrNames.begin(), indexAttrNames.end(), attrName) == indexAttrNames.end()) {
+                    isCovering = false;
+                    break;
+                }
+            }
+            if(!isCovering) {
+                continue;
+            }
+            if(indexName.empty() || indexAttrNames.size() < indexAttrNum) {
+                indexName = index.first;
+                indexAttrNum = indexAttrNames.size();
+            }
+        }
+        if(indexName.empty()) {
+            return ERR_INDEX_NOT_EXIST;
+        }
+
+        std::vector<uint32_t> keyAttrIndex;
+        Attribute keyAttr;
+        ret = getIndexKeyAttrs(attrs, indexName, keyAttrIndex, keyAttr);
         if(ret) return ret;
+        std::vector<Attribute> keyAttrs;
+        for(uint32_t index: keyAttrIndex) {
+            keyAttrs.push_back(attrs[index]);
+        }
 
-        ixScanFHList.push_back(ixScanFH);
-        ret = rm_IndexScanIterator.open(ixScanFH, attrs[attr_pos], (uint8_t *)lowKey, (uint8_t *)highKey, lowKeyInclusive, highKeyInclusive);
+        ret = rm_IndexScanIterator.open(fileHandleCache, indexedAttrAndFileName[indexName], keyAttrs, attrNames.size(), (uint8_t *)lowKey, (uint8_t *)highKey,
+                                        lowKeyInclusive, highKeyInclusive);
         if(ret) return ret;
 
         return 0;
@@ -875,6 +826,7 @@ namespace PeterDB {
         if(ret) {
             return ret;
         }
+        invalidateCatalogCache();
         tableRecord.tableVersion++;    // Add table version by one
         tableRecord.getRecordAPIFormat(apiData);
         ret = rbfm.updateRecord(catalogTablesFH, catalogTablesSchema, apiData, rid);
@@ -970,6 +922,7 @@ namespace PeterDB {
         }
 
         // 1. Update table record in TABLES
+        invalidateCatalogCache();
         tableRecord.tableVersion++;    // Add table version by one
         tableRecord.getRecordAPIFormat(apiData);
         ret = rbfm.updateRecord(catalogTablesFH, catalogTablesSchema, apiData, rid);
@@ -1016,6 +969,7 @@ namespace PeterDB {
             LOG(ERROR) << "Catalog not open @ RelationManager::insertTableColIntoCatalog" << std::endl;
             return ERR_CATALOG_NOT_OPEN;
         }
+        invalidateCatalogCache();
         RID rid;
 
         uint8_t data[PAGE_SIZE];
@@ -1049,6 +1003,7 @@ namespace PeterDB {
             LOG(ERROR) << "Catalog not open @ RelationManager::insertIndexIntoCatalog" << std::endl;
             return ERR_CATALOG_NOT_OPEN;
         }
+        invalidateCatalogCache();
         RID rid;
         uint8_t data[PAGE_SIZE];
         bzero(data, PAGE_SIZE);
@@ -1066,6 +1021,7 @@ namespace PeterDB {
     RC RelationManager::deleteTableColFromCatalog(int32_t tableID) {
         RC ret = 0;
         RecordBasedFileManager& rbfm = RecordBasedFileManager::instance();
+        invalidateCatalogCache();
 
         std::vector<std::string> tableAttrNames = {CATALOG_TABLES_TABLEID};
         std::vector<std::string> colAttrNames = {CATALOG_COLUMNS_TABLEID};
@@ -1119,6 +1075,7 @@ namespace PeterDB {
     RC RelationManager::deleteIndexFromCatalog(int32_t tableID) {
         RC ret = 0;
         RecordBasedFileManager& rbfm = RecordBasedFileManager::instance();
+        invalidateCatalogCache();
         RID curRID;
         uint8_t apiData[PAGE_SIZE];
         // Scan Catalog Columns and delete target column record in INDEXES
@@ -1140,6 +1097,7 @@ namespace PeterDB {
     RC RelationManager::deleteIndexFromCatalog(int32_t tableID, std::string attrName) {
         RC ret = 0;
         RecordBasedFileManager& rbfm = RecordBasedFileManager::instance();
+        invalidateCatalogCache();
         RID curRID;
         uint8_t apiData[PAGE_SIZE];
         std::vector<std::string> indexAttrNames = {CATALOG_INDEXES_ATTRNAME};
@@ -1233,8 +1191,11 @@ namespace PeterDB {
     }
 
     RC RelationManager::getTableMetaData(const std::string& tableName, CatalogTablesRecord& tableRecord) {
-        RID recordRID;
-        return getTableMetaDataAndRID(tableName, tableRecord, recordRID);
+        std::shared_ptr<CatalogCacheEntry> catalogEntry;
+        RC ret = getCatalogCacheEntry(tableName, catalogEntry);
+        if(ret) return ret;
+        tableRecord = catalogEntry->tableRecord;
+        return 0;
     }
 
     RC RelationManager::getTableMetaDataAndRID(const std::string& tableName, CatalogTablesRecord& tableRecord, RID& rid) {
@@ -1275,36 +1236,246 @@ namespace PeterDB {
     }
 
     RC RelationManager::getIndexes(const std::string& tableName, std::unordered_map<std::string, std::string>& indexedAttrAndFileName) {
+        RC ret = 0;
+        std::shared_ptr<CatalogCacheEntry> catalogEntry;
+        ret = getCatalogCacheEntry(tableName, catalogEntry);
+        if(ret) {
+            LOG(ERROR) << "Fail to get table meta data @ RelationManager::getIndexes" << std::endl;
+            return ret;
+        }
+        for(auto& index: catalogEntry->indexedAttrAndFileName) {
+            indexedAttrAndFileName[index.first] = index.second;
+        }
+        return 0;
+    }
+
+    RC RelationManager::getCatalogCacheEntry(const std::string& tableName, std::shared_ptr<CatalogCacheEntry>& entry) {
+        auto cacheIter = catalogCache.find(tableName);
+        if(cacheIter != catalogCache.end()) {
+            entry = cacheIter->second;
+            return 0;
+        }
+
         RC ret = 0;
         ret = openCatalog();
         if(ret) {
             return ERR_CATALOG_NOT_OPEN;
         }
         RecordBasedFileManager& rbfm = RecordBasedFileManager::instance();
-        CatalogTablesRecord tablesRecord;
-        ret = getTableMetaData(tableName, tablesRecord);
+        std::shared_ptr<CatalogCacheEntry> newEntryPtr = std::make_shared<CatalogCacheEntry>();
+        CatalogCacheEntry& newEntry = *newEntryPtr;
+        RID curRID;
+        ret = getTableMetaDataAndRID(tableName, newEntry.tableRecord, curRID);
+        if(ret) return ret;
+
+        // 1. Columns of every version
+        RBFM_ScanIterator colIter;
+        std::vector<std::string> colAttrName = {
+                CATALOG_COLUMNS_COLUMNNAME, CATALOG_COLUMNS_COLUMNTYPE, CATALOG_COLUMNS_COLUMNLENGTH, CATALOG_COLUMNS_COLUMNVERSION
+        };
+        ret = rbfm.scan(catalogColumnsFH, catalogColumnsSchema, CATALOG_COLUMNS_TABLEID,
+                        EQ_OP, &newEntry.tableRecord.tableID, colAttrName, colIter);
         if(ret) {
-            LOG(ERROR) << "Fail to get table meta data @ RelationManager::getIndexes" << std::endl;
             return ret;
         }
+        uint8_t apiData[PAGE_SIZE];
+        while(colIter.getNextRecord(curRID, apiData) == 0) {
+            CatalogColumnsRecord curCol(apiData, colAttrName);
+            newEntry.attrVersionMap[curCol.columnVersion].push_back(curCol.getAttribute());
+        }
 
+        // 2. Indexes
         RBFM_ScanIterator indexIter;
         std::vector<std::string> indexAttrName = {CATALOG_INDEXES_ATTRNAME, CATALOG_INDEXES_FILENAME};
         ret = rbfm.scan(catalogIndexesFH, catalogIndexesSchema, CATALOG_INDEXES_TABLEID,
-                        EQ_OP, &tablesRecord.tableID, indexAttrName, indexIter);
+                        EQ_OP, &newEntry.tableRecord.tableID, indexAttrName, indexIter);
         if(ret) {
             return ret;
         }
-        RID curRID;
-        uint8_t apiData[PAGE_SIZE];
         while(indexIter.getNextRecord(curRID, apiData) == 0) {
             CatalogIndexesRecord curIndex(apiData, indexAttrName);
-            indexedAttrAndFileName[curIndex.attrName] = curIndex.fileName;
+            newEntry.indexedAttrAndFileName[curIndex.attrName] = curIndex.fileName;
         }
 
+        // 3. Tuples of older versions are read with their surviving attributes, then laid out as the current version
+        int32_t tableVersion = newEntry.tableRecord.tableVersion;
+        buildProjAttrVersionMap(newEntry.attrVersionMap, tableVersion, newEntry.projAttrVersionMap);
+        const std::vector<Attribute>& curAttrs = newEntry.attrVersionMap[tableVersion];
+        for(auto& versionAttrs: newEntry.attrVersionMap) {
+            int32_t version = versionAttrs.first;
+            if(version == tableVersion) {
+                continue;
+            }
+            ret = rbfm.buildTransformPlan(newEntry.projAttrVersionMap[version], curAttrs, newEntry.transformPlans[version]);
+            if(ret) return ret;
+        }
+
+        // 4. Index keys resolved once for DML
+        for(auto& indexFile: newEntry.indexedAttrAndFileName) {
+            TableIndex index;
+            index.indexName = indexFile.first;
+            index.fileName = indexFile.second;
+            // Indexes on dropped attributes are no longer maintained
+            if(getIndexKeyAttrs(curAttrs, index.indexName, index.keyAttrIndex, index.keyAttr)) {
+                continue;
+            }
+            index.keyAttrNum = getIndexKeyAttrNum(index.indexName);
+            newEntry.indexes.push_back(index);
+        }
+
+        catalogCache[tableName] = newEntryPtr;
+        entry = newEntryPtr;
         return 0;
     }
 
+    void RelationManager::invalidateCatalogCache() {
+        catalogCache.clear();
+        catalogVersion++;
+    }
+
+    uint64_t RelationManager::getCatalogVersion() {
+        return catalogVersion;
+    }
+
+    RC RelationManager::getTableFileHandle(const std::string& tableName, FileHandle*& fileHandle) {
+        return fileHandleCache.getFileHandle(tableName, fileHandle);
+    }
+
+    void RelationManager::closeIndexFileHandle(const std::string& fileName) {
+        // A cached handle must not outlive its file, a new index may reuse the file name
+        fileHandleCache.closeFile(fileName);
+    }
+
+    FileHandleCache& RelationManager::getFileHandleCache() {
+        return fileHandleCache;
+    }
+
+    RC RelationManager::getIndexKeyAttrs(const std::vector<Attribute>& attrs, const std::string& indexName,
+                                         std::vector<uint32_t>& keyAttrIndex, Attribute& keyAttr) {
+        keyAttrIndex.clear();
+        std::vector<Attribute> keyAttrs;
+        for(const std::string& attrName: splitIndexName(indexName)) {
+            uint32_t attrPos = 0;
+            for(attrPos = 0; attrPos < attrs.size(); attrPos++) {
+                if(attrs[attrPos].name == attrName) {
+                    break;
+                }
+            }
+            if(attrPos >= attrs.size()) {
+                return ERR_ATTR_NOT_EXIST;
+            }
+            keyAttrIndex.push_back(attrPos);
+            keyAttrs.push_back(attrs[attrPos]);
+        }
+        if(keyAttrs.empty()) {
+            return ERR_ATTR_NOT_EXIST;
+        }
+        if(keyAttrs.size() == 1) {
+            keyAttr = keyAttrs[0];
+        }
+        else {
+            keyAttr = CompositeKeyHelper::getKeyAttribute(indexName, keyAttrs);
+        }
+        return 0;
+    }
+
+    RC RelationManager::updateIndex(IXFileHandle& ixFileHandle, const TableIndex& index, const std::vector<Attribute>& attrs,
+                                    const uint8_t* data, const std::vector<int16_t>& dict, const RID& rid, bool isInsert) {
+        RC ret = 0;
+        IndexManager& ix = IndexManager::instance();
+        if(isIndexKeyNull(data, index.keyAttrIndex, index.keyAttrNum)) {
+            return 0;
+        }
+        const uint8_t* key = data + dict[index.keyAttrIndex[0]];
+        uint8_t compositeKey[PAGE_SIZE];
+        if(index.keyAttrIndex.size() > 1) {
+            ret = CompositeKeyHelper::encode(data, attrs, index.keyAttrIndex, compositeKey);
+            if(ret) return ret;
+            key = compositeKey;
+        }
+        if(isInsert) {
+            return ix.insertEntry(ixFileHandle, index.keyAttr, key, rid);
+        }
+        return ix.deleteEntry(ixFileHandle, index.keyAttr, key, rid);
+    }
+
+    RC RelationManager::insertIndexEntries(IXFileHandle& ixFileHandle, const TableIndex& index, const std::vector<Attribute>& attrs,
+                                           const std::vector<const void *>& tuples, const std::vector<RID>& rids) {
+        RC ret = 0;
+        // Entries are laid out as in leaf pages, a key followed by its rid
+        std::vector<uint8_t> entryData;
+        std::vector<size_t> entryOffsets;
+        std::vector<int16_t> dict(attrs.size());
+        uint8_t compositeKey[PAGE_SIZE];
+        for(uint32_t i = 0; i < tuples.size(); i++) {
+            const uint8_t* data = (const uint8_t *)tuples[i];
+            if(isIndexKeyNull(data, index.keyAttrIndex, index.keyAttrNum)) {
+                continue;
+            }
+            ApiDataHelper::buildDict((uint8_t *)data, attrs, dict);
+            const uint8_t* key = data + dict[index.keyAttrIndex[0]];
+            if(index.keyAttrIndex.size() > 1) {
+                ret = CompositeKeyHelper::encode(data, attrs, index.keyAttrIndex, compositeKey);
+                if(ret) return ret;
+                key = compositeKey;
+            }
+            int16_t keyLen = IXPageHandle::getKeyLen(key, index.keyAttr);
+            size_t offset = entryData.size();
+            entryOffsets.push_back(offset);
+            entryData.resize(offset + keyLen + IX::PAGE_RID_PAGE_LEN + IX::PAGE_RID_SLOT_LEN);
+            memcpy(entryData.data() + offset, key, keyLen);
+            memcpy(entryData.data() + offset + keyLen, &rids[i].pageNum, IX::PAGE_RID_PAGE_LEN);
+            memcpy(entryData.data() + offset + keyLen + IX::PAGE_RID_PAGE_LEN, &rids[i].slotNum, IX::PAGE_RID_SLOT_LEN);
+        }
+
+        std::vector<const uint8_t*> entries;
+        entries.reserve(entryOffsets.size());
+        for(size_t offset: entryOffsets) {
+            entries.push_back(entryData.data() + offset);
+        }
+        const Attribute& keyAttr = index.keyAttr;
+        std::sort(entries.begin(), entries.end(), [&keyAttr](const uint8_t* entry1, const uint8_t* entry2) {
+            return IXPageHandle::compareCompositeKey(entry1, entry2, keyAttr) < 0;
+        });
+        return IndexManager::instance().insertEntries(ixFileHandle, keyAttr, entries);
+    }
+
+    void RelationManager::buildProjAttrVersionMap(const std::unordered_map<int32_t, std::vector<Attribute>>& attrVersionMap,
+                                                  int32_t tableVersion,
+                                                  std::unordered_map<int32_t, std::vector<Attribute>>& projAttrVersionMap) {
+        projAttrVersionMap.clear();
+        auto versionIter = attrVersionMap.find(tableVersion);
+        if(versionIter != attrVersionMap.end()) {
+            projAttrVersionMap[tableVersion] = versionIter->second;
+        }
+        for(int32_t v = tableVersion - 1; v >= 0; v--) {
+            std::vector<Attribute>& nextProjAttrs = projAttrVersionMap[v + 1];
+            std::vector<Attribute>& projAttrs = projAttrVersionMap[v];
+            versionIter = attrVersionMap.find(v);
+            if(versionIter == attrVersionMap.end()) {
+                continue;
+            }
+            for(const Attribute& attr: versionIter->second) {
+                for(const Attribute& nextAttr: nextProjAttrs) {
+                    if(nextAttr.name == attr.name) {
+                        projAttrs.push_back(attr);
+                        break;
+                    }
+                }
+            }
+        }
+    }
+
+    bool RelationManager::isIndexKeyNull(const uint8_t* data, const std::vector<uint32_t>& keyAttrIndex, uint32_t keyAttrNum) {
+        // A composite key is indexed unless all of its key attributes are null
+        for(uint32_t i = 0; i < keyAttrNum && i < keyAttrIndex.size(); i++) {
+            if(!RecordHelper::isAttrNull((uint8_t *)data, keyAttrIndex[i])) {
+                return false;
+            }
+        }
+        return true;
+    }
+
     bool RelationManager::isTableAccessible(const std::string& tableName) {
         return tableName != catalogTablesName && tableName != catalogColumnsName && tableName != catalogIndexesName;
     }
@@ -1319,5 +1490,40 @@ namespace PeterDB {
     std::string RelationManager::getIndexFileName(const std::string& tableName, const std::string& attrName) {
         return tableName + '_' + attrName + ".idx";
     }
+    std::string RelationManager::getIndexName(const std::vector<std::string>& attrNames,
+                                              const std::vector<std::string>& includedAttrNames) {
+        std::string indexName;
+        for(const std::string& attrName: attrNames) {
+            if(!indexName.empty()) {
+                indexName += CATALOG_INDEXES_ATTRNAME_DELIM;
+            }
+            indexName += attrName;
+        }
+        for(uint32_t i = 0; i < includedAttrNames.size(); i++) {
+            indexName += i == 0 ? CATALOG_INDEXES_INCLUDE_DELIM : CATALOG_INDEXES_ATTRNAME_DELIM;
+            indexName += includedAttrNames[i];
+        }
+        return indexName;
+    }
+    std::vector<std::string> RelationManager::splitIndexName(const std::string& indexName) {
+        // Key attributes followed by included attributes, in the order they are encoded
+        std::vector<std::string> attrNames;
+        std::string attrName;
+        for(char c: indexName) {
+            if(c == CATALOG_INDEXES_ATTRNAME_DELIM || c == CATALOG_INDEXES_INCLUDE_DELIM) {
+                attrNames.push_back(attrName);
+                attrName.clear();
+            }
+            else {
+                attrName += c;
+            }
+        }
+        attrNames.push_back(attrName);
+        return attrNames;
+    }
+    uint32_t RelationManager::getIndexKeyAttrNum(const std::string& indexName) {
+        std::string keyAttrNames = indexName.substr(0, indexName.find(CATALOG_INDEXES_INCLUDE_DELIM));
+        return std::count(keyAttrNames.begin(), keyAttrNames.end(), CATALOG_INDEXES_ATTRNAME_DELIM) + 1;
+    }
 
 } // namespace PeterDB
\ No newline at end of file
@@ -0,0 +1,207 @@
+#include <thread>
+#include <atomic>
+
+#include "src/include/ix.h"
+#include "test/utils/ix_test_utils.h"
+
+namespace PeterDBTesting {
+
+    // Insert and lookup throughput on long VarChar keys sharing a long prefix
+    // Every comparison has to scan the prefix, so key comparison dominates the descent
+    class IX_Bench_Test : public IX_Test {
+    protected:
+        unsigned numOfEntries = 50000;
+        unsigned keyLen = 200;
+        PeterDB::Attribute longKeyAttr{"long_key", PeterDB::TypeVarChar, 200};
+        unsigned insertThreadNum = 4;
+        unsigned scanThreadNum = 2;
+
+    public:
+        // Keys are inserted in a shuffled order
+        unsigned getValue(unsigned i) {
+            return i * 7919 % numOfEntries;
+        }
+
+        void prepareLongKey(unsigned value, char *key) {
+            *(unsigned *) key = keyLen;
+            memset(key + 4, 'k', keyLen - 8);
+            sprintf(key + 4 + keyLen - 8, "%08u", value);
+        }
+
+        // Every step-th entry from the first one, returns the first failure
+        // gtest assertions only abort the calling function, so worker threads report back instead
+        PeterDB::RC insertEntries(unsigned first = 0, unsigned step = 1) {
+            char key[PAGE_SIZE];
+            PeterDB::RID entryRid;
+            for (unsigned i = first; i < numOfEntries; i += step) {
+                unsigned value = getValue(i);
+                prepareLongKey(value, key);
+                entryRid.pageNum = value + 1;
+                entryRid.slotNum = value % PAGE_SIZE;
+                PeterDB::RC rc = ix.insertEntry(ixFileHandle, longKeyAttr, key, entryRid);
+                if (rc != success) return rc;
+            }
+            return success;
+        }
+
+        // Full scans while entries go in, every scan has to come out sorted without repeats
+        // Scans that fail to open or come out unsorted are counted in failedScanCount
+        void scanEntries(const std::atomic<bool> &isInserting, std::atomic<unsigned> &scanCount,
+                         std::atomic<unsigned> &failedScanCount) {
+            char key[PAGE_SIZE];
+            char lastKey[PAGE_SIZE];
+            PeterDB::RID entryRid;
+            while (isInserting) {
+                PeterDB::IX_ScanIterator scanIterator;
+                if (ix.scan(ixFileHandle, longKeyAttr, NULL, NULL, true, true, scanIterator) != success) {
+                    failedScanCount++;
+                    continue;
+                }
+                bool isFirst = true;
+                bool isSorted = true;
+                while (scanIterator.getNextEntry(entryRid, key) != IX_EOF) {
+                    if (!isFirst && memcmp(lastKey, key, keyLen + 4) >= 0) {
+                        isSorted = false;
+                    }
+                    memcpy(lastKey, key, keyLen + 4);
+                    isFirst = false;
+                }
+                if (scanIterator.close() != success || !isSorted) failedScanCount++;
+                scanCount++;
+            }
+        }
+
+        // Insert all entries from insertThreads threads while scanThreads threads scan, returns the insert time in us
+        long long insertAndScanConcurrently(unsigned insertThreads, unsigned scanThreads, unsigned &scanCount) {
+            std::atomic<bool> isInserting(true);
+            std::atomic<unsigned> scans(0);
+            std::atomic<unsigned> failedScans(0);
+            std::vector<std::thread> scanners;
+            for (unsigned i = 0; i < scanThreads; i++) {
+                scanners.emplace_back(&IX_Bench_Test::scanEntries, this, std::cref(isInserting), std::ref(scans),
+                                      std::ref(failedScans));
+            }
+
+            std::vector<PeterDB::RC> insertResults(insertThreads, success);
+            auto start = std::chrono::steady_clock::now();
+            std::vector<std::thread> inserters;
+            for (unsigned i = 0; i < insertThreads; i++) {
+                inserters.emplace_back([this, i, insertThreads, &insertResults]() {
+                    insertResults[i] = insertEntries(1 + i, insertThreads);
+                });
+            }
+            for (std::thread &t: inserters) {
+                t.join();
+            }
+            auto elapsed = std::chrono::duration_cast<std::chrono::microseconds>(
+                    std::chrono::steady_clock::now() - start).count();
+            isInserting = false;
+            for (std::thread &t: scanners) {
+                t.join();
+            }
+
+            for (PeterDB::RC rc: insertResults) {
+                EXPECT_EQ(rc, success) << "indexManager::insertEntry() should succeed.";
+            }
+            EXPECT_EQ(failedScans, 0) << "Every scan should succeed and come out sorted.";
+            scanCount = scans;
+            return elapsed;
+        }
+
+        void checkAllEntries() {
+            char key[PAGE_SIZE];
+            char expectedKey[PAGE_SIZE];
+            ASSERT_EQ(ix.scan(ixFileHandle, longKeyAttr, NULL, NULL, true, true, ix_ScanIterator), success)
+                                        << "indexManager::scan() should succeed.";
+            unsigned count = 0;
+            while (ix_ScanIterator.getNextEntry(rid, key) != IX_EOF) {
+                prepareLongKey(count, expectedKey);
+                ASSERT_EQ(memcmp(key, expectedKey, keyLen + 4), 0) << "Scan output (key) should be sorted.";
+                ASSERT_EQ(rid.pageNum, count + 1) << "Scan output (rid) should match inserted.";
+                count++;
+            }
+            ASSERT_EQ(count, numOfEntries) << "Scan outputs should match inserted.";
+        }
+
+        void logThroughput(const std::string &method, long long elapsedUs) {
+            GTEST_LOG_(INFO) << method << ": " << numOfEntries << " keys of " << keyLen << " bytes in "
+                             << elapsedUs << " us ("
+                             << (long long) numOfEntries * 1000000 / std::max(elapsedUs, 1LL) << " keys/s)";
+        }
+    };
+
+    TEST_F(IX_Bench_Test, insert_long_varchar_keys) {
+        // Functions tested
+        // 1. Insert 50000 long keys in a shuffled order
+        // 2. Scan all entries in key order
+
+        auto start = std::chrono::steady_clock::now();
+        ASSERT_EQ(insertEntries(), success) << "indexManager::insertEntry() should succeed.";
+        auto elapsed = std::chrono::duration_cast<std::chrono::microseconds>(
+                std::chrono::steady_clock::now() - start).count();
+        logThroughput("insertEntry", elapsed);
+
+        checkAllEntries();
+    }
+
+    TEST_F(IX_Bench_Test, lookup_long_varchar_keys) {
+        // Functions tested
+        // 1. Insert 50000 long keys in a shuffled order
+        // 2. Look up every key with an equality scan
+
+        char key[PAGE_SIZE];
+        char outKey[PAGE_SIZE];
+        ASSERT_EQ(insertEntries(), success) << "indexManager::insertEntry() should succeed.";
+
+        auto start = std::chrono::steady_clock::now();
+        for (unsigned i = 0; i < numOfEntries; i++) {
+            unsigned value = getValue(i);
+            prepareLongKey(value, key);
+            // Each scan reopens the iterator on the same index file
+            ASSERT_EQ(ix.scan(ixFileHandle, longKeyAttr, key, key, true, true, ix_ScanIterator), success)
+                                        << "indexManager::scan() should succeed.";
+            ASSERT_EQ(ix_ScanIterator.getNextEntry(rid, outKey), success) << "Lookup should find the key.";
+            ASSERT_EQ(rid.pageNum, value + 1) << "Lookup output (rid) should match inserted.";
+            ASSERT_EQ(ix_ScanIterator.getNextEntry(rid, outKey), IX_EOF) << "Lookup should find only one entry.";
+        }
+        auto elapsed = std::chrono::duration_cast<std::chrono::microseconds>(
+                std::chrono::steady_clock::now() - start).count();
+        logThroughput("lookup", elapsed);
+    }
+
+    TEST_F(IX_Bench_Test, concurrent_insert) {
+        // Functions tested
+        // 1. Insert 50000 long keys in a shuffled order from 4 threads, each one a disjoint share of them
+        // 2. Scan all entries in key order
+        // Inserts into different leaves only share the tree latch, so on one core this matches insert_long_varchar_keys
+
+        // The first entry creates the root
+        ASSERT_EQ(insertEntries(0, numOfEntries), success) << "indexManager::insertEntry() should succeed.";
+
+        unsigned scanCount;
+        long long elapsed = insertAndScanConcurrently(insertThreadNum, 0, scanCount);
+        logThroughput("concurrent insertEntry", elapsed);
+
+        checkAllEntries();
+    }
+
+    TEST_F(IX_Bench_Test, concurrent_insert_and_scan) {
+        // Functions tested
+        // 1. Insert 50000 long keys in a shuffled order from 4 threads, each one a disjoint share of them
+        // 2. Scan the whole index from 2 threads meanwhile, each scan is sorted
+        // 3. Scan all entries in key order
+        // The scanning threads take their share of the CPU, so inserts are slower than in concurrent_insert
+
+        // The first entry creates the root
+        ASSERT_EQ(insertEntries(0, numOfEntries), success) << "indexManager::insertEntry() should succeed.";
+
+        unsigned scanCount;
+        long long elapsed = insertAndScanConcurrently(insertThreadNum, scanThreadNum, scanCount);
+        logThroughput("concurrent insertEntry with scans", elapsed);
+        GTEST_LOG_(INFO) << scanCount << " full scans by " << scanThreadNum << " threads alongside "
+                         << insertThreadNum << " inserting threads";
+
+        checkAllEntries();
+    }
+
+}
@@ -490,12 +490,12 @@ namespace PeterDBTesting {
                                         << "indexManager::insertEntry() should succeed.";
         }
 
-        // print BTree, by this time the BTree should have height of 2
+        // print BTree, separators in index nodes are truncated to a few bytes, so the root still holds every leaf
         std::stringstream stream;
         ASSERT_EQ(ix.printBTree(ixFileHandle, empNameAttr, stream), success)
                                     << "indexManager::printBTree() should succeed";
 
-        validateTree(stream, numOfEntries, numOfEntries, 2, 2);
+        validateTree(stream, numOfEntries, numOfEntries, 1, 2, false, numOfEntries / 4);
 
         // Conduct a scan
         ASSERT_EQ(ix.scan(ixFileHandle, empNameAttr, NULL, NULL, true, true, ix_ScanIterator), success)
@@ -521,4 +521,609 @@ namespace PeterDBTesting {
 
         validateTree(stream, 1, 1, 0, 2, true);
     }
-}
\ No newline at end of file
+
+    TEST_F(IX_Private_Test, slotted_and_legacy_page_format) {
+        // Checks that pages searched by the slot array and legacy pages searched linearly agree
+        // Functions tested
+        // 1. Reopen a file written without the format version
+        // 2. Insert entries in random order into both files
+        // 3. Delete a third of the entries
+        // 4. Range scan both files
+
+        unsigned numOfEntries = 20000;
+        char key[PAGE_SIZE];
+        char lowKey[PAGE_SIZE];
+        char highKey[PAGE_SIZE];
+
+        ASSERT_EQ(ixFileHandle.getFormatVersion(), PeterDB::IX::FILE_VERSION_CURRENT)
+                                    << "New index file should use the current page format.";
+
+        // Files written before the format version have it zeroed
+        ixFileHandle2.formatVersion = 0;
+        ASSERT_EQ(ixFileHandle2.flushMetaData(), success) << "IXFileHandle::flushMetaData() should succeed.";
+        ASSERT_EQ(ix.closeFile(ixFileHandle2), success) << "indexManager::closeFile() should succeed.";
+        ASSERT_EQ(ix.openFile(indexFileName2, ixFileHandle2), success) << "indexManager::openFile() should succeed.";
+        ASSERT_EQ(ixFileHandle2.getFormatVersion(), PeterDB::IX::FILE_VERSION_LINEAR)
+                                    << "Index file without format version should use the legacy page format.";
+
+        // insert entries
+        for (unsigned i = 0; i < numOfEntries; i++) {
+            unsigned value = i * 7919 % numOfEntries;
+            *(int *) key = 8;
+            sprintf(key + 4, "%08u", value);
+            rid.pageNum = value + 1;
+            rid.slotNum = value % PAGE_SIZE;
+            ASSERT_EQ(ix.insertEntry(ixFileHandle, longEmpNameAttr, &key, rid), success)
+                                        << "indexManager::insertEntry() should succeed.";
+            ASSERT_EQ(ix.insertEntry(ixFileHandle2, longEmpNameAttr, &key, rid), success)
+                                        << "indexManager::insertEntry() should succeed.";
+        }
+
+        // delete entries
+        for (unsigned value = 0; value < numOfEntries; value += 3) {
+            *(int *) key = 8;
+            sprintf(key + 4, "%08u", value);
+            rid.pageNum = value + 1;
+            rid.slotNum = value % PAGE_SIZE;
+            ASSERT_EQ(ix.deleteEntry(ixFileHandle, longEmpNameAttr, &key, rid), success)
+                                        << "indexManager::deleteEntry() should succeed.";
+            ASSERT_EQ(ix.deleteEntry(ixFileHandle2, longEmpNameAttr, &key, rid), success)
+                                        << "indexManager::deleteEntry() should succeed.";
+        }
+        ASSERT_NE(ix.deleteEntry(ixFileHandle, longEmpNameAttr, &key, rid), success)
+                                    << "indexManager::deleteEntry() should fail on a deleted entry.";
+
+        // scan [5000, 15000)
+        *(int *) lowKey = 8;
+        sprintf(lowKey + 4, "%08u", 5000);
+        *(int *) highKey = 8;
+        sprintf(highKey + 4, "%08u", 15000);
+        ASSERT_EQ(ix.scan(ixFileHandle, longEmpNameAttr, lowKey, highKey, true, false, ix_ScanIterator), success)
+                                    << "indexManager::scan() should succeed.";
+        ASSERT_EQ(ix.scan(ixFileHandle2, longEmpNameAttr, lowKey, highKey, true, false, ix_ScanIterator2), success)
+                                    << "indexManager::scan() should succeed.";
+
+        unsigned expectedValue = 5000;
+        unsigned count = 0;
+        while (ix_ScanIterator.getNextEntry(rid, &key) != IX_EOF) {
+            if (expectedValue % 3 == 0) {
+                expectedValue++;
+            }
+            key[12] = '\0';
+            ASSERT_EQ(std::stoul(std::string(key + 4)), expectedValue) << "Scan output (value) should match inserted.";
+            ASSERT_EQ(rid.pageNum, expectedValue + 1) << "Scan output (rid) should match inserted.";
+            ASSERT_EQ(ix_ScanIterator2.getNextEntry(rid2, &key), success) << "Both scans should return the entry.";
+            ASSERT_EQ(rid2.pageNum, expectedValue + 1) << "Both scans should return the same rid.";
+            expectedValue++;
+            count++;
+        }
+        ASSERT_EQ(ix_ScanIterator2.getNextEntry(rid2, &key), IX_EOF) << "Both scans should end together.";
+        ASSERT_EQ(count, 6667) << "Scan outputs should match inserted.";
+    }
+
+    TEST_F(IX_Private_Test, bulk_load_from_sorted_runs) {
+        // Checks that a bulk loaded tree is ordered and still takes inserts and deletes
+        // Functions tested
+        // 1. Bulk load entries in random order, spilling several sorted runs
+        // 2. Insert the odd values and delete every 4th value
+        // 3. Bulk load into a non-empty index should fail
+        // 4. Scan all entries
+
+        unsigned numOfEntries = 20000;
+        char key[PAGE_SIZE];
+
+        PeterDB::IX_BulkLoader bulkLoader;
+        ASSERT_EQ(bulkLoader.open(&ixFileHandle, longEmpNameAttr), success) << "IX_BulkLoader::open() should succeed.";
+        bulkLoader.setMemoryBudget(32 * 1024);
+        bulkLoader.setFillFactor(0.7);
+        for (unsigned i = 0; i < numOfEntries; i++) {
+            unsigned value = i * 7919 % numOfEntries * 2;
+            *(int *) key = 8;
+            sprintf(key + 4, "%08u", value);
+            rid.pageNum = value + 1;
+            rid.slotNum = value % PAGE_SIZE;
+            ASSERT_EQ(bulkLoader.addEntry(&key, rid), success) << "IX_BulkLoader::addEntry() should succeed.";
+        }
+        ASSERT_EQ(bulkLoader.close(), success) << "IX_BulkLoader::close() should succeed.";
+
+        // insert odd values and delete every 4th value
+        for (unsigned i = 0; i < numOfEntries; i++) {
+            unsigned value = i * 7919 % numOfEntries * 2 + 1;
+            *(int *) key = 8;
+            sprintf(key + 4, "%08u", value);
+            rid.pageNum = value + 1;
+            rid.slotNum = value % PAGE_SIZE;
+            ASSERT_EQ(ix.insertEntry(ixFileHandle, longEmpNameAttr, &key, rid), success)
+                                        << "indexManager::insertEntry() should succeed.";
+        }
+        for (unsigned value = 0; value < numOfEntries * 2; value += 4) {
+            *(int *) key = 8;
+            sprintf(key + 4, "%08u", value);
+            rid.pageNum = value + 1;
+            rid.slotNum = value % PAGE_SIZE;
+            ASSERT_EQ(ix.deleteEntry(ixFileHandle, longEmpNameAttr, &key, rid), success)
+                                        << "indexManager::deleteEntry() should succeed.";
+        }
+
+        ASSERT_EQ(bulkLoader.open(&ixFileHandle, longEmpNameAttr), PeterDB::ERR_INDEX_NOT_EMPTY)
+                                    << "IX_BulkLoader::open() should fail on a non-empty index.";
+
+        ASSERT_EQ(ix.scan(ixFileHandle, longEmpNameAttr, NULL, NULL, true, true, ix_ScanIterator), success)
+                                    << "indexManager::scan() should succeed.";
+        unsigned expectedValue = 1;
+        unsigned count = 0;
+        while (ix_ScanIterator.getNextEntry(rid, &key) != IX_EOF) {
+            key[12] = '\0';
+            ASSERT_EQ(std::stoul(std::string(key + 4)), expectedValue) << "Scan output (value) should be sorted.";
+            ASSERT_EQ(rid.pageNum, expectedValue + 1) << "Scan output (rid) should match inserted.";
+            expectedValue += expectedValue % 4 == 3 ? 2 : 1;
+            count++;
+        }
+        ASSERT_EQ(count, numOfEntries * 2 - numOfEntries / 2) << "Scan outputs should match inserted.";
+    }
+
+    TEST_F(IX_Private_Test, bulk_load_without_empty_index_pages) {
+        // Checks that every index page of a bulk loaded tree keeps at least one key
+        // Functions tested
+        // 1. Bulk load full pages, find how many entries a leaf and how many children an index page takes
+        // 2. Bulk load one leaf more than an index page holds, the last index page starts with one child
+        // 3. Print BTree, no index page is without keys
+        // 4. Scan all entries
+
+        unsigned key;
+        unsigned leafEntryNum = 0;
+        unsigned indexChildNum = 0;
+        std::function<unsigned(TreeNode &)> countEmptyIndexPages = [&](TreeNode &node) {
+            unsigned count = 0;
+            if (!node.children.empty() && node.keyCount() == 0) count++;
+            for (auto &child: node.children) count += countEmptyIndexPages(child);
+            return count;
+        };
+
+        auto bulkLoad = [&](unsigned numOfEntries, TreeNode &root) {
+            PeterDB::IX_BulkLoader bulkLoader;
+            ASSERT_EQ(bulkLoader.open(&ixFileHandle, ageAttr), success) << "IX_BulkLoader::open() should succeed.";
+            bulkLoader.setFillFactor(1);
+            for (unsigned i = 0; i < numOfEntries; i++) {
+                key = i * 7919 % numOfEntries;
+                rid.pageNum = key + 1;
+                rid.slotNum = key % PAGE_SIZE;
+                ASSERT_EQ(bulkLoader.addEntry(&key, rid), success) << "IX_BulkLoader::addEntry() should succeed.";
+            }
+            ASSERT_EQ(bulkLoader.close(), success) << "IX_BulkLoader::close() should succeed.";
+
+            std::stringstream stream;
+            ASSERT_EQ(ix.printBTree(ixFileHandle, ageAttr, stream), success)
+                                        << "indexManager::printBTree() should succeed";
+            nlohmann::ordered_json j;
+            stream >> j;
+            root = buildTree(j);
+
+            ASSERT_EQ(ix.scan(ixFileHandle, ageAttr, NULL, NULL, true, true, ix_ScanIterator), success)
+                                        << "indexManager::scan() should succeed.";
+            unsigned count = 0;
+            while (ix_ScanIterator.getNextEntry(rid, &key) != IX_EOF) {
+                ASSERT_EQ(key, count) << "Scan output (key) should be sorted.";
+                count++;
+            }
+            ASSERT_EQ(count, numOfEntries) << "Scan outputs should match inserted.";
+
+            // Start over with an empty file
+            ASSERT_EQ(ix_ScanIterator.close(), success) << "IX_ScanIterator::close() should succeed.";
+            ASSERT_EQ(ix.closeFile(ixFileHandle), success) << "indexManager::closeFile() should succeed.";
+            ASSERT_EQ(ix.destroyFile(indexFileName), success) << "indexManager::destroyFile() should succeed.";
+            ASSERT_EQ(ix.createFile(indexFileName), success) << "indexManager::createFile() should succeed.";
+            ASSERT_EQ(ix.openFile(indexFileName, ixFileHandle), success) << "indexManager::openFile() should succeed.";
+        };
+
+        // Pages are filled completely, so all but the last page of a level are alike
+        TreeNode root;
+        bulkLoad(100000, root);
+        ASSERT_EQ(root.height(), 2) << "The tree should have two index levels.";
+        indexChildNum = root.children[0].childrenCount();
+        leafEntryNum = root.children[0].children[0].keyCount();
+
+        bulkLoad(leafEntryNum * indexChildNum + 1, root);
+        ASSERT_EQ(root.height(), 2) << "The tree should have two index levels.";
+        ASSERT_EQ(countEmptyIndexPages(root), 0) << "Index pages should keep at least one key.";
+    }
+
+    TEST_F(IX_Private_Test, posting_lists_for_low_cardinality_keys) {
+        // Checks that keys stored once with their rid lists match the one-entry-per-rid legacy format
+        // Functions tested
+        // 1. Insert a few hot keys in random rid order, spilling to overflow pages, and many cold keys
+        // 2. The posting file takes far fewer pages
+        // 3. Delete a third of the entries
+        // 4. Scan both files
+        // 5. Delete every entry of a hot key while scanning it
+
+        unsigned numOfHotEntries = 30000;
+        unsigned numOfColdKeys = 3000;
+        char key[PAGE_SIZE];
+        char key2[PAGE_SIZE];
+
+        // Files written before the format version have it zeroed
+        ixFileHandle2.formatVersion = 0;
+        ASSERT_EQ(ixFileHandle2.flushMetaData(), success) << "IXFileHandle::flushMetaData() should succeed.";
+        ASSERT_EQ(ix.closeFile(ixFileHandle2), success) << "indexManager::closeFile() should succeed.";
+        ASSERT_EQ(ix.openFile(indexFileName2, ixFileHandle2), success) << "indexManager::openFile() should succeed.";
+
+        auto prepareKey = [&](unsigned i, char *key) {
+            unsigned value = i < numOfHotEntries ? i % 5 : i;
+            *(int *) key = 40;
+            memset(key + 4, 'p', 32);
+            sprintf(key + 36, "%08u", value);
+        };
+        auto prepareRid = [&](unsigned i, PeterDB::RID &rid) {
+            rid.pageNum = i * 7919 % (numOfHotEntries + numOfColdKeys) + 1;
+            rid.slotNum = i % 50;
+        };
+
+        // insert entries
+        for (unsigned i = 0; i < numOfHotEntries + numOfColdKeys; i++) {
+            prepareKey(i, key);
+            prepareRid(i, rid);
+            ASSERT_EQ(ix.insertEntry(ixFileHandle, longEmpNameAttr, &key, rid), success)
+                                        << "indexManager::insertEntry() should succeed.";
+            ASSERT_EQ(ix.insertEntry(ixFileHandle2, longEmpNameAttr, &key, rid), success)
+                                        << "indexManager::insertEntry() should succeed.";
+        }
+        ASSERT_LT(ixFileHandle.getPageCounter() * 4, ixFileHandle2.getPageCounter())
+                                    << "Posting lists should store each hot key once.";
+
+        // delete entries
+        for (unsigned i = 0; i < numOfHotEntries + numOfColdKeys; i += 3) {
+            prepareKey(i, key);
+            prepareRid(i, rid);
+            ASSERT_EQ(ix.deleteEntry(ixFileHandle, longEmpNameAttr, &key, rid), success)
+                                        << "indexManager::deleteEntry() should succeed.";
+            ASSERT_EQ(ix.deleteEntry(ixFileHandle2, longEmpNameAttr, &key, rid), success)
+                                        << "indexManager::deleteEntry() should succeed.";
+        }
+        ASSERT_NE(ix.deleteEntry(ixFileHandle, longEmpNameAttr, &key, rid), success)
+                                    << "indexManager::deleteEntry() should fail on a deleted entry.";
+
+        ASSERT_EQ(ix.scan(ixFileHandle, longEmpNameAttr, NULL, NULL, true, true, ix_ScanIterator), success)
+                                    << "indexManager::scan() should succeed.";
+        ASSERT_EQ(ix.scan(ixFileHandle2, longEmpNameAttr, NULL, NULL, true, true, ix_ScanIterator2), success)
+                                    << "indexManager::scan() should succeed.";
+        unsigned count = 0;
+        while (ix_ScanIterator.getNextEntry(rid, &key) != IX_EOF) {
+            ASSERT_EQ(ix_ScanIterator2.getNextEntry(rid2, &key2), success) << "Both scans should return the entry.";
+            ASSERT_EQ(memcmp(key, key2, 44), 0) << "Both scans should return the same key.";
+            ASSERT_EQ(rid.pageNum, rid2.pageNum) << "Both scans should return the same rid.";
+            ASSERT_EQ(rid.slotNum, rid2.slotNum) << "Both scans should return the same rid.";
+            count++;
+        }
+        ASSERT_EQ(ix_ScanIterator2.getNextEntry(rid2, &key2), IX_EOF) << "Both scans should end together.";
+        ASSERT_EQ(count, (numOfHotEntries + numOfColdKeys) * 2 / 3) << "Scan outputs should match inserted.";
+
+        // delete a hot key while scanning it
+        prepareKey(2, key2);
+        ASSERT_EQ(ix.scan(ixFileHandle, longEmpNameAttr, key2, key2, true, true, ix_ScanIterator), success)
+                                    << "indexManager::scan() should succeed.";
+        count = 0;
+        while (ix_ScanIterator.getNextEntry(rid, &key) != IX_EOF) {
+            ASSERT_EQ(ix.deleteEntry(ixFileHandle, longEmpNameAttr, &key, rid), success)
+                                        << "indexManager::deleteEntry() should succeed.";
+            count++;
+        }
+        ASSERT_EQ(count, numOfHotEntries / 5 * 2 / 3) << "Scan outputs should match inserted.";
+        ASSERT_EQ(ix.scan(ixFileHandle, longEmpNameAttr, key2, key2, true, true, ix_ScanIterator), success)
+                                    << "indexManager::scan() should succeed.";
+        ASSERT_EQ(ix_ScanIterator.getNextEntry(rid, &key), IX_EOF) << "Deleted key should not be found.";
+    }
+
+    TEST_F(IX_Private_Test, prefix_compressed_separators_for_long_string_keys) {
+        // Checks that index pages keeping short separators without their common prefix make a lower tree
+        // Functions tested
+        // 1. Insert long keys sharing a prefix in random order into the current and a slotted file
+        // 2. Print both BTrees, the current one is lower
+        // 3. Delete a third of the entries
+        // 4. Range scan both files
+
+        unsigned numOfEntries = 20000;
+        char key[PAGE_SIZE];
+        char key2[PAGE_SIZE];
+        char lowKey[PAGE_SIZE];
+        char highKey[PAGE_SIZE];
+        PeterDB::Attribute urlAttr{"url", PeterDB::TypeVarChar, 500};
+
+        // Slotted files keep full separators
+        ixFileHandle2.formatVersion = PeterDB::IX::FILE_VERSION_SLOTTED;
+        ASSERT_EQ(ixFileHandle2.flushMetaData(), success) << "IXFileHandle::flushMetaData() should succeed.";
+        ASSERT_EQ(ix.closeFile(ixFileHandle2), success) << "indexManager::closeFile() should succeed.";
+        ASSERT_EQ(ix.openFile(indexFileName2, ixFileHandle2), success) << "indexManager::openFile() should succeed.";
+
+        auto prepareKey = [&](unsigned i, char *key) {
+            *(int *) key = 408;
+            memset(key + 4, 'u', 400);
+            sprintf(key + 404, "%08u", i);
+        };
+
+        // insert entries
+        for (unsigned i = 0; i < numOfEntries; i++) {
+            unsigned value = i * 7919 % numOfEntries;
+            prepareKey(value, key);
+            rid.pageNum = value + 1;
+            rid.slotNum = value % 50;
+            ASSERT_EQ(ix.insertEntry(ixFileHandle, urlAttr, &key, rid), success)
+                                        << "indexManager::insertEntry() should succeed.";
+            ASSERT_EQ(ix.insertEntry(ixFileHandle2, urlAttr, &key, rid), success)
+                                        << "indexManager::insertEntry() should succeed.";
+        }
+
+        std::stringstream stream;
+        ASSERT_EQ(ix.printBTree(ixFileHandle, urlAttr, stream), success)
+                                    << "indexManager::printBTree() should succeed";
+        nlohmann::ordered_json j;
+        stream >> j;
+        unsigned height = buildTree(j).height();
+        stream.str(std::string());
+        stream.clear();
+        ASSERT_EQ(ix.printBTree(ixFileHandle2, urlAttr, stream), success)
+                                    << "indexManager::printBTree() should succeed";
+        nlohmann::ordered_json j2;
+        stream >> j2;
+        ASSERT_LT(height, buildTree(j2).height()) << "Compressed separators should make a lower tree.";
+
+        // delete entries
+        for (unsigned i = 0; i < numOfEntries; i += 3) {
+            prepareKey(i, key);
+            rid.pageNum = i + 1;
+            rid.slotNum = i % 50;
+            ASSERT_EQ(ix.deleteEntry(ixFileHandle, urlAttr, &key, rid), success)
+                                        << "indexManager::deleteEntry() should succeed.";
+            ASSERT_EQ(ix.deleteEntry(ixFileHandle2, urlAttr, &key, rid), success)
+                                        << "indexManager::deleteEntry() should succeed.";
+        }
+
+        // range scan
+        prepareKey(5000, lowKey);
+        prepareKey(15000, highKey);
+        ASSERT_EQ(ix.scan(ixFileHandle, urlAttr, lowKey, highKey, true, false, ix_ScanIterator), success)
+                                    << "indexManager::scan() should succeed.";
+        ASSERT_EQ(ix.scan(ixFileHandle2, urlAttr, lowKey, highKey, true, false, ix_ScanIterator2), success)
+                                    << "indexManager::scan() should succeed.";
+        unsigned count = 0;
+        while (ix_ScanIterator.getNextEntry(rid, &key) != IX_EOF) {
+            ASSERT_EQ(ix_ScanIterator2.getNextEntry(rid2, &key2), success) << "Both scans should return the entry.";
+            ASSERT_EQ(memcmp(key, key2, 412), 0) << "Both scans should return the same key.";
+            ASSERT_EQ(rid.pageNum, rid2.pageNum) << "Both scans should return the same rid.";
+            count++;
+        }
+        ASSERT_EQ(ix_ScanIterator2.getNextEntry(rid2, &key2), IX_EOF) << "Both scans should end together.";
+        ASSERT_EQ(count, 10000 - 10000 / 3) << "Scan outputs should match inserted.";
+    }
+
+    TEST_F(IX_Private_Test, merge_on_deletion_and_reuse_freed_pages) {
+        // Checks that underflowing pages merge and the pages they leave are reused
+        // Functions tested
+        // 1. Insert entries in random order
+        // 2. Scan and delete half of the entries while scanning
+        // 3. Delete the rest, the tree shrinks to one leaf
+        // 4. Insert all entries again, no page is appended
+
+        unsigned numOfEntries = 20000;
+        unsigned key;
+
+        // insert entries
+        auto insertAll = [&]() {
+            for (unsigned i = 0; i < numOfEntries; i++) {
+                key = i * 7919 % numOfEntries;
+                rid.pageNum = key + 1;
+                rid.slotNum = key % 50;
+                ASSERT_EQ(ix.insertEntry(ixFileHandle, ageAttr, &key, rid), success)
+                                            << "indexManager::insertEntry() should succeed.";
+            }
+        };
+        insertAll();
+
+        // scan & delete every even key, pages merge under the scan
+        ASSERT_EQ(ix.scan(ixFileHandle, ageAttr, NULL, NULL, true, true, ix_ScanIterator), success)
+                                    << "indexManager::scan() should succeed.";
+        unsigned count = 0;
+        while (ix_ScanIterator.getNextEntry(rid, &key) != IX_EOF) {
+            ASSERT_EQ(key, count) << "Scan should return every key once and in order.";
+            ASSERT_EQ(rid.pageNum, key + 1) << "rid.pageNum is not correct.";
+            if (key % 2 == 0) {
+                ASSERT_EQ(ix.deleteEntry(ixFileHandle, ageAttr, &key, rid), success)
+                                            << "indexManager::deleteEntry() should succeed.";
+            }
+            count++;
+        }
+        ASSERT_EQ(count, numOfEntries) << "Scan outputs should match inserted.";
+
+        // delete the rest
+        for (unsigned i = 1; i < numOfEntries; i += 2) {
+            key = i;
+            rid.pageNum = key + 1;
+            rid.slotNum = key % 50;
+            ASSERT_EQ(ix.deleteEntry(ixFileHandle, ageAttr, &key, rid), success)
+                                        << "indexManager::deleteEntry() should succeed.";
+        }
+
+        std::stringstream stream;
+        ASSERT_EQ(ix.printBTree(ixFileHandle, ageAttr, stream), success)
+                                    << "indexManager::printBTree() should succeed";
+        nlohmann::ordered_json j;
+        stream >> j;
+        ASSERT_EQ(buildTree(j).height(), 0) << "The tree should shrink to one leaf.";
+
+        // insert again into the freed pages
+        ASSERT_EQ(ixFileHandle.collectCounterValues(rc, wc, ac), success)
+                                    << "indexManager::collectCounterValues() should succeed.";
+        insertAll();
+        ASSERT_EQ(ixFileHandle.collectCounterValues(rcAfter, wcAfter, acAfter), success)
+                                    << "indexManager::collectCounterValues() should succeed.";
+        EXPECT_EQ(acAfter - ac, 0) << "Freed pages should be reused before the file grows.";
+
+        ASSERT_EQ(ix.scan(ixFileHandle, ageAttr, NULL, NULL, true, true, ix_ScanIterator2), success)
+                                    << "indexManager::scan() should succeed.";
+        count = 0;
+        while (ix_ScanIterator2.getNextEntry(rid, &key) != IX_EOF) {
+            count++;
+        }
+        ASSERT_EQ(count, numOfEntries) << "Scan outputs should match inserted.";
+    }
+
+    TEST_F(IX_Private_Test, redo_root_and_free_pages_after_crash) {
+        // Checks that the root and the free page list are redone with the tree pages
+        // Functions tested
+        // 1. Insert entries, the root splits
+        // 2. Delete half of the entries, pages merge and are freed
+        // 3. Crash: cached pages are lost and the file is never closed
+        // 4. Reopen, every remaining entry is found and freed pages are reused
+
+        PeterDB::LogManager &logManager = PeterDB::LogManager::instance();
+        unsigned logPageCount, logSyncCount, redoPageCount, redoPageCount1;
+        unsigned numOfEntries = 20000;
+        unsigned key;
+
+        auto insertRange = [&](unsigned first, unsigned step) {
+            for (unsigned i = first; i < numOfEntries; i += step) {
+                key = i;
+                rid.pageNum = key + 1;
+                rid.slotNum = key % 50;
+                ASSERT_EQ(ix.insertEntry(ixFileHandle, ageAttr, &key, rid), success)
+                                            << "indexManager::insertEntry() should succeed.";
+            }
+        };
+        insertRange(0, 1);
+        for (unsigned i = 0; i < numOfEntries; i += 2) {
+            key = i;
+            rid.pageNum = key + 1;
+            rid.slotNum = key % 50;
+            ASSERT_EQ(ix.deleteEntry(ixFileHandle, ageAttr, &key, rid), success)
+                                        << "indexManager::deleteEntry() should succeed.";
+        }
+
+        // Crash
+        logManager.collectCounterValues(logPageCount, logSyncCount, redoPageCount);
+        uint64_t fileId = ixFileHandle.fileId;
+        ASSERT_EQ(PeterDB::BufferPool::instance().discardFile(indexFileName), success)
+                                    << "Dropping frames should succeed.";
+        ASSERT_EQ(logManager.closeLog(fileId), success) << "Detaching the log should succeed.";
+        ixFileHandle.backend->close();
+        delete ixFileHandle.backend;
+        ixFileHandle.backend = nullptr;
+
+        ASSERT_EQ(ix.openFile(indexFileName, ixFileHandle), success) << "indexManager::openFile() should succeed.";
+        logManager.collectCounterValues(logPageCount, logSyncCount, redoPageCount1);
+        ASSERT_GT(redoPageCount1, redoPageCount) << "Logged pages should be redone.";
+
+        ASSERT_EQ(ix.scan(ixFileHandle, ageAttr, NULL, NULL, true, true, ix_ScanIterator), success)
+                                    << "indexManager::scan() should succeed.";
+        unsigned count = 0;
+        while (ix_ScanIterator.getNextEntry(rid, &key) != IX_EOF) {
+            ASSERT_EQ(key, count * 2 + 1) << "Scan should return every remaining key once and in order.";
+            ASSERT_EQ(rid.pageNum, key + 1) << "rid.pageNum is not correct.";
+            count++;
+        }
+        ASSERT_EQ(count, numOfEntries / 2) << "Scan outputs should match the remaining entries.";
+
+        // insert the deleted entries again into the freed pages
+        ASSERT_EQ(ixFileHandle.collectCounterValues(rc, wc, ac), success)
+                                    << "indexManager::collectCounterValues() should succeed.";
+        insertRange(0, 2);
+        ASSERT_EQ(ixFileHandle.collectCounterValues(rcAfter, wcAfter, acAfter), success)
+                                    << "indexManager::collectCounterValues() should succeed.";
+        EXPECT_EQ(acAfter - ac, 0) << "Freed pages should be reused before the file grows.";
+    }
+
+    TEST_F(IX_Private_Test, split_with_full_and_truncated_separators) {
+        // Checks splits of the prefix format against the posting format, which keeps whole separators
+        // Functions tested
+        // 1. Insert entries in random order into the current and a posting file
+        // 2. Print both BTrees, the posting one promotes a level once its root holds 4 keys
+
+        unsigned numOfEntries = 21;
+        char key[PAGE_SIZE];
+        empNameAttr.length = PAGE_SIZE / 5; // each node can only occupy 4 keys
+
+        ixFileHandle2.formatVersion = PeterDB::IX::FILE_VERSION_POSTING;
+        ASSERT_EQ(ixFileHandle2.flushMetaData(), success) << "IXFileHandle::flushMetaData() should succeed.";
+        ASSERT_EQ(ix.closeFile(ixFileHandle2), success) << "indexManager::closeFile() should succeed.";
+        ASSERT_EQ(ix.openFile(indexFileName2, ixFileHandle2), success) << "indexManager::openFile() should succeed.";
+
+        std::vector<unsigned> keys(numOfEntries);
+        std::iota(keys.begin(), keys.end(), 1);
+        std::shuffle(keys.begin(), keys.end(), std::mt19937(std::random_device()()));
+
+        // insert entries
+        for (unsigned &k: keys) {
+            prepareKeyAndRid(k, key, rid, empNameAttr.length);
+            ASSERT_EQ(ix.insertEntry(ixFileHandle, empNameAttr, &key, rid), success)
+                                        << "indexManager::insertEntry() should succeed.";
+            ASSERT_EQ(ix.insertEntry(ixFileHandle2, empNameAttr, &key, rid), success)
+                                        << "indexManager::insertEntry() should succeed.";
+        }
+
+        // Truncated separators leave room for every leaf in the root
+        std::stringstream stream;
+        ASSERT_EQ(ix.printBTree(ixFileHandle, empNameAttr, stream), success)
+                                    << "indexManager::printBTree() should succeed";
+        validateTree(stream, numOfEntries, numOfEntries, 1, 2, false, numOfEntries / 4);
+
+        // Whole separators fill index nodes as fast as leaves
+        stream.str(std::string());
+        stream.clear();
+        ASSERT_EQ(ix.printBTree(ixFileHandle2, empNameAttr, stream), success)
+                                    << "indexManager::printBTree() should succeed";
+        validateTree(stream, numOfEntries, numOfEntries, 2, 2);
+    }
+
+    TEST_F(IX_Private_Test, merge_with_full_and_truncated_separators) {
+        // Checks merges of the prefix format against the posting format, which keeps whole separators
+        // Functions tested
+        // 1. Insert entries into the current and a posting file
+        // 2. Delete the "unsafe one" from both
+        // 3. Print both BTrees, the posting one merges its index nodes and loses a level
+
+        unsigned numOfEntries = 13;
+        char key[PAGE_SIZE];
+        empNameAttr.length = PAGE_SIZE / 5;  // Each node could only have 4 children
+
+        ixFileHandle2.formatVersion = PeterDB::IX::FILE_VERSION_POSTING;
+        ASSERT_EQ(ixFileHandle2.flushMetaData(), success) << "IXFileHandle::flushMetaData() should succeed.";
+        ASSERT_EQ(ix.closeFile(ixFileHandle2), success) << "indexManager::closeFile() should succeed.";
+        ASSERT_EQ(ix.openFile(indexFileName2, ixFileHandle2), success) << "indexManager::openFile() should succeed.";
+
+        // insert entries
+        for (unsigned i = 1; i <= numOfEntries; i++) {
+            prepareKeyAndRid(i, key, rid, empNameAttr.length);
+            ASSERT_EQ(ix.insertEntry(ixFileHandle, empNameAttr, &key, rid), success)
+                                        << "indexManager::insertEntry() should succeed.";
+            ASSERT_EQ(ix.insertEntry(ixFileHandle2, empNameAttr, &key, rid), success)
+                                        << "indexManager::insertEntry() should succeed.";
+        }
+
+        std::stringstream stream;
+        ASSERT_EQ(ix.printBTree(ixFileHandle, empNameAttr, stream), success)
+                                    << "indexManager::printBTree() should succeed";
+        validateTree(stream, 13, 13, 1, 2, false, 3);
+        stream.str(std::string());
+        stream.clear();
+        ASSERT_EQ(ix.printBTree(ixFileHandle2, empNameAttr, stream), success)
+                                    << "indexManager::printBTree() should succeed";
+        validateTree(stream, 13, 13, 2, 2);
+
+        // delete the 2nd entry
+        prepareKeyAndRid(2, key, rid, empNameAttr.length);
+        ASSERT_EQ(ix.deleteEntry(ixFileHandle, empNameAttr, key, rid), success)
+                                    << "indexManager::deleteEntry() should succeed.";
+        ASSERT_EQ(ix.deleteEntry(ixFileHandle2, empNameAttr, key, rid), success)
+                                    << "indexManager::deleteEntry() should succeed.";
+
+        stream.str(std::string());
+        stream.clear();
+        ASSERT_EQ(ix.printBTree(ixFileHandle, empNameAttr, stream), success)
+                                    << "indexManager::printBTree() should succeed";
+        validateTree(stream, 12, 12, 1, 2, false, 3);
+        stream.str(std::string());
+        stream.clear();
+        ASSERT_EQ(ix.printBTree(ixFileHandle2, empNameAttr, stream), success)
+                                    << "indexManager::printBTree() should succeed";
+        validateTree(stream, 12, 12, 1, 2);
+    }
+}
@@ -126,4 +126,375 @@ namespace PeterDBTesting {
         ASSERT_GT(getFileSize(fileName), 0) << "File Size should not be zero at this moment.";
     }
 
-}
\ No newline at end of file
+    TEST_F (PFM_Private_Test, check_buffer_pool_counters) {
+        // Functions Tested:
+        // 1. Append Page
+        // 2. Read Page repeatedly
+        // 3. Reopen File and Read Page
+        // 4. Get Counter Values with buffer hits and misses
+
+        unsigned readPageCount = 0, writePageCount = 0, appendPageCount = 0;
+        unsigned bufferHitCount = 0, bufferMissCount = 0;
+
+        inBuffer = malloc(PAGE_SIZE);
+        outBuffer = malloc(PAGE_SIZE);
+        generateData(inBuffer, PAGE_SIZE, 11, 17);
+        ASSERT_EQ(fileHandle.appendPage(inBuffer), success) << "Appending a page should succeed.";
+
+        // Appended page stays cached, every read is a hit
+        int numReads = 10;
+        for (int i = 0; i < numReads; i++) {
+            ASSERT_EQ(fileHandle.readPage(0, outBuffer), success) << "Reading a page should succeed.";
+            ASSERT_EQ(memcmp(inBuffer, outBuffer, PAGE_SIZE), 0) << "Checking the integrity of the page should succeed.";
+        }
+        ASSERT_EQ(fileHandle.collectCounterValues(readPageCount, writePageCount, appendPageCount,
+                                                  bufferHitCount, bufferMissCount), success)
+                                    << "Collecting counters should succeed.";
+        ASSERT_EQ(readPageCount, numReads) << "Read counter should count every page access.";
+        ASSERT_EQ(bufferHitCount, numReads) << "Buffer hit counter should be correct.";
+        ASSERT_EQ(bufferMissCount, 0) << "Buffer miss counter should be correct.";
+
+        // Written page is still visible after reopening the file
+        generateData(inBuffer, PAGE_SIZE, 19, 23);
+        ASSERT_EQ(fileHandle.writePage(0, inBuffer), success) << "Writing a page should succeed.";
+        reopenFile();
+        ASSERT_EQ(fileHandle.readPage(0, outBuffer), success) << "Reading a page should succeed.";
+        ASSERT_EQ(memcmp(inBuffer, outBuffer, PAGE_SIZE), 0) << "Checking the integrity of the page should succeed.";
+        ASSERT_EQ(fileHandle.collectCounterValues(readPageCount, writePageCount, appendPageCount,
+                                                  bufferHitCount, bufferMissCount), success)
+                                    << "Collecting counters should succeed.";
+        ASSERT_EQ(bufferHitCount + bufferMissCount, 1) << "Buffer counters should only cover this handle.";
+    }
+
+    TEST_F (PFM_Private_Test, check_page_num_rebuilt_from_file_size) {
+        // Functions Tested:
+        // 1. Append Pages without flushing metadata
+        // 2. Open the same file with another handle
+        // 3. Get Number Of Pages from the new handle
+
+        inBuffer = malloc(PAGE_SIZE);
+        outBuffer = malloc(PAGE_SIZE);
+        int numPages = 5;
+        for (int i = 0; i < numPages; i++) {
+            generateData(inBuffer, PAGE_SIZE, 31 + i, 29 - i);
+            ASSERT_EQ(fileHandle.appendPage(inBuffer), success) << "Appending a page should succeed.";
+        }
+
+        // Counters of the first handle are not persisted yet
+        PeterDB::FileHandle otherFileHandle;
+        ASSERT_EQ(pfm.openFile(fileName, otherFileHandle), success) << "Opening the file should not fail.";
+        ASSERT_EQ(otherFileHandle.getNumberOfPages(), numPages) << "The page count should be rebuilt from file size.";
+        ASSERT_EQ(otherFileHandle.readPage(numPages - 1, outBuffer), success) << "Reading a page should succeed.";
+        ASSERT_EQ(memcmp(inBuffer, outBuffer, PAGE_SIZE), 0) << "Checking the integrity of the page should succeed.";
+        ASSERT_EQ(pfm.closeFile(otherFileHandle), success) << "Closing the file should not fail.";
+    }
+
+    TEST_F (PFM_Private_Test, check_fstream_storage_backend) {
+        // Functions Tested:
+        // 1. Append and Write Pages with the fd backend
+        // 2. Reopen File with the fstream backend
+        // 3. Read Pages back
+
+        inBuffer = malloc(PAGE_SIZE);
+        outBuffer = malloc(PAGE_SIZE);
+        int numPages = 3;
+        for (int i = 0; i < numPages; i++) {
+            generateData(inBuffer, PAGE_SIZE, 41 + i, 37 - i);
+            ASSERT_EQ(fileHandle.appendPage(inBuffer), success) << "Appending a page should succeed.";
+        }
+
+        // Pages cached by the buffer pool are dropped, so reads go to the fstream backend
+        ASSERT_EQ(pfm.closeFile(fileHandle), success) << "Closing the file should not fail.";
+        ASSERT_EQ(PeterDB::BufferPool::instance().discardFile(fileName), success) << "Discarding cached pages should succeed.";
+        pfm.setStorageBackendType(PeterDB::StorageFstream);
+        fileHandle = PeterDB::FileHandle();
+        ASSERT_EQ(pfm.openFile(fileName, fileHandle), success) << "Opening the file should not fail: " << fileName;
+        pfm.setStorageBackendType(PeterDB::StorageFd);
+        fileHandle.setPrefetchDepth(0);
+
+        ASSERT_EQ(fileHandle.getNumberOfPages(), numPages) << "The page count should not have been changed.";
+        for (int i = 0; i < numPages; i++) {
+            generateData(inBuffer, PAGE_SIZE, 41 + i, 37 - i);
+            ASSERT_EQ(fileHandle.readPage(i, outBuffer), success) << "Reading a page should succeed.";
+            ASSERT_EQ(memcmp(inBuffer, outBuffer, PAGE_SIZE), 0) << "Checking the integrity of the page should succeed.";
+        }
+        unsigned readPageCount, writePageCount, appendPageCount, bufferHitCount, bufferMissCount;
+        ASSERT_EQ(fileHandle.collectCounterValues(readPageCount, writePageCount, appendPageCount,
+                                                  bufferHitCount, bufferMissCount), success)
+                                    << "Collecting counter values should succeed.";
+        ASSERT_EQ(bufferMissCount, numPages) << "Every page should be read from the fstream backend.";
+    }
+
+    TEST_F (PFM_Private_Test, check_free_space_map_persisted) {
+        // Functions Tested:
+        // 1. Append Pages, free space starts unknown
+        // 2. Set Page Free Space and find a page with enough free space
+        // 3. Reopen File and check the free space map again
+
+        inBuffer = malloc(PAGE_SIZE);
+        generateData(inBuffer, PAGE_SIZE, 13, 7);
+        int numPages = 4;
+        for (int i = 0; i < numPages; i++) {
+            ASSERT_EQ(fileHandle.appendPage(inBuffer), success) << "Appending a page should succeed.";
+            ASSERT_FALSE(fileHandle.isPageFreeSpaceKnown(i)) << "Free space of a new page should be unknown.";
+        }
+
+        for (int i = 0; i < numPages; i++) {
+            ASSERT_EQ(fileHandle.setPageFreeSpace(i, 100 * i), success) << "Setting free space should succeed.";
+        }
+        PeterDB::PageNum pageNum;
+        ASSERT_EQ(fileHandle.findPageWithFreeSpace(150, 0, pageNum), success) << "A page should have enough space.";
+        ASSERT_EQ(pageNum, 2) << "The first page with enough space should be found.";
+        ASSERT_NE(fileHandle.findPageWithFreeSpace(500, 0, pageNum), success) << "No page should have enough space.";
+
+        reopenFile();
+
+        for (int i = 0; i < numPages; i++) {
+            ASSERT_TRUE(fileHandle.isPageFreeSpaceKnown(i)) << "Free space should be persisted.";
+            ASSERT_LE(fileHandle.getPageFreeSpace(i), 100 * i) << "Free space should be a lower bound.";
+            ASSERT_GT(fileHandle.getPageFreeSpace(i) + PeterDB::PFM::FSM_BUCKET_BYTES, 100 * i)
+                                        << "Free space should be accurate to a bucket.";
+        }
+        ASSERT_EQ(fileHandle.findPageWithFreeSpace(150, 0, pageNum), success) << "A page should have enough space.";
+        ASSERT_EQ(pageNum, 2) << "The first page with enough space should be found.";
+    }
+
+    TEST_F (PFM_Private_Test, check_vectored_page_io) {
+        // Functions Tested:
+        // 1. Append Pages in one call
+        // 2. Read and Write consecutive Pages in one call
+        // 3. Counters are incremented per page
+        // 4. Reopen File and Read Pages back
+
+        unsigned readPageCount = 0, writePageCount = 0, appendPageCount = 0;
+        unsigned readPageCount1 = 0, writePageCount1 = 0, appendPageCount1 = 0;
+        int numPages = 100;
+        inBuffer = malloc(PAGE_SIZE * numPages);
+        outBuffer = malloc(PAGE_SIZE * numPages);
+        for (int i = 0; i < numPages; i++) {
+            generateData((char *) inBuffer + i * PAGE_SIZE, PAGE_SIZE, 17 + i, 43 - i);
+        }
+        ASSERT_EQ(fileHandle.appendPages(inBuffer, numPages), success) << "Appending pages should succeed.";
+        ASSERT_EQ(fileHandle.getNumberOfPages(), numPages) << "The page count should be " << numPages << ".";
+        ASSERT_EQ(getFileSize(fileName), (numPages + 1) * PAGE_SIZE) << "File size should have been increased.";
+
+        ASSERT_EQ(fileHandle.collectCounterValues(readPageCount, writePageCount, appendPageCount), success)
+                                    << "Collecting counters should succeed.";
+        ASSERT_EQ(fileHandle.readPages(0, numPages, outBuffer), success) << "Reading pages should succeed.";
+        ASSERT_EQ(memcmp(inBuffer, outBuffer, PAGE_SIZE * numPages), 0)
+                                    << "Checking the integrity of the pages should succeed.";
+        ASSERT_NE(fileHandle.readPages(numPages - 1, 2, outBuffer), success)
+                                    << "Reading pages out of the file should fail.";
+
+        // Overwrite a range of pages, one of them cached and modified by writePage before
+        for (int i = 10; i < 80; i++) {
+            generateData((char *) inBuffer + i * PAGE_SIZE, PAGE_SIZE, 71 + i, 13 + i);
+        }
+        ASSERT_EQ(fileHandle.writePage(10, (char *) inBuffer + 10 * PAGE_SIZE), success)
+                                    << "Writing a page should succeed.";
+        ASSERT_EQ(fileHandle.writePages(10, 70, (char *) inBuffer + 10 * PAGE_SIZE), success)
+                                    << "Writing pages should succeed.";
+        ASSERT_EQ(fileHandle.collectCounterValues(readPageCount1, writePageCount1, appendPageCount1), success)
+                                    << "Collecting counters should succeed.";
+        ASSERT_EQ(readPageCount1 - readPageCount, numPages) << "Read counter should count every page.";
+        ASSERT_EQ(writePageCount1 - writePageCount, 71) << "Write counter should count every page.";
+        ASSERT_EQ(appendPageCount1, numPages) << "Append counter should count every page.";
+
+        reopenFile();
+        ASSERT_EQ(fileHandle.getNumberOfPages(), numPages) << "The page count should not have been changed.";
+        memset(outBuffer, 0, PAGE_SIZE * numPages);
+        ASSERT_EQ(fileHandle.readPages(0, numPages, outBuffer), success) << "Reading pages should succeed.";
+        ASSERT_EQ(memcmp(inBuffer, outBuffer, PAGE_SIZE * numPages), 0)
+                                    << "Checking the integrity of the pages should succeed.";
+    }
+
+    TEST_F (PFM_Private_Test, check_sequential_prefetch) {
+        // Functions Tested:
+        // 1. Sequential Page reads are prefetched into the buffer pool
+        // 2. Prefetched Pages are read back correctly
+        // 3. Prefetched Pages evicted before being read are counted as wasted
+
+        PeterDB::BufferPool &bufferPool = PeterDB::BufferPool::instance();
+        PeterDB::Prefetcher &prefetcher = PeterDB::Prefetcher::instance();
+        unsigned prefetchCount = 0, prefetchHitCount = 0, prefetchWastedCount = 0;
+        unsigned prefetchCount1 = 0, prefetchHitCount1 = 0, prefetchWastedCount1 = 0;
+        int numPages = 64;
+        inBuffer = malloc(PAGE_SIZE * numPages);
+        outBuffer = malloc(PAGE_SIZE);
+        for (int i = 0; i < numPages; i++) {
+            generateData((char *) inBuffer + i * PAGE_SIZE, PAGE_SIZE, 29 + i, 61 - i);
+        }
+        ASSERT_EQ(fileHandle.appendPages(inBuffer, numPages), success) << "Appending pages should succeed.";
+
+        // Read all pages in order, letting the prefetcher catch up after every read
+        bufferPool.collectPrefetchCounterValues(prefetchCount, prefetchHitCount, prefetchWastedCount);
+        for (int i = 0; i < numPages; i++) {
+            ASSERT_EQ(fileHandle.readPage(i, outBuffer), success) << "Reading a page should succeed.";
+            ASSERT_EQ(memcmp((char *) inBuffer + i * PAGE_SIZE, outBuffer, PAGE_SIZE), 0)
+                                        << "Checking the integrity of the page should succeed.";
+            prefetcher.waitIdle();
+        }
+        bufferPool.collectPrefetchCounterValues(prefetchCount1, prefetchHitCount1, prefetchWastedCount1);
+        ASSERT_GT(prefetchCount1 - prefetchCount, 0) << "Sequential reads should be prefetched.";
+        ASSERT_GE(prefetchHitCount1 - prefetchHitCount, numPages - 2 * PeterDB::PFM::PREFETCH_TRIGGER_RUN)
+                                    << "Pages after the first few should have been prefetched.";
+
+        // Read ahead then jump away in a small buffer pool, the prefetched pages are evicted unread
+        reopenFile();
+        ASSERT_EQ(bufferPool.setFrameNum(16), success) << "Resizing the buffer pool should succeed.";
+        fileHandle.setPrefetchDepth(8);
+        bufferPool.collectPrefetchCounterValues(prefetchCount, prefetchHitCount, prefetchWastedCount);
+        for (int i = 0; i < 2; i++) {
+            ASSERT_EQ(fileHandle.readPage(i, outBuffer), success) << "Reading a page should succeed.";
+        }
+        prefetcher.waitIdle();
+        for (int i = 20; i < numPages; i += 2) {
+            ASSERT_EQ(fileHandle.readPage(i, outBuffer), success) << "Reading a page should succeed.";
+            ASSERT_EQ(memcmp((char *) inBuffer + i * PAGE_SIZE, outBuffer, PAGE_SIZE), 0)
+                                        << "Checking the integrity of the page should succeed.";
+        }
+        prefetcher.waitIdle();
+        bufferPool.collectPrefetchCounterValues(prefetchCount1, prefetchHitCount1, prefetchWastedCount1);
+        ASSERT_EQ(prefetchCount1 - prefetchCount, 8) << "The next 8 pages should have been prefetched.";
+        ASSERT_EQ(prefetchHitCount1 - prefetchHitCount, 0) << "No prefetched page should have been read.";
+        ASSERT_EQ(prefetchWastedCount1 - prefetchWastedCount, 8) << "Every prefetched page should be wasted.";
+
+        ASSERT_EQ(bufferPool.setFrameNum(PeterDB::PFM::BUFFER_POOL_FRAME_NUM_DEFAULT), success)
+                                    << "Resizing the buffer pool should succeed.";
+    }
+
+    TEST_F (PFM_Private_Test, check_redo_log_after_crash) {
+        // Functions Tested:
+        // 1. Page changes are logged and synced in groups
+        // 2. Dirty Pages lost in a crash are redone when the File is reopened
+        // 3. Closing the File checkpoints it and drops the log
+
+        PeterDB::LogManager &logManager = PeterDB::LogManager::instance();
+        unsigned logPageCount = 0, logSyncCount = 0, redoPageCount = 0;
+        unsigned logPageCount1 = 0, logSyncCount1 = 0, redoPageCount1 = 0;
+        std::string logFileName = PeterDB::LogManager::getLogFileName(fileName);
+        int numPages = 8;
+        int groupCommitSize = 4;
+        inBuffer = malloc(PAGE_SIZE * numPages);
+        outBuffer = malloc(PAGE_SIZE);
+        for (int i = 0; i < numPages; i++) {
+            generateData((char *) inBuffer + i * PAGE_SIZE, PAGE_SIZE, 37 + i, 19 + i);
+        }
+        ASSERT_EQ(fileHandle.appendPages(inBuffer, numPages), success) << "Appending pages should succeed.";
+        reopenFile();
+        ASSERT_FALSE(fileExists(logFileName)) << "A checkpointed file should have no log.";
+
+        // Overwrite every page, changes are only kept in the buffer pool and the log
+        // Only full groups are synced while the pages are written
+        logManager.setGroupCommitSize(groupCommitSize);
+        logManager.setGroupCommitInterval(0);
+        logManager.collectCounterValues(logPageCount, logSyncCount, redoPageCount);
+        for (int i = 0; i < numPages; i++) {
+            generateData((char *) inBuffer + i * PAGE_SIZE, PAGE_SIZE, 53 + i, 7 + i);
+            ASSERT_EQ(fileHandle.writePage(i, (char *) inBuffer + i * PAGE_SIZE), success)
+                                        << "Writing a page should succeed.";
+        }
+        logManager.collectCounterValues(logPageCount1, logSyncCount1, redoPageCount1);
+        logManager.setGroupCommitSize(PeterDB::PFM::WAL_GROUP_COMMIT_DEFAULT);
+        logManager.setGroupCommitInterval(PeterDB::PFM::WAL_GROUP_COMMIT_INTERVAL_MS);
+        ASSERT_EQ(logPageCount1 - logPageCount, numPages) << "Every page change should be logged.";
+        ASSERT_EQ(logSyncCount1 - logSyncCount, numPages / groupCommitSize) << "The log should be synced per group.";
+        ASSERT_TRUE(fileExists(logFileName)) << "The log should have been written.";
+
+        // Crash: cached pages are lost and the handle is never closed
+        uint64_t fileId = fileHandle.fileId;
+        ASSERT_EQ(PeterDB::BufferPool::instance().discardFile(fileName), success) << "Dropping frames should succeed.";
+        ASSERT_EQ(logManager.closeLog(fileId), success) << "Detaching the log should succeed.";
+        fileHandle.backend->close();
+        delete fileHandle.backend;
+        fileHandle = PeterDB::FileHandle();
+
+        ASSERT_EQ(pfm.openFile(fileName, fileHandle), success) << "Opening the file should succeed.";
+        logManager.collectCounterValues(logPageCount, logSyncCount, redoPageCount);
+        ASSERT_EQ(redoPageCount - redoPageCount1, numPages) << "Every logged page should be redone.";
+        for (int i = 0; i < numPages; i++) {
+            ASSERT_EQ(fileHandle.readPage(i, outBuffer), success) << "Reading a page should succeed.";
+            ASSERT_EQ(memcmp((char *) inBuffer + i * PAGE_SIZE, outBuffer, PAGE_SIZE), 0)
+                                        << "Checking the integrity of the redone page should succeed.";
+        }
+
+        // A clean close leaves nothing to redo
+        reopenFile();
+        ASSERT_FALSE(fileExists(logFileName)) << "Closing the file should drop its log.";
+        logManager.collectCounterValues(logPageCount1, logSyncCount1, redoPageCount1);
+        ASSERT_EQ(redoPageCount1, redoPageCount) << "Nothing should be redone after a clean close.";
+    }
+
+    TEST_F (PFM_Private_Test, check_group_commit_time_bound) {
+        // Functions Tested:
+        // 1. A change that never fills a group is synced once it is older than the interval
+
+        PeterDB::LogManager &logManager = PeterDB::LogManager::instance();
+        unsigned logPageCount = 0, logSyncCount = 0, redoPageCount = 0;
+        unsigned logPageCount1 = 0, logSyncCount1 = 0, redoPageCount1 = 0;
+        inBuffer = malloc(PAGE_SIZE);
+        generateData(inBuffer, PAGE_SIZE, 41, 13);
+        ASSERT_EQ(fileHandle.appendPage(inBuffer), success) << "Appending a page should succeed.";
+        reopenFile();
+
+        // A lone change, far from a full group
+        logManager.collectCounterValues(logPageCount, logSyncCount, redoPageCount);
+        generateData(inBuffer, PAGE_SIZE, 59, 3);
+        ASSERT_EQ(fileHandle.writePage(0, inBuffer), success) << "Writing a page should succeed.";
+        logManager.collectCounterValues(logPageCount1, logSyncCount1, redoPageCount1);
+        for (int i = 0; i < 100 && logSyncCount1 == logSyncCount; i++) {
+            std::this_thread::sleep_for(std::chrono::milliseconds(PeterDB::PFM::WAL_GROUP_COMMIT_INTERVAL_MS));
+            logManager.collectCounterValues(logPageCount1, logSyncCount1, redoPageCount1);
+        }
+        ASSERT_EQ(logPageCount1 - logPageCount, 1) << "The page change should be logged.";
+        ASSERT_EQ(logSyncCount1 - logSyncCount, 1) << "The change should be synced without a full group.";
+    }
+
+    TEST_F (PFM_Private_Test, check_checkpoint_skips_pinned_page) {
+        // Functions Tested:
+        // 1. A checkpoint does not write back a page pinned in the middle of a change
+        // 2. The log record of that page survives the checkpoint and is redone after a crash
+
+        PeterDB::LogManager &logManager = PeterDB::LogManager::instance();
+        std::string logFileName = PeterDB::LogManager::getLogFileName(fileName);
+        int numPages = 4;
+        inBuffer = malloc(PAGE_SIZE * numPages);
+        outBuffer = malloc(PAGE_SIZE);
+        for (int i = 0; i < numPages; i++) {
+            generateData((char *) inBuffer + i * PAGE_SIZE, PAGE_SIZE, 29 + i, 11 + i);
+        }
+        ASSERT_EQ(fileHandle.appendPages(inBuffer, numPages), success) << "Appending pages should succeed.";
+        reopenFile();
+
+        // Overwrite every page, then change page 1 in place without unpinning it
+        for (int i = 0; i < numPages; i++) {
+            generateData((char *) inBuffer + i * PAGE_SIZE, PAGE_SIZE, 61 + i, 5 + i);
+            ASSERT_EQ(fileHandle.writePage(i, (char *) inBuffer + i * PAGE_SIZE), success)
+                                        << "Writing a page should succeed.";
+        }
+        uint8_t *frameData = nullptr;
+        ASSERT_EQ(fileHandle.pinPage(1, frameData), success) << "Pinning a page should succeed.";
+        memset(frameData, 0xAB, PAGE_SIZE);
+        ASSERT_EQ(fileHandle.checkpoint(), success) << "Checkpointing the file should succeed.";
+        ASSERT_TRUE(fileExists(logFileName)) << "The record of the pinned page should be kept.";
+        ASSERT_EQ(fileHandle.unpinPage(1, false), success) << "Unpinning a page should succeed.";
+
+        // Crash: the half changed page never reaches the disk
+        uint64_t fileId = fileHandle.fileId;
+        ASSERT_EQ(PeterDB::BufferPool::instance().discardFile(fileName), success) << "Dropping frames should succeed.";
+        ASSERT_EQ(logManager.closeLog(fileId), success) << "Detaching the log should succeed.";
+        fileHandle.backend->close();
+        delete fileHandle.backend;
+        fileHandle = PeterDB::FileHandle();
+
+        ASSERT_EQ(pfm.openFile(fileName, fileHandle), success) << "Opening the file should succeed.";
+        for (int i = 0; i < numPages; i++) {
+            ASSERT_EQ(fileHandle.readPage(i, outBuffer), success) << "Reading a page should succeed.";
+            ASSERT_EQ(memcmp((char *) inBuffer + i * PAGE_SIZE, outBuffer, PAGE_SIZE), 0)
+                                        << "Checking the integrity of the page should succeed.";
+        }
+        reopenFile();
+        ASSERT_FALSE(fileExists(logFileName)) << "Closing the file should drop its log.";
+    }
+
+}
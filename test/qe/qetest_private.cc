@@ -716,5 +716,332 @@ namespace PeterDBTesting {
 
     }
 
+    TEST_F(QE_Private_Test, composite_index_prefix_and_range_scan) {
+        // Functions Tested
+        // Create an index on (B, A) after inserting tuples
+        // Insert, update and delete tuples with the index in place
+        // Index scan on the prefix (B) and on a range of (B, A)
+
+        inBuffer = malloc(bufSize);
+        outBuffer = malloc(bufSize);
+        char lowKey[bufSize];
+        char highKey[bufSize];
+
+        std::string tableName = "left";
+        createAndPopulateTable(tableName, {}, 1000);
+        ASSERT_EQ(rm.createIndex(tableName, std::vector<std::string>{"B", "A"}), success)
+                                    << "RelationManager.createIndex() should succeed.";
+        ASSERT_EQ(glob(".idx").size(), 1) << "There should be one index file now.";
+
+        for (unsigned i = 1000; i < 1100; i++) {
+            prepareLeftTuple(nullsIndicator, i, inBuffer);
+            ASSERT_EQ(rm.insertTuple(tableName, inBuffer, rid), success);
+            rids.emplace_back(rid);
+        }
+        for (unsigned i = 0; i < 10; i++) {
+            ASSERT_EQ(rm.deleteTuple(tableName, rids[i]), success);
+        }
+        for (unsigned i = 10; i < 20; i++) {
+            prepareLeftTuple(nullsIndicator, i + 500, inBuffer);
+            ASSERT_EQ(rm.updateTuple(tableName, inBuffer, rids[i]), success);
+        }
+
+        // Expected (B, A) pairs from a full table scan
+        std::vector<std::pair<int, int>> tuples;
+        PeterDB::RM_ScanIterator rmsi;
+        ASSERT_EQ(rm.scan(tableName, "", PeterDB::NO_OP, nullptr, {"B", "A"}, rmsi), success);
+        while (rmsi.getNextTuple(rid, outBuffer) != RM_EOF) {
+            int b = *(int *) ((char *) outBuffer + 1);
+            int a = *(int *) ((char *) outBuffer + 1 + sizeof(int));
+            tuples.emplace_back(b, a);
+        }
+        rmsi.close();
+        std::sort(tuples.begin(), tuples.end());
+
+        // Prefix scan: B = 50
+        std::vector<std::pair<int, int>> expected;
+        for (auto &tuple: tuples) {
+            if (tuple.first == 50) expected.push_back(tuple);
+        }
+        ASSERT_FALSE(expected.empty());
+        memset(lowKey, 0, bufSize);
+        *(int *) (lowKey + 1) = 50;
+        PeterDB::RM_IndexScanIterator rmisi;
+        ASSERT_EQ(rm.indexScan(tableName, std::vector<std::string>{"B"}, lowKey, lowKey, true, true, rmisi), success);
+        std::vector<std::pair<int, int>> scanned;
+        while (rmisi.getNextEntry(rid, outBuffer) != RM_EOF) {
+            int b = *(int *) ((char *) outBuffer + 1);
+            int a = *(int *) ((char *) outBuffer + 1 + sizeof(int));
+            scanned.emplace_back(b, a);
+
+            // The entry should point to a tuple with the same key
+            ASSERT_EQ(rm.readTuple(tableName, rid, inBuffer), success);
+            ASSERT_EQ(*(int *) ((char *) inBuffer + 1), a);
+            ASSERT_EQ(*(int *) ((char *) inBuffer + 1 + sizeof(int)), b);
+        }
+        rmisi.close();
+        ASSERT_EQ(scanned, expected) << "The prefix scan should return all keys with B = 50 in order.";
+
+        // Range scan: (50, 100) < (B, A) <= (60, 20)
+        expected.clear();
+        for (auto &tuple: tuples) {
+            if (tuple > std::make_pair(50, 100) && tuple <= std::make_pair(60, 20)) expected.push_back(tuple);
+        }
+        ASSERT_FALSE(expected.empty());
+        memset(lowKey, 0, bufSize);
+        *(int *) (lowKey + 1) = 50;
+        *(int *) (lowKey + 1 + sizeof(int)) = 100;
+        memset(highKey, 0, bufSize);
+        *(int *) (highKey + 1) = 60;
+        *(int *) (highKey + 1 + sizeof(int)) = 20;
+        ASSERT_EQ(rm.indexScan(tableName, std::vector<std::string>{"B", "A"}, lowKey, highKey, false, true, rmisi),
+                  success);
+        scanned.clear();
+        while (rmisi.getNextEntry(rid, outBuffer) != RM_EOF) {
+            scanned.emplace_back(*(int *) ((char *) outBuffer + 1), *(int *) ((char *) outBuffer + 1 + sizeof(int)));
+        }
+        rmisi.close();
+        ASSERT_EQ(scanned, expected) << "The range scan should return all keys in the range in order.";
+
+    }
+
+    TEST_F(QE_Private_Test, composite_index_name_checks) {
+        // Functions Tested
+        // An attribute name with an index name delimiter is rejected
+        // An index whose name or file name does not fit in the catalog is rejected
+
+        inBuffer = malloc(bufSize);
+        outBuffer = malloc(bufSize);
+
+        std::string tableName = "left";
+        createAndPopulateTable(tableName, {}, 10);
+
+        ASSERT_EQ(rm.createIndex(tableName, std::vector<std::string>{"A,B"}), PeterDB::ERR_INDEX_ATTR_NAME_INVALID)
+                                    << "An attribute name with ',' should be rejected.";
+        ASSERT_EQ(rm.createIndex(tableName, std::vector<std::string>{"A"}, std::vector<std::string>{"B+C"}),
+                  PeterDB::ERR_INDEX_ATTR_NAME_INVALID) << "An attribute name with '+' should be rejected.";
+
+        // "A,A,...,A" fits in the attribute-name column, "left_A,A,...,A.idx" does not fit in the file-name column
+        std::vector<std::string> keyAttrNames(22, "A");
+        ASSERT_EQ(rm.createIndex(tableName, keyAttrNames), PeterDB::ERR_INDEX_NAME_TOO_LONG)
+                                    << "An index file name longer than the catalog column should be rejected.";
+        ASSERT_EQ(glob(".idx").size(), 0) << "No index file should be created.";
+
+        keyAttrNames.resize(2);
+        ASSERT_EQ(rm.createIndex(tableName, keyAttrNames), success) << "RelationManager.createIndex() should succeed.";
+        ASSERT_EQ(glob(".idx").size(), 1) << "There should be one index file now.";
+
+    }
+
+    TEST_F(QE_Private_Test, create_index_with_fill_factor) {
+        // Functions Tested
+        // Build the same index at the default fill factor and at less than half of a page
+        // The sparse index takes more pages and returns the same entries
+
+        inBuffer = malloc(bufSize);
+        outBuffer = malloc(bufSize);
+
+        std::string tableName = "left";
+        createAndPopulateTable(tableName, {}, 10000);
+
+        auto countEntries = [&]() {
+            PeterDB::RM_IndexScanIterator rmisi;
+            unsigned count = 0;
+            EXPECT_EQ(rm.indexScan(tableName, "B", nullptr, nullptr, true, true, rmisi), success);
+            while (rmisi.getNextEntry(rid, outBuffer) != RM_EOF) count++;
+            rmisi.close();
+            return count;
+        };
+
+        ASSERT_EQ(rm.createIndex(tableName, "B"), success) << "RelationManager.createIndex() should succeed.";
+        auto defaultSize = getFileSize("left_B.idx");
+        ASSERT_EQ(countEntries(), 10000);
+        ASSERT_EQ(rm.destroyIndex(tableName, "B"), success) << "RelationManager.destroyIndex() should succeed.";
+
+        rm.setIndexFillFactor(0.45);
+        PeterDB::RC rc = rm.createIndex(tableName, "B");
+        rm.setIndexFillFactor(PeterDB::IX::BULKLOAD_FILL_FACTOR_DEFAULT);
+        ASSERT_EQ(rc, success) << "RelationManager.createIndex() should succeed.";
+        ASSERT_GT(getFileSize("left_B.idx"), defaultSize) << "A lower fill factor should leave more pages.";
+        ASSERT_EQ(countEntries(), 10000);
+
+    }
+
+    TEST_F(QE_Private_Test, index_only_scan_on_covering_index) {
+        // Functions Tested
+        // Create an index on B including C
+        // Update tuples with the index in place
+        // Index-only scan projecting (C, B) on a range of B
+
+        inBuffer = malloc(bufSize);
+        outBuffer = malloc(bufSize);
+        char lowKey[bufSize];
+        char highKey[bufSize];
+
+        std::string tableName = "left";
+        createAndPopulateTable(tableName, {}, 500);
+        ASSERT_EQ(rm.createIndex(tableName, std::vector<std::string>{"B"}, std::vector<std::string>{"C"}), success)
+                                    << "RelationManager.createIndex() should succeed.";
+        ASSERT_EQ(glob(".idx").size(), 1) << "There should be one index file now.";
+
+        for (unsigned i = 0; i < 20; i++) {
+            prepareLeftTuple(nullsIndicator, i + 1000, inBuffer);
+            ASSERT_EQ(rm.updateTuple(tableName, inBuffer, rids[i]), success);
+        }
+
+        // Expected (B, C) pairs from a full table scan
+        std::vector<std::pair<int, float>> expected;
+        PeterDB::RM_ScanIterator rmsi;
+        ASSERT_EQ(rm.scan(tableName, "", PeterDB::NO_OP, nullptr, {"B", "C"}, rmsi), success);
+        while (rmsi.getNextTuple(rid, outBuffer) != RM_EOF) {
+            int b = *(int *) ((char *) outBuffer + 1);
+            float c = *(float *) ((char *) outBuffer + 1 + sizeof(int));
+            if (b >= 20 && b < 30) expected.emplace_back(b, c);
+        }
+        rmsi.close();
+        std::sort(expected.begin(), expected.end());
+        ASSERT_FALSE(expected.empty());
+
+        PeterDB::IndexOnlyScan ios(rm, tableName, {"B"}, {"C", "B"});
+        std::vector<PeterDB::Attribute> projectedAttrs;
+        ASSERT_EQ(ios.getAttributes(projectedAttrs), success);
+        ASSERT_EQ(projectedAttrs.size(), 2);
+        ASSERT_EQ(projectedAttrs[0].name, "left.C");
+        ASSERT_EQ(projectedAttrs[1].name, "left.B");
+
+        memset(lowKey, 0, bufSize);
+        *(int *) (lowKey + 1) = 20;
+        memset(highKey, 0, bufSize);
+        *(int *) (highKey + 1) = 30;
+        ios.setIterator(lowKey, highKey, true, false);
+
+        std::vector<std::pair<int, float>> scanned;
+        while (ios.getNextTuple(outBuffer) != QE_EOF) {
+            float c = *(float *) ((char *) outBuffer + 1);
+            int b = *(int *) ((char *) outBuffer + 1 + sizeof(float));
+            scanned.emplace_back(b, c);
+        }
+        ASSERT_EQ(scanned, expected) << "The index-only scan should return the same tuples as the table.";
+
+        // Without a covering index there is nothing to scan
+        PeterDB::IndexOnlyScan notCovered(rm, tableName, {"B"}, {"A"});
+        ASSERT_EQ(notCovered.getNextTuple(outBuffer), QE_EOF);
+
+    }
+
+    TEST_F(QE_Private_Test, index_only_scan_on_single_attribute_index_and_null_keys) {
+        // Functions Tested
+        // Index-only scan projecting A from a single attribute index on A
+        // Tuples whose key B is null are not indexed, even though the included C is not null
+
+        inBuffer = malloc(bufSize);
+        outBuffer = malloc(bufSize);
+        char lowKey[bufSize];
+        char highKey[bufSize];
+
+        std::string tableName = "left";
+        createAndPopulateTable(tableName, {"A"}, 300);
+
+        // One tuple with a null B before the covering index is built, one after
+        unsigned char nullB[1] = {0x40};
+        memset(inBuffer, 0, bufSize);
+        prepareLeftTuple(nullB, 1000, inBuffer);
+        ASSERT_EQ(rm.insertTuple(tableName, inBuffer, rid), success);
+        ASSERT_EQ(rm.createIndex(tableName, std::vector<std::string>{"B"}, std::vector<std::string>{"C"}), success)
+                                    << "RelationManager.createIndex() should succeed.";
+        memset(inBuffer, 0, bufSize);
+        prepareLeftTuple(nullB, 1001, inBuffer);
+        ASSERT_EQ(rm.insertTuple(tableName, inBuffer, rid), success);
+
+        std::vector<int> expectedA;
+        std::vector<std::pair<int, float>> expectedBC;
+        PeterDB::RM_ScanIterator rmsi;
+        ASSERT_EQ(rm.scan(tableName, "", PeterDB::NO_OP, nullptr, {"A", "B", "C"}, rmsi), success);
+        while (rmsi.getNextTuple(rid, outBuffer) != RM_EOF) {
+            int a = *(int *) ((char *) outBuffer + 1);
+            if (a >= 50 && a <= 100) expectedA.push_back(a);
+            if (*(unsigned char *) outBuffer & 0x40) continue;
+            expectedBC.emplace_back(*(int *) ((char *) outBuffer + 1 + sizeof(int)),
+                                    *(float *) ((char *) outBuffer + 1 + 2 * sizeof(int)));
+        }
+        rmsi.close();
+        std::sort(expectedA.begin(), expectedA.end());
+        std::sort(expectedBC.begin(), expectedBC.end());
+        ASSERT_EQ(expectedBC.size(), 300);
+
+        PeterDB::IndexOnlyScan iosA(rm, tableName, {"A"}, {"A"});
+        memset(lowKey, 0, bufSize);
+        *(int *) (lowKey + 1) = 50;
+        memset(highKey, 0, bufSize);
+        *(int *) (highKey + 1) = 100;
+        iosA.setIterator(lowKey, highKey, true, true);
+        std::vector<int> scannedA;
+        while (iosA.getNextTuple(outBuffer) != QE_EOF) {
+            ASSERT_EQ(*(unsigned char *) outBuffer, 0);
+            scannedA.push_back(*(int *) ((char *) outBuffer + 1));
+        }
+        ASSERT_EQ(scannedA, expectedA) << "The single attribute index should cover a projection of its own key.";
+
+        PeterDB::IndexOnlyScan iosB(rm, tableName, {"B"}, {"B", "C"});
+        std::vector<std::pair<int, float>> scannedBC;
+        while (iosB.getNextTuple(outBuffer) != QE_EOF) {
+            ASSERT_EQ(*(unsigned char *) outBuffer, 0) << "Tuples with a null key should not be indexed.";
+            scannedBC.emplace_back(*(int *) ((char *) outBuffer + 1), *(float *) ((char *) outBuffer + 1 + sizeof(int)));
+        }
+        ASSERT_EQ(scannedBC, expectedBC);
+
+    }
+
+    TEST_F(QE_Private_Test, bitmap_heap_scan_with_and_or) {
+        // Functions Tested
+        // Bitmap heap scan on the AND and the OR of ranges on two indexes
+        // Compare against a table scan
+
+        inBuffer = malloc(bufSize);
+        outBuffer = malloc(bufSize);
+        char lowKey[bufSize];
+        char highKey[bufSize];
+
+        std::string tableName = "left";
+        createAndPopulateTable(tableName, {"A", "B"}, 1000);
+
+        // (A, B) of every tuple
+        std::vector<std::pair<int, int>> tuples;
+        PeterDB::RM_ScanIterator rmsi;
+        ASSERT_EQ(rm.scan(tableName, "", PeterDB::NO_OP, nullptr, {"A", "B"}, rmsi), success);
+        while (rmsi.getNextTuple(rid, outBuffer) != RM_EOF) {
+            tuples.emplace_back(*(int *) ((char *) outBuffer + 1), *(int *) ((char *) outBuffer + 1 + sizeof(int)));
+        }
+        rmsi.close();
+
+        for (PeterDB::BitmapOp op: {PeterDB::BITMAP_AND, PeterDB::BITMAP_OR}) {
+            // 10 <= A < 50 combined with 30 <= B <= 100
+            PeterDB::BitmapHeapScan bhs(rm, tableName);
+            *(int *) lowKey = 10;
+            *(int *) highKey = 50;
+            ASSERT_EQ(bhs.addIndexRange("A", lowKey, highKey, true, false), success);
+            *(int *) lowKey = 30;
+            *(int *) highKey = 100;
+            ASSERT_EQ(bhs.addIndexRange("B", lowKey, highKey, true, true, op), success);
+
+            std::vector<std::pair<int, int>> expected;
+            for (auto &tuple: tuples) {
+                bool inA = tuple.first >= 10 && tuple.first < 50;
+                bool inB = tuple.second >= 30 && tuple.second <= 100;
+                if (op == PeterDB::BITMAP_AND ? inA && inB : inA || inB) expected.push_back(tuple);
+            }
+            ASSERT_FALSE(expected.empty());
+
+            std::vector<std::pair<int, int>> scanned;
+            while (bhs.getNextTuple(outBuffer) != QE_EOF) {
+                scanned.emplace_back(*(int *) ((char *) outBuffer + 1), *(int *) ((char *) outBuffer + 1 + sizeof(int)));
+            }
+            std::sort(expected.begin(), expected.end());
+            std::sort(scanned.begin(), scanned.end());
+            ASSERT_EQ(scanned, expected) << "The bitmap heap scan should return each matching tuple once.";
+        }
+
+    }
+
 } // namespace PeterDBTesting
 
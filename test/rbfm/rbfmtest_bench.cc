@@ -0,0 +1,102 @@
+#include "src/include/rbfm.h"
+#include "test/utils/rbfm_test_utils.h"
+
+namespace PeterDBTesting {
+
+    // Load throughput of single and batched record insertion
+    // Each test loads the same records and reads them back to check the result
+    class RBFM_Bench_Test : public RBFM_Private_Test {
+    protected:
+        int numRecords = 50000;
+        std::vector<PeterDB::Attribute> recordDescriptor;
+        std::vector<void *> records;
+        std::vector<size_t> recordSizes;
+
+    public:
+        void SetUp() override {
+            RBFM_Private_Test::SetUp();
+            createRecordDescriptorForTwitterUser(recordDescriptor);
+            nullsIndicator = initializeNullFieldsIndicator(recordDescriptor);
+            for (int i = 0; i < numRecords; i++) {
+                void *record = malloc(1000);
+                memset(record, 0, 1000);
+                size_t size = 0;
+                prepareLargeRecordForTwitterUser(recordDescriptor.size(), nullsIndicator, i, record, size);
+                records.push_back(record);
+                recordSizes.push_back(size);
+            }
+            outBuffer = malloc(1000);
+        }
+
+        void TearDown() override {
+            for (void *record: records) {
+                free(record);
+            }
+            RBFM_Private_Test::TearDown();
+        }
+
+        void checkLoadedRecords(const std::vector<PeterDB::RID> &loadedRids) {
+            ASSERT_EQ(loadedRids.size(), numRecords) << "Every record should get a rid.";
+            for (int i = 0; i < numRecords; i++) {
+                memset(outBuffer, 0, 1000);
+                ASSERT_EQ(rbfm.readRecord(fileHandle, recordDescriptor, loadedRids[i], outBuffer), success)
+                                            << "Reading a record should succeed.";
+                ASSERT_EQ(memcmp(records[i], outBuffer, recordSizes[i]), 0) << "Reading unmatched data.";
+            }
+        }
+
+        void logLoad(const std::string &method, long long elapsedUs) {
+            unsigned readPageCount = 0, writePageCount = 0, appendPageCount = 0;
+            fileHandle.collectCounterValues(readPageCount, writePageCount, appendPageCount);
+            GTEST_LOG_(INFO) << method << ": " << numRecords << " records in " << elapsedUs << " us ("
+                             << (long long) numRecords * 1000000 / std::max(elapsedUs, 1LL) << " records/s), "
+                             << fileHandle.getNumberOfPages() << " pages, counters r/w/a: "
+                             << readPageCount << "/" << writePageCount << "/" << appendPageCount;
+        }
+    };
+
+    TEST_F(RBFM_Bench_Test, load_by_insert_record) {
+        // Functions tested
+        // 1. insert 50000 records one at a time
+        // 2. read 50000 records
+
+        std::vector<PeterDB::RID> loadedRids;
+        auto start = std::chrono::steady_clock::now();
+        for (int i = 0; i < numRecords; i++) {
+            PeterDB::RID rid;
+            ASSERT_EQ(rbfm.insertRecord(fileHandle, recordDescriptor, records[i], rid), success)
+                                        << "Inserting a record should succeed.";
+            loadedRids.push_back(rid);
+        }
+        auto elapsed = std::chrono::duration_cast<std::chrono::microseconds>(
+                std::chrono::steady_clock::now() - start).count();
+        logLoad("insertRecord", elapsed);
+
+        checkLoadedRecords(loadedRids);
+    }
+
+    TEST_F(RBFM_Bench_Test, load_by_insert_records) {
+        // Functions tested
+        // 1. insert 50000 records in one batch
+        // 2. read 50000 records
+
+        std::vector<const void *> batch(records.begin(), records.end());
+        std::vector<PeterDB::RID> loadedRids;
+        auto start = std::chrono::steady_clock::now();
+        ASSERT_EQ(rbfm.insertRecords(fileHandle, recordDescriptor, batch, loadedRids), success)
+                                    << "Inserting records should succeed.";
+        auto elapsed = std::chrono::duration_cast<std::chrono::microseconds>(
+                std::chrono::steady_clock::now() - start).count();
+        logLoad("insertRecords", elapsed);
+
+        unsigned readPageCount = 0, writePageCount = 0, appendPageCount = 0;
+        ASSERT_EQ(fileHandle.collectCounterValues(readPageCount, writePageCount, appendPageCount), success)
+                                    << "Collecting counters should succeed.";
+        ASSERT_EQ(readPageCount, 0) << "Batched insertion should not read any page.";
+        ASSERT_EQ(writePageCount, 0) << "Batched insertion should only append pages.";
+        ASSERT_EQ(appendPageCount, fileHandle.getNumberOfPages()) << "Every page should be appended once.";
+
+        checkLoadedRecords(loadedRids);
+    }
+
+}
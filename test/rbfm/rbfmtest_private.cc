@@ -659,4 +659,158 @@ namespace PeterDBTesting {
 
     }
 
+    TEST_F(RBFM_Private_Test, measure_writes_of_reads) {
+        // Functions tested
+        // 1. insert 5000 records
+        // 2. read 5000 records
+        // 3. scan 5000 records
+        // Pure reads should not write any page back, a scan reads each page once
+
+        int numRecords = 5000;
+
+        std::vector<PeterDB::RID> ridList;
+        size_t recordSize = 0;
+        inBuffer = malloc(100);
+        outBuffer = malloc(100);
+
+        std::vector<PeterDB::Attribute> recordDescriptor;
+        createRecordDescriptor(recordDescriptor);
+
+        // Initialize a NULL field indicator
+        nullsIndicator = initializeNullFieldsIndicator(recordDescriptor);
+
+        prepareRecord(recordDescriptor.size(), nullsIndicator, 8, "Anteater", 8934, 834.23, 328400, inBuffer,
+                      recordSize);
+        for (int i = 0; i < numRecords; i++) {
+            PeterDB::RID rid;
+            ASSERT_EQ(rbfm.insertRecord(fileHandle, recordDescriptor, inBuffer, rid), success)
+                                        << "Inserting a record should succeed.";
+            ridList.push_back(rid);
+        }
+
+        unsigned readPageCount = 0, writePageCount = 0, appendPageCount = 0;
+        unsigned readPageCount1 = 0, writePageCount1 = 0, appendPageCount1 = 0;
+        ASSERT_EQ(fileHandle.collectCounterValues(readPageCount, writePageCount, appendPageCount), success)
+                                    << "Collecting counters should succeed.";
+
+        // Point reads
+        auto start = std::chrono::steady_clock::now();
+        for (auto &rid: ridList) {
+            ASSERT_EQ(rbfm.readRecord(fileHandle, recordDescriptor, rid, outBuffer), success)
+                                        << "Reading record should succeed.";
+        }
+        auto readTime = std::chrono::duration_cast<std::chrono::microseconds>(
+                std::chrono::steady_clock::now() - start).count();
+
+        ASSERT_EQ(fileHandle.collectCounterValues(readPageCount1, writePageCount1, appendPageCount1), success)
+                                    << "Collecting counters should succeed.";
+        ASSERT_GE(readPageCount1 - readPageCount, numRecords) << "Every read should access a page.";
+        ASSERT_EQ(writePageCount1, writePageCount) << "Reading records should not write any page.";
+        ASSERT_EQ(appendPageCount1, appendPageCount) << "Reading records should not append any page.";
+
+        // Full scan
+        PeterDB::RBFM_ScanIterator rbfmScanIterator;
+        std::vector<std::string> attributeNames = {"EmpName", "Age"};
+        ASSERT_EQ(rbfm.scan(fileHandle, recordDescriptor, "", PeterDB::NO_OP, NULL, attributeNames,
+                            rbfmScanIterator), success) << "Opening a scan should succeed.";
+        start = std::chrono::steady_clock::now();
+        PeterDB::RID rid;
+        int scanned = 0;
+        while (rbfmScanIterator.getNextRecord(rid, outBuffer) != RBFM_EOF) {
+            scanned++;
+        }
+        auto scanTime = std::chrono::duration_cast<std::chrono::microseconds>(
+                std::chrono::steady_clock::now() - start).count();
+        ASSERT_EQ(scanned, numRecords) << "Scan should return all records.";
+        unsigned scanReadPageCount = 0, scanWritePageCount = 0, scanAppendPageCount = 0;
+        ASSERT_EQ(rbfmScanIterator.fileHandle->collectCounterValues(scanReadPageCount, scanWritePageCount,
+                                                                   scanAppendPageCount), success)
+                                    << "Collecting counters should succeed.";
+        ASSERT_EQ(scanWritePageCount, writePageCount) << "Scanning records should not write any page.";
+        ASSERT_EQ(scanReadPageCount - readPageCount1, fileHandle.getNumberOfPages())
+                                    << "Scanning should read every page exactly once.";
+        ASSERT_EQ(rbfmScanIterator.close(), success) << "Closing a scan should succeed.";
+
+        GTEST_LOG_(INFO) << numRecords << " point reads in " << readTime << " us, scan in " << scanTime << " us.";
+    }
+
+    TEST_F(RBFM_Private_Test, free_space_map_beyond_hidden_page) {
+        // Functions tested
+        // 1. Append more pages than the hidden page keeps free space entries for
+        // 2. Reopen the file, no page is read and the entries past the hidden page are unknown
+        // 3. Insert a record, only the pages it probes get known again
+
+        inBuffer = malloc(PAGE_SIZE);
+        outBuffer = malloc(PAGE_SIZE);
+        memset(inBuffer, 0, PAGE_SIZE);
+        unsigned numPages = PeterDB::PFM::FSM_HIDDEN_ENTRY_NUM + 100;
+        for (unsigned i = 0; i < numPages; i++) {
+            ASSERT_EQ(fileHandle.appendPage(inBuffer), success) << "Appending a page should succeed.";
+        }
+        unsigned readPageCount = 0, writePageCount = 0, appendPageCount = 0;
+        unsigned readPageCount1 = 0, writePageCount1 = 0, appendPageCount1 = 0;
+        ASSERT_EQ(fileHandle.collectCounterValues(readPageCount, writePageCount, appendPageCount), success)
+                                    << "Collecting counters should succeed.";
+        reopenFile(fileName, fileHandle);
+
+        ASSERT_EQ(fileHandle.getNumberOfPages(), numPages) << "The page count should not have been changed.";
+        ASSERT_EQ(fileHandle.collectCounterValues(readPageCount1, writePageCount1, appendPageCount1), success)
+                                    << "Collecting counters should succeed.";
+        ASSERT_EQ(readPageCount1, readPageCount) << "Opening a file should not read its pages.";
+        for (unsigned i = PeterDB::PFM::FSM_HIDDEN_ENTRY_NUM; i < numPages; i++) {
+            ASSERT_FALSE(fileHandle.isPageFreeSpaceKnown(i)) << "Free space of page " << i << " should be unknown.";
+        }
+
+        std::vector<PeterDB::Attribute> recordDescriptor;
+        createRecordDescriptor(recordDescriptor);
+        nullsIndicator = initializeNullFieldsIndicator(recordDescriptor);
+        size_t recordSize;
+        prepareRecord(recordDescriptor.size(), nullsIndicator, 8, "Anteater", 8934, 834.23, 328400, inBuffer,
+                      recordSize);
+        PeterDB::RID rid;
+        ASSERT_EQ(rbfm.insertRecord(fileHandle, recordDescriptor, inBuffer, rid), success)
+                                    << "Inserting a record should succeed.";
+        ASSERT_EQ(fileHandle.getNumberOfPages(), numPages) << "An empty page should have been reused.";
+        ASSERT_TRUE(fileHandle.isPageFreeSpaceKnown(rid.pageNum)) << "The page taking the record should be known.";
+        ASSERT_EQ(rbfm.readRecord(fileHandle, recordDescriptor, rid, outBuffer), success)
+                                    << "Reading the record should succeed.";
+        ASSERT_EQ(memcmp(inBuffer, outBuffer, recordSize), 0) << "The record read should match the one inserted.";
+    }
+
+    TEST_F(RBFM_Private_Test, insert_records_stops_at_failing_record) {
+        // Functions tested
+        // 1. Insert a batch with a record larger than a page
+        // 2. The batch fails, records before the failing one are inserted and readable
+
+        std::vector<PeterDB::Attribute> recordDescriptor;
+        createRecordDescriptor(recordDescriptor);
+        nullsIndicator = initializeNullFieldsIndicator(recordDescriptor);
+
+        int numRecords = 500;
+        int failingIndex = 300;
+        size_t recordSize = 0;
+        std::vector<std::vector<uint8_t>> records(numRecords, std::vector<uint8_t>(PAGE_SIZE * 2));
+        std::vector<const void *> batch;
+        for (int i = 0; i < numRecords; i++) {
+            std::string name = i == failingIndex ? std::string(PAGE_SIZE, 'a') : "Anteater";
+            prepareRecord(recordDescriptor.size(), nullsIndicator, name.length(), name, i, 177.8, 6200,
+                          records[i].data(), recordSize);
+            batch.push_back(records[i].data());
+        }
+
+        std::vector<PeterDB::RID> rids;
+        ASSERT_NE(rbfm.insertRecords(fileHandle, recordDescriptor, batch, rids), success)
+                                    << "Inserting a record larger than a page should fail.";
+        ASSERT_EQ(rids.size(), failingIndex) << "Records before the failing one should be inserted.";
+
+        outBuffer = malloc(PAGE_SIZE);
+        for (int i = 0; i < failingIndex; i++) {
+            prepareRecord(recordDescriptor.size(), nullsIndicator, 8, "Anteater", i, 177.8, 6200, records[i].data(),
+                          recordSize);
+            ASSERT_EQ(rbfm.readRecord(fileHandle, recordDescriptor, rids[i], outBuffer), success)
+                                        << "Reading a record should succeed.";
+            ASSERT_EQ(memcmp(records[i].data(), outBuffer, recordSize), 0) << "Returned record should match.";
+        }
+    }
+
 }
@@ -694,4 +694,406 @@ namespace PeterDBTesting {
 
     }
 
-}
\ No newline at end of file
+    TEST_F(RM_Version_Test, catalog_changes_after_ddl) {
+        // Functions Tested:
+        // 1. Insert tuple before and after creating an index
+        // 2. Destroy index
+        // 3. Recreate the table with another schema
+
+        size_t tupleSize = 0;
+        inBuffer = malloc(200);
+        outBuffer = malloc(200);
+
+        ASSERT_EQ(rm.getAttributes(tableName, attrs), success) << "RelationManager::getAttributes() should succeed.";
+        nullsIndicator = initializeNullFieldsIndicator(attrs);
+
+        std::string name = "Peter Anteater";
+        prepareTuple(attrs.size(), nullsIndicator, name.length(), name, 24, 185.7, 23333.3, inBuffer, tupleSize);
+        ASSERT_EQ(rm.insertTuple(tableName, inBuffer, rid), success)
+                                    << "RelationManager::insertTuple() should succeed.";
+
+        // Tuples inserted after createIndex must reach the new index
+        ASSERT_EQ(rm.createIndex(tableName, "age"), success) << "RelationManager::createIndex() should succeed.";
+        prepareTuple(attrs.size(), nullsIndicator, name.length(), name, 25, 185.7, 23333.3, inBuffer, tupleSize);
+        ASSERT_EQ(rm.insertTuple(tableName, inBuffer, rid), success)
+                                    << "RelationManager::insertTuple() should succeed.";
+
+        PeterDB::RM_IndexScanIterator rmisi;
+        ASSERT_EQ(rm.indexScan(tableName, "age", nullptr, nullptr, true, true, rmisi), success)
+                                    << "RelationManager::indexScan() should succeed.";
+        PeterDB::RID scanRID;
+        int key;
+        int count = 0;
+        while (rmisi.getNextEntry(scanRID, &key) != RM_EOF) {
+            ASSERT_EQ(key, 24 + count) << "Returned key does not match the inserted.";
+            count++;
+        }
+        ASSERT_EQ(count, 2) << "Index should contain both tuples.";
+        ASSERT_EQ(rmisi.close(), success) << "RM_IndexScanIterator::close() should succeed.";
+
+        ASSERT_EQ(rm.destroyIndex(tableName, "age"), success) << "RelationManager::destroyIndex() should succeed.";
+        ASSERT_EQ(rm.insertTuple(tableName, inBuffer, rid), success)
+                                    << "RelationManager::insertTuple() should succeed after destroying the index.";
+
+        // The recreated table must not see the schema of the dropped one
+        ASSERT_EQ(rm.deleteTable(tableName), success) << "RelationManager::deleteTable() should succeed.";
+        ASSERT_EQ(rm.createTable(tableName, parseDDL("CREATE TABLE " + tableName + " (emp_name VARCHAR(40), age INT)")),
+                  success) << "RelationManager::createTable() should succeed.";
+
+        std::vector<PeterDB::Attribute> attrs2;
+        ASSERT_EQ(rm.getAttributes(tableName, attrs2), success) << "RelationManager::getAttributes() should succeed.";
+        ASSERT_EQ(attrs2.size(), 2) << "Recreated table should have two attributes.";
+
+        prepareTuple(attrs2.size(), nullsIndicator, name.length(), name, 26, 0, 0, inBuffer, tupleSize);
+        ASSERT_EQ(rm.insertTuple(tableName, inBuffer, rid), success)
+                                    << "RelationManager::insertTuple() should succeed.";
+        ASSERT_EQ(rm.readTuple(tableName, rid, outBuffer), success) << "RelationManager::readTuple() should succeed.";
+
+        std::stringstream stream;
+        ASSERT_EQ(rm.printTuple(attrs2, outBuffer, stream), success)
+                                    << "RelationManager::printTuple() should succeed.";
+        checkPrintRecord("emp_name: Peter Anteater, age: 26", stream.str());
+
+    }
+
+    TEST_F(RM_Version_Test, file_handle_cache) {
+        // Functions Tested:
+        // 1. Interleaved inserts and reads on two tables
+        // 2. A pinned scan survives eviction
+        // 3. A scan left open on a deleted table reads it to the end
+
+        size_t tupleSize = 0;
+        inBuffer = malloc(200);
+        outBuffer = malloc(200);
+        std::string tableName2 = tableName + "_2";
+        remove(tableName2.c_str());
+        ASSERT_EQ(rm.createTable(tableName2, parseDDL(
+                "CREATE TABLE " + tableName2 + " (emp_name VARCHAR(40), age INT, height REAL, salary REAL)")), success)
+                                    << "Create table " << tableName2 << " should succeed.";
+
+        ASSERT_EQ(rm.getAttributes(tableName, attrs), success) << "RelationManager::getAttributes() should succeed.";
+        nullsIndicator = initializeNullFieldsIndicator(attrs);
+        std::string name = "Peter Anteater";
+        prepareTuple(attrs.size(), nullsIndicator, name.length(), name, 24, 185.7, 23333.3, inBuffer, tupleSize);
+
+        PeterDB::FileHandleCache& cache = rm.getFileHandleCache();
+        PeterDB::RID rid2;
+        ASSERT_EQ(rm.insertTuple(tableName, inBuffer, rid), success) << "RelationManager::insertTuple() should succeed.";
+        ASSERT_EQ(rm.insertTuple(tableName2, inBuffer, rid2), success) << "RelationManager::insertTuple() should succeed.";
+
+        // Both tables stay open, alternating between them opens nothing
+        unsigned hitCount, missCount, openCount;
+        cache.collectCounterValues(hitCount, missCount, openCount);
+        for (int i = 0; i < 100; i++) {
+            ASSERT_EQ(rm.insertTuple(i % 2 ? tableName : tableName2, inBuffer, i % 2 ? rid : rid2), success)
+                                        << "RelationManager::insertTuple() should succeed.";
+            ASSERT_EQ(rm.readTuple(i % 2 ? tableName : tableName2, i % 2 ? rid : rid2, outBuffer), success)
+                                        << "RelationManager::readTuple() should succeed.";
+        }
+        unsigned hitCount1, missCount1, openCount1;
+        cache.collectCounterValues(hitCount1, missCount1, openCount1);
+        ASSERT_EQ(openCount1, openCount) << "No file should be opened again.";
+        ASSERT_EQ(missCount1, missCount) << "Every lookup should hit.";
+        ASSERT_EQ(hitCount1 - hitCount, 200) << "Every insert and read should hit.";
+
+        // With room for one file, the scanned table is kept open while the other one is used
+        uint32_t capacity = cache.getCapacity();
+        ASSERT_EQ(cache.setCapacity(1), success) << "FileHandleCache::setCapacity() should succeed.";
+        PeterDB::RM_ScanIterator rmsi;
+        ASSERT_EQ(rm.scan(tableName, "", PeterDB::NO_OP, NULL, {"age"}, rmsi), success)
+                                    << "RelationManager::scan() should succeed.";
+        ASSERT_EQ(rm.insertTuple(tableName2, inBuffer, rid2), success) << "RelationManager::insertTuple() should succeed.";
+        ASSERT_EQ(cache.getOpenFileNum(), 2) << "The pinned file should not be closed.";
+
+        PeterDB::RID scanRID;
+        int count = 0;
+        while (rmsi.getNextTuple(scanRID, outBuffer) != RM_EOF) {
+            ASSERT_EQ(*(int *) ((char *) outBuffer + 1), 24) << "Returned age does not match the inserted.";
+            count++;
+        }
+        ASSERT_EQ(count, 51) << "Scan should return every tuple of the table.";
+        ASSERT_EQ(rmsi.close(), success) << "RM_ScanIterator::close() should succeed.";
+
+        ASSERT_EQ(rm.readTuple(tableName2, rid2, outBuffer), success) << "RelationManager::readTuple() should succeed.";
+        ASSERT_EQ(cache.getOpenFileNum(), 1) << "The unpinned file should be closed.";
+
+        ASSERT_EQ(cache.setCapacity(capacity), success) << "FileHandleCache::setCapacity() should succeed.";
+
+        // The deleted file is closed once the scan is done with it
+        ASSERT_EQ(rm.scan(tableName2, "", PeterDB::NO_OP, NULL, {"age"}, rmsi), success)
+                                    << "RelationManager::scan() should succeed.";
+        uint32_t openFileNum = cache.getOpenFileNum();
+        ASSERT_EQ(rm.deleteTable(tableName2), success) << "RelationManager::deleteTable() should succeed.";
+        ASSERT_EQ(cache.getOpenFileNum(), openFileNum - 1) << "The deleted file should leave the cache.";
+        count = 0;
+        while (rmsi.getNextTuple(scanRID, outBuffer) != RM_EOF) {
+            ASSERT_EQ(*(int *) ((char *) outBuffer + 1), 24) << "Returned age does not match the inserted.";
+            count++;
+        }
+        ASSERT_EQ(count, 52) << "Scan should return every tuple of the deleted table.";
+        ASSERT_EQ(rmsi.close(), success) << "RM_ScanIterator::close() should succeed.";
+
+    }
+
+    TEST_F(RM_Version_Test, dml_with_one_cached_file) {
+        // Functions Tested:
+        // 1. Insert, update and delete on a table with two indexes while the cache holds one file
+        // 2. Both indexes follow every change
+
+        size_t tupleSize = 0;
+        inBuffer = malloc(200);
+        outBuffer = malloc(200);
+        ASSERT_EQ(rm.createIndex(tableName, "age"), success) << "RelationManager::createIndex() should succeed.";
+        ASSERT_EQ(rm.createIndex(tableName, "height"), success) << "RelationManager::createIndex() should succeed.";
+
+        ASSERT_EQ(rm.getAttributes(tableName, attrs), success) << "RelationManager::getAttributes() should succeed.";
+        nullsIndicator = initializeNullFieldsIndicator(attrs);
+        std::string name = "Peter Anteater";
+
+        PeterDB::FileHandleCache& cache = rm.getFileHandleCache();
+        uint32_t capacity = cache.getCapacity();
+        ASSERT_EQ(cache.setCapacity(1), success) << "FileHandleCache::setCapacity() should succeed.";
+
+        // Every index lookup would evict the table file if it were not pinned
+        prepareTuple(attrs.size(), nullsIndicator, name.length(), name, 24, 185.7, 23333.3, inBuffer, tupleSize);
+        ASSERT_EQ(rm.insertTuple(tableName, inBuffer, rid), success) << "RelationManager::insertTuple() should succeed.";
+        prepareTuple(attrs.size(), nullsIndicator, name.length(), name, 42, 170.2, 23333.3, inBuffer, tupleSize);
+        ASSERT_EQ(rm.updateTuple(tableName, inBuffer, rid), success) << "RelationManager::updateTuple() should succeed.";
+        ASSERT_EQ(cache.getOpenFileNum(), 1) << "Files should be closed once the call releases them.";
+
+        ASSERT_EQ(rm.readTuple(tableName, rid, outBuffer), success) << "RelationManager::readTuple() should succeed.";
+        ASSERT_EQ(memcmp(inBuffer, outBuffer, tupleSize), 0) << "The updated tuple should be read back.";
+
+        PeterDB::RM_IndexScanIterator rmisi;
+        PeterDB::RID scanRID;
+        int age;
+        int count = 0;
+        ASSERT_EQ(rm.indexScan(tableName, "age", nullptr, nullptr, true, true, rmisi), success)
+                                    << "RelationManager::indexScan() should succeed.";
+        while (rmisi.getNextEntry(scanRID, &age) != RM_EOF) {
+            ASSERT_EQ(age, 42) << "Only the updated key should be indexed.";
+            count++;
+        }
+        ASSERT_EQ(count, 1) << "The age index should hold one entry.";
+        ASSERT_EQ(rmisi.close(), success) << "RM_IndexScanIterator::close() should succeed.";
+
+        float height;
+        count = 0;
+        ASSERT_EQ(rm.indexScan(tableName, "height", nullptr, nullptr, true, true, rmisi), success)
+                                    << "RelationManager::indexScan() should succeed.";
+        while (rmisi.getNextEntry(scanRID, &height) != RM_EOF) {
+            ASSERT_FLOAT_EQ(height, 170.2) << "Only the updated key should be indexed.";
+            count++;
+        }
+        ASSERT_EQ(count, 1) << "The height index should hold one entry.";
+        ASSERT_EQ(rmisi.close(), success) << "RM_IndexScanIterator::close() should succeed.";
+
+        ASSERT_EQ(rm.deleteTuple(tableName, rid), success) << "RelationManager::deleteTuple() should succeed.";
+        ASSERT_EQ(rm.indexScan(tableName, "age", nullptr, nullptr, true, true, rmisi), success)
+                                    << "RelationManager::indexScan() should succeed.";
+        ASSERT_EQ(rmisi.getNextEntry(scanRID, &age), RM_EOF) << "The deleted tuple should leave the index.";
+        ASSERT_EQ(rmisi.close(), success) << "RM_IndexScanIterator::close() should succeed.";
+
+        ASSERT_EQ(cache.setCapacity(capacity), success) << "FileHandleCache::setCapacity() should succeed.";
+
+    }
+
+    TEST_F(RM_Version_Test, table_handle) {
+        // Functions Tested:
+        // 1. Insert, read, update and delete through a table handle
+        // 2. The handle follows createIndex and dropAttribute
+
+        size_t tupleSize = 0;
+        inBuffer = malloc(200);
+        outBuffer = malloc(200);
+
+        PeterDB::TableHandle table;
+        ASSERT_EQ(rm.openTable(tableName, table), success) << "RelationManager::openTable() should succeed.";
+        attrs = table.getAttributes();
+        ASSERT_EQ(attrs.size(), 4) << "Handle should carry the schema of the table.";
+        nullsIndicator = initializeNullFieldsIndicator(attrs);
+
+        std::string name = "Peter Anteater";
+        prepareTuple(attrs.size(), nullsIndicator, name.length(), name, 24, 185.7, 23333.3, inBuffer, tupleSize);
+        ASSERT_EQ(table.insertTuple(inBuffer, rid), success) << "TableHandle::insertTuple() should succeed.";
+        ASSERT_EQ(table.readTuple(rid, outBuffer), success) << "TableHandle::readTuple() should succeed.";
+        ASSERT_EQ(memcmp(inBuffer, outBuffer, tupleSize), 0) << "Returned tuple does not match the inserted.";
+
+        // The index created after opening is maintained by the handle
+        ASSERT_EQ(rm.createIndex(tableName, "age"), success) << "RelationManager::createIndex() should succeed.";
+        prepareTuple(attrs.size(), nullsIndicator, name.length(), name, 30, 185.7, 23333.3, inBuffer, tupleSize);
+        ASSERT_EQ(table.updateTuple(inBuffer, rid), success) << "TableHandle::updateTuple() should succeed.";
+        PeterDB::RID rid2;
+        prepareTuple(attrs.size(), nullsIndicator, name.length(), name, 25, 185.7, 23333.3, inBuffer, tupleSize);
+        ASSERT_EQ(table.insertTuple(inBuffer, rid2), success) << "TableHandle::insertTuple() should succeed.";
+
+        PeterDB::RM_IndexScanIterator rmisi;
+        ASSERT_EQ(table.indexScan("age", nullptr, nullptr, true, true, rmisi), success)
+                                    << "TableHandle::indexScan() should succeed.";
+        PeterDB::RID scanRID;
+        int key;
+        std::vector<int> keys;
+        while (rmisi.getNextEntry(scanRID, &key) != RM_EOF) {
+            keys.push_back(key);
+        }
+        ASSERT_EQ(keys, std::vector<int>({25, 30})) << "Index should hold the updated and inserted keys.";
+        ASSERT_EQ(rmisi.close(), success) << "RM_IndexScanIterator::close() should succeed.";
+
+        ASSERT_EQ(table.deleteTuple(rid2), success) << "TableHandle::deleteTuple() should succeed.";
+        ASSERT_NE(table.readTuple(rid2, outBuffer), success) << "Deleted tuple should not be read.";
+
+        // Tuples of the old version are read in the new schema
+        ASSERT_EQ(rm.dropAttribute(tableName, "height"), success) << "RelationManager::dropAttribute() should succeed.";
+        ASSERT_EQ(table.readTuple(rid, outBuffer), success) << "TableHandle::readTuple() should succeed.";
+        ASSERT_EQ(table.getAttributes().size(), 3) << "Handle should follow the dropped attribute.";
+        std::stringstream stream;
+        ASSERT_EQ(rm.printTuple(table.getAttributes(), outBuffer, stream), success)
+                                    << "RelationManager::printTuple() should succeed.";
+        checkPrintRecord("emp_name: Peter Anteater, age: 30, salary: 23333.3", stream.str());
+
+        // Catalog tables are read only
+        PeterDB::TableHandle catalog;
+        ASSERT_EQ(rm.openTable("Tables", catalog), success) << "RelationManager::openTable() should succeed.";
+        ASSERT_EQ(catalog.insertTuple(inBuffer, rid2), PeterDB::ERR_ACCESS_DENIED_SYS_TABLE)
+                                    << "Catalog tables should not be modified through a handle.";
+
+        ASSERT_EQ(table.close(), success) << "TableHandle::close() should succeed.";
+        ASSERT_NE(table.readTuple(rid, outBuffer), success) << "Closed handle should not be read.";
+
+    }
+
+    TEST_F(RM_Version_Test, insert_tuples_batch) {
+        // Functions Tested:
+        // 1. Insert a batch of tuples, every tuple is read back by its rid
+        // 2. Index holds the keys of the batch in order, null keys are not indexed
+        // 3. Index entries of a batch take fewer page reads than inserting tuples one by one
+
+        size_t tupleSize = 0;
+        outBuffer = malloc(200);
+
+        ASSERT_EQ(rm.getAttributes(tableName, attrs), success) << "RelationManager::getAttributes() should succeed.";
+        nullsIndicator = initializeNullFieldsIndicator(attrs);
+        ASSERT_EQ(rm.createIndex(tableName, "age"), success) << "RelationManager::createIndex() should succeed.";
+
+        PeterDB::IXFileHandle* ixFileHandle;
+        ASSERT_EQ(rm.getFileHandleCache().getIXFileHandle(tableName + "_age.idx", ixFileHandle), success)
+                                    << "Index file should be opened through the cache.";
+        unsigned readCount = 0, writeCount = 0, appendCount = 0;
+
+        std::string name = "Peter Anteater";
+        const int tupleNum = 1000;
+        std::vector<std::vector<uint8_t>> tuples(tupleNum * 2 + 1, std::vector<uint8_t>(200));
+        for (int i = 0; i < tupleNum * 2; i++) {
+            // Shuffled ages, the first half below the second one
+            int age = (i * 7919) % tupleNum + (i < tupleNum ? 0 : tupleNum);
+            prepareTuple(attrs.size(), nullsIndicator, name.length(), name, age, 185.7, 23333.3, tuples[i].data(), tupleSize);
+        }
+        nullsIndicatorWithNull = initializeNullFieldsIndicator(attrs);
+        nullsIndicatorWithNull[0] = 64;     // age is null
+        prepareTuple(attrs.size(), nullsIndicatorWithNull, name.length(), name, 0, 185.7, 23333.3,
+                     tuples[tupleNum * 2].data(), tupleSize);
+
+        // 1. The first half one by one
+        ixFileHandle->collectCounterValues(readCount, writeCount, appendCount);
+        unsigned singleReadCount = readCount;
+        for (int i = 0; i < tupleNum; i++) {
+            ASSERT_EQ(rm.insertTuple(tableName, tuples[i].data(), rid), success) << "RelationManager::insertTuple() should succeed.";
+        }
+        ixFileHandle->collectCounterValues(readCount, writeCount, appendCount);
+        singleReadCount = readCount - singleReadCount;
+
+        // 2. The second half and a null key in a batch
+        std::vector<const void *> batch;
+        for (int i = tupleNum; i < tupleNum * 2 + 1; i++) {
+            batch.push_back(tuples[i].data());
+        }
+        std::vector<PeterDB::RID> rids;
+        unsigned batchReadCount = readCount;
+        ASSERT_EQ(rm.insertTuples(tableName, batch, rids), success) << "RelationManager::insertTuples() should succeed.";
+        ixFileHandle->collectCounterValues(readCount, writeCount, appendCount);
+        batchReadCount = readCount - batchReadCount;
+        ASSERT_EQ(rids.size(), batch.size()) << "Every tuple should get a rid.";
+        ASSERT_LT(batchReadCount * 4, singleReadCount) << "Sorted index entries should take much fewer page reads.";
+
+        for (size_t i = 0; i < rids.size(); i++) {
+            ASSERT_EQ(rm.readTuple(tableName, rids[i], outBuffer), success) << "RelationManager::readTuple() should succeed.";
+            ASSERT_EQ(memcmp(batch[i], outBuffer, tupleSize), 0) << "Returned tuple does not match the inserted.";
+        }
+
+        PeterDB::RM_IndexScanIterator rmisi;
+        ASSERT_EQ(rm.indexScan(tableName, "age", nullptr, nullptr, true, true, rmisi), success)
+                                    << "RelationManager::indexScan() should succeed.";
+        PeterDB::RID scanRID;
+        int key;
+        int expectedKey = 0;
+        while (rmisi.getNextEntry(scanRID, &key) != RM_EOF) {
+            ASSERT_EQ(key, expectedKey) << "Index should return keys in order.";
+            expectedKey++;
+        }
+        ASSERT_EQ(expectedKey, tupleNum * 2) << "Index should hold every key but the null one.";
+        ASSERT_EQ(rmisi.close(), success) << "RM_IndexScanIterator::close() should succeed.";
+
+    }
+
+    TEST_F(RM_Version_Test, read_tuples_of_every_version) {
+        // Functions Tested:
+        // 1. Tuples of older versions are read in the current schema after each DDL
+        // 2. A table handle reads them as RelationManager::readTuple() does
+
+        size_t tupleSize = 0;
+        inBuffer = malloc(200);
+        outBuffer = malloc(200);
+
+        ASSERT_EQ(rm.getAttributes(tableName, attrs), success) << "RelationManager::getAttributes() should succeed.";
+        nullsIndicator = initializeNullFieldsIndicator(attrs);
+
+        std::string name = "Peter Anteater";
+        prepareTuple(attrs.size(), nullsIndicator, name.length(), name, 24, 185.7, 23333.3, inBuffer, tupleSize);
+        ASSERT_EQ(rm.insertTuple(tableName, inBuffer, rid), success) << "RelationManager::insertTuple() should succeed.";
+
+        // Version 1: emp_name, age, salary
+        ASSERT_EQ(rm.dropAttribute(tableName, "height"), success) << "RelationManager::dropAttribute() should succeed.";
+        std::vector<PeterDB::Attribute> curAttrs;
+        ASSERT_EQ(rm.getAttributes(tableName, curAttrs), success) << "RelationManager::getAttributes() should succeed.";
+        std::stringstream stream;
+        for (int i = 0; i < 2; i++) {
+            ASSERT_EQ(rm.readTuple(tableName, rid, outBuffer), success) << "RelationManager::readTuple() should succeed.";
+            stream.str(std::string());
+            stream.clear();
+            ASSERT_EQ(rm.printTuple(curAttrs, outBuffer, stream), success) << "RelationManager::printTuple() should succeed.";
+            checkPrintRecord("emp_name: Peter Anteater, age: 24, salary: 23333.3", stream.str());
+        }
+
+        // Version 2: emp_name, age, salary, height
+        ASSERT_EQ(rm.addAttribute(tableName, attrs[2]), success) << "RelationManager::addAttribute() should succeed.";
+        std::string name2 = "John Doe";
+        PeterDB::RID rid2;
+        // Fields are laid out in the order of prepareTuple(), so salary goes before height
+        prepareTuple(attrs.size(), nullsIndicator, name2.length(), name2, 30, 1000.5, 170.2, inBuffer, tupleSize);
+        ASSERT_EQ(rm.insertTuple(tableName, inBuffer, rid2), success) << "RelationManager::insertTuple() should succeed.";
+
+        // Version 3: emp_name, salary, height
+        ASSERT_EQ(rm.dropAttribute(tableName, "age"), success) << "RelationManager::dropAttribute() should succeed.";
+        curAttrs.clear();
+        ASSERT_EQ(rm.getAttributes(tableName, curAttrs), success) << "RelationManager::getAttributes() should succeed.";
+
+        PeterDB::TableHandle table;
+        ASSERT_EQ(rm.openTable(tableName, table), success) << "RelationManager::openTable() should succeed.";
+        std::vector<PeterDB::RID> rids = {rid, rid2};
+        std::vector<std::string> expected = {"emp_name: Peter Anteater, salary: 23333.3, height: NULL",
+                                             "emp_name: John Doe, salary: 1000.5, height: 170.2"};
+        for (size_t i = 0; i < rids.size(); i++) {
+            ASSERT_EQ(rm.readTuple(tableName, rids[i], outBuffer), success) << "RelationManager::readTuple() should succeed.";
+            stream.str(std::string());
+            stream.clear();
+            ASSERT_EQ(rm.printTuple(curAttrs, outBuffer, stream), success) << "RelationManager::printTuple() should succeed.";
+            checkPrintRecord(expected[i], stream.str());
+
+            ASSERT_EQ(table.readTuple(rids[i], inBuffer), success) << "TableHandle::readTuple() should succeed.";
+            ASSERT_EQ(memcmp(inBuffer, outBuffer, PeterDB::ApiDataHelper::getDataLen((uint8_t *)outBuffer, curAttrs)), 0)
+                                        << "Table handle should read the same tuple.";
+        }
+
+    }
+
+}
@@ -225,15 +225,16 @@ namespace PeterDBTesting {
             rid.slotNum = seed;
         }
 
+        // indexD bounds the keys of index nodes when they differ from leaves, 0 means D
         void validateTree(std::stringstream &in, unsigned keyCount, unsigned ridCount, unsigned height, unsigned D,
-                          bool allowUnderFit = false) {
+                          bool allowUnderFit = false, unsigned indexD = 0) {
             nlohmann::ordered_json j;
             in >> j;
             LOG(INFO) << j.dump(2);
             TreeNode root = buildTree(j);
             EXPECT_EQ(root.totalKeyCount(), keyCount) << "key count should match.";
             EXPECT_EQ(root.totalRIDCount(), ridCount) << "RID count should match.";
-            checkTree(root, height, D, allowUnderFit, true);
+            checkTree(root, height, D, allowUnderFit, true, indexD ? indexD : D);
             std::string s;
             for (const auto &key: root.projectKeys()) {
                 if (!s.empty()) ASSERT_LE(s, key) << "keys should be sorted ASC.";
@@ -241,19 +242,21 @@ namespace PeterDBTesting {
             }
         }
 
-        void checkTree(TreeNode &root, unsigned height, unsigned D, bool allowUnderFit, bool isTreeRoot = false) {
+        void checkTree(TreeNode &root, unsigned height, unsigned D, bool allowUnderFit, bool isTreeRoot = false,
+                       unsigned indexD = 0) {
+            if (indexD == 0) indexD = D;
             EXPECT_EQ(root.height(), height) << "tree height should match.";
-            EXPECT_LE(root.keyCount(), 2 * D) << "number of keys should be less than or equal to 2D.";
 
             if (root.childrenCount() > 0) {
                 // internal node
+                EXPECT_LE(root.keyCount(), 2 * indexD) << "number of keys should be less than or equal to 2D.";
                 EXPECT_EQ(root.keyCount() + 1, root.childrenCount())
                                     << "number of children should be 1 more than the number of keys.";
 
-                EXPECT_LE(root.childrenCount(), 2 * D + 1)
+                EXPECT_LE(root.childrenCount(), 2 * indexD + 1)
                                     << "number of children should be less than or equal to 2D+1.";
                 if (!isTreeRoot && !allowUnderFit)
-                    EXPECT_GE(root.keyCount(), D) << "number of children should be more than or equal to D.";
+                    EXPECT_GE(root.keyCount(), indexD) << "number of children should be more than or equal to D.";
             } else {
                 // leaf node
                 EXPECT_LE(root.keyCount(), 2 * D) << "number of entries should be less than or equal to 2D.";
@@ -261,7 +264,7 @@ namespace PeterDBTesting {
                     EXPECT_GE(root.keyCount(), D) << "number of entries should be more than or equal to D.";
             }
 
-            for (auto child: root.children)checkTree(child, height - 1, D, allowUnderFit);
+            for (auto child: root.children)checkTree(child, height - 1, D, allowUnderFit, false, indexD);
 
         }
 